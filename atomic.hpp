@@ -0,0 +1,110 @@
+//----------------------------------------------------------------------------
+/// \file  atomic.hpp
+//----------------------------------------------------------------------------
+/// \brief Thin wrappers around GCC atomic builtins.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _REPLOG_ATOMIC_HPP_
+#define _REPLOG_ATOMIC_HPP_
+
+namespace replog {
+namespace atomic {
+
+#ifdef __ATOMIC_RELAXED
+
+template <typename T>
+inline T    load_relaxed (const T& a)       { return __atomic_load_n(&a, __ATOMIC_RELAXED); }
+template <typename T>
+inline T    load_acquire (const T& a)       { return __atomic_load_n(&a, __ATOMIC_ACQUIRE); }
+template <typename T>
+inline void store_relaxed(T& a, T v)        { __atomic_store_n(&a, v, __ATOMIC_RELAXED); }
+template <typename T>
+inline void store_release(T& a, T v)        { __atomic_store_n(&a, v, __ATOMIC_RELEASE); }
+template <typename T>
+inline T    add_relaxed  (T& a, T v)        { return __atomic_fetch_add(&a, v, __ATOMIC_RELAXED); }
+template <typename T>
+inline T    sub_relaxed  (T& a, T v)        { return __atomic_fetch_sub(&a, v, __ATOMIC_RELAXED); }
+/// Subtract \a v ordering prior accesses before it and later ones after
+/// it, e.g. to drop a reference.  @return the previous value.
+template <typename T>
+inline T    sub_acq_rel  (T& a, T v)        { return __atomic_fetch_sub(&a, v, __ATOMIC_ACQ_REL); }
+template <typename T>
+inline bool cas(T& a, T& expected, T v) {
+    return __atomic_compare_exchange_n(&a, &expected, v, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+/// Full (store-load) memory barrier.
+inline void fence()                         { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+
+#else // Pre-4.7 compilers: fall back to __sync builtins and volatile accesses
+
+template <typename T>
+inline T    load_relaxed (const T& a)       { return *(const volatile T*)&a; }
+template <typename T>
+inline T    load_acquire (const T& a)       { T v = *(const volatile T*)&a; __sync_synchronize(); return v; }
+template <typename T>
+inline void store_relaxed(T& a, T v)        { *(volatile T*)&a = v; }
+template <typename T>
+inline void store_release(T& a, T v)        { __sync_synchronize(); *(volatile T*)&a = v; }
+template <typename T>
+inline T    add_relaxed  (T& a, T v)        { return __sync_fetch_and_add(&a, v); }
+template <typename T>
+inline T    sub_relaxed  (T& a, T v)        { return __sync_fetch_and_sub(&a, v); }
+template <typename T>
+inline T    sub_acq_rel  (T& a, T v)        { return __sync_fetch_and_sub(&a, v); }
+template <typename T>
+inline bool cas(T& a, T& expected, T v) {
+    T old = __sync_val_compare_and_swap(&a, expected, v);
+    bool ok = old == expected;
+    expected = old;
+    return ok;
+}
+inline void fence()                         { __sync_synchronize(); }
+
+#endif
+
+/// Hint the CPU that the caller is in a spin-wait loop.
+inline void pause() {
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+/// Raise \a a to \a v if \a v is greater (relaxed ordering).
+template <typename T>
+inline void max_relaxed(T& a, T v) {
+    T old = load_relaxed(a);
+    while (v > old && !cas(a, old, v));
+}
+
+} // namespace atomic
+} // namespace replog
+
+#endif // _REPLOG_ATOMIC_HPP_
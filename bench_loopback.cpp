@@ -0,0 +1,1258 @@
+//----------------------------------------------------------------------------
+/// \file  bench_loopback.cpp
+//----------------------------------------------------------------------------
+/// \brief End-to-end loopback throughput and latency benchmark.
+/// Synthetic writers append time-stamped lines to source files, a sender
+/// tails them and streams msg_append frames over a socketpair, loopback
+/// TCP or shared memory rings to a receiver that applies them to
+/// destination files.  The sender
+/// and receiver run as two threads of one process or as two processes.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/scoped_ptr.hpp>
+#include <replog/proto.hpp>
+#include <replog/stats.hpp>
+#include <replog/trace.hpp>
+#include <replog/shm_transport.hpp>
+#include <replog/session.hpp>
+#include <replog/rate_limit.hpp>
+#include <replog/file_writer.hpp>
+#include <replog/durability.hpp>
+#include <replog/record_index.hpp>
+#include <replog/retention_cache.hpp>
+#include <replog/bulk_sync.hpp>
+#include <replog/tail_follow.hpp>
+#include <replog/send_policy.hpp>
+#include <replog/busy_poll.hpp>
+#include <replog/pipeline.hpp>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+using namespace replog;
+
+namespace {
+
+    const size_t s_ts_len    = 16;          // Hex timestamp prefix of a line
+    const size_t s_max_chunk = 64 * 1024;   // Max payload of one msg_append
+    const size_t s_ring_size = 4 * 1024 * 1024; // Shared memory ring per direction
+    const size_t s_hole_period = 1024 * 1024; // Source data between holes (-H)
+
+    uint64_t now_ns() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+    }
+
+    /// Timestamp prefix of a line for the record index.
+    uint64_t line_timestamp(const char* a_rec, size_t n) {
+        char ts[s_ts_len + 1];
+        n = std::min(n, s_ts_len);
+        memcpy(ts, a_rec, n); ts[n] = '\0';
+        return strtoull(ts, NULL, 16);
+    }
+
+    /// Record the delay of every line of \a a_data since its timestamp.
+    void record_lines(latency_histogram& a_hist, const char* a_data, size_t n, uint64_t a_now) {
+        for (const char* p = a_data, *e = a_data + n; p + s_ts_len <= e; ) {
+            a_hist.record(a_now - line_timestamp(p, s_ts_len));
+            const char* q = (const char*)memchr(p, '\n', e - p);
+            p = q ? q + 1 : e;
+        }
+    }
+
+    double cpu_seconds(int a_who) {
+        rusage ru;
+        getrusage(a_who, &ru);
+        return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec
+             + (ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+    }
+
+    struct config {
+        bool        fork_mode;      // Run receiver in a separate process
+        bool        tcp;            // Use loopback TCP instead of socketpair
+        bool        shm;            // Use shared memory rings instead of sockets
+        int         files;          // Number of source files
+        int         rate;           // Lines per second per file (0 - unlimited)
+        int         line_size;      // Line size including '\n'
+        int         duration;       // Seconds to run writers
+        int         durability;     // group_commit::mode
+        int         sync_bytes;     // Group commit byte window
+        int         sync_usec;      // Group commit time window
+        int         poll_usec;      // Sender sleep when no source file grew
+        int         extent_mb;      // Destination preallocation extent (0 - none)
+        bool        direct;         // Write destination files with O_DIRECT
+        int         index_interval; // Lines per record index entry (0 - no index)
+        bool        mmap;           // Read source files through mmap_reader
+        int         loss;           // Permille of appends dropped by the receiver
+        int         cache_mb;       // Retention cache for resends (0 - none)
+        int         bulk_streams;   // Parallel streams of a bulk sync (0 - tail mode)
+        int         backlog_mb;     // Size of the file seeded in bulk mode
+        int         hole_kb;        // Hole left by writers after every s_hole_period
+        bool        follow;         // Tail the first destination file locally
+        int         rate_mb;        // Global cap of APPEND traffic in MB/s (0 - none)
+        std::vector<int> class_mb;  // Cap of each priority class in MB/s (0 - none)
+        int         send_bytes;     // Coalesce sender output up to this size (0 - off)
+        int         send_usec;      // Hold sender output up to this time (0 - off)
+        int         idle_usec;      // Busy-poll until idle this long (0 - off)
+        std::vector<int> cpus;      // CPUs of the sender and the receiver
+        int         shards;         // Disk threads of a pipelined receiver (0 - none)
+        std::string dir;
+        std::string stats;          // Receiver statistics segment name
+        std::string trace;          // Trace dump file name
+        std::vector<int> weights;   // Scheduler weight of each file
+        std::vector<int> priorities;// Scheduler priority class of each file
+
+        config()
+            : fork_mode(false), tcp(false), shm(false), files(1), rate(0), line_size(100)
+            , duration(5), durability(group_commit::NONE)
+            , sync_bytes(1024 * 1024), sync_usec(1000), poll_usec(0), extent_mb(0), direct(false)
+            , index_interval(0), mmap(false), loss(0), cache_mb(0)
+            , bulk_streams(0), backlog_mb(1024), hole_kb(0), follow(false)
+            , rate_mb(0), send_bytes(0), send_usec(0)
+            , idle_usec(0), shards(0)
+            , dir("/tmp")
+        {}
+
+        int weight(size_t i)   const { return i < weights.size()    ? weights[i]    : 1; }
+        int priority(size_t i) const { return i < priorities.size() ? priorities[i] : 0; }
+    } g_cfg;
+
+    volatile bool g_stop_writers = false;
+    stats_segment g_stats;
+    rate_limiter  g_limiter;
+    retention_cache* g_cache = NULL;
+    uint64_t      g_resends  = 0;
+    send_policy   g_send_policy;
+    busy_poll     g_busy;
+    uint64_t      g_tx_frames = 0;  // Frames and write calls of the sender
+    uint64_t      g_tx_writes = 0;
+    uint64_t      g_srtt      = 0;  // Chunk sizer state of the sender at the end
+    uint32_t      g_chunk_limit = 0;
+
+    /// Results reported by the receiver back to the sender.
+    struct receiver_result {
+        uint64_t bytes;
+        uint64_t frames;
+        uint64_t lines;
+        uint64_t syncs;
+        uint64_t lost;
+        uint64_t hole_bytes;
+        uint64_t elapsed_ns;
+        uint64_t p50, p99, p999, max;
+        uint64_t follow_p50, follow_p99;
+        double   cpu;
+    };
+
+    void write_all(int a_fd, const void* a_buf, size_t n) {
+        const char* p = static_cast<const char*>(a_buf);
+        while (n > 0) {
+            ssize_t m = ::write(a_fd, p, n);
+            if (m < 0) {
+                if (errno == EINTR) continue;
+                throw io_error(errno, "write");
+            }
+            p += m; n -= m;
+        }
+    }
+
+    std::string src_name(int i) {
+        char buf[256];
+        snprintf(buf, sizeof(buf), "%s/replog_bench.%d.%d.src", g_cfg.dir.c_str(), getpid(), i);
+        return buf;
+    }
+
+    //------------------------------------------------------------------------
+    // Transports: a socket and a shared memory channel driven by the same
+    // sender/receiver code through reserve()/commit() and wait()/consume()
+    //------------------------------------------------------------------------
+
+    /// Socket exposing the shm_channel interface.  Frames are written out
+    /// as they are committed.  In busy-polling mode wait() polls the
+    /// socket until it has been idle for busy_poll::idle_ns.
+    class socket_channel: boost::noncopyable {
+        int                   m_fd;
+        basic_io_buffer<4096> m_in;
+        std::vector<char>     m_out;
+        idle_backoff          m_backoff;
+    public:
+        socket_channel() : m_fd(-1), m_out(sizeof(msg_append) + s_max_chunk) {
+            m_in.reallocate(4 * s_max_chunk);
+        }
+        ~socket_channel() { if (m_fd >= 0) ::close(m_fd); }
+
+        int  fd() const { return m_fd; }
+        void open(int a_fd) {
+            m_fd = a_fd;
+            m_backoff.idle_ns(g_busy.idle_ns);
+            g_busy.apply(a_fd);
+        }
+
+        char* reserve(size_t n) {
+            if (m_out.size() < n)
+                m_out.resize(n);
+            return &m_out[0];
+        }
+        void commit(size_t n) { write_all(m_fd, &m_out[0], n); }
+        void shutdown()       { ::shutdown(m_fd, SHUT_WR); }
+
+        size_t wait(char*& a_ptr, size_t n) {
+            while (m_in.size() < n) {
+                if (m_in.available() < s_max_chunk)
+                    m_in.crunch();
+                ssize_t k;
+                if (m_backoff.polling(now_ns())) {
+                    k = ::recv(m_fd, m_in.wr_ptr(), m_in.available(), MSG_DONTWAIT);
+                    if (k < 0 && errno == EAGAIN)
+                        continue;
+                } else
+                    k = ::read(m_fd, m_in.wr_ptr(), m_in.available());
+                if (k < 0 && errno == EINTR)
+                    continue;
+                if (k <= 0)
+                    break;
+                m_in.commit(k);
+                m_backoff.work(now_ns());
+            }
+            a_ptr = m_in.rd_ptr();
+            return m_in.size();
+        }
+        size_t peek(char*& a_ptr) {
+            if (m_in.available() < s_max_chunk)
+                m_in.crunch();
+            ssize_t k = ::recv(m_fd, m_in.wr_ptr(), m_in.available(), MSG_DONTWAIT);
+            if (k > 0)
+                m_in.commit(k);
+            a_ptr = m_in.rd_ptr();
+            return m_in.size();
+        }
+        void consume(size_t n) { m_in.read(n); }
+    };
+
+    /// Both ends of a socketpair or a loopback TCP connection.
+    struct socket_endpoints {
+        int fds[2];
+
+        void open(socket_channel& a_ch, int a_side) {
+            a_ch.open(fds[a_side]);
+            fds[a_side] = -1;
+        }
+        void close() {
+            for (int i = 0; i < 2; ++i)
+                if (fds[i] >= 0) { ::close(fds[i]); fds[i] = -1; }
+        }
+    };
+
+    /// Descriptors of a shared memory channel.
+    struct shm_endpoints {
+        shm_channel_fds fds;
+
+        void open(shm_channel& a_ch, int a_side) {
+            a_ch.open(fds, a_side ? shm_channel::SERVER : shm_channel::CLIENT);
+        }
+        void close() { fds.close(); }
+    };
+
+    template <class Channel>
+    void send(Channel& a_ch, const void* a_buf, size_t n) {
+        memcpy(a_ch.reserve(n), a_buf, n);
+        a_ch.commit(n);
+    }
+
+    /// Sender session over the client end of a socket.  The session owns
+    /// a duplicate of the socket, so that the channel reads the results of
+    /// the receiver once the session is closed.
+    sender_session* open_sender(reactor& a_r, socket_channel& a_ch,
+                                const sender_session::options& a_opts) {
+        int fd = dup(a_ch.fd());
+        if (fd < 0)
+            throw io_error(errno, "dup");
+        return new sender_session(a_r, fd, a_opts);
+    }
+
+    sender_session* open_sender(reactor& a_r, shm_channel& a_ch,
+                                const sender_session::options& a_opts) {
+        return new sender_session(a_r, a_ch, a_opts);
+    }
+
+    /// The reactor made the socket non-blocking, the channel reads it
+    /// blocking.
+    void close_sender(socket_channel& a_ch) {
+        int flags = fcntl(a_ch.fd(), F_GETFL);
+        if (flags < 0 || fcntl(a_ch.fd(), F_SETFL, flags & ~O_NONBLOCK) < 0)
+            throw io_error(errno, "fcntl");
+    }
+    void close_sender(shm_channel&) {}
+
+    template <class Channel>
+    bool recv(Channel& a_ch, void* a_buf, size_t n) {
+        char* p;
+        if (a_ch.wait(p, n) < n)
+            return false;
+        memcpy(a_buf, p, n);
+        a_ch.consume(n);
+        return true;
+    }
+
+    //------------------------------------------------------------------------
+    // Writer: appends time-stamped lines at a fixed rate
+    //------------------------------------------------------------------------
+    void* writer(void* a_arg) {
+        int fd = (int)(long)a_arg;
+        std::string line(g_cfg.line_size, 'x');
+        line[line.size()-1] = '\n';
+        uint64_t interval = g_cfg.rate ? 1000000000ull / g_cfg.rate : 0;
+        uint64_t next     = now_ns();
+        uint64_t size     = 0;
+        uint64_t period   = s_hole_period;
+
+        while (!g_stop_writers) {
+            if (interval) {
+                uint64_t now = now_ns();
+                if (now < next) {
+                    timespec ts = { (time_t)((next - now) / 1000000000ull),
+                                    (long)((next - now) % 1000000000ull) };
+                    nanosleep(&ts, NULL);
+                }
+                next += interval;
+            }
+            char ts[s_ts_len + 1];
+            snprintf(ts, sizeof(ts), "%016llx", (unsigned long long)now_ns());
+            memcpy(&line[0], ts, s_ts_len);
+            write_all(fd, line.data(), line.size());
+            size += line.size();
+            if (g_cfg.hole_kb && size >= period) {
+                // Pad to a block boundary with a filler line and leave a
+                // hole, as a preallocated journal would
+                uint64_t end = (size + s_ts_len + 1 + 4095) & ~4095ull;
+                std::string pad(end - size, 'x');
+                memcpy(&pad[0], ts, s_ts_len);
+                pad[pad.size()-1] = '\n';
+                write_all(fd, pad.data(), pad.size());
+                size = end + g_cfg.hole_kb * 1024ull;
+                if (ftruncate(fd, size) < 0)
+                    throw io_error(errno, "ftruncate");
+                period = size + s_hole_period;
+            }
+        }
+        return NULL;
+    }
+
+    //------------------------------------------------------------------------
+    // Local consumer: tails a destination file through the follow segment
+    // and measures the delay from a source write to its notification
+    //------------------------------------------------------------------------
+    struct follower_state {
+        std::string       segment;
+        std::string       name;
+        latency_histogram hist;
+        volatile bool     stop;
+    };
+
+    void* follower(void* a_arg) {
+        follower_state* st = static_cast<follower_state*>(a_arg);
+        try {
+            tail_follower f;
+            f.open(st->segment, st->name);
+            for (uint64_t off = 0; !st->stop; ) {
+                uint64_t end = f.wait(off, 100);
+                uint64_t now = now_ns();
+                while (off < end) {
+                    const char* p;
+                    size_t n = f.read(off, std::min<uint64_t>(end - off, s_hole_period), p);
+                    // Appends are record aligned, a piece may end mid-line
+                    const char* e = p + n;
+                    const char* q = p;
+                    for (const char* r; q < e; q = r + 1) {
+                        while (q < e && !*q)
+                            ++q;        // Holes of sparse sources
+                        if (!(r = (const char*)memchr(q, '\n', e - q)))
+                            break;
+                        st->hist.record(now - line_timestamp(q, r - q));
+                    }
+                    off += q - p;
+                    if (q == p)
+                        break;          // A line longer than the piece
+                }
+                f.release(off);
+            }
+        } catch (std::exception& e) {
+            fprintf(stderr, "Follower error: %s\n", e.what());
+        }
+        return NULL;
+    }
+
+    //------------------------------------------------------------------------
+    // Receiver: applies msg_append frames to destination files
+    //------------------------------------------------------------------------
+    struct ack_state {
+        uint32_t name_hash;
+        bool     pending;
+        ack_state() : name_hash(0), pending(false) {}
+    };
+
+    /// Sync written files and publish the synced sizes to local consumers.
+    void sync(group_commit& a_gc, follow_segment& a_seg,
+              const std::vector<file_writer*>& a_writers) {
+        if (!a_gc.sync() || !a_seg.is_open() || a_gc.get_mode() == group_commit::NONE)
+            return;
+        for (size_t i = 0; i < a_writers.size(); ++i)
+            if (a_writers[i])
+                a_seg.on_sync(i, a_writers[i]->size());
+    }
+
+    template <class Channel>
+    void receiver(Channel& a_ch) {
+        std::vector<file_writer*> writers;
+        std::vector<record_index*> indexes;
+        latency_histogram local_hist;
+        local_hist.reset();
+        latency_histogram& hist = g_stats.is_open() ? g_stats.data()->apply_latency : local_hist;
+        std::vector<stats_file*> files;
+        receiver_result   res;
+        memset(&res, 0, sizeof(res));
+        uint64_t start = 0;
+        double   cpu0 = cpu_seconds(RUSAGE_THREAD);
+        std::allocator<char> alloc;
+        std::vector<ack_state> acks;
+        std::vector<uint32_t>  pending;
+        std::vector<bool>      recovering;
+        unsigned int           seed = getpid();
+        group_commit gc(group_commit::mode(g_cfg.durability),
+                        g_cfg.sync_usec * 1000ull, g_cfg.sync_bytes);
+        bool ack_now = false;
+        follow_segment seg;
+        follower_state fst;
+        pthread_t      fth;
+        fst.stop = false;
+        fst.hist.reset();
+        if (g_cfg.follow) {
+            char buf[64];
+            snprintf(buf, sizeof(buf), "/replog_bench.%d.follow", getpid());
+            fst.segment = buf;
+            seg.create(fst.segment, g_cfg.files);
+        }
+
+        for (;;) {
+            char*  p;
+            // Commit and acknowledge applied data before blocking for more
+            if ((!pending.empty() || gc.dirty()) &&
+                (ack_now || a_ch.peek(p) < sizeof(msg_base_header))) {
+                // Acks wait for the sync, periodic syncs wait for the window
+                if (gc.get_mode() == group_commit::BEFORE_ACK || gc.due(now_ns()))
+                    sync(gc, seg, writers);
+                for (size_t i = 0; i < pending.size(); ++i) {
+                    ack_state& a = acks[pending[i]];
+                    writers[pending[i]]->flush();
+                    msg_ack::create(pending[i], a.name_hash, gc.durable(pending[i]),
+                                    buffer_allocator(a_ch.reserve(sizeof(msg_ack))));
+                    a_ch.commit(sizeof(msg_ack));
+                    a.pending = false;
+                }
+                pending.clear();
+                ack_now = false;
+            }
+            size_t avail = a_ch.wait(p, sizeof(msg_base_header));
+            if (avail < sizeof(msg_base_header))
+                break;
+            size_t need = msg_base_header::decode_header(p, avail)->header_size();
+            if (avail < need && (avail = a_ch.wait(p, need)) < need)
+                throw io_error("Truncated frame");
+            msg_base_header* h = reinterpret_cast<msg_base_header*>(p);
+            if (h->cmd() == msg_base_header::APPEND) {
+                need += static_cast<msg_append*>(h)->chunk_size();
+                if (avail < need && (avail = a_ch.wait(p, need)) < need)
+                    throw io_error("Truncated frame");
+                h = reinterpret_cast<msg_base_header*>(p);
+            }
+
+            switch (h->cmd()) {
+                case msg_base_header::GET_SIZE: {
+                    msg_get_size* m = static_cast<msg_get_size*>(h);
+                    std::string name = g_cfg.dir + '/' + m->name() + ".dst";
+                    if (writers.size() <= m->id())
+                        writers.resize(m->id() + 1, NULL);
+                    file_writer*& w = writers[m->id()];
+                    if (!w)
+                        w = new file_writer;
+                    file_writer::options opts;
+                    opts.extent = (uint64_t)g_cfg.extent_mb * 1024 * 1024;
+                    opts.direct = g_cfg.direct;
+                    w->open(name, opts, true);
+                    if (g_cfg.index_interval) {
+                        indexes.resize(writers.size(), NULL);
+                        record_index*& idx = indexes[m->id()];
+                        if (!idx)
+                            idx = new record_index(g_cfg.index_interval, '\n', line_timestamp);
+                        idx->open(name);
+                    }
+                    if (g_stats.is_open()) {
+                        files.resize(writers.size());
+                        files[m->id()] = g_stats.add_file(m->id(), m->name_hash(), m->name());
+                    }
+                    msg_get_size_response* r = msg_get_size_response::create(
+                        m->id(), m->name_hash(), w->fd(), 0, alloc);
+                    send(a_ch, r, r->header_size());
+                    alloc.deallocate(reinterpret_cast<char*>(r), r->header_size());
+                    if (seg.is_open()) {
+                        seg.add_file(m->id(), name, 0);
+                        if (m->id() == 0) {
+                            fst.name = name;
+                            pthread_create(&fth, NULL, follower, &fst);
+                        }
+                    }
+                    if (!start)
+                        start = now_ns();
+                    break;
+                }
+                case msg_base_header::APPEND: {
+                    msg_append* m    = static_cast<msg_append*>(h);
+                    const char* data = p + m->header_size();
+                    uint32_t    len  = m->chunk_size();
+                    REPLOG_TRACE(TRACE_DECODE, m->id(), m->src_offset(), len);
+                    file_writer* w   = writers[m->id()];
+                    if (recovering.size() <= m->id())
+                        recovering.resize(m->id() + 1);
+                    bool in_seq = m->src_offset() == w->size();
+                    if (!in_seq ||
+                        (g_cfg.loss && rand_r(&seed) % 1000 < g_cfg.loss)) {
+                        // Drop the chunk and ask for a resend once per loss
+                        if (in_seq || !recovering[m->id()]) {
+                            msg_resend_request::create(m->id(), m->name_hash(), w->size(),
+                                buffer_allocator(a_ch.reserve(sizeof(msg_resend_request))));
+                            a_ch.commit(sizeof(msg_resend_request));
+                        }
+                        recovering[m->id()] = true;
+                        res.lost++;
+                        break;
+                    }
+                    recovering[m->id()] = false;
+                    w->write(data, len, m->src_offset());
+                    if (g_cfg.index_interval)
+                        indexes[m->id()]->append(data, len, m->src_offset());
+                    REPLOG_TRACE(TRACE_WRITE, m->id(), m->src_offset(), len);
+                    if (seg.is_open()) {
+                        w->flush();
+                        seg.on_apply(m->id(), w->size());
+                    }
+                    uint64_t now = now_ns();
+                    gc.on_write(m->id(), w, m->src_offset() + len, len, now);
+                    if (gc.due(now)) {
+                        sync(gc, seg, writers);
+                        REPLOG_TRACE(TRACE_FSYNC, m->id(), m->src_offset(), len);
+                        // Release acks held back by the sync
+                        ack_now = gc.get_mode() == group_commit::BEFORE_ACK;
+                    }
+                    record_lines(hist, data, len, now);
+                    if (g_stats.is_open())
+                        g_stats.on_ack(files[m->id()], m->src_offset() + len);
+                    if (acks.size() <= m->id())
+                        acks.resize(m->id() + 1);
+                    ack_state& a = acks[m->id()];
+                    a.name_hash = m->name_hash();
+                    if (!a.pending) {
+                        a.pending = true;
+                        pending.push_back(m->id());
+                    }
+                    res.bytes += len;
+                    res.frames++;
+                    break;
+                }
+                case msg_base_header::HOLE: {
+                    msg_hole*    m   = static_cast<msg_hole*>(h);
+                    file_writer* w   = writers[m->id()];
+                    if (recovering.size() <= m->id())
+                        recovering.resize(m->id() + 1);
+                    if (m->src_offset() != w->size()) {
+                        if (!recovering[m->id()]) {
+                            msg_resend_request::create(m->id(), m->name_hash(), w->size(),
+                                buffer_allocator(a_ch.reserve(sizeof(msg_resend_request))));
+                            a_ch.commit(sizeof(msg_resend_request));
+                        }
+                        recovering[m->id()] = true;
+                        res.lost++;
+                        break;
+                    }
+                    recovering[m->id()] = false;
+                    w->hole(m->src_offset(), m->length());
+                    if (g_cfg.index_interval)
+                        indexes[m->id()]->skip(m->src_offset(), m->length());
+                    if (seg.is_open())
+                        seg.on_apply(m->id(), w->size());
+                    gc.on_write(m->id(), w, w->size(), 0, now_ns());
+                    if (acks.size() <= m->id())
+                        acks.resize(m->id() + 1);
+                    ack_state& a = acks[m->id()];
+                    a.name_hash = m->name_hash();
+                    if (!a.pending) {
+                        a.pending = true;
+                        pending.push_back(m->id());
+                    }
+                    res.hole_bytes += m->length();
+                    res.frames++;
+                    break;
+                }
+                default:
+                    throw io_error("Unexpected command:", (char)h->cmd());
+            }
+            if (g_stats.is_open())
+                g_stats.on_frame(stats_layout::RX, h->cmd(), need);
+            a_ch.consume(need);
+        }
+
+        sync(gc, seg, writers);
+        if (seg.is_open()) {
+            fst.stop = true;
+            seg.remove_file(0);
+            pthread_join(fth, NULL);
+            seg.close();
+            res.follow_p50 = fst.hist.percentile(50);
+            res.follow_p99 = fst.hist.percentile(99);
+        }
+        res.syncs      = gc.syncs();
+        res.elapsed_ns = now_ns() - start;
+        res.lines      = hist.total();
+        res.p50        = hist.percentile(50);
+        res.p99        = hist.percentile(99);
+        res.p999       = hist.percentile(99.9);
+        res.max        = hist.max();
+        res.cpu        = cpu_seconds(RUSAGE_THREAD) - cpu0;
+        send(a_ch, &res, sizeof(res));
+
+        for (size_t i = 0; i < writers.size(); ++i)
+            delete writers[i];
+        for (size_t i = 0; i < indexes.size(); ++i)
+            delete indexes[i];
+    }
+
+    /// Disk stage of the pipelined receiver: applies records to the files of
+    /// its shard and records the latency of the lines written.
+    struct bench_disk: public file_apply_handler {
+        latency_histogram& hist;
+
+        bench_disk(const options& a_opts, latency_histogram& a_hist, int a_shards)
+            : file_apply_handler(a_shards, a_opts), hist(a_hist)
+        {}
+
+        bool apply(int a_shard, const disk_record& a_rec, disk_completion& a_done) {
+            file_apply_handler::apply(a_shard, a_rec, a_done);
+            if (a_rec.cmd == msg_base_header::APPEND)
+                record_lines(hist, a_rec.data, a_rec.length, now_ns());
+            return true;
+        }
+    };
+
+    /// Network stage of the pipelined receiver, dropping chunks at the
+    /// configured loss rate.
+    class bench_network: public pipeline_receiver {
+        unsigned int m_seed;
+    public:
+        bench_network(int a_fd, apply_pipeline& a_pipe)
+            : pipeline_receiver(a_fd, a_pipe, g_cfg.files), m_seed(getpid())
+        {}
+    protected:
+        bool drop(const msg_base_header& a_hdr) {
+            return g_cfg.loss && a_hdr.cmd() == msg_base_header::APPEND &&
+                   rand_r(&m_seed) % 1000 < g_cfg.loss;
+        }
+    };
+
+    /// Receiver with the network and disk stages in separate threads: the
+    /// network thread reads the socket into pipeline blocks, decodes frames
+    /// in place and hands their payloads to the disk threads by reference.
+    void pipelined_receiver(socket_channel& a_ch) {
+        latency_histogram hist;
+        hist.reset();
+        receiver_result res;
+        memset(&res, 0, sizeof(res));
+        uint64_t start = now_ns();
+        double   cpu0  = cpu_seconds(RUSAGE_THREAD);
+
+        file_apply_handler::options fo;
+        fo.root              = g_cfg.dir;
+        fo.suffix            = ".dst";
+        fo.writer.extent     = (uint64_t)g_cfg.extent_mb * 1024 * 1024;
+        fo.writer.direct     = g_cfg.direct;
+        fo.durability        = group_commit::mode(g_cfg.durability);
+        fo.sync_window       = g_cfg.sync_usec * 1000ull;
+        fo.sync_window_bytes = g_cfg.sync_bytes;
+        fo.stats             = g_stats.is_open() ? &g_stats : NULL;
+        bench_disk     disk(fo, hist, g_cfg.shards);
+        apply_pipeline::options opts;
+        opts.shards = g_cfg.shards;
+        apply_pipeline pipe(disk, opts);
+        pipe.start();
+        bench_network  net(a_ch.fd(), pipe);
+        net.stats(fo.stats);
+        net.run();
+        pipe.stop();
+        disk.sync();
+
+        res.bytes      = net.bytes();
+        res.hole_bytes = net.hole_bytes();
+        res.frames     = net.frames();
+        res.lost       = net.dropped();
+        res.syncs      = disk.syncs();
+        res.elapsed_ns = now_ns() - start;
+        res.lines      = hist.total();
+        res.p50        = hist.percentile(50);
+        res.p99        = hist.percentile(99);
+        res.p999       = hist.percentile(99.9);
+        res.max        = hist.max();
+        res.cpu        = cpu_seconds(RUSAGE_THREAD) - cpu0;
+        send(a_ch, &res, sizeof(res));
+        fprintf(stderr, "pipeline: %llu network stalls, %zu blocks\n",
+                (unsigned long long)pipe.stalls(), pipe.blocks());
+    }
+
+    /// The pipeline reads sockets only.
+    void receive(shm_channel& a_ch) { receiver(a_ch); }
+    void receive(socket_channel& a_ch) {
+        if (g_cfg.shards)
+            pipelined_receiver(a_ch);
+        else
+            receiver(a_ch);
+    }
+
+    /// Pin I/O thread \a a_idx (0 - sender, 1 - receiver) if configured.
+    void pin_io_thread(size_t a_idx) {
+        if (a_idx < g_cfg.cpus.size() && g_cfg.cpus[a_idx] >= 0)
+            busy_poll::pin(g_cfg.cpus[a_idx]);
+    }
+
+    template <class Channel>
+    void* receiver_thread(void* a_arg) {
+        try {
+            pin_io_thread(1);
+            receive(*static_cast<Channel*>(a_arg));
+        } catch (std::exception& e) {
+            fprintf(stderr, "Receiver error: %s\n", e.what());
+            exit(1);
+        }
+        return NULL;
+    }
+
+    //------------------------------------------------------------------------
+    // Sender: a sender_session tailing the source files
+    //------------------------------------------------------------------------
+    struct source {
+        std::string name;
+        int         fd;
+    };
+
+    template <class Channel>
+    double sender(Channel& a_ch, std::vector<source>& a_src, pthread_t* a_writers) {
+        pin_io_thread(0);
+        double cpu0 = cpu_seconds(RUSAGE_THREAD);
+        // Idle files are checked every poll_usec, without it the reactor
+        // spins and checks them at every tick
+        reactor r(std::max(g_cfg.poll_usec, 10) * 1000ull);
+        r.busy_polling(g_busy);
+
+        sender_session::options opts;
+        opts.root          = g_cfg.dir;
+        opts.max_chunk     = s_max_chunk;
+        opts.mmap          = g_cfg.mmap;
+        opts.holes         = g_cfg.hole_kb > 0;
+        opts.poll_interval = g_cfg.poll_usec * 1000ull;
+        opts.cache         = g_cache;
+        opts.limiter       = &g_limiter;
+        boost::scoped_ptr<sender_session> s(open_sender(r, a_ch, opts));
+        s->policy(g_send_policy);
+        for (size_t i = 0; i < a_src.size(); ++i)
+            // Names are relative to the directory of the receiver
+            s->add_file(a_src[i].name.substr(g_cfg.dir.size() + 1),
+                        g_cfg.priority(i), g_cfg.weight(i));
+        r.add(*s);
+        s->start();
+
+        for (size_t i = 0; i < a_src.size(); ++i)
+            pthread_create(&a_writers[i], NULL, writer, (void*)(long)a_src[i].fd);
+
+        int      timeout  = g_cfg.poll_usec ? -1 : 0;
+        uint64_t deadline = now_ns() + g_cfg.duration * 1000000000ull;
+        while (s->is_open() && now_ns() < deadline)
+            r.run_once(timeout);
+        g_stop_writers = true;
+        for (size_t i = 0; i < a_src.size(); ++i)
+            pthread_join(a_writers[i], NULL);
+        // Wait until the receiver applied everything
+        s->finish();
+        while (s->is_open())
+            r.run_once(timeout);
+        if (!s->complete())
+            throw io_error("Sender failed: ", s->reason().c_str());
+
+        g_resends     = s->resends();
+        g_tx_frames   = s->frames_sent();
+        g_tx_writes   = s->writes();
+        g_srtt        = s->sizer().srtt();
+        g_chunk_limit = s->sizer().chunk_size();
+        close_sender(a_ch);
+        a_ch.shutdown();
+        return cpu_seconds(RUSAGE_THREAD) - cpu0;
+    }
+
+    void connect_pair(int a_fds[2]) {
+        if (!g_cfg.tcp) {
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, a_fds) < 0)
+                throw io_error(errno, "socketpair");
+            return;
+        }
+        int ls = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family      = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        if (ls < 0 || bind(ls, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(ls, 1) < 0
+         || getsockname(ls, (sockaddr*)&addr, &len) < 0)
+            throw io_error(errno, "listen");
+        a_fds[0] = socket(AF_INET, SOCK_STREAM, 0);
+        if (connect(a_fds[0], (sockaddr*)&addr, sizeof(addr)) < 0)
+            throw io_error(errno, "connect");
+        if ((a_fds[1] = accept(ls, NULL, NULL)) < 0)
+            throw io_error(errno, "accept");
+        ::close(ls);
+        int on = 1;
+        setsockopt(a_fds[0], IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        setsockopt(a_fds[1], IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    }
+
+    /// Run the receiver over the server end of a channel, in a thread or
+    /// in a child process, and the sender over its client end.
+    template <class Channel, class Endpoints>
+    double run(Endpoints& a_ep, std::vector<source>& a_src, receiver_result& a_res) {
+        Channel   client, server;
+        pid_t     pid = 0;
+        pthread_t rcv_thread;
+        if (g_cfg.fork_mode) {
+            if ((pid = fork()) < 0)
+                throw io_error(errno, "fork");
+            if (pid == 0) {
+                a_ep.open(server, 1);
+                a_ep.close();
+                receiver_thread<Channel>(&server);
+                if (!g_cfg.trace.empty())
+                    tracer::dump(g_cfg.trace + ".receiver");
+                _exit(0);
+            }
+        } else {
+            a_ep.open(server, 1);
+            pthread_create(&rcv_thread, NULL, receiver_thread<Channel>, &server);
+        }
+        a_ep.open(client, 0);
+        a_ep.close();
+
+        std::vector<pthread_t> writers(a_src.size());
+        double snd_cpu = sender(client, a_src, &writers[0]);
+
+        if (!recv(client, &a_res, sizeof(a_res)))
+            throw io_error("Failed to read receiver results");
+        if (g_cfg.fork_mode)
+            waitpid(pid, NULL, 0);
+        else
+            pthread_join(rcv_thread, NULL);
+        return snd_cpu;
+    }
+
+    //------------------------------------------------------------------------
+    // Bulk sync: a backlog file split into ranges sent over parallel
+    // connections, one sender and one receiver thread per range
+    //------------------------------------------------------------------------
+    struct bulk_stream {
+        byte_range range;
+        int        src_fd;
+        int        fds[2];
+        bulk_sink* sink;
+        pthread_t  threads[2];
+    };
+
+    void* bulk_sender(void* a_arg) {
+        bulk_stream* b = static_cast<bulk_stream*>(a_arg);
+        try {
+            socket_channel ch;
+            ch.open(b->fds[0]);
+            for (uint64_t off = b->range.begin; off < b->range.end; ) {
+                size_t  n   = std::min<uint64_t>(s_max_chunk, b->range.end - off);
+                char*   hdr = ch.reserve(sizeof(msg_append) + n);
+                ssize_t k   = pread(b->src_fd, hdr + sizeof(msg_append), n, off);
+                if (k <= 0)
+                    throw io_error(k < 0 ? errno : EIO, "pread");
+                msg_append::create(0, 0, 0, off, k, buffer_allocator(hdr));
+                ch.commit(sizeof(msg_append) + k);
+                off += k;
+            }
+            ch.shutdown();
+        } catch (std::exception& e) {
+            fprintf(stderr, "Bulk sender error: %s\n", e.what());
+            exit(1);
+        }
+        return NULL;
+    }
+
+    void* bulk_receiver(void* a_arg) {
+        bulk_stream* b = static_cast<bulk_stream*>(a_arg);
+        try {
+            socket_channel ch;
+            ch.open(b->fds[1]);
+            for (;;) {
+                char*  p;
+                size_t avail = ch.wait(p, sizeof(msg_append));
+                if (avail < sizeof(msg_append))
+                    break;
+                msg_append* m    = static_cast<msg_append*>(
+                                        msg_base_header::decode_header(p, avail));
+                size_t      need = m->header_size() + m->chunk_size();
+                if (avail < need && (avail = ch.wait(p, need)) < need)
+                    throw io_error("Truncated frame");
+                m = reinterpret_cast<msg_append*>(p);
+                b->sink->write(p + m->header_size(), m->chunk_size(), m->src_offset());
+                ch.consume(need);
+            }
+        } catch (std::exception& e) {
+            fprintf(stderr, "Bulk receiver error: %s\n", e.what());
+            exit(1);
+        }
+        return NULL;
+    }
+
+    void run_bulk() {
+        std::string name = src_name(0);
+        uint64_t    size = (uint64_t)g_cfg.backlog_mb * 1024 * 1024;
+        int fd = ::open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+            throw io_error(errno, name.c_str());
+        std::string line(g_cfg.line_size, 'x');
+        line[line.size()-1] = '\n';
+        std::string buf;
+        while (buf.size() < 1024 * 1024)
+            buf += line;
+        for (uint64_t off = 0; off < size; off += buf.size())
+            write_all(fd, buf.data(), std::min<uint64_t>(buf.size(), size - off));
+
+        bulk_sink sink;
+        sink.open(name + ".dst", size);
+        std::vector<byte_range>  ranges = split_ranges(0, size, g_cfg.bulk_streams);
+        std::vector<bulk_stream> streams(ranges.size());
+        double   cpu0  = cpu_seconds(RUSAGE_SELF);
+        uint64_t start = now_ns();
+        for (size_t i = 0; i < streams.size(); ++i) {
+            bulk_stream& b = streams[i];
+            b.range  = ranges[i];
+            b.src_fd = fd;
+            b.sink   = &sink;
+            connect_pair(b.fds);
+            pthread_create(&b.threads[0], NULL, bulk_receiver, &b);
+            pthread_create(&b.threads[1], NULL, bulk_sender,   &b);
+        }
+        for (size_t i = 0; i < streams.size(); ++i) {
+            pthread_join(streams[i].threads[1], NULL);
+            pthread_join(streams[i].threads[0], NULL);
+        }
+        double secs = (now_ns() - start) / 1e9;
+        double cpu  = cpu_seconds(RUSAGE_SELF) - cpu0;
+        bool   done = sink.complete();
+        sink.close();
+
+        printf("%-20s %14s\n",    "mode",          "bulk");
+        printf("%-20s %14s\n",    "transport",     g_cfg.tcp ? "tcp" : "socketpair");
+        printf("%-20s %14zu\n",   "streams",       streams.size());
+        printf("%-20s %14llu\n",  "bytes",         (unsigned long long)size);
+        printf("%-20s %14s\n",    "complete",      done ? "yes" : "no");
+        printf("%-20s %14.2f\n",  "MB/s",          secs > 0 ? size / 1e6 / secs : 0);
+        printf("%-20s %14.3f\n",  "cpu_s/GB",      size ? cpu / (size / 1e9) : 0);
+
+        ::close(fd);
+        unlink(name.c_str());
+        unlink((name + ".dst").c_str());
+        unlink(sink.part_name().c_str());
+        if (!done)
+            throw io_error("Bulk transfer incomplete");
+    }
+
+    std::vector<int> parse_list(const char* a_str) {
+        std::vector<int> v;
+        for (char* e; *a_str; a_str = *e ? e + 1 : e)
+            v.push_back(strtol(a_str, &e, 10));
+        return v;
+    }
+
+    void usage(const char* a_prog) {
+        fprintf(stderr,
+            "Usage: %s [-F] [-T] [-M] [-f Files] [-r LinesPerSec] [-l LineSize]\n"
+            "          [-d Seconds] [-y Durability] [-s SyncBytes] [-W SyncUsec]\n"
+            "          [-p PollUsec] [-o Dir] [-S Name]\n"
+            "          [-t TraceFile] [-w W1,W2,...] [-c C1,C2,...] [-P ExtentMB] [-D]\n"
+            "          [-I Lines] [-m] [-L Permille] [-C CacheMB] [-H HoleKB] [-N]\n"
+            "          [-R MBps] [-Q C0MBps,C1MBps,...] [-B Bytes] [-U Usec]\n"
+            "          [-Z IdleUsec] [-A SenderCpu,ReceiverCpu] [-G Shards]\n"
+            "   or: %s -K Streams [-b BacklogMB] [-T] [-l LineSize] [-o Dir]\n\n"
+            "  -F  Run receiver in a separate process (default: thread)\n"
+            "  -T  Use loopback TCP (default: socketpair)\n"
+            "  -M  Use shared memory rings (default: socketpair)\n"
+            "  -f  Number of source files (default: 1)\n"
+            "  -r  Lines per second per file, 0 - unlimited (default: 0)\n"
+            "  -l  Line size in bytes (default: 100)\n"
+            "  -d  Duration of the run in seconds (default: 5)\n"
+            "  -y  Durability: none, periodic - sync by window, ack - ack after sync\n"
+            "      (default: none, periodic if -s or -W is given)\n"
+            "  -s  Group commit window in bytes, 1 - every append (default: 1048576)\n"
+            "  -W  Group commit window in usec (default: 1000)\n"
+            "  -p  Sender check of idle files for growth every Usec (default: 0 - spin)\n"
+            "  -o  Directory for source and destination files (default: /tmp)\n"
+            "  -S  Publish receiver statistics in shared memory segment Name\n"
+            "  -t  Trace chunk lifecycle and dump it to TraceFile (see replog_trace)\n"
+            "  -w  Scheduler weights of files in the order of creation (default: 1)\n"
+            "  -c  Priority classes of files, 0 - highest (default: 0)\n"
+            "  -P  Preallocate destination files in extents of ExtentMB (default: 0 - off)\n"
+            "  -D  Write destination files with O_DIRECT\n"
+            "  -I  Index destination files with an entry every Lines lines (default: 0 - off)\n"
+            "  -m  Read source files through memory mapped windows (default: pread)\n"
+            "  -L  Drop Permille of appends at the receiver, which asks to resend them\n"
+            "  -C  Serve resends from a cache of CacheMB of sent chunks (default: 0 - off)\n"
+            "  -K  Bulk sync a backlog file over Streams parallel connections\n"
+            "  -b  Size of the backlog file in bulk mode (default: 1024)\n"
+            "  -H  Make sources sparse with a hole of HoleKB after every 1MB of lines\n"
+            "  -N  Tail the first destination file through a follow segment and\n"
+            "      report the delay from a source write to the consumer's wakeup\n"
+            "  -R  Cap APPEND traffic at MBps, keeping a quarter of the burst for\n"
+            "      class 0 (default: 0 - unlimited)\n"
+            "  -Q  Cap each priority class at MBps (default: 0 - unlimited)\n"
+            "  -B  Coalesce output of the sender into writes of Bytes\n"
+            "      (default: 0 - write every frame)\n"
+            "  -U  Hold output of the sender up to Usec, with -B at most\n"
+            "      Usec before a partial batch is written (default: 1000)\n"
+            "  -Z  Busy-poll sockets (and sources, with -p) until idle for IdleUsec,\n"
+            "      then block (default: 0 - always block)\n"
+            "  -A  Pin the sender and the receiver threads to CPUs, -1 - don't pin\n"
+            "  -G  Receive in a network thread handing frames to Shards disk threads\n"
+            "      by file (sockets only, not with -I or -N)\n",
+            a_prog, a_prog);
+        exit(1);
+    }
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    int         opt;
+    bool        sync_opt = false;
+    std::string durability;
+    while ((opt = getopt(argc, argv, "FTMDmNR:Q:B:U:Z:A:G:f:r:l:d:y:s:W:p:o:S:t:w:c:P:I:L:C:K:b:H:h")) != -1)
+        switch (opt) {
+            case 'F': g_cfg.fork_mode  = true;                          break;
+            case 'T': g_cfg.tcp        = true;                          break;
+            case 'M': g_cfg.shm        = true;                          break;
+            case 'D': g_cfg.direct     = true;                          break;
+            case 'm': g_cfg.mmap       = true;                          break;
+            case 'f': g_cfg.files      = std::max(1, atoi(optarg));     break;
+            case 'r': g_cfg.rate       = atoi(optarg);                  break;
+            case 'l': g_cfg.line_size  = std::max((int)s_ts_len + 1, atoi(optarg)); break;
+            case 'd': g_cfg.duration   = atoi(optarg);                  break;
+            case 'y': durability       = optarg;                        break;
+            case 's': g_cfg.sync_bytes = atoi(optarg); sync_opt = true; break;
+            case 'W': g_cfg.sync_usec  = atoi(optarg); sync_opt = true; break;
+            case 'p': g_cfg.poll_usec  = atoi(optarg);                  break;
+            case 'o': g_cfg.dir        = optarg;                        break;
+            case 'S': g_cfg.stats      = optarg;                        break;
+            case 't': g_cfg.trace      = optarg;                        break;
+            case 'w': g_cfg.weights    = parse_list(optarg);            break;
+            case 'c': g_cfg.priorities = parse_list(optarg);            break;
+            case 'P': g_cfg.extent_mb  = std::max(0, atoi(optarg));     break;
+            case 'I': g_cfg.index_interval = std::max(0, atoi(optarg)); break;
+            case 'L': g_cfg.loss       = std::max(0, atoi(optarg));     break;
+            case 'C': g_cfg.cache_mb   = std::max(0, atoi(optarg));     break;
+            case 'K': g_cfg.bulk_streams = std::max(1, atoi(optarg));   break;
+            case 'b': g_cfg.backlog_mb = std::max(1, atoi(optarg));     break;
+            case 'H': g_cfg.hole_kb    = std::max(0, atoi(optarg));     break;
+            case 'N': g_cfg.follow     = true;                          break;
+            case 'R': g_cfg.rate_mb    = std::max(0, atoi(optarg));     break;
+            case 'Q': g_cfg.class_mb   = parse_list(optarg);            break;
+            case 'B': g_cfg.send_bytes = std::max(0, atoi(optarg));     break;
+            case 'U': g_cfg.send_usec  = std::max(0, atoi(optarg));     break;
+            case 'Z': g_cfg.idle_usec  = std::max(0, atoi(optarg));     break;
+            case 'A': g_cfg.cpus       = parse_list(optarg);            break;
+            case 'G': g_cfg.shards     = std::max(0, atoi(optarg));     break;
+            default:  usage(argv[0]);
+        }
+
+    for (size_t i = 0; i < g_cfg.priorities.size(); ++i)
+        if (g_cfg.priorities[i] < 0 || g_cfg.priorities[i] >= stream_scheduler::s_classes)
+            usage(argv[0]);
+    for (size_t i = 0; i < g_cfg.weights.size(); ++i)
+        if (g_cfg.weights[i] <= 0)
+            usage(argv[0]);
+    if (durability == "ack")
+        g_cfg.durability = group_commit::BEFORE_ACK;
+    else if (durability == "periodic" || (durability.empty() && sync_opt))
+        g_cfg.durability = group_commit::PERIODIC;
+    else if (!durability.empty() && durability != "none")
+        usage(argv[0]);
+    if (g_cfg.sync_bytes <= 0 || g_cfg.sync_usec < 0)
+        usage(argv[0]);
+    if (g_cfg.class_mb.size() > (size_t)rate_limiter::s_classes)
+        usage(argv[0]);
+    if (g_cfg.shards && (g_cfg.shm || g_cfg.index_interval || g_cfg.follow))
+        usage(argv[0]);
+    if (g_cfg.rate_mb) {
+        g_limiter.global(g_cfg.rate_mb * 1000000ull);
+        g_limiter.reserve(g_limiter.global().burst() / 4);
+    }
+    for (size_t i = 0; i < g_cfg.class_mb.size(); ++i)
+        if (g_cfg.class_mb[i] > 0)
+            g_limiter.file_class(i, g_cfg.class_mb[i] * 1000000ull);
+
+    if (g_cfg.send_bytes)
+        g_send_policy = send_policy::bytes(g_cfg.send_bytes,
+                                           (g_cfg.send_usec ? g_cfg.send_usec : 1000) * 1000ull);
+    else if (g_cfg.send_usec)
+        g_send_policy = send_policy::delay(g_cfg.send_usec * 1000ull);
+
+    if (g_cfg.idle_usec)
+        g_busy = busy_poll::spin(g_cfg.idle_usec * 1000ull, -1, g_cfg.idle_usec);
+
+    signal(SIGPIPE, SIG_IGN);
+
+    try {
+        if (g_cfg.bulk_streams) {
+            run_bulk();
+            return 0;
+        }
+
+        std::vector<source> src(g_cfg.files);
+        for (int i = 0; i < g_cfg.files; ++i) {
+            src[i].name   = src_name(i);
+            src[i].fd     = ::open(src[i].name.c_str(),
+                                   O_RDWR | O_CREAT | O_TRUNC | O_APPEND, 0644);
+            if (src[i].fd < 0)
+                throw io_error(errno, src[i].name.c_str());
+        }
+
+        if (g_cfg.cache_mb)
+            g_cache = new retention_cache((size_t)g_cfg.cache_mb * 1024 * 1024);
+
+        if (!g_cfg.trace.empty()) {
+            tracer::tsc_hz();
+            tracer::enable(true);
+        }
+        if (!g_cfg.stats.empty())
+            g_stats.create(g_cfg.stats, "receiver", g_cfg.files);
+
+        receiver_result res;
+        double          snd_cpu;
+        if (g_cfg.shm) {
+            shm_endpoints ep;
+            shm_channel::create(s_ring_size, ep.fds);
+            snd_cpu = run<shm_channel>(ep, src, res);
+        } else {
+            socket_endpoints ep;
+            connect_pair(ep.fds);
+            snd_cpu = run<socket_channel>(ep, src, res);
+        }
+
+        if (!g_cfg.trace.empty())
+            tracer::dump(g_cfg.trace);
+
+        double secs = res.elapsed_ns / 1e9;
+        double gb   = res.bytes / 1e9;
+        printf("%-20s %14s\n",    "mode",          g_cfg.fork_mode ? "process" : "thread");
+        printf("%-20s %14s\n",    "transport",
+               g_cfg.shm ? "shm" : g_cfg.tcp ? "tcp" : "socketpair");
+        printf("%-20s %14llu\n",  "bytes",         (unsigned long long)res.bytes);
+        printf("%-20s %14llu\n",  "frames",        (unsigned long long)res.frames);
+        printf("%-20s %14llu\n",  "lines",         (unsigned long long)res.lines);
+        printf("%-20s %14llu\n",  "syncs",         (unsigned long long)res.syncs);
+        printf("%-20s %14llu\n",  "lost_frames",   (unsigned long long)res.lost);
+        printf("%-20s %14llu\n",  "resends",       (unsigned long long)g_resends);
+        if (g_tx_writes) {
+            printf("%-20s %14llu\n", "tx_frames",  (unsigned long long)g_tx_frames);
+            printf("%-20s %14llu\n", "tx_writes",  (unsigned long long)g_tx_writes);
+            printf("%-20s %14.2f\n", "frames_per_write", (double)g_tx_frames / g_tx_writes);
+        }
+        if (g_cfg.hole_kb) {
+            uint64_t disk = 0;
+            for (size_t i = 0; i < src.size(); ++i) {
+                struct stat st;
+                if (stat((src[i].name + ".dst").c_str(), &st) == 0)
+                    disk += st.st_blocks * 512ull;
+            }
+            printf("%-20s %14llu\n", "hole_bytes",     (unsigned long long)res.hole_bytes);
+            printf("%-20s %14llu\n", "dst_disk_bytes", (unsigned long long)disk);
+        }
+        if (g_cache) {
+            printf("%-20s %14llu\n", "cache_hit_bytes",  (unsigned long long)g_cache->hit_bytes());
+            printf("%-20s %14llu\n", "cache_miss_bytes", (unsigned long long)g_cache->miss_bytes());
+        }
+        printf("%-20s %14.2f\n",  "MB/s",          secs > 0 ? res.bytes / 1e6 / secs : 0);
+        printf("%-20s %14.0f\n",  "frames/s",      secs > 0 ? res.frames / secs : 0);
+        printf("%-20s %14.3f\n",  "sender_cpu_s/GB",   gb > 0 ? snd_cpu / gb : 0);
+        printf("%-20s %14.3f\n",  "receiver_cpu_s/GB", gb > 0 ? res.cpu / gb : 0);
+        printf("%-20s %14.3f\n",  "p50_us",        res.p50  / 1e3);
+        printf("%-20s %14.3f\n",  "p99_us",        res.p99  / 1e3);
+        printf("%-20s %14.3f\n",  "p999_us",       res.p999 / 1e3);
+        printf("%-20s %14.3f\n",  "max_us",        res.max  / 1e3);
+        if (g_cfg.follow) {
+            printf("%-20s %14.3f\n", "follow_p50_us", res.follow_p50 / 1e3);
+            printf("%-20s %14.3f\n", "follow_p99_us", res.follow_p99 / 1e3);
+        }
+        printf("%-20s %14.3f\n",  "srtt_us",       g_srtt / 1e3);
+        printf("%-20s %14u\n",    "chunk_limit",   g_chunk_limit);
+
+        for (size_t i = 0; i < src.size(); ++i) {
+            ::close(src[i].fd);
+            unlink(src[i].name.c_str());
+            unlink((src[i].name + ".dst").c_str());
+            unlink((src[i].name + ".dst.idx").c_str());
+        }
+        delete g_cache;
+    } catch (std::exception& e) {
+        fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,527 @@
+//----------------------------------------------------------------------------
+/// \file  bench_replog.cpp
+//----------------------------------------------------------------------------
+/// \brief Microbenchmarks of the core REPLOG primitives.
+/// Each benchmark prints one line: name, iterations, ns/op and bytes/s
+/// (0 when not applicable), so the output can be diffed between commits.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <replog/proto.hpp>
+#include <replog/schema.hpp>
+#include <replog/proto_v2.hpp>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+using namespace replog;
+
+namespace {
+
+    uint64_t now_ns() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+    }
+
+    /// Prevent the compiler from optimizing away computation of \a a.
+    template <typename T>
+    inline void do_not_optimize(const T& a) {
+        asm volatile("" : : "r"(&a) : "memory");
+    }
+
+    struct bench_config {
+        const char* filter;
+        int         samples;
+        uint64_t    min_time_ns;
+
+        bench_config() : filter(NULL), samples(5), min_time_ns(50000000ull) {}
+    } g_cfg;
+
+    /// Run \a a_fun for a calibrated number of iterations and report the
+    /// median of g_cfg.samples measurements.  \a a_bytes is the number
+    /// of bytes processed by one operation.
+    template <class F>
+    void run(const std::string& a_name, F a_fun, size_t a_bytes = 0) {
+        if (g_cfg.filter && a_name.find(g_cfg.filter) == std::string::npos)
+            return;
+
+        // Calibrate the iteration count so that a sample takes min_time_ns
+        uint64_t iters = 1;
+        for (;;) {
+            uint64_t t = now_ns();
+            a_fun(iters);
+            t = now_ns() - t;
+            if (t >= g_cfg.min_time_ns / 4 || iters >= (1ull << 40))
+                break;
+            iters *= t < g_cfg.min_time_ns / 64 ? 8 : 2;
+        }
+        iters *= 4;
+
+        std::vector<double> ns(g_cfg.samples);
+        for (int i = 0; i < g_cfg.samples; ++i) {
+            uint64_t t = now_ns();
+            a_fun(iters);
+            ns[i] = double(now_ns() - t) / iters;
+        }
+        std::sort(ns.begin(), ns.end());
+        double median = ns[ns.size() / 2];
+        double rate   = a_bytes && median > 0 ? a_bytes * 1e9 / median : 0;
+        printf("%-36s %12llu %10.2f %14.0f\n",
+            a_name.c_str(), (unsigned long long)iters, median, rate);
+        fflush(stdout);
+    }
+
+    std::string name(const char* a_prefix, size_t a_n) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%s/%lu", a_prefix, (unsigned long)a_n);
+        return buf;
+    }
+
+    //------------------------------------------------------------------------
+    // raw_char<N> and endian conversion
+    //------------------------------------------------------------------------
+    template <typename T>
+    struct raw_char_encode {
+        void operator()(uint64_t n) const {
+            raw_char<sizeof(T)> rc;
+            for (uint64_t i = 0; i < n; ++i) {
+                rc = (T)i;
+                do_not_optimize(rc);
+            }
+        }
+    };
+
+    template <typename T>
+    struct raw_char_decode {
+        void operator()(uint64_t n) const {
+            raw_char<sizeof(T)> rc((T)0x0102030405060708ull);
+            T sum = 0;
+            for (uint64_t i = 0; i < n; ++i) {
+                do_not_optimize(rc);
+                sum += (T)rc;
+            }
+            do_not_optimize(sum);
+        }
+    };
+
+    template <typename T>
+    struct store_be_bench {
+        void operator()(uint64_t n) const {
+            char buf[sizeof(T)];
+            for (uint64_t i = 0; i < n; ++i) {
+                store_be(buf, (T)i);
+                do_not_optimize(buf);
+            }
+        }
+    };
+
+    template <typename T>
+    struct cast_be_bench {
+        void operator()(uint64_t n) const {
+            char buf[sizeof(T)];
+            store_be(buf, (T)0x0102030405060708ull);
+            T sum = 0;
+            for (uint64_t i = 0; i < n; ++i) {
+                T v;
+                do_not_optimize(buf);
+                cast_be(buf, v);
+                sum += v;
+            }
+            do_not_optimize(sum);
+        }
+    };
+
+    //------------------------------------------------------------------------
+    // Message decoding and construction
+    //------------------------------------------------------------------------
+    struct decode_header_bench {
+        char*  buf;
+        size_t len;
+        decode_header_bench(msg_base_header* a_msg)
+            : buf(reinterpret_cast<char*>(a_msg)), len(a_msg->header_size()) {}
+
+        void operator()(uint64_t n) const {
+            for (uint64_t i = 0; i < n; ++i) {
+                do_not_optimize(buf);
+                msg_base_header* p = msg_base_header::decode_header(buf, len);
+                do_not_optimize(p);
+            }
+        }
+    };
+
+    /// Bump-pointer allocator over a fixed arena that wraps around when
+    /// exhausted.  Models allocation of messages directly in an I/O buffer.
+    class arena_allocator {
+        char*   m_arena;
+        size_t  m_size;
+        size_t* m_used;
+    public:
+        arena_allocator(char* a_arena, size_t a_size, size_t* a_used)
+            : m_arena(a_arena), m_size(a_size), m_used(a_used) {}
+
+        char* allocate(size_t n) {
+            n = (n + 7) & ~(size_t)7;
+            if (*m_used + n > m_size)
+                *m_used = 0;
+            char* p = m_arena + *m_used;
+            *m_used += n;
+            return p;
+        }
+        void deallocate(char*, size_t) {}
+    };
+
+    template <class Alloc>
+    struct create_append_bench {
+        Alloc alloc;
+        create_append_bench(const Alloc& a) : alloc(a) {}
+
+        void operator()(uint64_t n) const {
+            Alloc a(alloc);
+            for (uint64_t i = 0; i < n; ++i) {
+                msg_append* p = msg_append::create(1, 123456789u, 2, i, 1024u, a);
+                do_not_optimize(p);
+                a.deallocate(reinterpret_cast<char*>(p), sizeof(msg_append));
+            }
+        }
+    };
+
+    template <class Alloc>
+    struct create_get_size_bench {
+        Alloc       alloc;
+        std::string filename;
+        create_get_size_bench(const Alloc& a, const std::string& a_filename)
+            : alloc(a), filename(a_filename) {}
+
+        void operator()(uint64_t n) const {
+            Alloc a(alloc);
+            size_t size = sizeof(msg_get_size) + filename.size() + 1;
+            for (uint64_t i = 0; i < n; ++i) {
+                msg_get_size* p = msg_get_size::create(1, filename, i, 2, 0644, a);
+                do_not_optimize(p);
+                a.deallocate(reinterpret_cast<char*>(p), size);
+            }
+        }
+    };
+
+    /// Encode an append header with a schema-generated message.
+    template <class Msg>
+    struct schema_append_bench {
+        void operator()(uint64_t n) const {
+            char buf[Msg::s_size];
+            for (uint64_t i = 0; i < n; ++i) {
+                Msg* p = Msg::init(buf, 1, 123456789u);
+                p->template set<schema::tag::dst_fd>(2);
+                p->template set<schema::tag::src_offset>(i);
+                p->template set<schema::tag::chunk_size>(1024u);
+                do_not_optimize(buf);
+            }
+        }
+    };
+
+    /// Validate and decode an append header with a schema-generated message.
+    template <class Msg>
+    struct schema_decode_bench {
+        void operator()(uint64_t n) const {
+            char buf[Msg::s_size];
+            Msg* m = Msg::init(buf, 1, 123456789u);
+            m->template set<schema::tag::src_offset>(1234567890ull);
+            m->template set<schema::tag::chunk_size>(1024u);
+            uint64_t sum = 0;
+            for (uint64_t i = 0; i < n; ++i) {
+                do_not_optimize(buf);
+                Msg* p = Msg::cast(buf, sizeof(buf));
+                sum += p->template get<schema::tag::src_offset>()
+                     + p->template get<schema::tag::chunk_size>();
+            }
+            do_not_optimize(sum);
+        }
+    };
+
+    /// Decode the same fields from a hand-written message for comparison.
+    struct append_decode_bench {
+        void operator()(uint64_t n) const {
+            char   buf[sizeof(msg_append)];
+            size_t used = 0;
+            msg_append::create(1, 123456789u, 2, 1234567890ull, 1024u,
+                               arena_allocator(buf, sizeof(buf), &used));
+            uint64_t sum = 0;
+            for (uint64_t i = 0; i < n; ++i) {
+                do_not_optimize(buf);
+                msg_append* p = static_cast<msg_append*>(
+                    msg_base_header::decode_header(buf, sizeof(buf)));
+                sum += p->src_offset() + p->chunk_size();
+            }
+            do_not_optimize(sum);
+        }
+    };
+
+    //------------------------------------------------------------------------
+    // Version 2 wire format
+    //------------------------------------------------------------------------
+    struct varint_decode_bench {
+        std::vector<char> buf;
+        size_t            count;
+        bool              batch;
+        varint_decode_bench(uint64_t a_value, bool a_batch)
+            : buf(4 * s_max_varint_size + 16), count(4), batch(a_batch)
+        {
+            char* p = &buf[0];
+            for (size_t i = 0; i < count; ++i)
+                put_varint(p, a_value);
+        }
+
+        void operator()(uint64_t n) const {
+            uint64_t v[4], sum = 0;
+            const char* end = &buf[0] + buf.size();
+            for (uint64_t i = 0; i < n; ++i) {
+                const char* p = &buf[0];
+                do_not_optimize(p);
+                if (batch)
+                    get_varints(p, end, v, 4);
+                else
+                    for (int j = 0; j < 4; ++j)
+                        get_varint(p, end, v[j]);
+                sum += v[0] + v[1] + v[2] + v[3];
+            }
+            do_not_optimize(sum);
+        }
+    };
+
+    struct append_v2_encode_bench {
+        void operator()(uint64_t n) const {
+            codec_v2 codec;
+            char     buf[codec_v2::s_max_append_header];
+            for (uint64_t i = 0; i < n; ++i) {
+                size_t len = codec.encode_append(buf, 1, i * 100, 100);
+                do_not_optimize(buf);
+                do_not_optimize(len);
+            }
+        }
+    };
+
+    struct append_v2_decode_bench {
+        void operator()(uint64_t n) const {
+            // A batch of 64 consecutive 100-byte appends decoded repeatedly
+            codec_v2          enc;
+            std::vector<char> buf(64 * (codec_v2::s_max_append_header + 100));
+            char* p = &buf[0];
+            for (int i = 0; i < 64; ++i) {
+                p += enc.encode_append(p, 1, i * 100, 100);
+                p += 100;
+            }
+            size_t   size = p - &buf[0];
+            uint64_t sum  = 0;
+            frame_v2 f = frame_v2();
+            for (uint64_t i = 0; i < n; i += 64) {
+                codec_v2 dec;
+                for (const char* q = &buf[0], *e = q + size; q < e; q += f.size) {
+                    dec.decode(q, e - q, f);
+                    sum += f.src_offset;
+                }
+            }
+            do_not_optimize(sum);
+        }
+    };
+
+    //------------------------------------------------------------------------
+    // Hashing
+    //------------------------------------------------------------------------
+    struct strhash_bench {
+        std::string key;
+        strhash_bench(size_t a_len) : key(a_len, 'x') {
+            for (size_t i = 0; i < a_len; ++i)
+                key[i] = 'a' + i % 26;
+        }
+        void operator()(uint64_t n) const {
+            uint32_t sum = 0;
+            for (uint64_t i = 0; i < n; ++i) {
+                do_not_optimize(key);
+                sum += strhash(key);
+            }
+            do_not_optimize(sum);
+        }
+    };
+
+    //------------------------------------------------------------------------
+    // basic_io_buffer
+    //------------------------------------------------------------------------
+    struct io_buffer_rw_bench {
+        size_t chunk;
+        io_buffer_rw_bench(size_t a_chunk) : chunk(a_chunk) {}
+
+        void operator()(uint64_t n) const {
+            basic_io_buffer<64*1024> buf;
+            std::vector<char> src(chunk, 'x');
+            for (uint64_t i = 0; i < n; ++i) {
+                if (buf.available() <= chunk)
+                    buf.crunch();
+                buf.write(&src[0], chunk);
+                char* p = buf.read(chunk);
+                do_not_optimize(p);
+            }
+        }
+    };
+
+    struct io_buffer_crunch_bench {
+        size_t pending;
+        io_buffer_crunch_bench(size_t a_pending) : pending(a_pending) {}
+
+        void operator()(uint64_t n) const {
+            basic_io_buffer<64*1024> buf;
+            std::vector<char> src(pending + 1, 'x');
+            for (uint64_t i = 0; i < n; ++i) {
+                buf.write(&src[0], pending + 1);
+                buf.read(1);
+                buf.crunch();
+                buf.read(pending);
+                do_not_optimize(buf);
+            }
+        }
+    };
+
+    struct io_buffer_reallocate_bench {
+        size_t size;
+        io_buffer_reallocate_bench(size_t a_size) : size(a_size) {}
+
+        void operator()(uint64_t n) const {
+            basic_io_buffer<4096> buf;
+            for (uint64_t i = 0; i < n; ++i) {
+                buf.commit(64);
+                buf.reallocate(size);
+                do_not_optimize(buf);
+                buf.reset();
+            }
+        }
+    };
+
+    void usage(const char* a_prog) {
+        fprintf(stderr,
+            "Usage: %s [-n Samples] [-t MinSampleMsec] [Filter]\n"
+            "  Filter  - run only benchmarks whose name contains the string\n",
+            a_prog);
+        exit(1);
+    }
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    int opt;
+    while ((opt = getopt(argc, argv, "n:t:h")) != -1)
+        switch (opt) {
+            case 'n': g_cfg.samples     = std::max(1, atoi(optarg));       break;
+            case 't': g_cfg.min_time_ns = atoi(optarg) * 1000000ull;       break;
+            default:  usage(argv[0]);
+        }
+    if (optind < argc)
+        g_cfg.filter = argv[optind];
+
+    printf("# %-34s %12s %10s %14s\n", "benchmark", "iterations", "ns/op", "bytes/s");
+
+    run("raw_char_encode/2", raw_char_encode<uint16_t>(), 2);
+    run("raw_char_encode/4", raw_char_encode<uint32_t>(), 4);
+    run("raw_char_encode/8", raw_char_encode<uint64_t>(), 8);
+    run("raw_char_decode/2", raw_char_decode<uint16_t>(), 2);
+    run("raw_char_decode/4", raw_char_decode<uint32_t>(), 4);
+    run("raw_char_decode/8", raw_char_decode<uint64_t>(), 8);
+    run("store_be/2",        store_be_bench<uint16_t>(),  2);
+    run("store_be/4",        store_be_bench<uint32_t>(),  4);
+    run("store_be/8",        store_be_bench<uint64_t>(),  8);
+    run("cast_be/2",         cast_be_bench<uint16_t>(),   2);
+    run("cast_be/4",         cast_be_bench<uint32_t>(),   4);
+    run("cast_be/8",         cast_be_bench<uint64_t>(),   8);
+
+    {
+        std::allocator<char> a;
+        const std::string filename("/var/log/replog/test.log");
+        msg_base_header* msgs[] = {
+            msg_get_size::create(1, filename, 1234567890ull, 2, 0644, a),
+            msg_get_size_response::create(1, 123456789u, 2, 1234567890ull, a),
+            msg_append::create(1, 123456789u, 2, 1234567890ull, 1024u, a),
+            msg_resend_request::create(1, 123456789u, 1234567890ull, a),
+            msg_error_response::create(1, 123456789u, msg_base_header::APPEND,
+                                       "error", a)
+        };
+        const char* names[] = {
+            "decode_header/get_size",
+            "decode_header/get_size_response",
+            "decode_header/append",
+            "decode_header/resend_request",
+            "decode_header/error_response"
+        };
+        for (size_t i = 0; i < sizeof(msgs)/sizeof(msgs[0]); ++i) {
+            run(names[i], decode_header_bench(msgs[i]), msgs[i]->header_size());
+            a.deallocate(reinterpret_cast<char*>(msgs[i]), msgs[i]->header_size());
+        }
+
+        static char arena[64*1024];
+        size_t used = 0;
+        arena_allocator arena_alloc(arena, sizeof(arena), &used);
+        run("create/append/std_allocator",
+            create_append_bench<std::allocator<char> >(a), sizeof(msg_append));
+        run("create/append/arena",
+            create_append_bench<arena_allocator>(arena_alloc), sizeof(msg_append));
+        run("create/append/schema",
+            schema_append_bench<schema::wire::append>(), sizeof(msg_append));
+        run("decode/append/hand_written",
+            append_decode_bench(), sizeof(msg_append));
+        run("decode/append/schema",
+            schema_decode_bench<schema::wire::append>(), sizeof(msg_append));
+        run("create/get_size/std_allocator",
+            create_get_size_bench<std::allocator<char> >(a, filename));
+        run("create/get_size/arena",
+            create_get_size_bench<arena_allocator>(arena_alloc, filename));
+    }
+
+    run("varint_decode/1byte",          varint_decode_bench(100,  false), 4);
+    run("varint_decode/1byte/batch",    varint_decode_bench(100,  true),  4);
+    run("varint_decode/5byte",          varint_decode_bench(1ull << 30, false), 20);
+    run("varint_decode/5byte/batch",    varint_decode_bench(1ull << 30, true),  20);
+    run("varint_decode/10byte",         varint_decode_bench(~0ull, false), 40);
+    run("create/append/v2",             append_v2_encode_bench());
+    run("decode/append/v2",             append_v2_decode_bench(), 105);
+
+    const size_t key_lengths[] = {8, 16, 32, 64, 128, 256};
+    for (size_t i = 0; i < sizeof(key_lengths)/sizeof(key_lengths[0]); ++i)
+        run(name("strhash", key_lengths[i]), strhash_bench(key_lengths[i]), key_lengths[i]);
+
+    const size_t chunks[] = {64, 512, 4096};
+    for (size_t i = 0; i < sizeof(chunks)/sizeof(chunks[0]); ++i)
+        run(name("io_buffer/write_read", chunks[i]), io_buffer_rw_bench(chunks[i]), chunks[i]);
+    for (size_t i = 0; i < sizeof(chunks)/sizeof(chunks[0]); ++i)
+        run(name("io_buffer/crunch", chunks[i]), io_buffer_crunch_bench(chunks[i]), chunks[i]);
+    run("io_buffer/reallocate/64K", io_buffer_reallocate_bench(64*1024));
+    run("io_buffer/reallocate/1M",  io_buffer_reallocate_bench(1024*1024));
+
+    return 0;
+}
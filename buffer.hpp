@@ -37,8 +37,10 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <boost/assert.hpp>
 #include <boost/noncopyable.hpp>
 #include <algorithm>
+#include <new>
 #include <string.h>
 #include <replog/error.hpp>
+#include <replog/memory_budget.hpp>
 
 namespace replog {
 
@@ -46,7 +48,8 @@ namespace replog {
  * \brief Basic buffer providing stack space for data up to N bytes and
  *        heap space when reallocation of space over N bytes is needed.
  * A typical use of the buffer is for I/O operations that require tracking
- * of produced and consumed space. 
+ * of produced and consumed space.  Heap space is accounted in the
+ * process-wide memory_budget.
  */
 template <int N>
 class basic_io_buffer: boost::noncopyable {
@@ -65,27 +68,41 @@ public:
 
     /// Reset internal storage to initial state.
     void reset() {
-        if (m_begin != m_data)
+        if (m_begin != m_data) {
             delete [] m_begin;
+            memory_budget::instance().release(max_size());
+        }
         m_rd_ptr = m_wr_ptr = m_begin = m_data;
         m_end    = m_data + N;
     }
         
     /// Ensure there's enough space in the buffer to hold \a n bytes.
-    void reallocate(size_t n) {
+    /// Throws if the memory budget is exhausted.
+    void reallocate(size_t n) throw(io_error) {
         if (n < max_size())
             return;
+        memory_budget::instance().acquire(n);
+        char* p;
+        try {
+            p = new char[n];
+        } catch (std::bad_alloc&) {
+            memory_budget::instance().release(n);
+            throw io_error("Out of memory for buffer:", n);
+        }
         size_t rd_offset = m_rd_ptr - m_begin;
         size_t wr_offset = m_wr_ptr - m_begin;
+        size_t old_size  = max_size();
         char*  old_begin = m_begin;
-        m_begin = new char[n];
+        m_begin = p;
         m_end   = m_begin + n;
         if (wr_offset > 0)
             memcpy(m_begin, old_begin, wr_offset);
         m_rd_ptr = m_begin + rd_offset;
         m_wr_ptr = m_begin + wr_offset;
-        if (old_begin != m_data)
+        if (old_begin != m_data) {
             delete [] old_begin;
+            memory_budget::instance().release(old_size);
+        }
     }
 
     size_t      max_size() const { return m_end    - m_begin;  }
@@ -0,0 +1,163 @@
+//----------------------------------------------------------------------------
+/// \file  bulk_sync.cpp
+//----------------------------------------------------------------------------
+/// \brief Parallel range-split transfer of large backlog files.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#include <replog/bulk_sync.hpp>
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
+namespace replog {
+
+std::vector<byte_range>
+split_ranges(uint64_t a_begin, uint64_t a_end, int a_parts, uint64_t a_align)
+{
+    std::vector<byte_range> v;
+    if (a_begin >= a_end)
+        return v;
+    if (a_parts < 1)
+        a_parts = 1;
+    if (!a_align)
+        a_align = 1;
+    uint64_t step = (a_end - a_begin + a_parts - 1) / a_parts;
+    step = std::max(a_align, (step + a_align - 1) / a_align * a_align);
+    for (uint64_t b = a_begin; b < a_end; ) {
+        // Align inner boundaries to file offsets, not to a_begin
+        uint64_t e = std::min(a_end, (b + step) / a_align * a_align);
+        v.push_back(byte_range(b, e));
+        b = e;
+    }
+    return v;
+}
+
+bulk_sink::bulk_sink() : m_fd(-1), m_size(0)
+{
+    pthread_mutex_init(&m_lock, NULL);
+}
+
+bulk_sink::~bulk_sink()
+{
+    try { close(); } catch (...) {}
+    pthread_mutex_destroy(&m_lock);
+}
+
+void bulk_sink::open(const std::string& a_name, uint64_t a_size, bool a_resume)
+    throw(io_error)
+{
+    close();
+    m_name = a_name;
+    m_size = a_size;
+    m_done.clear();
+    std::string part = part_name();
+    if ((m_fd = ::open(part.c_str(), O_WRONLY | O_CREAT | (a_resume ? 0 : O_TRUNC), 0644)) < 0)
+        throw io_error(errno, part.c_str());
+
+    struct stat st;
+    int err = 0;
+    if (fstat(m_fd, &st) < 0)
+        err = errno;
+    else if ((uint64_t)st.st_size > a_size) {
+        if (ftruncate(m_fd, 0) < 0)     // Left by a transfer of another size
+            err = errno;
+    } else if (st.st_size)
+        m_done.insert(0, st.st_size);
+    // Contiguous space for all streams, without changing the visible size
+    if (!err && a_size && fallocate(m_fd, FALLOC_FL_KEEP_SIZE, 0, a_size) < 0 &&
+        errno != EOPNOTSUPP)
+        err = errno;
+    if (err) {
+        ::close(m_fd);
+        m_fd = -1;
+        throw io_error(err, part.c_str());
+    }
+}
+
+uint64_t bulk_sink::write(const char* a_data, size_t n, uint64_t a_offset) throw(io_error)
+{
+    if (a_offset + n > m_size)
+        throw io_error("Bulk write past the end of file (offset=", a_offset,
+                       ", size=", m_size, ")");
+    for (size_t done = 0; done < n; ) {
+        ssize_t k = pwrite(m_fd, a_data + done, n - done, a_offset + done);
+        if (k < 0) {
+            if (errno == EINTR)
+                continue;
+            throw io_error(errno, "pwrite");
+        }
+        done += k;
+    }
+    pthread_mutex_lock(&m_lock);
+    m_done.insert(a_offset, a_offset + n);
+    uint64_t prefix = m_done.contiguous();
+    pthread_mutex_unlock(&m_lock);
+    return prefix;
+}
+
+uint64_t bulk_sink::contiguous() const
+{
+    pthread_mutex_lock(&m_lock);
+    uint64_t n = m_done.contiguous();
+    pthread_mutex_unlock(&m_lock);
+    return n;
+}
+
+uint64_t bulk_sink::received() const
+{
+    pthread_mutex_lock(&m_lock);
+    uint64_t n = m_done.bytes();
+    pthread_mutex_unlock(&m_lock);
+    return n;
+}
+
+void bulk_sink::sync() throw(io_error)
+{
+    if (m_fd >= 0 && fdatasync(m_fd) < 0)
+        throw io_error(errno, "fdatasync");
+}
+
+void bulk_sink::close() throw(io_error)
+{
+    if (m_fd < 0)
+        return;
+    uint64_t prefix = contiguous();
+    int rc  = ftruncate(m_fd, prefix);
+    int err = errno;
+    ::close(m_fd);
+    m_fd = -1;
+    if (rc < 0)
+        throw io_error(err, "ftruncate");
+    if (prefix == m_size && ::rename(part_name().c_str(), m_name.c_str()) < 0)
+        throw io_error(errno, "rename");
+}
+
+} // namespace replog
@@ -0,0 +1,121 @@
+//----------------------------------------------------------------------------
+/// \file  bulk_sync.hpp
+//----------------------------------------------------------------------------
+/// \brief Parallel range-split transfer of large backlog files.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _REPLOG_BULK_SYNC_HPP_
+#define _REPLOG_BULK_SYNC_HPP_
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <pthread.h>
+#include <boost/noncopyable.hpp>
+#include <replog/error.hpp>
+#include <replog/interval_set.hpp>
+
+namespace replog {
+
+/// Range [begin, end) of a file.
+struct byte_range {
+    uint64_t begin;
+    uint64_t end;
+
+    byte_range(uint64_t a_begin = 0, uint64_t a_end = 0) : begin(a_begin), end(a_end) {}
+    uint64_t size() const { return end - begin; }
+};
+
+/// Split [\a a_begin, \a a_end) into at most \a a_parts ranges of nearly
+/// equal size with inner boundaries at multiples of \a a_align.
+std::vector<byte_range>
+split_ranges(uint64_t a_begin, uint64_t a_end, int a_parts, uint64_t a_align = 1024 * 1024);
+
+/**
+ * \brief Destination of a bulk transfer sent as parallel streams.
+ * Seeding a new receiver with a large backlog over a single in-order
+ * stream is limited by what one connection and one thread can carry.
+ * In bulk mode the sender splits the file with split_ranges() and sends
+ * each range over its own connection from its own thread.  msg_append
+ * frames of all the streams are written here at their src_offset.
+ *
+ * write() is called concurrently by the receiving threads.  Completed
+ * ranges are tracked in an interval_set.  The size that the receiver
+ * acknowledges and that the destination reports is contiguous(), the
+ * complete prefix of the file, so the file grows for the protocol only
+ * when the data below is complete.
+ *
+ * Streams land in a part file (name + ".part") renamed to the file once
+ * the transfer is complete, so the file never shows the holes between
+ * ranges still in flight.  close() of an incomplete transfer truncates
+ * the part file to contiguous(), and a transfer reopened in resume mode
+ * keeps that prefix and needs only the rest.
+ */
+class bulk_sink: boost::noncopyable {
+public:
+    bulk_sink();
+    ~bulk_sink();
+
+    /// Start the transfer of \a a_size bytes to file \a a_name, with
+    /// space preallocated.  With \a a_resume the prefix left in the part
+    /// file by an interrupted transfer is kept and counted as received,
+    /// otherwise the part file is discarded.
+    void open(const std::string& a_name, uint64_t a_size, bool a_resume = false)
+        throw(io_error);
+
+    /// Write \a n bytes at \a a_offset.  Thread-safe.
+    /// @return size of the complete prefix of the file.
+    uint64_t write(const char* a_data, size_t n, uint64_t a_offset) throw(io_error);
+
+    /// Flush written data to disk.
+    void sync() throw(io_error);
+
+    /// Close the file: a complete one replaces \a name(), the part file of
+    /// an incomplete one is truncated to contiguous().
+    void close() throw(io_error);
+
+    uint64_t contiguous() const;
+    /// Bytes received, complete or not.
+    uint64_t received()   const;
+    uint64_t size()       const { return m_size; }
+    bool     complete()   const { return contiguous() == m_size; }
+    bool     is_open()    const { return m_fd >= 0; }
+    const std::string& name() const { return m_name; }
+    std::string part_name()   const { return m_name + ".part"; }
+
+private:
+    std::string             m_name;
+    int                     m_fd;
+    uint64_t                m_size;
+    interval_set            m_done;
+    mutable pthread_mutex_t m_lock;
+};
+
+} // namespace replog
+
+#endif // _REPLOG_BULK_SYNC_HPP_
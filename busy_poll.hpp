@@ -0,0 +1,133 @@
+//----------------------------------------------------------------------------
+/// \file  busy_poll.hpp
+//----------------------------------------------------------------------------
+/// \brief Busy-polling mode of I/O threads: CPU pinning, socket busy
+/// polling and adaptive back-off to blocking when idle.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _REPLOG_BUSY_POLL_HPP_
+#define _REPLOG_BUSY_POLL_HPP_
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <replog/error.hpp>
+
+#ifndef SO_BUSY_POLL
+#define SO_BUSY_POLL 46
+#endif
+
+namespace replog {
+
+/**
+ * \brief Options of the busy-polling mode.
+ * A thread sleeping in epoll_wait() or read() pays for a wakeup and a
+ * context switch on every event, several microseconds at best.  In
+ * busy-polling mode an I/O thread keeps polling without blocking while
+ * work arrives, and goes back to blocking only after idle_ns without
+ * any, so a dedicated core gets the lowest latency while an idle host
+ * doesn't lose a core to spinning.  Pinning the thread to a core keeps
+ * its caches warm and its wakeups off other cores.
+ *
+ * SO_BUSY_POLL additionally lets the kernel poll the device queue of a
+ * socket on blocking reads.  Raising it above net.core.busy_read needs
+ * CAP_NET_ADMIN, so it's applied on a best-effort basis.
+ */
+struct busy_poll {
+    int      cpu;           ///< CPU to pin the I/O thread to, -1 - don't pin
+    uint64_t idle_ns;       ///< Poll this long after the last event, 0 - off
+    int      socket_usec;   ///< SO_BUSY_POLL of sockets, 0 - leave as is
+
+    busy_poll() : cpu(-1), idle_ns(0), socket_usec(0) {}
+
+    /// Blocking waits only (the default).
+    static busy_poll disabled() { return busy_poll(); }
+
+    /// Poll for \a a_idle_ns after the last event on CPU \a a_cpu.
+    static busy_poll spin(uint64_t a_idle_ns, int a_cpu = -1, int a_socket_usec = 0) {
+        busy_poll p;
+        p.cpu         = a_cpu;
+        p.idle_ns     = a_idle_ns;
+        p.socket_usec = a_socket_usec;
+        return p;
+    }
+
+    bool enabled() const { return idle_ns != 0; }
+
+    /// Pin the calling thread to CPU \a a_cpu.
+    static void pin(int a_cpu) throw(io_error) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(a_cpu, &set);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err)
+            throw io_error(err, "pthread_setaffinity_np");
+    }
+
+    /// Set SO_BUSY_POLL of socket \a a_fd if configured.
+    /// @return false if the kernel refused it.
+    bool apply(int a_fd) const {
+        if (!socket_usec)
+            return true;
+        return setsockopt(a_fd, SOL_SOCKET, SO_BUSY_POLL,
+                          &socket_usec, sizeof(socket_usec)) == 0;
+    }
+};
+
+/**
+ * \brief Decides whether an I/O thread may block.
+ * Call work() whenever the thread finds something to do; polling()
+ * stays true for idle_ns after the last call.
+ */
+class idle_backoff {
+    uint64_t m_idle_ns;
+    uint64_t m_last_work;
+public:
+    explicit idle_backoff(uint64_t a_idle_ns = 0) : m_idle_ns(a_idle_ns), m_last_work(0) {}
+
+    void     idle_ns(uint64_t a_idle_ns) { m_idle_ns = a_idle_ns; }
+    uint64_t idle_ns() const { return m_idle_ns; }
+
+    /// Record work done at time \a a_now (ns).
+    void work(uint64_t a_now) { m_last_work = a_now; }
+
+    /// True if the thread is to keep polling at time \a a_now.
+    bool polling(uint64_t a_now) const { return remaining(a_now) != 0; }
+
+    /// Nanoseconds left at time \a a_now until the thread may block.
+    uint64_t remaining(uint64_t a_now) const {
+        return m_idle_ns && a_now - m_last_work < m_idle_ns
+             ? m_idle_ns - (a_now - m_last_work) : 0;
+    }
+};
+
+} // namespace replog
+
+#endif // _REPLOG_BUSY_POLL_HPP_
@@ -0,0 +1,196 @@
+//----------------------------------------------------------------------------
+/// \file  chunk_sizer.hpp
+//----------------------------------------------------------------------------
+/// \brief Adaptive sizing of APPEND chunks from measured round-trip time
+/// and delivery rate.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _REPLOG_CHUNK_SIZER_HPP_
+#define _REPLOG_CHUNK_SIZER_HPP_
+
+#include <deque>
+#include <algorithm>
+#include <vector>
+#include <stdint.h>
+#include <replog/error.hpp>
+
+namespace replog {
+
+/**
+ * \brief Per-session upper bound of APPEND chunk sizes.
+ * The sender reports every chunk it sends with on_send() and every
+ * msg_ack with on_ack().  From these the sizer keeps a smoothed RTT and a
+ * delivery rate.  Acks are sent after the data is applied, so the
+ * delivery rate is the lesser of the network throughput and the
+ * receiver's apply rate.  The chunk limit is a fraction of the
+ * bandwidth-delay product, so that several chunks are in flight at once.
+ *
+ * At light load the rate is small and so is the limit: a chunk carries
+ * whatever has been written and is sent right away.  During a catch-up the
+ * rate grows and chunks grow with it, up to the configured maximum, to
+ * amortize per-frame costs.  A resend halves the limit to reduce the
+ * cost of further losses; it recovers by a quarter per loss-free RTT.
+ */
+class chunk_sizer {
+public:
+    /// Chunks kept in flight within one bandwidth-delay product
+    static const int      s_chunks_in_flight = 4;
+    /// Outstanding RTT samples kept per file
+    static const size_t   s_max_samples      = 256;
+
+    chunk_sizer(uint32_t a_min = 4 * 1024, uint32_t a_max = 1024 * 1024)
+        throw(io_error)
+        : m_min(a_min), m_max(a_max), m_srtt(0), m_rate(0)
+        , m_window_start(0), m_window_bytes(0), m_loss_scale(s_scale_one)
+        , m_last_loss(0), m_limit(a_min)
+    {
+        if (a_min == 0 || a_min > a_max)
+            throw io_error("Invalid chunk size bounds (min=", a_min, ", max=", a_max, ")");
+    }
+
+    /// Current limit of a chunk size in bytes.
+    uint32_t chunk_size()   const { return m_limit; }
+    /// Smoothed round-trip time in nanoseconds (0 until measured).
+    uint64_t srtt()         const { return m_srtt; }
+    /// Delivery rate in bytes per second (0 until measured).
+    uint64_t rate()         const { return m_rate; }
+
+    uint32_t min_size()     const { return m_min; }
+    uint32_t max_size()     const { return m_max; }
+
+    /// Change the bounds at runtime.
+    void bounds(uint32_t a_min, uint32_t a_max) throw(io_error) {
+        if (a_min == 0 || a_min > a_max)
+            throw io_error("Invalid chunk size bounds (min=", a_min, ", max=", a_max, ")");
+        m_min = a_min;
+        m_max = a_max;
+        update();
+    }
+
+    /// Record a chunk of file \a a_id ending at \a a_end_offset sent at
+    /// time \a a_now (ns).
+    void on_send(uint32_t a_id, uint64_t a_end_offset, uint64_t a_now) {
+        file& f = get(a_id);
+        if (f.samples.size() < s_max_samples)
+            f.samples.push_back(sample(a_end_offset, a_now));
+    }
+
+    /// Record an ack of file \a a_id up to \a a_dst_size received at time
+    /// \a a_now (ns).
+    void on_ack(uint32_t a_id, uint64_t a_dst_size, uint64_t a_now) {
+        file& f = get(a_id);
+        if (a_dst_size > f.acked) {
+            m_window_bytes += a_dst_size - f.acked;
+            f.acked = a_dst_size;
+        }
+
+        // The newest chunk covered by the ack gives the least delayed sample
+        uint64_t sent = 0;
+        while (!f.samples.empty() && f.samples.front().end_offset <= a_dst_size) {
+            sent = f.samples.front().time;
+            f.samples.pop_front();
+        }
+        if (sent && a_now > sent) {
+            uint64_t rtt = a_now - sent;
+            m_srtt = m_srtt ? (7 * m_srtt + rtt) / 8 : rtt;
+        }
+
+        // Sample the delivery rate once per RTT (at least 1ms)
+        if (!m_window_start)
+            m_window_start = a_now;
+        uint64_t elapsed = a_now - m_window_start;
+        if (elapsed >= std::max<uint64_t>(m_srtt, 1000000)) {
+            uint64_t rate = m_window_bytes * 1000000000ull / elapsed;
+            m_rate = m_rate ? (3 * m_rate + rate) / 4 : rate;
+            m_window_start = a_now;
+            m_window_bytes = 0;
+            // Recover from losses gradually
+            if (m_loss_scale < s_scale_one && a_now - m_last_loss >= m_srtt) {
+                m_loss_scale += m_loss_scale / 4 + 1;
+                if (m_loss_scale > s_scale_one)
+                    m_loss_scale = s_scale_one;
+            }
+            update();
+        }
+    }
+
+    /// Record a resend request received at time \a a_now (ns).
+    void on_resend(uint64_t a_now) {
+        m_loss_scale = std::max<uint32_t>(m_loss_scale / 2, 1);
+        m_last_loss  = a_now;
+        update();
+    }
+
+    /// Forget file \a a_id (e.g. when it's closed).
+    void remove(uint32_t a_id) {
+        if (a_id < m_files.size())
+            m_files[a_id] = file();
+    }
+
+private:
+    static const uint32_t s_scale_one = 1024;
+
+    struct sample {
+        uint64_t end_offset;
+        uint64_t time;
+        sample(uint64_t a_off, uint64_t a_time) : end_offset(a_off), time(a_time) {}
+    };
+
+    struct file {
+        uint64_t           acked;
+        std::deque<sample> samples;
+        file() : acked(0) {}
+    };
+
+    uint32_t          m_min;
+    uint32_t          m_max;
+    uint64_t          m_srtt;
+    uint64_t          m_rate;
+    uint64_t          m_window_start;
+    uint64_t          m_window_bytes;
+    uint32_t          m_loss_scale;     // Fraction of s_scale_one
+    uint64_t          m_last_loss;
+    uint32_t          m_limit;
+    std::vector<file> m_files;
+
+    file& get(uint32_t a_id) {
+        if (a_id >= m_files.size())
+            m_files.resize(a_id + 1);
+        return m_files[a_id];
+    }
+
+    void update() {
+        uint64_t bdp   = m_rate / 1000 * m_srtt / 1000000;
+        uint64_t limit = bdp / s_chunks_in_flight * m_loss_scale / s_scale_one;
+        m_limit = (uint32_t)std::max<uint64_t>(m_min, std::min<uint64_t>(m_max, limit));
+    }
+};
+
+} // namespace replog
+
+#endif // _REPLOG_CHUNK_SIZER_HPP_
@@ -0,0 +1,69 @@
+//----------------------------------------------------------------------------
+/// \file  coroutine.hpp
+//----------------------------------------------------------------------------
+/// \brief Stackless coroutines for protocol state machines.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _REPLOG_COROUTINE_HPP_
+#define _REPLOG_COROUTINE_HPP_
+
+namespace replog {
+
+/**
+ * \brief Resumption point of a stackless coroutine.
+ * A coroutine is a member function whose body is enclosed in
+ * REPLOG_CO_BEGIN()/REPLOG_CO_END().  REPLOG_CO_YIELD() returns from the
+ * function and the next call resumes right after it.  The state is a
+ * single int kept in the object, so suspending and resuming never
+ * allocates.  Local variables don't survive a yield, state that has to
+ * must be kept in members.  At most one yield may appear on a line.
+ */
+class coroutine {
+    int m_line;
+public:
+    coroutine() : m_line(0) {}
+
+    bool is_complete() const { return m_line < 0; }
+    /// Restart the coroutine from the beginning on the next call.
+    void reset()             { m_line = 0; }
+
+    int& line()              { return m_line; }
+};
+
+} // namespace replog
+
+#define REPLOG_CO_BEGIN(Co) \
+    switch ((Co).line()) { case 0:
+
+#define REPLOG_CO_YIELD(Co) \
+    do { (Co).line() = __LINE__; return; case __LINE__:; } while (0)
+
+#define REPLOG_CO_END(Co) \
+    default:; } (Co).line() = -1
+
+#endif // _REPLOG_COROUTINE_HPP_
@@ -0,0 +1,131 @@
+//----------------------------------------------------------------------------
+/// \file  delta.cpp
+//----------------------------------------------------------------------------
+/// \brief Implementation of file I/O helpers of delta synchronization.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#include <replog/delta.hpp>
+#include <unistd.h>
+#include <errno.h>
+
+namespace replog {
+
+namespace {
+
+    /// Read up to \a n bytes at \a a_offset retrying on short reads.
+    size_t pread_full(int a_fd, char* a_buf, size_t n, uint64_t a_offset) {
+        size_t got = 0;
+        while (got < n) {
+            ssize_t m = pread(a_fd, a_buf + got, n - got, a_offset + got);
+            if (m < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw io_error(errno, "pread");
+            } else if (m == 0)
+                break;
+            got += m;
+        }
+        return got;
+    }
+
+    /// Write \a n bytes at \a a_offset retrying on short writes.
+    void pwrite_full(int a_fd, const char* a_data, size_t n, uint64_t a_offset) {
+        for (size_t written = 0; written < n; ) {
+            ssize_t m = pwrite(a_fd, a_data + written, n - written, a_offset + written);
+            if (m < 0) {
+                if (errno == EINTR)
+                    continue;
+                throw io_error(errno, "pwrite");
+            }
+            written += m;
+        }
+    }
+
+} // namespace
+
+void delta_signatures(int a_fd, uint64_t a_size, uint32_t a_block_size,
+    std::vector<block_signature>& a_sigs) throw(io_error)
+{
+    if (a_block_size == 0)
+        throw io_error("Invalid delta block size:", a_block_size);
+
+    std::vector<char> buf(a_block_size);
+    a_sigs.clear();
+    a_sigs.reserve(a_size / a_block_size + 1);
+
+    for (uint64_t offset = 0; offset < a_size; ) {
+        size_t len = std::min((uint64_t)a_block_size, a_size - offset);
+        len = pread_full(a_fd, &buf[0], len, offset);
+        if (len == 0)
+            break;  // File was truncated while reading
+        a_sigs.push_back(block_signature(&buf[0], len));
+        offset += len;
+    }
+}
+
+uint64_t file_content_hash(int a_fd, uint64_t a_size) throw(io_error)
+{
+    std::vector<char> buf(content_hash::s_piece_size);
+    content_hash h;
+    for (uint64_t offset = 0; offset < a_size; ) {
+        size_t len = std::min((uint64_t)buf.size(), a_size - offset);
+        if (pread_full(a_fd, &buf[0], len, offset) != len)
+            throw io_error("Short file at offset", offset);
+        h.update(&buf[0], len);
+        offset += len;
+    }
+    return h.value();
+}
+
+void delta_copy(int a_old_fd, int a_new_fd, uint64_t a_dst_offset,
+    uint64_t a_old_offset, uint32_t a_len) throw(io_error)
+{
+    char buf[64*1024];
+    while (a_len > 0) {
+        ssize_t n = pread(a_old_fd, buf, std::min((size_t)a_len, sizeof(buf)), a_old_offset);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw io_error(errno, "pread");
+        } else if (n == 0)
+            throw io_error("Delta copy beyond end of file at offset", a_old_offset);
+
+        pwrite_full(a_new_fd, buf, n, a_dst_offset);
+        a_len        -= n;
+        a_old_offset += n;
+        a_dst_offset += n;
+    }
+}
+
+void delta_literal(int a_new_fd, uint64_t a_dst_offset, const char* a_data,
+    uint32_t a_len) throw(io_error)
+{
+    pwrite_full(a_new_fd, a_data, a_len, a_dst_offset);
+}
+
+} // namespace replog
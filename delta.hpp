@@ -0,0 +1,539 @@
+//----------------------------------------------------------------------------
+/// \file  delta.hpp
+//----------------------------------------------------------------------------
+/// \brief Block-signature delta synchronization of rewritten files
+/// (rolling weak checksum plus strong hash, in the spirit of rsync).
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _REPLOG_DELTA_HPP_
+#define _REPLOG_DELTA_HPP_
+
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+#include <boost/noncopyable.hpp>
+#include <replog/error.hpp>
+#include <replog/endian.hpp>
+#include <replog/hashtable.hpp>
+#include <replog/proto.hpp>
+
+namespace replog {
+
+/**
+ * \brief Weak rolling checksum of a fixed-size window.
+ * The checksum can be moved forward by one byte in constant time,
+ * which makes it possible to look for matching blocks at every
+ * offset of a file.
+ */
+class rolling_checksum {
+    uint32_t m_a;
+    uint32_t m_b;
+    uint32_t m_len;
+public:
+    rolling_checksum() : m_a(0), m_b(0), m_len(0) {}
+    rolling_checksum(const char* a_data, size_t n) { reset(a_data, n); }
+
+    /// Compute the checksum of the window of \a n bytes at \a a_data.
+    void reset(const char* a_data, size_t n) {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(a_data);
+        uint32_t a = 0, b = 0;
+        for (size_t i = 0; i < n; ++i) {
+            a += p[i];
+            b += a;
+        }
+        m_a = a; m_b = b; m_len = n;
+    }
+
+    /// Slide the window by one byte: \a a_out leaves it and \a a_in enters it.
+    void roll(char a_out, char a_in) {
+        uint32_t out = (unsigned char)a_out;
+        m_a += (unsigned char)a_in - out;
+        m_b += m_a - m_len * out;
+    }
+
+    uint32_t value() const { return (m_b << 16) | (m_a & 0xFFFF); }
+
+    static uint32_t compute(const char* a_data, size_t n) {
+        return rolling_checksum(a_data, n).value();
+    }
+};
+
+/// Signature of one block of the destination file.
+struct block_signature {
+    uint32_t weak;
+    uint64_t strong;
+
+    block_signature() : weak(0), strong(0) {}
+    block_signature(const char* a_data, size_t n)
+        : weak(rolling_checksum::compute(a_data, n))
+        , strong(strong_hash(a_data, n))
+    {}
+
+    /// Encode the signature in the wire format of msg_delta_signatures.
+    char* encode(char* p) const { put32be(p, weak); put64be(p, strong); return p; }
+
+    /// Decode the signature from the wire format of msg_delta_signatures.
+    const char* decode(const char* p) { weak = get32be(p); strong = get64be(p); return p; }
+};
+
+/**
+ * \brief 64-bit hash of the content of a whole file fed in pieces of any
+ * size.
+ * The data is hashed in s_piece_size blocks, each seeded with the hash of
+ * the previous one, so the value doesn't depend on how it's fed.  Block
+ * matches of a delta transfer rely on a non-cryptographic block hash:
+ * the destination checks the rebuilt file against this hash of the
+ * source before it replaces the old file.
+ */
+class content_hash {
+    uint64_t          m_hash;
+    std::vector<char> m_piece;      // Incomplete piece
+public:
+    static const size_t s_piece_size = 64 * 1024;
+
+    content_hash() : m_hash(0) {}
+
+    void update(const char* a_data, size_t n) {
+        detail::murmur_hash64a_fun h;
+        if (!m_piece.empty()) {
+            size_t k = std::min(n, s_piece_size - m_piece.size());
+            m_piece.insert(m_piece.end(), a_data, a_data + k);
+            a_data += k;
+            n      -= k;
+            if (m_piece.size() < s_piece_size)
+                return;
+            m_hash = h(&m_piece[0], s_piece_size, m_hash);
+            m_piece.clear();
+        }
+        for (; n >= s_piece_size; a_data += s_piece_size, n -= s_piece_size)
+            m_hash = h(a_data, s_piece_size, m_hash);
+        m_piece.assign(a_data, a_data + n);
+    }
+
+    uint64_t value() const {
+        return m_piece.empty() ? m_hash
+             : detail::murmur_hash64a_fun()(&m_piece[0], m_piece.size(), m_hash);
+    }
+
+    static uint64_t compute(const char* a_data, size_t n) {
+        content_hash h;
+        h.update(a_data, n);
+        return h.value();
+    }
+};
+
+/// Delta synchronization is needed when the destination file can no
+/// longer be brought up to date by appending data, i.e. when it's larger
+/// than the source.
+inline bool delta_sync_required(uint64_t a_src_size, uint64_t a_dst_size)
+{
+    return a_dst_size > a_src_size;
+}
+
+/// Pick the signature block size for a file of \a a_file_size bytes.
+/// The size grows as a square root of the file size so that the
+/// number of signatures and the amount of literal data on mismatch
+/// stay balanced.
+inline uint32_t delta_block_size(uint64_t a_file_size) {
+    static const uint32_t s_min_block = 2  * 1024;
+    static const uint32_t s_max_block = 128 * 1024;
+    uint32_t n = s_min_block;
+    while (n < s_max_block && (uint64_t)n * n < a_file_size)
+        n <<= 1;
+    return n;
+}
+
+/**
+ * \brief Lookup table of destination block signatures.
+ * Only full blocks are indexed, so the trailing partial block of the
+ * destination file is always resent as literal data.
+ */
+class signature_index {
+    struct entry {
+        uint32_t weak;
+        uint32_t block;
+        bool operator< (const entry& a) const { return weak < a.weak; }
+    };
+
+    std::vector<block_signature> m_sigs;
+    std::vector<entry>           m_sorted;
+    std::vector<uint8_t>         m_filter;  // Bitmap on the low 16 bits of weak sums
+    uint32_t                     m_block_size;
+    uint64_t                     m_file_size;
+
+    bool filter(uint32_t a_weak) const {
+        uint32_t n = a_weak & 0xFFFF;
+        return m_filter[n >> 3] & (1 << (n & 7));
+    }
+public:
+    signature_index(uint32_t a_block_size, uint64_t a_file_size)
+        : m_filter(8192, 0), m_block_size(a_block_size), m_file_size(a_file_size)
+    {
+        if (a_block_size == 0)
+            throw replog_error("Invalid delta block size:", a_block_size);
+        m_sigs.reserve(a_file_size / a_block_size + 1);
+    }
+
+    uint32_t block_size()   const { return m_block_size; }
+    uint64_t file_size()    const { return m_file_size;  }
+    size_t   size()         const { return m_sigs.size(); }
+
+    const block_signature& operator[] (size_t i) const { return m_sigs[i]; }
+
+    /// Add signature of the next block in file order.
+    void add(const block_signature& a_sig) { m_sigs.push_back(a_sig); }
+
+    /// Add \a a_count signatures encoded in msg_delta_signatures payload.
+    void add(const char* a_data, uint32_t a_count) {
+        block_signature sig;
+        for (uint32_t i = 0; i < a_count; ++i) {
+            a_data = sig.decode(a_data);
+            add(sig);
+        }
+    }
+
+    /// Prepare the index for lookups.  Must be called after all
+    /// signatures were added.
+    void build() {
+        size_t full = std::min((size_t)(m_file_size / m_block_size), m_sigs.size());
+        m_sorted.resize(full);
+        std::fill(m_filter.begin(), m_filter.end(), 0);
+        for (size_t i = 0; i < full; ++i) {
+            m_sorted[i].weak  = m_sigs[i].weak;
+            m_sorted[i].block = i;
+            uint32_t n = m_sigs[i].weak & 0xFFFF;
+            m_filter[n >> 3] |= 1 << (n & 7);
+        }
+        std::stable_sort(m_sorted.begin(), m_sorted.end());
+    }
+
+    /// Find a block whose content matches block_size() bytes at \a a_data
+    /// and whose weak checksum is \a a_weak.  If several blocks match,
+    /// \a a_hint block is preferred so that adjacent copies can be merged.
+    /// @return block index or -1 if there's no match.
+    long find(uint32_t a_weak, const char* a_data, long a_hint = -1) const {
+        if (!filter(a_weak))
+            return -1;
+        entry e; e.weak = a_weak;
+        std::pair<std::vector<entry>::const_iterator,
+                  std::vector<entry>::const_iterator>
+            r = std::equal_range(m_sorted.begin(), m_sorted.end(), e);
+        if (r.first == r.second)
+            return -1;
+        uint64_t strong = strong_hash(a_data, m_block_size);
+        if (a_hint >= 0 && (size_t)a_hint < m_sorted.size()
+         && m_sigs[a_hint].weak == a_weak && m_sigs[a_hint].strong == strong)
+            return a_hint;
+        for (; r.first != r.second; ++r.first)
+            if (m_sigs[r.first->block].strong == strong)
+                return r.first->block;
+        return -1;
+    }
+};
+
+/**
+ * \brief Incremental computation of the delta between the source data
+ * and the destination file described by a signature_index.
+ * run() calls \a a_handler with instructions that rebuild the source data
+ * from the destination file:
+ * \code
+ *   void copy(uint64_t a_dst_offset, uint64_t a_old_offset, uint32_t a_len);
+ *   void literal(uint64_t a_dst_offset, const char* a_data, uint32_t a_len);
+ *   bool full() const;
+ * \endcode
+ * Copies of consecutive blocks are merged, literal runs are split in
+ * pieces no longer than \a a_max_literal bytes.  The generation pauses
+ * as soon as the handler is full() and the next run() continues from
+ * there, so that the delta of a large file is produced only as fast as
+ * it's sent.  The index and the data must outlive the generator.
+ */
+class delta_generator {
+    const signature_index* m_index;
+    const char*            m_data;
+    size_t                 m_size;
+    uint32_t               m_max_literal;
+    size_t                 m_pos;       // Start of the window being matched
+    size_t                 m_lit;       // Start of the pending literal run
+    uint64_t               m_copy_dst;  // Pending copy, merged with adjacent ones
+    uint64_t               m_copy_old;
+    uint32_t               m_copy_len;
+    uint64_t               m_literals;
+    rolling_checksum       m_rc;
+    bool                   m_done;
+
+    template <class Handler>
+    void flush_literals(Handler& a_handler, size_t a_end) {
+        while (m_lit < a_end) {
+            uint32_t len = std::min(a_end - m_lit, (size_t)m_max_literal);
+            a_handler.literal(m_lit, m_data + m_lit, len);
+            m_literals += len;
+            m_lit      += len;
+        }
+    }
+public:
+    delta_generator(const signature_index& a_index, const char* a_data, size_t n,
+                    uint32_t a_max_literal = 64*1024)
+        : m_index(&a_index), m_data(a_data), m_size(n), m_max_literal(a_max_literal)
+        , m_pos(0), m_lit(0), m_copy_dst(0), m_copy_old(0), m_copy_len(0), m_literals(0)
+        , m_done(false)
+    {
+        if (n >= a_index.block_size())
+            m_rc.reset(a_data, a_index.block_size());
+    }
+
+    /// True once all instructions were produced.
+    bool     done()     const { return m_done; }
+    /// Number of literal bytes produced so far.
+    uint64_t literals() const { return m_literals; }
+
+    /// Produce instructions until the end of the data or until the
+    /// handler is full().
+    /// @return true if all instructions were produced.
+    template <class Handler>
+    bool run(Handler& a_handler) {
+        const size_t bs = m_index->block_size();
+        const size_t n  = m_size;
+        while (!m_done && m_pos + bs <= n) {
+            long hint = m_copy_len && m_copy_dst + m_copy_len == m_pos
+                      ? (long)((m_copy_old + m_copy_len) / bs) : -1;
+            long b    = m_index->find(m_rc.value(), m_data + m_pos, hint);
+
+            if (b < 0) {
+                if (m_pos + bs < n)
+                    m_rc.roll(m_data[m_pos], m_data[m_pos + bs]);
+                if (++m_pos - m_lit < m_max_literal)
+                    continue;
+            }
+
+            if (m_copy_len && m_lit < m_pos) {
+                a_handler.copy(m_copy_dst, m_copy_old, m_copy_len);
+                m_copy_len = 0;
+            }
+            flush_literals(a_handler, m_pos);
+
+            if (b >= 0) {
+                uint64_t old = (uint64_t)b * bs;
+                if (m_copy_len && m_copy_dst + m_copy_len == m_pos
+                 && m_copy_old + m_copy_len == old && m_copy_len <= 0xFFFFFFFFu - bs)
+                    m_copy_len += bs;
+                else {
+                    if (m_copy_len)
+                        a_handler.copy(m_copy_dst, m_copy_old, m_copy_len);
+                    m_copy_dst = m_pos; m_copy_old = old; m_copy_len = bs;
+                }
+                m_pos += bs;
+                m_lit  = m_pos;
+                if (m_pos + bs <= n)
+                    m_rc.reset(m_data + m_pos, bs);
+            }
+            if (a_handler.full())
+                return false;
+        }
+        if (m_done)
+            return true;
+        if (m_copy_len) {
+            a_handler.copy(m_copy_dst, m_copy_old, m_copy_len);
+            m_copy_len = 0;
+        }
+        flush_literals(a_handler, n);
+        m_done = true;
+        return true;
+    }
+};
+
+namespace detail {
+    template <class Handler>
+    struct unbounded_delta_handler {
+        Handler& h;
+        unbounded_delta_handler(Handler& a_h) : h(a_h) {}
+        void copy(uint64_t a_dst_offset, uint64_t a_old_offset, uint32_t a_len) {
+            h.copy(a_dst_offset, a_old_offset, a_len);
+        }
+        void literal(uint64_t a_dst_offset, const char* a_data, uint32_t a_len) {
+            h.literal(a_dst_offset, a_data, a_len);
+        }
+        bool full() const { return false; }
+    };
+} // namespace detail
+
+/// Compute the whole delta between the source data and the destination
+/// file described by \a a_index at once (see delta_generator, the
+/// handler needs no full()).
+/// @return number of literal bytes produced.
+template <class Handler>
+uint64_t delta_generate(const signature_index& a_index, const char* a_data,
+    size_t n, Handler& a_handler, uint32_t a_max_literal = 64*1024)
+{
+    delta_generator g(a_index, a_data, n, a_max_literal);
+    detail::unbounded_delta_handler<Handler> h(a_handler);
+    g.run(h);
+    return g.literals();
+}
+
+/// Compute signatures of the first \a a_size bytes of file \a a_fd
+/// using \a a_block_size blocks.
+void delta_signatures(int a_fd, uint64_t a_size, uint32_t a_block_size,
+    std::vector<block_signature>& a_sigs) throw(io_error);
+
+/// content_hash of the first \a a_size bytes of file \a a_fd.
+uint64_t file_content_hash(int a_fd, uint64_t a_size) throw(io_error);
+
+/// Copy \a a_len bytes at \a a_old_offset of \a a_old_fd to
+/// \a a_dst_offset of \a a_new_fd (destination side of msg_delta_copy).
+void delta_copy(int a_old_fd, int a_new_fd, uint64_t a_dst_offset,
+    uint64_t a_old_offset, uint32_t a_len) throw(io_error);
+
+/// Write \a a_len bytes of literal data to \a a_dst_offset of \a a_new_fd
+/// (destination side of msg_append during a delta transfer).
+void delta_literal(int a_new_fd, uint64_t a_dst_offset, const char* a_data,
+    uint32_t a_len) throw(io_error);
+
+/**
+ * \brief Source side of the delta synchronization of one file.
+ * When the size of the destination reported by msg_get_size_response
+ * makes delta_sync_required() true, the source calls request() to ask
+ * for the signatures of the destination blocks and passes every
+ * msg_delta_signatures received to on_signatures().  Once the last one
+ * arrived, the source data is sent as msg_delta_copy frames for blocks
+ * the destination already has and msg_append frames for the rest,
+ * followed by msg_delta_done carrying the content_hash of the source.
+ * Appends then resume from size().
+ *
+ * The delta is queued in pieces: once more than \a a_max_pending bytes
+ * of output are pending, on_signatures() and resume() return false and
+ * the source calls resume() again when the output drained (from
+ * connection::on_drained() or after REPLOG_AWAIT_DRAIN) until it returns
+ * true.  The output of a mostly changed file thus never has to be
+ * buffered whole.
+ *
+ * Frames are built in place through the reserve()/commit()/pending()
+ * interface of connection.
+ */
+class delta_sender: boost::noncopyable {
+    uint32_t        m_id;
+    uint32_t        m_name_hash;
+    int             m_dst_fd;
+    const char*     m_data;
+    uint64_t        m_size;
+    size_t          m_max_pending;
+    signature_index m_index;
+    delta_generator m_gen;
+    bool            m_sending;      // Signatures complete, delta being queued
+
+    template <class Conn>
+    struct frame_sink {
+        delta_sender& s;
+        Conn&         conn;
+
+        frame_sink(delta_sender& a_s, Conn& a_conn) : s(a_s), conn(a_conn) {}
+
+        void copy(uint64_t a_dst_offset, uint64_t a_old_offset, uint32_t a_len) {
+            msg_delta_copy::create(s.m_id, s.m_name_hash, s.m_dst_fd, a_dst_offset,
+                a_old_offset, a_len, buffer_allocator(conn.reserve(sizeof(msg_delta_copy))));
+            conn.commit(sizeof(msg_delta_copy));
+        }
+        void literal(uint64_t a_dst_offset, const char* a_data, uint32_t a_len) {
+            size_t n = sizeof(msg_append) + a_len;
+            char*  p = conn.reserve(n);
+            msg_append::create(s.m_id, s.m_name_hash, s.m_dst_fd, a_dst_offset, a_len,
+                buffer_allocator(p));
+            memcpy(p + sizeof(msg_append), a_data, a_len);
+            conn.commit(n);
+        }
+        bool full() const { return conn.pending() > s.m_max_pending; }
+    };
+public:
+    /// Synchronize file \a a_id with \a a_size bytes of source data at
+    /// \a a_data, which must stay valid until the delta is sent.
+    delta_sender(uint32_t a_id, uint32_t a_name_hash, const char* a_data, uint64_t a_size,
+                 size_t a_max_pending = 1024 * 1024)
+        : m_id(a_id), m_name_hash(a_name_hash), m_dst_fd(0), m_data(a_data)
+        , m_size(a_size), m_max_pending(a_max_pending), m_index(1, 0)
+        , m_gen(m_index, NULL, 0), m_sending(false)
+    {}
+
+    uint64_t size()     const { return m_size; }
+    /// Bytes sent as literal data so far.
+    uint64_t literals() const { return m_gen.literals(); }
+    /// True while the delta is being queued: call resume() when drained.
+    bool     sending()  const { return m_sending; }
+
+    /// Ask for the signatures of the destination file of \a a_dst_size bytes.
+    template <class Conn>
+    void request(Conn& a_conn, uint64_t a_dst_size, int a_dst_fd = 0) {
+        m_dst_fd = a_dst_fd;
+        msg_delta_request::create(m_id, m_name_hash, m_dst_fd, m_size,
+            delta_block_size(a_dst_size),
+            buffer_allocator(a_conn.reserve(sizeof(msg_delta_request))));
+        a_conn.commit(sizeof(msg_delta_request));
+    }
+
+    /// Collect the signatures of \a a_msg and start sending the delta
+    /// once all of them arrived.
+    /// @return true if the whole delta was queued.
+    template <class Conn>
+    bool on_signatures(Conn& a_conn, const msg_delta_signatures* a_msg) throw(replog_error) {
+        if (a_msg->first_block() == 0)
+            m_index = signature_index(a_msg->block_size(), a_msg->dst_size());
+        else if (a_msg->block_size() != m_index.block_size() ||
+                 a_msg->first_block() != m_index.size())
+            throw replog_error("Unexpected delta signatures at block", a_msg->first_block());
+        m_index.add(reinterpret_cast<const char*>(a_msg) + a_msg->header_size(),
+                    a_msg->count());
+
+        uint64_t bs = m_index.block_size();
+        if (m_index.size() < (m_index.file_size() + bs - 1) / bs)
+            return false;
+        m_index.build();
+        m_gen     = delta_generator(m_index, m_data, m_size);
+        m_sending = true;
+        return resume(a_conn);
+    }
+
+    /// Queue more of the delta started by on_signatures().
+    /// @return true if the whole delta was queued.
+    template <class Conn>
+    bool resume(Conn& a_conn) {
+        if (!m_sending)
+            return true;
+        frame_sink<Conn> sink(*this, a_conn);
+        if (!m_gen.run(sink))
+            return false;
+        msg_delta_done::create(m_id, m_name_hash, m_dst_fd, m_size,
+            content_hash::compute(m_data, m_size),
+            buffer_allocator(a_conn.reserve(sizeof(msg_delta_done))));
+        a_conn.commit(sizeof(msg_delta_done));
+        m_sending = false;
+        return true;
+    }
+};
+
+} // namespace replog
+
+#endif // _REPLOG_DELTA_HPP_
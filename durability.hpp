@@ -0,0 +1,183 @@
+//----------------------------------------------------------------------------
+/// \file  durability.hpp
+//----------------------------------------------------------------------------
+/// \brief Group commit of receiver writes with configurable durability
+/// levels.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _REPLOG_DURABILITY_HPP_
+#define _REPLOG_DURABILITY_HPP_
+
+#include <vector>
+#include <stdint.h>
+#include <replog/error.hpp>
+#include <replog/file_writer.hpp>
+#include <replog/stats.hpp>
+
+namespace replog {
+
+/**
+ * \brief Group commit of writes to destination files.
+ * The receiver reports every applied chunk with on_write().  Instead of
+ * syncing each append, files touched within a window are synced together
+ * by sync() once the window closes: when due() tells that the oldest
+ * unsynced write is older than the time window or the unsynced bytes
+ * exceed the byte window, or, in BEFORE_ACK mode, as soon as the receiver
+ * runs out of input (connection::on_input_idle(), disk_handler::idle()),
+ * so that acks aren't delayed by the window.  The
+ * writeback of all dirty files is started before waiting for any of them,
+ * so their I/O overlaps.  One sync thus covers any number of appends.
+ *
+ * The mode sets the durability level:
+ *   - NONE:       files are never synced, data is acked once applied;
+ *   - PERIODIC:   files are synced by window, data is acked once applied,
+ *                 so a crash loses at most one window of acked data;
+ *   - BEFORE_ACK: data is acked only once the covering sync completed,
+ *                 durable() is the size safe to acknowledge.
+ */
+class group_commit {
+public:
+    enum mode { NONE, PERIODIC, BEFORE_ACK };
+
+    explicit group_commit(mode a_mode = NONE, uint64_t a_window_ns = 1000000,
+                          uint64_t a_window_bytes = 1024 * 1024)
+        : m_mode(a_mode), m_window_ns(a_window_ns), m_window_bytes(a_window_bytes)
+        , m_first_write(0), m_bytes(0), m_syncs(0), m_stats(NULL)
+    {}
+
+    /// Count syncs in \a a_stats too, NULL - don't.
+    void stats(stats_segment* a_stats) { m_stats = a_stats; }
+
+    mode     get_mode()     const { return m_mode; }
+    uint64_t window_ns()    const { return m_window_ns; }
+    uint64_t window_bytes() const { return m_window_bytes; }
+    /// Number of group syncs done.
+    uint64_t syncs()        const { return m_syncs; }
+    /// True if some writes are not synced yet.
+    bool     dirty()        const { return !m_dirty.empty(); }
+
+    /// Record \a a_bytes written to file \a a_id through \a a_file at
+    /// time \a a_now (ns), the file's size being \a a_size.
+    void on_write(uint32_t a_id, file_writer* a_file, uint64_t a_size,
+                  uint64_t a_bytes, uint64_t a_now)
+    {
+        if (a_id >= m_files.size())
+            m_files.resize(a_id + 1);
+        file& f  = m_files[a_id];
+        f.writer = a_file;
+        if (a_size > f.written)
+            f.written = a_size;
+        if (m_mode == NONE)
+            return;
+        if (!f.dirty) {
+            f.dirty = true;
+            m_dirty.push_back(a_id);
+        }
+        if (!m_first_write)
+            m_first_write = a_now;
+        m_bytes += a_bytes;
+    }
+
+    /// True if the window of unsynced writes closed at time \a a_now.
+    bool due(uint64_t a_now) const {
+        return dirty() && (m_bytes >= m_window_bytes || a_now - m_first_write >= m_window_ns);
+    }
+
+    /// Time (ns) the window of unsynced writes closes at, 0 if there are
+    /// none.  Event loops arm a timer for it to sync an idle receiver.
+    uint64_t deadline() const { return dirty() ? m_first_write + m_window_ns : 0; }
+
+    /// Sync all files written since the last sync.
+    /// @return number of files synced.
+    size_t sync() throw(io_error) {
+        size_t n = m_dirty.size();
+        if (n > 1)
+            for (size_t i = 0; i < n; ++i)
+                m_files[m_dirty[i]].writer->writeback();
+        for (size_t i = 0; i < n; ++i) {
+            file& f = m_files[m_dirty[i]];
+            f.writer->sync();
+            f.synced = f.written;
+            f.dirty  = false;
+        }
+        m_dirty.clear();
+        m_first_write = 0;
+        m_bytes       = 0;
+        if (n) {
+            m_syncs++;
+            if (m_stats)
+                m_stats->on_sync();
+        }
+        return n;
+    }
+
+    /// Size of file \a a_id that can be acknowledged.
+    uint64_t durable(uint32_t a_id) const {
+        if (a_id >= m_files.size())
+            return 0;
+        const file& f = m_files[a_id];
+        return m_mode == BEFORE_ACK ? f.synced : f.written;
+    }
+
+    /// Forget file \a a_id.  Its writes must have been synced or the file
+    /// closed before.
+    void remove(uint32_t a_id) {
+        if (a_id >= m_files.size())
+            return;
+        if (m_files[a_id].dirty)
+            for (size_t i = 0; i < m_dirty.size(); ++i)
+                if (m_dirty[i] == a_id) {
+                    m_dirty.erase(m_dirty.begin() + i);
+                    break;
+                }
+        m_files[a_id] = file();
+    }
+
+private:
+    struct file {
+        file_writer* writer;
+        uint64_t     written;
+        uint64_t     synced;
+        bool         dirty;
+        file() : writer(NULL), written(0), synced(0), dirty(false) {}
+    };
+
+    mode                  m_mode;
+    uint64_t              m_window_ns;
+    uint64_t              m_window_bytes;
+    uint64_t              m_first_write;    // Time of the oldest unsynced write
+    uint64_t              m_bytes;          // Unsynced bytes
+    uint64_t              m_syncs;
+    stats_segment*        m_stats;
+    std::vector<file>     m_files;
+    std::vector<uint32_t> m_dirty;
+};
+
+} // namespace replog
+
+#endif // _REPLOG_DURABILITY_HPP_
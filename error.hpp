@@ -35,6 +35,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <exception>
 #include <sstream>
 #include <stdio.h>
+#include <string.h>
 
 namespace replog {
 
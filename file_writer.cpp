@@ -0,0 +1,343 @@
+//----------------------------------------------------------------------------
+/// \file  file_writer.cpp
+//----------------------------------------------------------------------------
+/// \brief Receiver-side writer of replicated files.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#include <replog/file_writer.hpp>
+#include <replog/memory_budget.hpp>
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace replog {
+
+//----------------------------------------------------------------------------
+// aligned_buffer_pool
+//----------------------------------------------------------------------------
+
+aligned_buffer_pool::aligned_buffer_pool(size_t a_size, size_t a_align, size_t a_max_free)
+    : m_size(a_size), m_align(a_align), m_max_free(a_max_free)
+{
+    pthread_mutex_init(&m_lock, NULL);
+}
+
+aligned_buffer_pool::~aligned_buffer_pool()
+{
+    for (size_t i = 0; i < m_free.size(); ++i) {
+        free(m_free[i]);
+        memory_budget::instance().release(m_size);
+    }
+    pthread_mutex_destroy(&m_lock);
+}
+
+char* aligned_buffer_pool::allocate() throw(io_error)
+{
+    pthread_mutex_lock(&m_lock);
+    char* p = NULL;
+    if (!m_free.empty()) {
+        p = m_free.back();
+        m_free.pop_back();
+    }
+    pthread_mutex_unlock(&m_lock);
+    if (p)
+        return p;
+    memory_budget::instance().acquire(m_size);
+    void* q;
+    int   err = posix_memalign(&q, m_align, m_size);
+    if (err) {
+        memory_budget::instance().release(m_size);
+        throw io_error(err, "posix_memalign");
+    }
+    return static_cast<char*>(q);
+}
+
+void aligned_buffer_pool::release(char* a_buf)
+{
+    pthread_mutex_lock(&m_lock);
+    bool keep = m_free.size() < m_max_free;
+    if (keep)
+        m_free.push_back(a_buf);
+    pthread_mutex_unlock(&m_lock);
+    if (!keep) {
+        free(a_buf);
+        memory_budget::instance().release(m_size);
+    }
+}
+
+aligned_buffer_pool& aligned_buffer_pool::instance()
+{
+    static aligned_buffer_pool s_pool(1024 * 1024);
+    return s_pool;
+}
+
+//----------------------------------------------------------------------------
+// file_writer
+//----------------------------------------------------------------------------
+
+file_writer::file_writer()
+    : m_fd(-1), m_tail_fd(-1), m_size(0), m_allocated(0), m_synced(0)
+    , m_buf(NULL), m_buf_len(0), m_buf_flushed(0), m_buf_offset(0)
+{}
+
+file_writer::~file_writer()
+{
+    try { close(); } catch (...) {}
+}
+
+void file_writer::open(const std::string& a_name, const options& a_opts,
+    bool a_truncate, int a_mode) throw(io_error)
+{
+    close();
+    m_name = a_name;
+    m_opts = a_opts;
+
+    int flags = O_WRONLY | O_CREAT | (a_truncate ? O_TRUNC : 0);
+    bool direct = a_opts.direct;
+    m_fd = ::open(a_name.c_str(), flags | (direct ? O_DIRECT : 0), a_mode);
+    if (m_fd < 0 && direct && errno == EINVAL) {
+        // The file system doesn't support O_DIRECT
+        direct = false;
+        m_fd   = ::open(a_name.c_str(), flags, a_mode);
+    }
+    if (m_fd < 0)
+        throw io_error(errno, a_name.c_str());
+
+    struct stat st;
+    if (fstat(m_fd, &st) < 0) {
+        int err = errno;
+        release();
+        throw io_error(err, "fstat");
+    }
+    m_size = m_allocated = m_synced = st.st_size;
+
+    if (direct) {
+        aligned_buffer_pool& pool = aligned_buffer_pool::instance();
+        if ((m_tail_fd = ::open(a_name.c_str(), O_RDWR)) < 0) {
+            int err = errno;
+            release();
+            throw io_error(err, a_name.c_str());
+        }
+        m_buf = pool.allocate();
+        m_buf_offset = m_buf_len = m_buf_flushed = 0;
+        reposition(m_size);
+    }
+}
+
+void file_writer::write(const char* a_data, size_t n, uint64_t a_offset) throw(io_error)
+{
+    if (!n)
+        return;
+    preallocate(a_offset + n);
+    uint64_t end = a_offset + n;
+
+    if (!m_buf)
+        pwrite_all(m_fd, a_data, n, a_offset);
+    else {
+        size_t cap = aligned_buffer_pool::instance().buffer_size();
+        if (a_offset != m_buf_offset + m_buf_len)
+            reposition(a_offset);
+        while (n) {
+            size_t k = std::min(n, cap - m_buf_len);
+            memcpy(m_buf + m_buf_len, a_data, k);
+            m_buf_len += k;
+            a_data    += k;
+            n         -= k;
+            if (m_buf_len == cap)
+                write_direct(cap);
+        }
+    }
+    m_size = std::max(m_size, end);
+}
+
+void file_writer::hole(uint64_t a_offset, uint64_t n) throw(io_error)
+{
+    if (!n)
+        return;
+    uint64_t end = a_offset + n;
+    // Direct mode data must reach the file before the range is punched
+    flush();
+    if (end > m_size && ftruncate(m_fd, end) < 0)
+        throw io_error(errno, "ftruncate");
+    // Free the range, which may be in a preallocated extent.  Without
+    // support for punching, extending the file has already made the hole.
+    if (fallocate(m_fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, a_offset, n) < 0 &&
+        errno != EOPNOTSUPP)
+        throw io_error(errno, "fallocate");
+    m_size = std::max(m_size, end);
+    // Restart the staging buffer past the hole
+    if (m_buf)
+        reposition(end);
+}
+
+void file_writer::flush() throw(io_error)
+{
+    if (!m_buf)
+        return;
+    size_t full = m_buf_len & ~(aligned_buffer_pool::instance().alignment() - 1);
+    if (full)
+        write_direct(full);
+    if (m_buf_len > m_buf_flushed) {
+        pwrite_all(m_tail_fd, m_buf + m_buf_flushed, m_buf_len - m_buf_flushed,
+                   m_buf_offset + m_buf_flushed);
+        m_buf_flushed = m_buf_len;
+    }
+}
+
+void file_writer::writeback() throw(io_error)
+{
+    if (m_fd < 0)
+        return;
+    flush();
+    if (m_size > m_synced &&
+        sync_file_range(m_fd, m_synced, m_size - m_synced, SYNC_FILE_RANGE_WRITE) < 0)
+        throw io_error(errno, "sync_file_range");
+}
+
+void file_writer::sync() throw(io_error)
+{
+    if (m_fd < 0)
+        return;
+    flush();
+    if (fdatasync(m_fd) < 0)
+        throw io_error(errno, "fdatasync");
+    if (m_opts.drop_behind && !m_buf && m_size > m_synced)
+        posix_fadvise(m_fd, m_synced, m_size - m_synced, POSIX_FADV_DONTNEED);
+    m_synced = m_size;
+}
+
+void file_writer::close() throw(io_error)
+{
+    if (m_fd < 0)
+        return;
+    try {
+        flush();
+    } catch (...) {
+        release();
+        throw;
+    }
+    // Release the unused part of the last preallocated extent
+    int rc  = m_allocated > m_size ? ftruncate(m_fd, m_size) : 0;
+    int err = errno;
+    release();
+    if (rc < 0)
+        throw io_error(err, "ftruncate");
+}
+
+void file_writer::release()
+{
+    ::close(m_fd);
+    m_fd = -1;
+    if (m_tail_fd >= 0) {
+        ::close(m_tail_fd);
+        m_tail_fd = -1;
+    }
+    if (m_buf) {
+        aligned_buffer_pool::instance().release(m_buf);
+        m_buf = NULL;
+    }
+}
+
+void file_writer::preallocate(uint64_t a_end) throw(io_error)
+{
+    if (!m_opts.extent || a_end <= m_allocated)
+        return;
+    uint64_t end = (a_end + m_opts.extent - 1) / m_opts.extent * m_opts.extent;
+    uint64_t from = std::max(m_allocated, m_size);
+    if (fallocate(m_fd, FALLOC_FL_KEEP_SIZE, from, end - from) < 0) {
+        if (errno != EOPNOTSUPP)
+            throw io_error(errno, "fallocate");
+        m_opts.extent = 0;
+        return;
+    }
+    m_allocated = end;
+}
+
+void file_writer::write_direct(size_t n) throw(io_error)
+{
+    pwrite_all(m_fd, m_buf, n, m_buf_offset);
+    m_buf_len    -= n;
+    m_buf_offset += n;
+    memmove(m_buf, m_buf + n, m_buf_len);
+    m_buf_flushed = m_buf_flushed > n ? m_buf_flushed - n : 0;
+}
+
+void file_writer::reposition(uint64_t a_offset) throw(io_error)
+{
+    flush();
+    m_buf_offset  = a_offset & ~(uint64_t)(aligned_buffer_pool::instance().alignment() - 1);
+    m_buf_len     = a_offset - m_buf_offset;
+    m_buf_flushed = m_buf_len;
+    if (!m_buf_len)
+        return;
+    // Load the head of the partial block that the next writes extend
+    ssize_t k = pread(m_tail_fd, m_buf, m_buf_len, m_buf_offset);
+    if (k < 0)
+        throw io_error(errno, "pread");
+    if ((size_t)k < m_buf_len) {
+        memset(m_buf + k, 0, m_buf_len - k);
+        m_buf_flushed = k;
+    }
+}
+
+void file_writer::pwrite_all(int a_fd, const char* a_data, size_t n, uint64_t a_offset)
+    throw(io_error)
+{
+    while (n) {
+        ssize_t k = pwrite(a_fd, a_data, n, a_offset);
+        if (k < 0) {
+            if (errno == EINTR)
+                continue;
+            throw io_error(errno, "pwrite");
+        }
+        a_data   += k;
+        a_offset += k;
+        n        -= k;
+    }
+}
+
+bool contained_name(const std::string& a_name)
+{
+    if (a_name.empty() || a_name[0] == '/')
+        return false;
+    for (size_t i = 0; i <= a_name.size(); ) {
+        size_t j = a_name.find('/', i);
+        if (j == std::string::npos)
+            j = a_name.size();
+        if (a_name.compare(i, j - i, "..") == 0)
+            return false;
+        i = j + 1;
+    }
+    return true;
+}
+
+} // namespace replog
@@ -33,6 +33,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #define _REPLOG_HASHTABLE_HPP_
 
 #include <stdint.h>
+#include <string.h>
+#include <string>
 
 #ifdef __GXX_EXPERIMENTAL_CXX0X__
 #include <unordered_map>
@@ -68,11 +70,11 @@ struct hsieh_hash_fun {
     static uint16_t get16bits(const char* d) { return *(const uint16_t *)d; }
 
     static uint32_t hash(const std::string& a_str) {
-        hsieh_hash_fun()(a_str.c_str(), a_str.size());
+        return hsieh_hash_fun()(a_str.c_str(), a_str.size());
     }
 
     static uint32_t hash(const char* a_str) {
-        hsieh_hash_fun()(a_str, strlen(a_str));
+        return hsieh_hash_fun()(a_str, strlen(a_str));
     }
 
     uint32_t operator()(const char* data) const {
@@ -125,6 +127,46 @@ struct hsieh_hash_fun {
     }
 };
 
+/// 64-bit hash function implementing MurmurHash64A algorithm
+// See http://sites.google.com/site/murmurhash/
+// MurmurHash2 was written by Austin Appleby and placed in the public domain.
+struct murmur_hash64a_fun {
+    uint64_t operator()(const char* data, size_t len, uint64_t seed = 0) const {
+        const uint64_t m = 0xc6a4a7935bd1e995ull;
+        const int      r = 47;
+
+        uint64_t h = seed ^ (len * m);
+
+        const char* end = data + (len & ~(size_t)7);
+        for (; data != end; data += 8) {
+            uint64_t k;
+            memcpy(&k, data, sizeof(k));
+            k *= m;
+            k ^= k >> r;
+            k *= m;
+            h ^= k;
+            h *= m;
+        }
+
+        const unsigned char* tail = (const unsigned char*)data;
+        switch (len & 7) {
+            case 7: h ^= uint64_t(tail[6]) << 48;   // fall through
+            case 6: h ^= uint64_t(tail[5]) << 40;   // fall through
+            case 5: h ^= uint64_t(tail[4]) << 32;   // fall through
+            case 4: h ^= uint64_t(tail[3]) << 24;   // fall through
+            case 3: h ^= uint64_t(tail[2]) << 16;   // fall through
+            case 2: h ^= uint64_t(tail[1]) << 8;    // fall through
+            case 1: h ^= uint64_t(tail[0]);
+                    h *= m;
+        }
+
+        h ^= h >> r;
+        h *= m;
+        h ^= h >> r;
+        return h;
+    }
+};
+
 } // namespace detail
 
 typedef detail::hash_map_base<const char*, size_t, detail::hsieh_hash_fun> char_int_hash_map;
@@ -132,6 +174,10 @@ typedef detail::hash_map_base<const char*, size_t, detail::hsieh_hash_fun> char_
 inline uint32_t strhash(const std::string& a_str) { return detail::hsieh_hash_fun::hash(a_str); }
 inline uint32_t strhash(const char* a_str)        { return detail::hsieh_hash_fun::hash(a_str); }
 
+inline uint64_t strong_hash(const char* a_data, size_t n) {
+    return detail::murmur_hash64a_fun()(a_data, n);
+}
+
 } // namespace replog
 
 #endif // _REPLOG_HASHTABLE_HPP_
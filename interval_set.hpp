@@ -0,0 +1,117 @@
+//----------------------------------------------------------------------------
+/// \file  interval_set.hpp
+//----------------------------------------------------------------------------
+/// \brief Set of disjoint byte ranges of a file.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _REPLOG_INTERVAL_SET_HPP_
+#define _REPLOG_INTERVAL_SET_HPP_
+
+#include <map>
+#include <algorithm>
+#include <stdint.h>
+
+namespace replog {
+
+/**
+ * \brief Set of half-open ranges [begin, end) of uint64_t offsets.
+ * Adjacent and overlapping ranges are merged on insertion, so the set
+ * holds as many entries as there are gaps between received data.  Used
+ * to track which parts of a file transferred out of order are complete.
+ */
+class interval_set {
+public:
+    typedef std::map<uint64_t, uint64_t>    map_type;   // begin -> end
+    typedef map_type::const_iterator        const_iterator;
+
+    interval_set() : m_bytes(0) {}
+
+    /// Add range [\a a_begin, \a a_end).
+    void insert(uint64_t a_begin, uint64_t a_end) {
+        if (a_begin >= a_end)
+            return;
+        // Merge with a range that starts before a_begin and reaches it
+        map_type::iterator it = m_ranges.upper_bound(a_begin);
+        if (it != m_ranges.begin()) {
+            map_type::iterator prev = it;
+            if ((--prev)->second >= a_begin) {
+                if (prev->second >= a_end)
+                    return;
+                a_begin = prev->first;
+                it      = prev;
+            }
+        }
+        // Absorb ranges that start within the new one
+        while (it != m_ranges.end() && it->first <= a_end) {
+            a_end    = std::max(a_end, it->second);
+            m_bytes -= it->second - it->first;
+            m_ranges.erase(it++);
+        }
+        m_ranges[a_begin] = a_end;
+        m_bytes += a_end - a_begin;
+    }
+
+    /// True if range [\a a_begin, \a a_end) is entirely in the set.
+    bool contains(uint64_t a_begin, uint64_t a_end) const {
+        if (a_begin >= a_end)
+            return true;
+        const_iterator it = m_ranges.upper_bound(a_begin);
+        if (it == m_ranges.begin())
+            return false;
+        --it;
+        return it->second >= a_end;
+    }
+
+    /// End of the range covering \a a_from, or \a a_from if it isn't
+    /// covered.  contiguous(0) is the size of the complete prefix.
+    uint64_t contiguous(uint64_t a_from = 0) const {
+        const_iterator it = m_ranges.upper_bound(a_from);
+        if (it == m_ranges.begin())
+            return a_from;
+        --it;
+        return it->second > a_from ? it->second : a_from;
+    }
+
+    /// Total bytes covered.
+    uint64_t bytes()  const { return m_bytes; }
+    /// Number of disjoint ranges.
+    size_t   size()   const { return m_ranges.size(); }
+    bool     empty()  const { return m_ranges.empty(); }
+    void     clear()        { m_ranges.clear(); m_bytes = 0; }
+
+    const_iterator begin() const { return m_ranges.begin(); }
+    const_iterator end()   const { return m_ranges.end(); }
+
+private:
+    map_type m_ranges;
+    uint64_t m_bytes;
+};
+
+} // namespace replog
+
+#endif // _REPLOG_INTERVAL_SET_HPP_
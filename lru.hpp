@@ -32,17 +32,21 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #ifndef _REPLOG_LRU_HPP_
 #define _REPLOG_LRU_HPP_
 
-#include <exception>
+#include <stddef.h>
 #include <assert.h>
 
 namespace replog {
 
-/// \brienf Implements a node of a double-linked list.
+/// \brief Implements a node of a double-linked list.
+/// The \a data member comes first, so that a pointer to the data can be
+/// converted back to its node.
 template <typename T>
 struct lru_node {
-    T       data;
-    lru<T>* prev;
-    lru<T>* next;
+    T               data;
+    lru_node<T>*    prev;
+    lru_node<T>*    next;
+
+    lru_node() : data(), prev(NULL), next(NULL) {}
 
     template <class Arg1>
     lru_node(Arg1 a1) : data(a1), prev(NULL), next(NULL) {}
@@ -63,11 +67,13 @@ struct lru_node {
         : data(a1, a2, a3, a4, a5), prev(NULL), next(NULL) {}
 
     template <class Arg1, class Arg2, class Arg3, class Arg4, class Arg5, class Arg6>
-    lru_node(Arg1 a1, Arg2 a2, Arg3 a3, Arg4 a4, Arg5 a5, Arg6)
+    lru_node(Arg1 a1, Arg2 a2, Arg3 a3, Arg4 a4, Arg5 a5, Arg6 a6)
         : data(a1, a2, a3, a4, a5, a6), prev(NULL), next(NULL) {}
 };
 
-/// \brienf Implements LRU double-linked list.
+/// \brief Implements LRU double-linked list.
+/// The most recently used node is at the head, the eviction candidate
+/// at the tail.
 template <typename T>
 class lru {
 protected:
@@ -78,42 +84,48 @@ public:
     lru(bool a_owner = false) : m_head(NULL), m_tail(NULL), m_owner(a_owner) {}
     ~lru() {
         if (m_owner) {
-            for (lru_node* next; m_head; m_head = next) {
+            for (lru_node<T>* next; m_head; m_head = next) {
                next = m_head->next;
                delete m_head;
             }
         }
     }
 
-    lru_node<T*> node(T* a_node) const { return reinterpret_cast<lru_node<T>*>(a_node); }
+    static lru_node<T>* node(T* a_data) { return reinterpret_cast<lru_node<T>*>(a_data); }
+
+    bool empty() const { return m_head == NULL; }
 
-    T* head() { return m_head ? m_head->data : NULL; }
-    T* tail() { return m_tail ? m_tail->data : NULL; }
+    T* head() { return m_head ? &m_head->data : NULL; }
+    T* tail() { return m_tail ? &m_tail->data : NULL; }
 
-    T* next(T* a_node) {
-        assert(a_node != NULL);
-        return reinterpret_cast<lru_node<T>*>(a_node)->next;
+    T* next(T* a_data) {
+        assert(a_data != NULL);
+        lru_node<T>* p = node(a_data)->next;
+        return p ? &p->data : NULL;
     }
 
-    T* prev(T* a_node) {
-        assert(a_node != NULL);
-        return reinterpret_cast<lru_node<T>*>(a_node)->prev;
+    T* prev(T* a_data) {
+        assert(a_data != NULL);
+        lru_node<T>* p = node(a_data)->prev;
+        return p ? &p->data : NULL;
     }
 
     /// Add a \a a_node to the head of the LRU list.
     void add(lru_node<T>* a_node) {
         a_node->prev = NULL;
         a_node->next = m_head;
+        if (m_head)
+            m_head->prev = a_node;
         m_head = a_node;
         if (m_tail == NULL)
             m_tail = m_head;
     }
 
-    /// Remove a \a a_node from the LRU list. The node
+    /// Remove a \a a_data from the LRU list. The node
     /// must be part of the list. The caller is responsible
     /// for freeing the removed node.
-    lru_node<T>* remove(T* a_node) {
-        lru_node<T>* p = reinterpret_cast<lru_node<T>*>(a_node);
+    lru_node<T>* remove(T* a_data) {
+        lru_node<T>* p = node(a_data);
         remove(p);
         return p;
     }
@@ -126,19 +138,20 @@ public:
             a_node->prev->next = a_node->next;
         else {
             assert(m_head == a_node);
-            m_head = NULL;
+            m_head = a_node->next;
         }
         if (a_node->next != NULL)
             a_node->next->prev = a_node->prev;
         else {
             assert(m_tail == a_node);
-            m_tail = a_node->prev ? a_node->prev : m_head;
+            m_tail = a_node->prev;
         }
+        a_node->prev = a_node->next = NULL;
     }
 
-    /// Move the \a a_node to the head of the LRU list.
-    void use(T* a_node) {
-        use(reinterpret_cast<lru_node<T>*>(a_node));
+    /// Move the \a a_data to the head of the LRU list.
+    void use(T* a_data) {
+        use(node(a_data));
     }
 
     /// Move the \a a_node to the head of the LRU list.
@@ -150,10 +163,10 @@ public:
     }
 };
 
-/// \brienf Implements LRU double-linked list of fixed size.
+/// \brief Implements LRU double-linked list of fixed size.
 /// When a node is added to the LRU list so that the list
-/// reaches its maximum fixed size, the oldest node is 
-/// deleted from the list.
+/// exceeds its maximum fixed size, the oldest node is
+/// removed from the list.
 template <typename T>
 class lru_fixed_size: protected lru<T> {
     size_t m_max_size;
@@ -161,35 +174,40 @@ class lru_fixed_size: protected lru<T> {
 
     typedef lru<T> base;
 public:
-    lru_fixed_size(size_t max_size, bool a_owner = false)
+    lru_fixed_size(size_t a_max_size, bool a_owner = false)
         : base(a_owner), m_max_size(a_max_size), m_count(0)
     {}
 
+    using base::node;
+    using base::empty;
+    using base::head;
+    using base::tail;
+    using base::next;
+    using base::prev;
+    using base::use;
+
     size_t max_size()  const { return m_max_size; }
     size_t size()      const { return m_count;    }
 
     /// Add a \a a_node to the head of the LRU list.
     /// If addition of \a a_node increases the node count
-    /// in the list to max_size(), the oldest node is
+    /// in the list above max_size(), the oldest node is
     /// removed from the list and returned.  Otherwise
     /// the function returns NULL.  It is the responsibility
     /// of the caller to delete that node.
     lru_node<T>* add(lru_node<T>* a_node) {
-        if (m_count < m_max_size) {
-            base::add(a_node);
-            m_count++;
+        base::add(a_node);
+        if (++m_count <= m_max_size)
             return NULL;
-        }
-        lru_node<T>* old = m_tail;
-        base::remove(old);
-        m_count--;
+        lru_node<T>* old = this->m_tail;
+        remove(old);
         return old;
     }
 
-    /// Remove a \a a_node from the LRU list. The node
+    /// Remove a \a a_data from the LRU list. The node
     /// must be part of the list.
-    lru_node<T>* remove(T* a_node) {
-        lru_node<T>* p = reinterpret_cast<lru_node<T>*>(a_node);
+    lru_node<T>* remove(T* a_data) {
+        lru_node<T>* p = node(a_data);
         remove(p);
         return p;
     }
@@ -200,6 +218,8 @@ public:
         base::remove(a_node);
         m_count--;
     }
+};
+
 } // namespace replog
 
 #endif // _REPLOG_LRU_HPP_
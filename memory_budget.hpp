@@ -0,0 +1,183 @@
+//----------------------------------------------------------------------------
+/// \file  memory_budget.hpp
+//----------------------------------------------------------------------------
+/// \brief Process-wide accounting of memory held by buffers, pools and
+/// caches against a global limit.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _REPLOG_MEMORY_BUDGET_HPP_
+#define _REPLOG_MEMORY_BUDGET_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <boost/noncopyable.hpp>
+#include <replog/atomic.hpp>
+#include <replog/error.hpp>
+
+namespace replog {
+
+/**
+ * \brief Component able to give memory back under pressure, e.g. a cache.
+ */
+struct memory_reclaimer {
+    virtual ~memory_reclaimer() {}
+    /// Free about \a a_bytes of memory.
+    /// @return number of bytes freed.
+    virtual size_t reclaim(size_t a_bytes) = 0;
+};
+
+/**
+ * \brief Process-wide memory accountant.
+ * Every growable buffer, buffer pool and cache reserves its memory with
+ * acquire() before allocating it and returns it with release().  The sum
+ * never exceeds limit(): an acquire() over the limit throws, a
+ * try_acquire() fails.  When usage crosses the high watermark pressure()
+ * turns on, and it stays on until usage drops below the low watermark.
+ * Under pressure reactors stop reading from sockets and ask their
+ * reclaimers to shrink caches, so usage falls back before the hard limit
+ * is reached.
+ *
+ * Each thread keeps a credit of up to 2 * s_slab bytes reserved from the
+ * shared counter.  Most acquire() and release() calls only adjust this
+ * thread-local credit; the shared counter is touched once per slab.
+ * Credits count as used, and a thread returns its credit with flush()
+ * before it exits.
+ */
+class memory_budget: boost::noncopyable {
+public:
+    static const int64_t s_slab = 256 * 1024;
+
+    static memory_budget& instance() {
+        static memory_budget s_budget;
+        return s_budget;
+    }
+
+    /// Limit usage to \a a_bytes (0 - unlimited).  Pressure starts above
+    /// \a a_high_pct percent of the limit and ends below \a a_low_pct.
+    void limit(size_t a_bytes, int a_high_pct = 90, int a_low_pct = 75) {
+        m_limit = a_bytes;
+        m_high  = a_bytes / 100 * a_high_pct;
+        m_low   = a_bytes / 100 * a_low_pct;
+        update(used());
+    }
+
+    size_t   limit()    const { return m_limit; }
+    /// Usage below which pressure ends.
+    size_t   low_watermark() const { return m_low; }
+    /// Bytes reserved by all threads, including their credits.
+    size_t   used()     const { return atomic::load_relaxed(m_used); }
+    bool     pressure() const { return atomic::load_relaxed(m_pressure); }
+    /// Number of acquisitions refused for the limit.
+    uint64_t failures() const { return atomic::load_relaxed(m_failures); }
+
+    /// Account \a n bytes to be allocated by the calling thread.
+    /// @return false if that would exceed the limit.
+    bool try_acquire(size_t n) {
+        int64_t& c = credit();
+        if (c >= (int64_t)n) {
+            c -= n;
+            return true;
+        }
+        int64_t need = n - c;
+        int64_t grab = need + s_slab;
+        if (!take(grab) && !take(grab = need)) {
+            atomic::add_relaxed(m_failures, (uint64_t)1);
+            return false;
+        }
+        c += grab - n;
+        return true;
+    }
+
+    /// Account \a n bytes to be allocated.  Throws if that would exceed
+    /// the limit.
+    void acquire(size_t n) throw(io_error) {
+        if (!try_acquire(n))
+            throw io_error("Memory budget exceeded (limit=", m_limit, ", used=", used(), ")");
+    }
+
+    /// Account \a n bytes freed by the calling thread.
+    void release(size_t n) {
+        int64_t& c = credit();
+        c += n;
+        if (c > 2 * s_slab) {
+            int64_t k = c - s_slab;
+            c = s_slab;
+            give(k);
+        }
+    }
+
+    /// Return the credit of the calling thread to the shared counter.
+    void flush() {
+        int64_t& c = credit();
+        if (c) {
+            give(c);
+            c = 0;
+        }
+    }
+
+private:
+    size_t   m_limit;
+    size_t   m_high;
+    size_t   m_low;
+    size_t   m_used;
+    bool     m_pressure;
+    uint64_t m_failures;
+
+    memory_budget()
+        : m_limit(0), m_high(0), m_low(0), m_used(0), m_pressure(false), m_failures(0)
+    {}
+
+    static int64_t& credit() {
+        static __thread int64_t s_credit;
+        return s_credit;
+    }
+
+    bool take(int64_t n) {
+        size_t u = atomic::add_relaxed(m_used, (size_t)n) + n;
+        if (m_limit && u > m_limit) {
+            atomic::sub_relaxed(m_used, (size_t)n);
+            return false;
+        }
+        update(u);
+        return true;
+    }
+
+    void give(int64_t n) {
+        update(atomic::sub_relaxed(m_used, (size_t)n) - n);
+    }
+
+    void update(size_t a_used) {
+        bool p = m_limit && (a_used > m_high || (pressure() && a_used >= m_low));
+        if (p != pressure())
+            atomic::store_relaxed(m_pressure, p);
+    }
+};
+
+} // namespace replog
+
+#endif // _REPLOG_MEMORY_BUDGET_HPP_
@@ -0,0 +1,242 @@
+//----------------------------------------------------------------------------
+/// \file  mmap_reader.cpp
+//----------------------------------------------------------------------------
+/// \brief Sender-side reader of source files through mapped windows.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#include <replog/mmap_reader.hpp>
+#include <replog/record_index.hpp>
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace replog {
+
+namespace {
+    __thread sigjmp_buf* t_sigbus_jmp;
+    struct sigaction     s_old_sigbus;
+    pthread_once_t       s_sigbus_once = PTHREAD_ONCE_INIT;
+    pthread_mutex_t      s_sigbus_lock = PTHREAD_MUTEX_INITIALIZER;
+
+    void sigbus_handler(int a_sig, siginfo_t* a_info, void* a_ctx) {
+        if (t_sigbus_jmp)
+            siglongjmp(*t_sigbus_jmp, 1);
+        // Not a guarded access: chain to the previous handler, staying
+        // installed for guard() calls of other threads
+        if (s_old_sigbus.sa_flags & SA_SIGINFO) {
+            s_old_sigbus.sa_sigaction(a_sig, a_info, a_ctx);
+            return;
+        }
+        if (s_old_sigbus.sa_handler != SIG_DFL && s_old_sigbus.sa_handler != SIG_IGN) {
+            s_old_sigbus.sa_handler(a_sig);
+            return;
+        }
+        if (s_old_sigbus.sa_handler == SIG_IGN && a_info->si_code <= 0)
+            return;
+        // A fault can't be ignored, the default action terminates the
+        // process: restore it for the faulting instruction to be retried
+        signal(SIGBUS, SIG_DFL);
+        if (a_info->si_code <= 0)
+            raise(a_sig);
+    }
+
+    /// Install the handler unless it's installed.  Whoever replaced it
+    /// since (e.g. a test harness around each test case) becomes the
+    /// handler it chains to.
+    void install_sigbus_handler() {
+        pthread_mutex_lock(&s_sigbus_lock);
+        struct sigaction cur;
+        if (sigaction(SIGBUS, NULL, &cur) < 0 || !(cur.sa_flags & SA_SIGINFO)
+         || cur.sa_sigaction != sigbus_handler) {
+            struct sigaction sa;
+            memset(&sa, 0, sizeof(sa));
+            sa.sa_sigaction = sigbus_handler;
+            // SA_NODEFER leaves SIGBUS unblocked after siglongjmp, so that
+            // guard() doesn't need to save the signal mask on every call
+            sa.sa_flags     = SA_SIGINFO | SA_NODEFER;
+            sigemptyset(&sa.sa_mask);
+            sigaction(SIGBUS, &sa, &s_old_sigbus);
+        }
+        pthread_mutex_unlock(&s_sigbus_lock);
+    }
+
+    struct scan_args {
+        const char* ptr;
+        size_t      len;
+        char        delim;
+        size_t      result;
+    };
+
+    void scan(void* a_arg) {
+        scan_args* a = static_cast<scan_args*>(a_arg);
+        a->result = record_boundary(a->ptr, a->len, a->delim);
+    }
+
+    struct copy_args {
+        char*       dst;
+        const char* src;
+        size_t      len;
+    };
+
+    void copy_data(void* a_arg) {
+        copy_args* a = static_cast<copy_args*>(a_arg);
+        memcpy(a->dst, a->src, a->len);
+    }
+}
+
+const size_t mmap_reader::s_default_window;
+
+mmap_reader::mmap_reader(size_t a_window)
+    : m_fd(-1), m_size(0), m_truncated(false)
+{
+    size_t page = sysconf(_SC_PAGESIZE);
+    m_window = std::max(page, (a_window + page - 1) / page * page);
+}
+
+void mmap_reader::open(const std::string& a_name) throw(io_error)
+{
+    close();
+    if ((m_fd = ::open(a_name.c_str(), O_RDONLY)) < 0)
+        throw io_error(errno, a_name.c_str());
+    m_name      = a_name;
+    m_size      = 0;
+    m_truncated = false;
+    // The handler may have been replaced since guard() installed it
+    install_sigbus_handler();
+    try {
+        refresh();
+    } catch (...) {
+        close();
+        throw;
+    }
+}
+
+void mmap_reader::close()
+{
+    release((uint64_t)-1);
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+void mmap_reader::refresh() throw(io_error)
+{
+    struct stat st;
+    if (fstat(m_fd, &st) < 0)
+        throw io_error(errno, "fstat");
+    if ((uint64_t)st.st_size < m_size)
+        m_truncated = true;
+    m_size = st.st_size;
+}
+
+size_t mmap_reader::read(uint64_t a_offset, size_t n, const char*& a_ptr) throw(io_error)
+{
+    if (a_offset + n > m_size)
+        refresh();
+    if (a_offset >= m_size)
+        return 0;
+    n = std::min<uint64_t>(n, m_size - a_offset);
+
+    for (size_t i = m_windows.size(); i-- > 0; ) {
+        const window& w = m_windows[i];
+        if (a_offset >= w.offset && a_offset + n <= w.offset + w.len) {
+            a_ptr = w.base + (a_offset - w.offset);
+            return n;
+        }
+    }
+
+    window w;
+    w.offset = a_offset & ~(uint64_t)(sysconf(_SC_PAGESIZE) - 1);
+    w.len    = m_window;
+    if (a_offset + n > w.offset + w.len)
+        throw io_error("Read of ", n, " bytes exceeds mmap window of ", m_window);
+    void* p  = mmap(NULL, w.len, PROT_READ, MAP_SHARED, m_fd, w.offset);
+    if (p == MAP_FAILED)
+        throw io_error(errno, "mmap");
+    w.base   = static_cast<char*>(p);
+    madvise(w.base, w.len, MADV_SEQUENTIAL);
+    m_windows.push_back(w);
+    a_ptr = w.base + (a_offset - w.offset);
+    return n;
+}
+
+void mmap_reader::release(uint64_t a_offset)
+{
+    size_t j = 0;
+    for (size_t i = 0; i < m_windows.size(); ++i) {
+        const window& w = m_windows[i];
+        if (w.offset + w.len <= a_offset)
+            munmap(w.base, w.len);
+        else
+            m_windows[j++] = w;
+    }
+    m_windows.resize(j);
+}
+
+size_t mmap_reader::boundary(const char* a_ptr, size_t n, char a_delim)
+{
+    scan_args a = { a_ptr, n, a_delim, 0 };
+    if (guard(scan, &a))
+        return a.result;
+    m_truncated = true;
+    return 0;
+}
+
+bool mmap_reader::copy(char* a_dst, const char* a_src, size_t n)
+{
+    copy_args a = { a_dst, a_src, n };
+    if (guard(copy_data, &a))
+        return true;
+    m_truncated = true;
+    return false;
+}
+
+bool mmap_reader::guard(void (*a_fn)(void*), void* a_arg)
+{
+    pthread_once(&s_sigbus_once, install_sigbus_handler);
+    sigjmp_buf  jb;
+    sigjmp_buf* prev = t_sigbus_jmp;
+    if (sigsetjmp(jb, 0)) {
+        t_sigbus_jmp = prev;
+        return false;
+    }
+    t_sigbus_jmp = &jb;
+    a_fn(a_arg);
+    t_sigbus_jmp = prev;
+    return true;
+}
+
+} // namespace replog
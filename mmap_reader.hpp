@@ -0,0 +1,125 @@
+//----------------------------------------------------------------------------
+/// \file  mmap_reader.hpp
+//----------------------------------------------------------------------------
+/// \brief Sender-side reader of source files through sliding memory
+/// mapped windows.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _REPLOG_MMAP_READER_HPP_
+#define _REPLOG_MMAP_READER_HPP_
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <boost/noncopyable.hpp>
+#include <replog/error.hpp>
+
+namespace replog {
+
+/**
+ * \brief Reader of a tailed source file through memory mapped windows.
+ * read() returns a pointer into a read-only shared mapping of the file
+ * instead of copying the data into a buffer, so a chunk can be passed to
+ * writev() (e.g. with connection::send(hdr, len, payload, n)) and reach
+ * the socket without being copied in user space.  Windows are mapped in
+ * large page-aligned pieces with MADV_SEQUENTIAL; a window covers space
+ * past the end of file, so appends become visible without remapping, and
+ * a new window is mapped only when a read crosses the end of the last
+ * one.  A window stays mapped while its data may still be referenced,
+ * i.e. until release() reports it acknowledged.
+ *
+ * Touching a mapped page past the end of a truncated file raises SIGBUS.
+ * Accesses done by the reader on behalf of the caller (boundary() and
+ * copy()) are guarded: the fault is caught and reported as a truncation.
+ * The kernel reports such a fault inside writev() as EFAULT.  open()
+ * reinstalls the SIGBUS handler if it was replaced since it was installed.
+ */
+class mmap_reader: boost::noncopyable {
+public:
+    static const size_t s_default_window = 64 * 1024 * 1024;
+
+    explicit mmap_reader(size_t a_window = s_default_window);
+    ~mmap_reader() { close(); }
+
+    /// Open file \a a_name for reading.
+    void open(const std::string& a_name) throw(io_error);
+    /// Unmap all windows and close the file.
+    void close();
+
+    /// Map up to \a n bytes at \a a_offset and set \a a_ptr to them.
+    /// The size of the file is refreshed when the range goes past it.
+    /// \a n must not exceed the window size.
+    /// @return number of bytes available at \a a_ptr, 0 at end of file.
+    size_t read(uint64_t a_offset, size_t n, const char*& a_ptr) throw(io_error);
+
+    /// Data before \a a_offset is no longer referenced: unmap windows
+    /// that lie entirely below it.
+    void release(uint64_t a_offset);
+
+    /// End of the last complete record in \a n mapped bytes at \a a_ptr
+    /// (see record_boundary()).  Returns 0 if the file was truncated
+    /// under the range.
+    size_t boundary(const char* a_ptr, size_t n, char a_delim = '\n');
+
+    /// Copy \a n mapped bytes at \a a_src to \a a_dst.
+    /// @return false if the file was truncated under the range.
+    bool copy(char* a_dst, const char* a_src, size_t n);
+
+    /// Update the size of the file.  A file shrinking below its known
+    /// size is flagged as truncated.
+    void refresh() throw(io_error);
+
+    bool     is_open()   const { return m_fd >= 0; }
+    int      fd()        const { return m_fd; }
+    uint64_t size()      const { return m_size; }
+    bool     truncated() const { return m_truncated; }
+    size_t   windows()   const { return m_windows.size(); }
+    const std::string& name() const { return m_name; }
+
+    /// Call \a a_fn(\a a_arg) catching SIGBUS raised by the calling
+    /// thread.  Returns false if the call was interrupted by the signal.
+    static bool guard(void (*a_fn)(void*), void* a_arg);
+
+private:
+    struct window {
+        char*    base;
+        uint64_t offset;    // File offset of base, page aligned
+        size_t   len;
+    };
+
+    std::string         m_name;
+    int                 m_fd;
+    size_t              m_window;
+    uint64_t            m_size;
+    bool                m_truncated;
+    std::vector<window> m_windows;  // The last one is used first
+};
+
+} // namespace replog
+
+#endif // _REPLOG_MMAP_READER_HPP_
@@ -0,0 +1,749 @@
+//----------------------------------------------------------------------------
+/// \file  pipeline.cpp
+//----------------------------------------------------------------------------
+/// \brief Receiver pipeline decoupling the network stage from disk
+/// stages sharded by file.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#include <replog/pipeline.hpp>
+#include <replog/memory_budget.hpp>
+#include <replog/proto.hpp>
+#include <replog/trace.hpp>
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+namespace replog {
+
+namespace {
+
+    /// Busy-poll iterations before a disk thread blocks on its event
+    const int s_spin_count = 256;
+
+    int futex(uint32_t* a_addr, int a_op, uint32_t a_val, const timespec* a_timeout) {
+        return syscall(SYS_futex, a_addr, a_op, a_val, a_timeout, NULL, 0);
+    }
+
+    uint64_t now_ns() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+    }
+}
+
+//----------------------------------------------------------------------------
+// stage_event
+//----------------------------------------------------------------------------
+
+stage_event::stage_event(bool a_eventfd) throw(io_error)
+    : m_seq(0), m_waiters(0), m_efd(-1)
+{
+    if (a_eventfd && (m_efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0)
+        throw io_error(errno, "eventfd");
+}
+
+stage_event::~stage_event()
+{
+    if (m_efd >= 0)
+        ::close(m_efd);
+}
+
+void stage_event::wait(uint32_t a_seq, int a_timeout_ms) throw(io_error)
+{
+    timespec  ts;
+    timespec* timeout = NULL;
+    if (a_timeout_ms >= 0) {
+        ts.tv_sec  = a_timeout_ms / 1000;
+        ts.tv_nsec = a_timeout_ms % 1000 * 1000000l;
+        timeout    = &ts;
+    }
+    int rc  = futex(&m_seq, FUTEX_WAIT_PRIVATE, a_seq, timeout);
+    int err = errno;
+    atomic::sub_relaxed(m_waiters, 1u);
+    if (rc < 0 && err != EAGAIN && err != EINTR && err != ETIMEDOUT)
+        throw io_error(err, "futex");
+}
+
+void stage_event::clear()
+{
+    uint64_t n;
+    if (m_efd >= 0 && ::read(m_efd, &n, sizeof(n)) < 0) {
+        // Not signalled, nothing to reset
+    }
+    atomic::sub_relaxed(m_waiters, 1u);
+}
+
+void stage_event::wake()
+{
+    if (m_efd < 0) {
+        futex(&m_seq, FUTEX_WAKE_PRIVATE, INT_MAX, NULL);
+        return;
+    }
+    uint64_t one = 1;
+    if (::write(m_efd, &one, sizeof(one)) < 0) {
+        // The counter is already non-zero: the waiter is woken anyway
+    }
+}
+
+//----------------------------------------------------------------------------
+// apply_pipeline
+//----------------------------------------------------------------------------
+
+apply_pipeline::apply_pipeline(disk_handler& a_handler, const options& a_opts)
+    throw(io_error)
+    : m_handler(a_handler), m_opts(a_opts), m_cur(NULL), m_rd(0), m_wr(0)
+    , m_net_event(true), m_stalls(0), m_stopping(false), m_failed(false)
+{
+    if (a_opts.shards < 1)
+        throw io_error("Invalid number of pipeline shards:", a_opts.shards);
+    if (a_opts.block_size < 4096 || a_opts.max_blocks < 2)
+        throw io_error("Invalid pipeline blocks (size=", a_opts.block_size,
+                       ", count=", a_opts.max_blocks, ")");
+    pthread_mutex_init(&m_error_lock, NULL);
+    for (int i = 0; i < a_opts.shards; ++i)
+        m_shards.push_back(new shard_state(this, i, a_opts.queue_depth));
+}
+
+apply_pipeline::~apply_pipeline()
+{
+    stop();
+    for (size_t i = 0; i < m_shards.size(); ++i)
+        delete m_shards[i];
+    for (size_t i = 0; i < m_blocks.size(); ++i) {
+        delete [] m_blocks[i]->data;
+        delete m_blocks[i];
+        memory_budget::instance().release(m_opts.block_size);
+    }
+    pthread_mutex_destroy(&m_error_lock);
+}
+
+void apply_pipeline::start() throw(io_error)
+{
+    m_stopping = false;
+    for (size_t i = 0; i < m_shards.size(); ++i) {
+        shard_state& s = *m_shards[i];
+        s.finished = false;
+        int err = pthread_create(&s.thread, NULL, disk_thread, &s);
+        if (err)
+            throw io_error(err, "pthread_create");
+        s.running = true;
+    }
+}
+
+void apply_pipeline::stop()
+{
+    atomic::store_release(m_stopping, true);
+    for (size_t i = 0; i < m_shards.size(); ++i)
+        m_shards[i]->event.notify();
+    for (size_t i = 0; i < m_shards.size(); ++i) {
+        shard_state& s = *m_shards[i];
+        if (!s.running)
+            continue;
+        // Keep draining completions, a disk thread may be blocked on them
+        while (!atomic::load_acquire(s.finished)) {
+            drain();
+            if (prepare_wait()) {
+                pollfd pfd = { m_net_event.fd(), POLLIN, 0 };
+                ::poll(&pfd, 1, 1);
+                end_wait();
+            }
+        }
+        pthread_join(s.thread, NULL);
+        s.running = false;
+    }
+    drain();
+}
+
+char* apply_pipeline::input(size_t& a_avail) throw(io_error)
+{
+    size_t want = m_opts.block_size / 4;
+    // Rewind a block that no record references anymore
+    if (m_cur && m_rd == m_wr && atomic::load_acquire(m_cur->refs) == 1)
+        m_rd = m_wr = 0;
+    if (!m_cur || m_opts.block_size - m_wr < want) {
+        size_t left = m_wr - m_rd;
+        if (left > m_opts.block_size - want)
+            throw io_error("Frame exceeds pipeline block size:", m_opts.block_size);
+        frame_block* b;
+        while (!(b = allocate()))
+            wait_disk();
+        // Only the incomplete frame at the end moves to the new block
+        if (m_cur) {
+            memcpy(b->data, m_cur->data + m_rd, left);
+            release(m_cur);
+        }
+        m_cur = b;
+        m_rd  = 0;
+        m_wr  = left;
+    }
+    a_avail = m_opts.block_size - m_wr;
+    return m_cur->data + m_wr;
+}
+
+void apply_pipeline::submit(const disk_record& a_rec) throw(io_error)
+{
+    disk_record r = a_rec;
+    r.block = m_cur;
+    if (m_cur)
+        atomic::add_relaxed(m_cur->refs, 1u);
+    shard_state& s = *m_shards[shard(r.id)];
+    while (!s.queue.push(r))
+        wait_disk();
+    s.submitted++;
+    s.event.notify();
+}
+
+size_t apply_pipeline::queued() const
+{
+    size_t n = 0;
+    for (size_t i = 0; i < m_shards.size(); ++i)
+        n += m_shards[i]->submitted - atomic::load_relaxed(m_shards[i]->applied);
+    return n;
+}
+
+size_t apply_pipeline::poll(std::vector<disk_completion>& a_done) throw(io_error)
+{
+    collect();
+    size_t n = m_ready.size();
+    a_done.insert(a_done.end(), m_ready.begin(), m_ready.end());
+    m_ready.clear();
+    return n;
+}
+
+bool apply_pipeline::prepare_wait()
+{
+    m_net_event.prepare();
+    bool pending = !m_ready.empty() || atomic::load_acquire(m_failed);
+    for (size_t i = 0; i < m_shards.size() && !pending; ++i)
+        pending = !m_shards[i]->done.empty();
+    if (pending)
+        m_net_event.cancel();
+    return !pending;
+}
+
+void apply_pipeline::collect() throw(io_error)
+{
+    if (atomic::load_acquire(m_failed)) {
+        pthread_mutex_lock(&m_error_lock);
+        std::string err = m_error;
+        pthread_mutex_unlock(&m_error_lock);
+        throw io_error("Disk stage failed: ", err.c_str());
+    }
+    drain();
+}
+
+void apply_pipeline::drain()
+{
+    disk_completion d;
+    for (size_t i = 0; i < m_shards.size(); ++i)
+        while (m_shards[i]->done.pop(d)) {
+            if (d.block)
+                m_free.push_back(d.block);
+            if (d.progress)
+                m_ready.push_back(d);
+        }
+}
+
+frame_block* apply_pipeline::allocate() throw(io_error)
+{
+    frame_block* b = NULL;
+    if (!m_free.empty()) {
+        b = m_free.back();
+        m_free.pop_back();
+    } else if (m_blocks.size() < m_opts.max_blocks) {
+        memory_budget::instance().acquire(m_opts.block_size);
+        b = new frame_block;
+        b->data = new char[m_opts.block_size];
+        m_blocks.push_back(b);
+    } else
+        return NULL;
+    b->refs = 1;    // Held by the network stage
+    return b;
+}
+
+void apply_pipeline::release(frame_block* a_block)
+{
+    if (atomic::sub_acq_rel(a_block->refs, 1u) == 1)
+        m_free.push_back(a_block);
+}
+
+void apply_pipeline::wait_disk() throw(io_error)
+{
+    m_stalls++;
+    if (prepare_wait()) {
+        pollfd pfd = { m_net_event.fd(), POLLIN, 0 };
+        ::poll(&pfd, 1, 10);
+        end_wait();
+    }
+    collect();
+}
+
+void apply_pipeline::complete(shard_state& a_shard, const disk_completion& a_done)
+{
+    // The network stage drains completions whenever it waits, so a full
+    // queue only lasts until it gets to run
+    while (!a_shard.done.push(a_done)) {
+        m_net_event.notify();
+        sched_yield();
+    }
+    m_net_event.notify();
+}
+
+void apply_pipeline::run(shard_state& a_shard)
+{
+    bool worked = false;
+    for (;;) {
+        disk_record r;
+        if (a_shard.queue.pop(r)) {
+            disk_completion d;
+            d.progress = m_handler.apply(a_shard.index, r, d);
+            atomic::store_relaxed(a_shard.applied, a_shard.applied + 1);
+            if (r.block && atomic::sub_acq_rel(r.block->refs, 1u) == 1)
+                d.block = r.block;
+            if (d.progress || d.block)
+                complete(a_shard, d);
+            worked = true;
+            continue;
+        }
+        if (worked) {
+            a_shard.pending.clear();
+            m_handler.idle(a_shard.index, a_shard.pending);
+            for (size_t i = 0; i < a_shard.pending.size(); ++i) {
+                a_shard.pending[i].progress = true;
+                a_shard.pending[i].block    = NULL;
+                complete(a_shard, a_shard.pending[i]);
+            }
+            worked = false;
+            continue;
+        }
+        if (atomic::load_acquire(m_stopping))
+            break;
+        int i = 0;
+        while (i < s_spin_count && a_shard.queue.empty() && !atomic::load_relaxed(m_stopping)) {
+            atomic::pause();
+            ++i;
+        }
+        if (i < s_spin_count)
+            continue;
+        uint32_t seq = a_shard.event.prepare();
+        if (!a_shard.queue.empty() || atomic::load_acquire(m_stopping))
+            a_shard.event.cancel();
+        else
+            a_shard.event.wait(seq);
+    }
+}
+
+void* apply_pipeline::disk_thread(void* a_arg)
+{
+    shard_state& s = *static_cast<shard_state*>(a_arg);
+    try {
+        s.owner->run(s);
+    } catch (std::exception& e) {
+        pthread_mutex_lock(&s.owner->m_error_lock);
+        s.owner->m_error = e.what();
+        pthread_mutex_unlock(&s.owner->m_error_lock);
+        atomic::store_release(s.owner->m_failed, true);
+        s.owner->m_net_event.notify();
+    }
+    atomic::store_release(s.finished, true);
+    s.owner->m_net_event.notify();
+    return NULL;
+}
+
+//----------------------------------------------------------------------------
+// file_apply_handler
+//----------------------------------------------------------------------------
+
+file_apply_handler::file_apply_handler(int a_shards, const options& a_opts)
+    : m_opts(a_opts), m_files(a_shards)
+{
+    for (int i = 0; i < a_shards; ++i) {
+        m_commits.push_back(new group_commit(a_opts.durability, a_opts.sync_window,
+                                             a_opts.sync_window_bytes));
+        m_commits.back()->stats(a_opts.stats);
+    }
+}
+
+file_apply_handler::~file_apply_handler()
+{
+    for (size_t i = 0; i < m_commits.size(); ++i)
+        delete m_commits[i];
+    for (size_t i = 0; i < m_files.size(); ++i)
+        for (size_t j = 0; j < m_files[i].size(); ++j)
+            delete m_files[i][j].writer;
+}
+
+bool file_apply_handler::apply(int a_shard, const disk_record& a_rec, disk_completion& a_done)
+{
+    if (a_rec.cmd == msg_base_header::GET_SIZE) {
+        open(a_shard, a_rec, a_done);
+        return true;
+    }
+    file_table& files = m_files[a_shard];
+    size_t      slot  = a_rec.id / m_commits.size();
+    if (slot >= files.size() || !files[slot].writer || !files[slot].writer->is_open())
+        throw io_error("File not open:", a_rec.id);
+    file_writer*  w   = files[slot].writer;
+    group_commit& gc  = *m_commits[a_shard];
+    uint64_t      len = 0;
+    if (a_rec.cmd == msg_base_header::APPEND) {
+        w->write(a_rec.data, a_rec.length, a_rec.offset);
+        w->flush();
+        REPLOG_TRACE(TRACE_WRITE, a_rec.id, a_rec.offset, a_rec.length);
+        len = a_rec.length;
+    } else if (a_rec.cmd == msg_base_header::HOLE)
+        w->hole(a_rec.offset, a_rec.length);
+    else
+        throw io_error("Unexpected command:", a_rec.cmd);
+    uint64_t now = now_ns();
+    gc.on_write(a_rec.id, w, w->size(), len, now);
+    if (gc.due(now))
+        gc.sync();
+    a_done.id        = a_rec.id;
+    a_done.name_hash = a_rec.name_hash;
+    a_done.cmd       = a_rec.cmd;
+    a_done.size      = w->size();
+    a_done.durable   = gc.durable(a_rec.id);
+    return true;
+}
+
+void file_apply_handler::open(int a_shard, const disk_record& a_rec, disk_completion& a_done)
+{
+    file_table& files = m_files[a_shard];
+    size_t      slot  = a_rec.id / m_commits.size();
+    if (slot >= files.size())
+        files.resize(slot + 1);
+    file_state&   f  = files[slot];
+    group_commit& gc = *m_commits[a_shard];
+    if (!f.writer)
+        f.writer = new file_writer;
+    else if (f.writer->is_open()) {
+        // Unsynced writes of the file must not outlive its reopening
+        gc.sync();
+        gc.remove(a_rec.id);
+    }
+    std::string name(a_rec.data, a_rec.length);
+    if (!m_opts.root.empty())
+        name = m_opts.root + '/' + name;
+    name += m_opts.suffix;
+    a_done.id        = a_rec.id;
+    a_done.name_hash = a_rec.name_hash;
+    a_done.cmd       = a_rec.cmd;
+    try {
+        f.writer->open(name, m_opts.writer);
+    } catch (io_error&) {
+        // The writer is left closed, the network stage reports the failure
+        return;
+    }
+    f.name_hash = a_rec.name_hash;
+    a_done.fd   = f.writer->fd();
+    a_done.size = f.writer->size();
+}
+
+void file_apply_handler::idle(int a_shard, std::vector<disk_completion>& a_done)
+{
+    // Acks wait for the sync, periodic syncs wait for the window
+    group_commit& gc = *m_commits[a_shard];
+    if (gc.get_mode() != group_commit::BEFORE_ACK || !gc.dirty())
+        return;
+    gc.sync();
+    const file_table& files = m_files[a_shard];
+    for (size_t i = 0; i < files.size(); ++i)
+        if (files[i].writer && files[i].writer->is_open()) {
+            disk_completion d;
+            d.id        = i * m_commits.size() + a_shard;
+            d.name_hash = files[i].name_hash;
+            d.size      = files[i].writer->size();
+            d.durable   = gc.durable(d.id);
+            a_done.push_back(d);
+        }
+}
+
+void file_apply_handler::sync() throw(io_error)
+{
+    for (size_t i = 0; i < m_commits.size(); ++i)
+        m_commits[i]->sync();
+}
+
+uint64_t file_apply_handler::syncs() const
+{
+    uint64_t n = 0;
+    for (size_t i = 0; i < m_commits.size(); ++i)
+        n += m_commits[i]->syncs();
+    return n;
+}
+
+file_writer* file_apply_handler::file(uint32_t a_id) const
+{
+    const file_table& files = m_files[a_id % m_commits.size()];
+    size_t            slot  = a_id / m_commits.size();
+    return slot < files.size() ? files[slot].writer : NULL;
+}
+
+//----------------------------------------------------------------------------
+// pipeline_receiver
+//----------------------------------------------------------------------------
+
+pipeline_receiver::pipeline_receiver(int a_fd, apply_pipeline& a_pipe, uint32_t a_max_files)
+    : m_fd(a_fd), m_pipe(a_pipe), m_max_files(a_max_files)
+    , m_bytes(0), m_hole_bytes(0), m_frames(0), m_dropped(0), m_stats(NULL)
+{}
+
+pipeline_receiver::~pipeline_receiver()
+{
+    for (size_t i = 0; i < m_files.size(); ++i)
+        if (m_files[i].stats)
+            m_stats->remove_file(i);
+}
+
+void pipeline_receiver::run() throw(io_error)
+{
+    for (;;) {
+        // Respond to the progress of the disk stages
+        m_done.clear();
+        m_pipe.poll(m_done);
+        for (size_t i = 0; i < m_done.size(); ++i)
+            complete(m_done[i]);
+
+        char*  p;
+        size_t n = m_pipe.peek(p);
+        while (n >= sizeof(msg_base_header)) {
+            msg_base_header* h = msg_base_header::decode_header(p, n);
+            size_t need = h->header_size();
+            if (n < need || n < (need += h->payload_size()))
+                break;
+            if (m_stats)
+                m_stats->on_frame(stats_layout::RX, h->cmd(), need);
+            dispatch(h, p);
+            m_pipe.consume(need);
+            n = m_pipe.peek(p);
+        }
+        if (m_stats)
+            m_stats->on_queue_depth(m_pipe.queued());
+        flush();
+
+        // Read more input, or wait for it and for disk progress
+        size_t  avail;
+        char*   q = m_pipe.input(avail);
+        ssize_t k = ::recv(m_fd, q, avail, MSG_DONTWAIT);
+        if (k > 0)
+            m_pipe.received(k);
+        else if (k == 0)
+            break;
+        else if (errno == EAGAIN && m_pipe.prepare_wait()) {
+            short  events = m_out.size() ? POLLIN | POLLOUT : POLLIN;
+            pollfd fds[2] = { { m_fd, events, 0 }, { m_pipe.notify_fd(), POLLIN, 0 } };
+            ::poll(fds, 2, -1);
+            m_pipe.end_wait();
+        } else if (errno != EAGAIN && errno != EINTR)
+            throw io_error(errno, "recv");
+    }
+    while (!flush()) {
+        pollfd pfd = { m_fd, POLLOUT, 0 };
+        ::poll(&pfd, 1, -1);
+    }
+}
+
+void pipeline_receiver::dispatch(msg_base_header* a_hdr, char* a_frame) throw(io_error)
+{
+    uint32_t id = a_hdr->id();
+    switch (a_hdr->cmd()) {
+        case msg_base_header::GET_SIZE:
+            open_file(static_cast<msg_get_size*>(a_hdr));
+            return;
+        case msg_base_header::APPEND:
+        case msg_base_header::HOLE:
+            break;
+        default:
+            error(id, a_hdr->name_hash(), a_hdr->cmd(), "Unsupported command");
+            return;
+    }
+    if (id >= m_files.size() || !m_files[id].open) {
+        error(id, a_hdr->name_hash(), a_hdr->cmd(), "File not open");
+        return;
+    }
+    file_state& f = m_files[id];
+    disk_record rec;
+    rec.id        = id;
+    rec.name_hash = f.name_hash;
+    rec.cmd       = a_hdr->cmd();
+    if (rec.cmd == msg_base_header::APPEND) {
+        msg_append* m = static_cast<msg_append*>(a_hdr);
+        rec.offset = m->src_offset();
+        rec.length = m->chunk_size();
+        rec.data   = a_frame + m->header_size();
+        REPLOG_TRACE(TRACE_DECODE, id, rec.offset, rec.length);
+    } else {
+        msg_hole* m = static_cast<msg_hole*>(a_hdr);
+        rec.offset = m->src_offset();
+        rec.length = m->length();
+    }
+    bool in_seq = rec.offset == f.expected;
+    if (!in_seq || drop(*a_hdr)) {
+        // Drop the frame and ask for a resend once per loss
+        if (in_seq || !f.recovering) {
+            msg_resend_request::create(id, f.name_hash, f.expected,
+                buffer_allocator(reserve(sizeof(msg_resend_request))));
+            commit(sizeof(msg_resend_request));
+            if (f.stats)
+                m_stats->on_resend(f.stats);
+        }
+        f.recovering = true;
+        m_dropped++;
+        return;
+    }
+    f.recovering = false;
+    m_pipe.submit(rec);
+    f.expected += rec.length;
+    if (f.stats)
+        m_stats->on_source_size(f.stats, f.expected);
+    if (rec.cmd == msg_base_header::APPEND)
+        m_bytes += rec.length;
+    else
+        m_hole_bytes += rec.length;
+    m_frames++;
+}
+
+void pipeline_receiver::open_file(const msg_get_size* a_msg) throw(io_error)
+{
+    // Both the id and the name come from the peer
+    uint32_t id  = a_msg->id();
+    size_t   len = strnlen(a_msg->name(), a_msg->header_size() - sizeof(msg_get_size));
+    std::string name(a_msg->name(), len);
+    if (id >= m_max_files) {
+        error(id, a_msg->name_hash(), a_msg->cmd(), "Bad file id");
+        return;
+    }
+    if (!contained_name(name)) {
+        error(id, a_msg->name_hash(), a_msg->cmd(), "Bad file name");
+        return;
+    }
+    if (id >= m_files.size())
+        m_files.resize(id + 1);
+    // Frames of the file are refused until the disk stage opened it
+    file_state& f = m_files[id];
+    f.name_hash  = a_msg->name_hash();
+    f.open       = false;
+    f.recovering = false;
+    if (m_stats)
+        f.stats = m_stats->add_file(id, f.name_hash, name.c_str());
+    disk_record rec;
+    rec.id        = id;
+    rec.name_hash = f.name_hash;
+    rec.cmd       = a_msg->cmd();
+    rec.data      = a_msg->name();
+    rec.length    = len;
+    m_pipe.submit(rec);
+}
+
+void pipeline_receiver::complete(const disk_completion& a_done)
+{
+    if (a_done.id >= m_files.size())
+        return;
+    file_state& f = m_files[a_done.id];
+    if (a_done.cmd == msg_base_header::GET_SIZE) {
+        if (a_done.fd < 0) {
+            error(a_done.id, f.name_hash, a_done.cmd, "Cannot open file");
+            return;
+        }
+        // The source resumes from the current size of the destination
+        f.open     = true;
+        f.expected = a_done.size;
+        f.acked    = 0;
+        if (f.stats) {
+            m_stats->on_source_size(f.stats, a_done.size);
+            m_stats->on_ack(f.stats, a_done.size);
+        }
+        msg_get_size_response::create(a_done.id, f.name_hash, a_done.fd, a_done.size,
+            buffer_allocator(reserve(sizeof(msg_get_size_response))));
+        commit(sizeof(msg_get_size_response));
+        return;
+    }
+    if (!f.open || a_done.durable <= f.acked)
+        return;
+    f.acked = a_done.durable;
+    msg_ack::create(a_done.id, f.name_hash, f.acked,
+                    buffer_allocator(reserve(sizeof(msg_ack))));
+    commit(sizeof(msg_ack));
+    if (f.stats)
+        m_stats->on_ack(f.stats, f.acked);
+}
+
+void pipeline_receiver::error(uint32_t a_id, uint32_t a_name_hash, char a_cmd,
+                              const std::string& a_error)
+{
+    size_t n = sizeof(msg_error_response) + a_error.size() + 1;
+    msg_error_response::create(a_id, a_name_hash, msg_base_header::cmd_type(a_cmd), a_error,
+        buffer_allocator(reserve(n)));
+    commit(n);
+}
+
+char* pipeline_receiver::reserve(size_t n) throw(io_error)
+{
+    if (m_out.available() < n) {
+        m_out.crunch();
+        if (m_out.available() < n)
+            m_out.reallocate(2 * (m_out.size() + n));
+    }
+    return m_out.wr_ptr();
+}
+
+void pipeline_receiver::commit(size_t n)
+{
+    m_out.commit(n);
+    if (m_stats)
+        m_stats->on_frame(stats_layout::TX,
+            reinterpret_cast<const msg_base_header*>(m_out.wr_ptr() - n)->cmd(), n);
+}
+
+bool pipeline_receiver::flush() throw(io_error)
+{
+    while (m_out.size()) {
+        ssize_t k = ::send(m_fd, m_out.rd_ptr(), m_out.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (m_stats)
+            m_stats->on_write();
+        if (k > 0)
+            m_out.read(k);
+        else if (errno == EAGAIN)
+            return false;
+        else if (errno != EINTR)
+            throw io_error(errno, "send");
+    }
+    m_out.crunch();
+    return true;
+}
+
+} // namespace replog
@@ -0,0 +1,396 @@
+//----------------------------------------------------------------------------
+/// \file  pipeline.hpp
+//----------------------------------------------------------------------------
+/// \brief Receiver pipeline decoupling the network stage from disk
+/// stages sharded by file.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _REPLOG_PIPELINE_HPP_
+#define _REPLOG_PIPELINE_HPP_
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <pthread.h>
+#include <boost/noncopyable.hpp>
+#include <replog/error.hpp>
+#include <replog/buffer.hpp>
+#include <replog/proto.hpp>
+#include <replog/durability.hpp>
+#include <replog/stats.hpp>
+#include <replog/stage_queue.hpp>
+
+namespace replog {
+
+/// Block of received bytes shared by the stages of a pipeline.  It is
+/// reused once the network stage moved past it and every record
+/// referencing it has been applied.
+struct frame_block {
+    char*    data;
+    uint32_t refs;
+};
+
+/// Work item passed from the network stage to a disk stage.  A GET_SIZE
+/// record opens the file, its payload is the name of the file.
+struct disk_record {
+    uint32_t     id;            ///< File id
+    uint32_t     name_hash;
+    char         cmd;           ///< msg_base_header command, e.g. APPEND
+    uint64_t     offset;
+    uint64_t     length;
+    const char*  data;          ///< Payload in block, NULL if none
+    frame_block* block;         ///< Set by apply_pipeline::submit()
+
+    disk_record()
+        : id(0), name_hash(0), cmd(0), offset(0), length(0), data(NULL), block(NULL)
+    {}
+};
+
+/// Result passed from a disk stage back to the network stage.
+struct disk_completion {
+    uint32_t     id;            ///< File id
+    uint32_t     name_hash;
+    char         cmd;           ///< Command of the record applied, 0 - idle()
+    int          fd;            ///< Descriptor of a file opened, -1 - open failed
+    uint64_t     size;          ///< Bytes applied
+    uint64_t     durable;       ///< Bytes synced
+    bool         progress;      ///< The fields above are set
+    frame_block* block;         ///< Block released to the network stage
+
+    disk_completion()
+        : id(0), name_hash(0), cmd(0), fd(-1), size(0), durable(0), progress(false)
+        , block(NULL)
+    {}
+};
+
+/**
+ * \brief Work done by the disk stages.
+ * Calls for one shard come from its own thread, so files of a shard
+ * need no locking.  Exceptions are reported to the network stage by
+ * apply_pipeline::poll().
+ */
+class disk_handler {
+public:
+    virtual ~disk_handler() {}
+
+    /// Apply \a a_rec in the thread of \a a_shard.  Return true to report
+    /// progress set in \a a_done.
+    virtual bool apply(int a_shard, const disk_record& a_rec, disk_completion& a_done) = 0;
+
+    /// Called when the queue of \a a_shard ran dry, e.g. to commit a group
+    /// of writes.  Progress may be reported by appending to \a a_done.
+    virtual void idle(int /*a_shard*/, std::vector<disk_completion>& /*a_done*/) {}
+};
+
+/**
+ * \brief disk_handler opening destination files and writing APPEND and
+ * HOLE records to them.
+ * A GET_SIZE record opens the file it names under the root directory in
+ * the disk thread of the file.  That thread owns the writer from then on:
+ * it alone creates, reopens, writes, syncs and closes it, so the writer
+ * needs no locking and no other thread sees it while the pipeline runs.
+ * The completion of an open reports the descriptor and size of the file,
+ * or fd -1 if it couldn't be opened.  Each shard has its own
+ * group_commit, so files of a shard are synced together by its thread
+ * only.  Progress reports the size applied and the size safe to
+ * acknowledge; in BEFORE_ACK mode the latter grows when the shard runs
+ * dry and idle() syncs its files.
+ */
+class file_apply_handler: public disk_handler, boost::noncopyable {
+public:
+    struct options {
+        std::string          root;              ///< Directory of files, empty - current
+        std::string          suffix;            ///< Appended to file names
+        file_writer::options writer;
+        group_commit::mode   durability;
+        uint64_t             sync_window;       ///< ns
+        uint64_t             sync_window_bytes;
+        stats_segment*       stats;             ///< Sync counters, NULL - off
+
+        options()
+            : durability(group_commit::NONE), sync_window(1000000)
+            , sync_window_bytes(1024 * 1024), stats(NULL)
+        {}
+    };
+
+    file_apply_handler(int a_shards, const options& a_opts = options());
+    ~file_apply_handler();
+
+    bool apply(int a_shard, const disk_record& a_rec, disk_completion& a_done);
+    void idle(int a_shard, std::vector<disk_completion>& a_done);
+
+    /// Sync the files of all shards.  Call once the disk threads stopped.
+    void sync() throw(io_error);
+
+    /// Group syncs done by all shards.
+    uint64_t syncs() const;
+
+    /// Writer of file \a a_id, NULL if the file was never opened.  Call
+    /// once the disk threads stopped.
+    file_writer* file(uint32_t a_id) const;
+
+private:
+    struct file_state {
+        file_writer* writer;
+        uint32_t     name_hash;
+        file_state() : writer(NULL), name_hash(0) {}
+    };
+    typedef std::vector<file_state> file_table;
+
+    options                     m_opts;
+    std::vector<file_table>     m_files;    // One per shard, indexed by id / shards
+    std::vector<group_commit*>  m_commits;  // One per shard
+
+    void open(int a_shard, const disk_record& a_rec, disk_completion& a_done);
+};
+
+/**
+ * \brief Staged receiver: a network stage and disk stages in their own
+ * threads.
+ * In a single-threaded receiver a slow pwrite() or fsync() stops reading
+ * the socket, the TCP window closes and the sender stalls.  In the
+ * pipeline the network thread reads into large blocks, decodes frames in
+ * place and submit()s records referencing their payloads to the disk
+ * thread owning the file (file id modulo the number of shards) through
+ * an spsc_queue.  The disk thread applies them with the disk_handler and
+ * returns progress, and blocks nobody references anymore, through a
+ * queue going the other way.  Payloads are never copied: a block's
+ * ownership moves to the disk stages and back with its reference count.
+ * Only the incomplete frame at the end of a block is moved to the next
+ * block when the network stage rotates blocks.
+ *
+ * A disk latency spike only fills the queue of one shard and the blocks
+ * it holds; the network stage keeps reading as long as free blocks are
+ * left, up to max_blocks, and waits for the disk stages only then.
+ *
+ * The network thread waits for socket input and completions in one
+ * poll() on the socket and notify_fd(), with prepare_wait() and
+ * end_wait() around it.  pipeline_receiver is such a network stage for
+ * the replication protocol, file_apply_handler the matching disk stage.
+ */
+class apply_pipeline: boost::noncopyable {
+public:
+    struct options {
+        int    shards;          ///< Disk threads
+        size_t block_size;      ///< Size of an input block
+        size_t max_blocks;      ///< Blocks received but not yet applied
+        size_t queue_depth;     ///< Records queued per disk thread
+
+        options()
+            : shards(2), block_size(1024 * 1024), max_blocks(64), queue_depth(4096)
+        {}
+    };
+
+    apply_pipeline(disk_handler& a_handler, const options& a_opts = options()) throw(io_error);
+    ~apply_pipeline();
+
+    /// Start the disk threads.
+    void start() throw(io_error);
+    /// Let the disk threads apply queued records and stop them.  Their
+    /// progress is still returned by poll().
+    void stop();
+
+    int shards()              const { return m_opts.shards; }
+    int shard(uint32_t a_id)  const { return a_id % m_opts.shards; }
+
+    //------------------------------------------------------------------------
+    // Network stage
+    //------------------------------------------------------------------------
+
+    /// Return space to read into, at least a quarter of a block, moving
+    /// to a fresh block if needed.  Blocks while all blocks are in use.
+    char*  input(size_t& a_avail) throw(io_error);
+    /// Account \a n bytes read at the pointer returned by input().
+    void   received(size_t n) { m_wr += n; }
+
+    /// Set \a a_ptr to received bytes not consumed yet.
+    /// @return their number.
+    size_t peek(char*& a_ptr) const {
+        a_ptr = m_cur ? m_cur->data + m_rd : NULL;
+        return m_wr - m_rd;
+    }
+    /// Release \a n bytes returned by peek().
+    void   consume(size_t n) { m_rd += n; }
+
+    /// Queue \a a_rec, whose payload is in bytes returned by peek() (or
+    /// outlives the record), for the disk thread of its file.  Blocks
+    /// while the queue is full.
+    void   submit(const disk_record& a_rec) throw(io_error);
+
+    /// Collect progress reported by the disk stages into \a a_done and
+    /// recycle released blocks.  Rethrows errors of the disk stages.
+    /// @return number of completions appended.
+    size_t poll(std::vector<disk_completion>& a_done) throw(io_error);
+
+    /// Readable when completions arrive after prepare_wait().
+    int    notify_fd() const { return m_net_event.fd(); }
+    /// Announce that the network stage is going to poll().  Returns false
+    /// (without announcing) if completions are already pending.
+    bool   prepare_wait();
+    /// Call after the poll() that followed a successful prepare_wait().
+    void   end_wait()   { m_net_event.clear(); }
+
+    /// Times the network stage waited for the disk stages.
+    uint64_t stalls()    const { return m_stalls; }
+    /// Blocks allocated so far.
+    size_t   blocks()    const { return m_blocks.size(); }
+    /// Records submitted and not yet applied by the disk stages.
+    size_t   queued()    const;
+
+private:
+    struct shard_state {
+        apply_pipeline*              owner;
+        int                          index;
+        spsc_queue<disk_record>      queue;
+        spsc_queue<disk_completion>  done;
+        stage_event                  event;
+        pthread_t                    thread;
+        bool                         running;
+        bool                         finished;  // The thread is about to exit
+        std::vector<disk_completion> pending;
+        uint64_t                     submitted; // Written by the network stage
+        uint64_t                     applied;   // Written by the disk thread
+
+        shard_state(apply_pipeline* a_owner, int a_index, size_t a_depth)
+            : owner(a_owner), index(a_index), queue(a_depth), done(a_depth * 2)
+            , running(false), finished(false), submitted(0), applied(0)
+        {}
+    };
+
+    disk_handler&             m_handler;
+    options                   m_opts;
+    std::vector<shard_state*> m_shards;
+    std::vector<frame_block*> m_blocks;     // All blocks allocated
+    std::vector<frame_block*> m_free;
+    frame_block*              m_cur;        // Block being read into
+    size_t                    m_rd;
+    size_t                    m_wr;
+    stage_event               m_net_event;
+    uint64_t                  m_stalls;
+    bool                      m_stopping;
+    bool                      m_failed;     // A disk stage threw
+    std::string               m_error;
+    pthread_mutex_t           m_error_lock;
+
+    std::vector<disk_completion> m_ready;   // Progress collected by input()
+
+    frame_block* allocate() throw(io_error);
+    void         release(frame_block* a_block);
+    void         collect() throw(io_error);
+    void         drain();
+    void         wait_disk() throw(io_error);
+    void         complete(shard_state& a_shard, const disk_completion& a_done);
+    void         run(shard_state& a_shard);
+    static void* disk_thread(void* a_arg);
+};
+
+/**
+ * \brief Network stage of a staged receiver, serving one connection.
+ * It reads the socket into the blocks of an apply_pipeline, decodes the
+ * frames in place and submits GET_SIZE, APPEND and HOLE frames as
+ * records to the disk stages, whose file_apply_handler opens and writes
+ * the files.  Completions coming back become responses: a
+ * msg_get_size_response once a file is open, so the source resumes from
+ * its size, and a msg_ack whenever the size safe to acknowledge grows.
+ * Sequencing is checked here, before anything is queued: a frame past
+ * the data submitted so far means lost data and is dropped, answered
+ * with one msg_resend_request per loss.  Frames of files not open and
+ * unexpected frames are answered with msg_error_response.  Responses
+ * are staged in an output buffer written out before the stage waits.
+ * Given a stats_segment, the stage publishes the frames it receives and
+ * sends, the state of its files and the depth of the pipeline queues.
+ */
+class pipeline_receiver: boost::noncopyable {
+public:
+    /// Serve socket \a a_fd with pipeline \a a_pipe, accepting file ids
+    /// below \a a_max_files.
+    pipeline_receiver(int a_fd, apply_pipeline& a_pipe, uint32_t a_max_files = 64 * 1024);
+    virtual ~pipeline_receiver();
+
+    /// Serve the connection until the peer shuts it down.  The pipeline
+    /// must be started.  Responses are all written when it returns.
+    void run() throw(io_error);
+
+    /// Payload bytes of APPEND frames submitted.
+    uint64_t bytes()        const { return m_bytes; }
+    /// Bytes of HOLE frames submitted.
+    uint64_t hole_bytes()   const { return m_hole_bytes; }
+    /// APPEND and HOLE frames submitted.
+    uint64_t frames()       const { return m_frames; }
+    /// Frames dropped for being out of sequence.
+    uint64_t dropped()      const { return m_dropped; }
+
+    /// Publish counters to \a a_stats, NULL - don't.  The segment must
+    /// outlive the receiver.
+    void stats(stats_segment* a_stats) { m_stats = a_stats; }
+
+protected:
+    /// Return true to drop in-sequence frame \a a_hdr as if it was lost,
+    /// e.g. to exercise recovery.
+    virtual bool drop(const msg_base_header& /*a_hdr*/) { return false; }
+
+private:
+    struct file_state {
+        uint64_t    expected;       // End of the data submitted
+        uint64_t    acked;
+        stats_file* stats;          // Slot in the stats segment, NULL - none
+        uint32_t    name_hash;
+        bool        open;           // The disk stage opened the file
+        bool        recovering;     // Waiting for resent data
+        file_state()
+            : expected(0), acked(0), stats(NULL), name_hash(0), open(false)
+            , recovering(false)
+        {}
+    };
+
+    int                          m_fd;
+    apply_pipeline&              m_pipe;
+    uint32_t                     m_max_files;
+    std::vector<file_state>      m_files;
+    std::vector<disk_completion> m_done;
+    basic_io_buffer<16 * 1024>   m_out;
+    uint64_t                     m_bytes;
+    uint64_t                     m_hole_bytes;
+    uint64_t                     m_frames;
+    uint64_t                     m_dropped;
+    stats_segment*               m_stats;
+
+    void  dispatch(msg_base_header* a_hdr, char* a_frame) throw(io_error);
+    void  open_file(const msg_get_size* a_msg) throw(io_error);
+    void  complete(const disk_completion& a_done);
+    void  error(uint32_t a_id, uint32_t a_name_hash, char a_cmd, const std::string& a_error);
+    char* reserve(size_t n) throw(io_error);
+    void  commit(size_t n);
+    /// Write out staged responses without blocking.
+    /// @return true if none are left.
+    bool  flush() throw(io_error);
+};
+
+} // namespace replog
+
+#endif // _REPLOG_PIPELINE_HPP_
@@ -48,13 +48,39 @@ msg_base_header* msg_base_header::decode_header(char* a_buf, size_t len)
         case MOVE_FILE:         min_sz = sizeof(msg_move_file);         break;
         case DELETE_FILE:       min_sz = sizeof(msg_delete_file);       break;
         case APPEND:            min_sz = sizeof(msg_append);            break;
+        case HOLE:              min_sz = sizeof(msg_hole);              break;
         case ERROR_RESPONSE:    min_sz = sizeof(msg_error_response);    break;
         case RESEND_REQUEST:    min_sz = sizeof(msg_resend_request);    break;
+        case ACK:               min_sz = sizeof(msg_ack);               break;
+        case DELTA_REQUEST:     min_sz = sizeof(msg_delta_request);     break;
+        case DELTA_SIGNATURES:  min_sz = sizeof(msg_delta_signatures);  break;
+        case DELTA_COPY:        min_sz = sizeof(msg_delta_copy);        break;
+        case DELTA_DONE:        min_sz = sizeof(msg_delta_done);        break;
+        case HELLO:             min_sz = sizeof(msg_hello);             break;
         default:
             throw replog_error("Unknown command type:", p->cmd());
     }
     if (n < min_sz)
         throw replog_error("Bad header size (got=", n, ", expected=", min_sz, ")");
+    return p;
+}
+
+size_t msg_base_header::payload_size() const throw(replog_error)
+{
+    size_t n;
+    switch (cmd()) {
+        case APPEND:
+            n = static_cast<const msg_append*>(this)->chunk_size();
+            break;
+        case DELTA_SIGNATURES:
+            n = static_cast<const msg_delta_signatures*>(this)->payload_size();
+            break;
+        default:
+            return 0;
+    }
+    if (n > s_max_payload_size)
+        throw replog_error("Payload too large:", n);
+    return n;
 }
 
 } // namespace replog
@@ -43,6 +43,14 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 namespace replog {
 
+/// Allocator placing a message directly into an output buffer, e.g.
+/// msg_ack::create(..., buffer_allocator(out.reserve(sizeof(msg_ack)))).
+struct buffer_allocator {
+    char* m_buf;
+    buffer_allocator(char* a_buf) : m_buf(a_buf) {}
+    char* allocate(size_t) { return m_buf; }
+};
+
 class msg_base_header {
 protected:
     static const uint8_t s_magic_header = 132;
@@ -60,8 +68,15 @@ public:
         , MOVE_FILE         = 'M'
         , DELETE_FILE       = 'D'
         , APPEND            = 'A'
+        , HOLE              = 'H'
         , RESEND_REQUEST    = 'r'
+        , ACK               = 'K'
         , ERROR_RESPONSE    = 'e'
+        , DELTA_REQUEST     = 'B'
+        , DELTA_SIGNATURES  = 'b'
+        , DELTA_COPY        = 'C'
+        , DELTA_DONE        = 'E'
+        , HELLO             = 'V'
     };
     
     msg_base_header(cmd_type a_cmd, uint16_t a_msg_size, uint32_t a_id,
@@ -73,6 +88,10 @@ public:
         m_name_hash     = a_name_hash;
     }
 
+    /// Largest payload following a header.  Receivers size their input
+    /// buffer for a whole frame, so a bigger one is a protocol error.
+    static const uint32_t s_max_payload_size = 16 * 1024 * 1024;
+
     static uint8_t get_magic()      { return s_magic_header; }
 
     uint16_t header_size()  const   { uint16_t n = (uint16_t)m_header_size; return n; }
@@ -83,6 +102,11 @@ public:
 
     static msg_base_header*
     decode_header(char* a_buf, size_t len);
+
+    /// Size of data following the header of a decoded frame (the chunk
+    /// of an APPEND, the entries of DELTA_SIGNATURES).  Throws if it
+    /// exceeds s_max_payload_size.
+    size_t payload_size() const throw(replog_error);
 };
 
 class msg_get_size : public msg_base_header {
@@ -105,6 +129,8 @@ public:
            int a_src_fd, mode_t a_mode, const Alloc& a = Alloc())
     {
         size_t size = sizeof(msg_get_size) + a_filename.size() + 1;
+        if (size > 0xFFFF)
+            throw replog_error("File name too long:", a_filename.size());
         msg_get_size* p = reinterpret_cast<msg_get_size*>(Alloc(a).allocate(size));
         uint32_t name_hash = strhash(a_filename);
         new (p) msg_get_size(size, a_id, name_hash);
@@ -164,6 +190,8 @@ public:
     create(uint32_t a_id, uint32_t a_name_hash, int a_dst_fd, uint64_t a_src_offset,
            uint32_t a_chunk_size, const Alloc& a = Alloc())
     {
+        if (a_chunk_size > s_max_payload_size)
+            throw replog_error("Chunk too large:", a_chunk_size);
         size_t size = sizeof(msg_append);
         msg_append* p =
             reinterpret_cast<msg_append*>(Alloc(a).allocate(size));
@@ -175,6 +203,37 @@ public:
     }
 };
 
+/// Sent instead of APPEND for a hole of a sparse source file.  The
+/// destination extends the file over the hole without writing to it, so
+/// the range stays unallocated.
+class msg_hole : public msg_base_header {
+    msg_hole(size_t a_msg_size, uint32_t a_id, uint32_t a_name_hash)
+        : msg_base_header(HOLE, a_msg_size, a_id, a_name_hash)
+    {}
+
+    raw_char<4> m_dst_fd;
+    raw_char<8> m_src_offset; // Source file offset of the hole
+    raw_char<8> m_length;     // Length of the hole
+public:
+    int      dst_fd()       const { return m_dst_fd; }
+    uint64_t src_offset()   const { return m_src_offset; }
+    uint64_t length()       const { return m_length; }
+
+    template <typename Alloc>
+    static msg_hole*
+    create(uint32_t a_id, uint32_t a_name_hash, int a_dst_fd, uint64_t a_src_offset,
+           uint64_t a_length, const Alloc& a = Alloc())
+    {
+        size_t size = sizeof(msg_hole);
+        msg_hole* p = reinterpret_cast<msg_hole*>(Alloc(a).allocate(size));
+        new (p) msg_hole(size, a_id, a_name_hash);
+        p->m_dst_fd     = a_dst_fd;
+        p->m_src_offset = a_src_offset;
+        p->m_length     = a_length;
+        return p;
+    }
+};
+
 class msg_resend_request : public msg_base_header {
     msg_resend_request(size_t a_msg_size, uint32_t a_id, uint32_t a_name_hash)
         : msg_base_header(RESEND_REQUEST, a_msg_size, a_id, a_name_hash)
@@ -197,6 +256,30 @@ public:
     }
 };
 
+/// Sent by the destination to report the size up to which a file has been
+/// applied.  The sender uses it to release retained data and to measure
+/// round-trip time and delivery rate.
+class msg_ack : public msg_base_header {
+    msg_ack(size_t a_msg_size, uint32_t a_id, uint32_t a_name_hash)
+        : msg_base_header(ACK, a_msg_size, a_id, a_name_hash)
+    {}
+    raw_char<8> m_dst_size;   // Contiguous size of the destination file
+public:
+    uint64_t dst_size() const { return m_dst_size; }
+
+    template <typename Alloc>
+    static msg_ack*
+    create(uint32_t a_id, uint32_t a_name_hash, uint64_t a_dst_size,
+           const Alloc& a = Alloc())
+    {
+        size_t size = sizeof(msg_ack);
+        msg_ack* p = reinterpret_cast<msg_ack*>(Alloc(a).allocate(size));
+        new (p) msg_ack(size, a_id, a_name_hash);
+        p->m_dst_size   = a_dst_size;
+        return p;
+    }
+};
+
 class msg_error_response : public msg_base_header {
     msg_error_response(size_t a_msg_size, uint32_t a_id, uint32_t a_name_hash)
         : msg_base_header(ERROR_RESPONSE, a_msg_size, a_id, a_name_hash)
@@ -214,6 +297,8 @@ public:
            cmd_type a_last_cmd, const std::string& a_error, const Alloc& a = Alloc())
     {
         size_t size = sizeof(msg_error_response) + a_error.size() + 1;
+        if (size > 0xFFFF)
+            throw replog_error("Error message too long:", a_error.size());
         msg_error_response* p =
             reinterpret_cast<msg_error_response*>(Alloc(a).allocate(size));
         new (p) msg_error_response(size, a_id, a_name_hash);
@@ -223,6 +308,173 @@ public:
     }
 };
 
+/// Sent by the source when the destination file can't be extended by
+/// appends (it is larger than the source or its content differs).
+/// The destination replies with a series of msg_delta_signatures.
+class msg_delta_request : public msg_base_header {
+    msg_delta_request(size_t a_msg_size, uint32_t a_id, uint32_t a_name_hash)
+        : msg_base_header(DELTA_REQUEST, a_msg_size, a_id, a_name_hash)
+    {}
+
+    raw_char<4> m_dst_fd;
+    raw_char<8> m_src_size;   // Source file size
+    raw_char<4> m_block_size; // Requested signature block size
+public:
+    int      dst_fd()       const { return m_dst_fd;     }
+    uint64_t src_size()     const { return m_src_size;   }
+    uint32_t block_size()   const { return m_block_size; }
+
+    template <typename Alloc>
+    static msg_delta_request*
+    create(uint32_t a_id, uint32_t a_name_hash, int a_dst_fd, uint64_t a_src_size,
+           uint32_t a_block_size, const Alloc& a = Alloc())
+    {
+        size_t size = sizeof(msg_delta_request);
+        msg_delta_request* p =
+            reinterpret_cast<msg_delta_request*>(Alloc(a).allocate(size));
+        new (p) msg_delta_request(size, a_id, a_name_hash);
+        p->m_dst_fd     = a_dst_fd;
+        p->m_src_size   = a_src_size;
+        p->m_block_size = a_block_size;
+        return p;
+    }
+};
+
+/// Block signatures of the destination file.  The header is followed
+/// by count() entries of s_entry_size bytes each: a 4-byte weak rolling
+/// checksum and an 8-byte strong hash, both big endian.
+class msg_delta_signatures : public msg_base_header {
+    msg_delta_signatures(size_t a_msg_size, uint32_t a_id, uint32_t a_name_hash)
+        : msg_base_header(DELTA_SIGNATURES, a_msg_size, a_id, a_name_hash)
+    {}
+
+    raw_char<8> m_dst_size;    // Destination file size
+    raw_char<4> m_block_size;
+    raw_char<4> m_first_block; // Index of the first block in this message
+    raw_char<4> m_count;       // Number of signatures following the header
+public:
+    static const size_t s_entry_size = 12;
+
+    uint64_t dst_size()     const { return m_dst_size;    }
+    uint32_t block_size()   const { return m_block_size;  }
+    uint32_t first_block()  const { return m_first_block; }
+    uint32_t count()        const { return m_count;       }
+    size_t   payload_size() const { return (size_t)count() * s_entry_size; }
+
+    template <typename Alloc>
+    static msg_delta_signatures*
+    create(uint32_t a_id, uint32_t a_name_hash, uint64_t a_dst_size,
+           uint32_t a_block_size, uint32_t a_first_block, uint32_t a_count,
+           const Alloc& a = Alloc())
+    {
+        if ((uint64_t)a_count * s_entry_size > s_max_payload_size)
+            throw replog_error("Too many signatures:", a_count);
+        size_t size = sizeof(msg_delta_signatures);
+        msg_delta_signatures* p =
+            reinterpret_cast<msg_delta_signatures*>(Alloc(a).allocate(size));
+        new (p) msg_delta_signatures(size, a_id, a_name_hash);
+        p->m_dst_size    = a_dst_size;
+        p->m_block_size  = a_block_size;
+        p->m_first_block = a_first_block;
+        p->m_count       = a_count;
+        return p;
+    }
+};
+
+/// Instructs the destination to copy \a length bytes found at
+/// \a old_offset of its current file to \a dst_offset of the file
+/// being reconstructed.  Literal data is delivered with msg_append.
+class msg_delta_copy : public msg_base_header {
+    msg_delta_copy(size_t a_msg_size, uint32_t a_id, uint32_t a_name_hash)
+        : msg_base_header(DELTA_COPY, a_msg_size, a_id, a_name_hash)
+    {}
+
+    raw_char<4> m_dst_fd;
+    raw_char<8> m_dst_offset; // Offset in the reconstructed file
+    raw_char<8> m_old_offset; // Offset in the current destination file
+    raw_char<4> m_length;
+public:
+    int      dst_fd()       const { return m_dst_fd;     }
+    uint64_t dst_offset()   const { return m_dst_offset; }
+    uint64_t old_offset()   const { return m_old_offset; }
+    uint32_t length()       const { return m_length;     }
+
+    template <typename Alloc>
+    static msg_delta_copy*
+    create(uint32_t a_id, uint32_t a_name_hash, int a_dst_fd, uint64_t a_dst_offset,
+           uint64_t a_old_offset, uint32_t a_length, const Alloc& a = Alloc())
+    {
+        size_t size = sizeof(msg_delta_copy);
+        msg_delta_copy* p =
+            reinterpret_cast<msg_delta_copy*>(Alloc(a).allocate(size));
+        new (p) msg_delta_copy(size, a_id, a_name_hash);
+        p->m_dst_fd     = a_dst_fd;
+        p->m_dst_offset = a_dst_offset;
+        p->m_old_offset = a_old_offset;
+        p->m_length     = a_length;
+        return p;
+    }
+};
+
+/// Marks the end of a delta transfer.  The destination truncates the
+/// reconstructed file to \a src_size and replaces the old file with it.
+class msg_delta_done : public msg_base_header {
+    msg_delta_done(size_t a_msg_size, uint32_t a_id, uint32_t a_name_hash)
+        : msg_base_header(DELTA_DONE, a_msg_size, a_id, a_name_hash)
+    {}
+
+    raw_char<4> m_dst_fd;
+    raw_char<8> m_src_size;
+    raw_char<8> m_checksum;   // content_hash of the source data
+public:
+    int      dst_fd()       const { return m_dst_fd;   }
+    uint64_t src_size()     const { return m_src_size; }
+    uint64_t checksum()     const { return m_checksum; }
+
+    template <typename Alloc>
+    static msg_delta_done*
+    create(uint32_t a_id, uint32_t a_name_hash, int a_dst_fd, uint64_t a_src_size,
+           uint64_t a_checksum, const Alloc& a = Alloc())
+    {
+        size_t size = sizeof(msg_delta_done);
+        msg_delta_done* p =
+            reinterpret_cast<msg_delta_done*>(Alloc(a).allocate(size));
+        new (p) msg_delta_done(size, a_id, a_name_hash);
+        p->m_dst_fd   = a_dst_fd;
+        p->m_src_size = a_src_size;
+        p->m_checksum = a_checksum;
+        return p;
+    }
+};
+
+/// Sent by the source before anything else to offer the highest wire
+/// version it supports, and answered by the destination with the version
+/// both use from then on (see codec_v2).  The destination decodes every
+/// frame following the source's msg_hello in that version, so the source
+/// waits for the answer before sending anything else.  A destination
+/// answering with msg_error_response keeps version 1.  Frames going back
+/// to the source stay in version 1.
+class msg_hello : public msg_base_header {
+    msg_hello(size_t a_msg_size)
+        : msg_base_header(HELLO, a_msg_size, 0, 0)
+    {}
+
+    raw_char<4> m_version;
+public:
+    uint32_t version()      const { return m_version; }
+
+    template <typename Alloc>
+    static msg_hello*
+    create(uint32_t a_version, const Alloc& a = Alloc())
+    {
+        size_t size = sizeof(msg_hello);
+        msg_hello* p = reinterpret_cast<msg_hello*>(Alloc(a).allocate(size));
+        new (p) msg_hello(size);
+        p->m_version = a_version;
+        return p;
+    }
+};
+
 } // namespace replog
 
 #endif // _REPLOG_PROTO_HPP_
@@ -0,0 +1,199 @@
+//----------------------------------------------------------------------------
+/// \file  proto_v2.hpp
+//----------------------------------------------------------------------------
+/// \brief Compact version 2 wire format of REPLOG frames.
+/// APPEND frames carry varint-encoded file id, offset delta and chunk size
+/// instead of the 28-byte fixed header.  Other messages are sent in their
+/// version 1 encoding behind a short prefix.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _REPLOG_PROTO_V2_HPP_
+#define _REPLOG_PROTO_V2_HPP_
+
+#include <vector>
+#include <replog/proto.hpp>
+#include <replog/varint.hpp>
+
+namespace replog {
+
+/// Wire protocol versions.  The version is carried by the magic byte.
+enum wire_version { WIRE_V1 = 1, WIRE_V2 = 2 };
+
+/// Highest version supported by both peers, agreed with msg_hello.
+inline wire_version negotiate_version(wire_version a_local, wire_version a_peer) {
+    return a_local < a_peer ? a_local : a_peer;
+}
+
+/// Frame decoded from a version 2 stream.
+struct frame_v2 {
+    char        cmd;
+    uint32_t    id;
+    uint64_t    src_offset;     // APPEND only
+    uint32_t    chunk_size;     // APPEND only
+    const char* data;           // APPEND payload or version 1 message
+    size_t      size;           // Total frame size including the payload
+};
+
+/**
+ * \brief Encoder/decoder of the version 2 frame format:
+ * \code
+ *   APPEND:  magic | 'A' | varint id | varint zigzag(offset - expected) |
+ *            varint chunk_size | payload
+ *   other:   magic | cmd | varint length | version 1 message
+ * \endcode
+ * The expected offset of a file is the end of its previous APPEND, so
+ * a stream of consecutive appends encodes a zero delta in one byte.
+ * The encoder and the decoder of a session each keep this per-file
+ * state and must see the same sequence of frames.
+ */
+class codec_v2 {
+    std::vector<uint64_t> m_next_offset;
+    uint32_t              m_max_files;
+
+    uint64_t& next_offset(uint64_t a_id) {
+        // File ids come from the peer: don't let them size the state
+        if (a_id >= m_max_files)
+            throw replog_error("Bad file id:", a_id);
+        if (a_id >= m_next_offset.size())
+            m_next_offset.resize(a_id + 1, 0);
+        return m_next_offset[a_id];
+    }
+public:
+    static const uint8_t  s_magic             = 136;
+    static const uint32_t s_default_max_files = 64 * 1024;
+    /// Max size of a version 1 message including its payload.
+    static const uint32_t s_max_message_size  = 16 * 1024 * 1024;
+
+    /// Max size of an APPEND header and of a message prefix.
+    static const size_t s_max_append_header = 2 + 5 + s_max_varint_size + 5;
+    static const size_t s_max_prefix        = 2 + 5;
+
+    /// @param a_max_files bound of file ids accepted from the peer.
+    explicit codec_v2(uint32_t a_max_files = s_default_max_files)
+        : m_max_files(a_max_files)
+    {}
+
+    static bool is_v2(uint8_t a_magic) { return a_magic == s_magic; }
+
+    /// Forget the offset state of file \a a_id (e.g. when it's reopened).
+    void reset(uint32_t a_id) { next_offset(a_id) = 0; }
+
+    /// Encode the header of an APPEND frame into \a a_buf which must have
+    /// room for s_max_append_header bytes.  The payload follows it.
+    /// @return size of the encoded header.
+    size_t encode_append(char* a_buf, uint32_t a_id, uint64_t a_src_offset,
+                         uint32_t a_chunk_size)
+    {
+        if (a_chunk_size > msg_base_header::s_max_payload_size)
+            throw replog_error("Chunk too large:", a_chunk_size);
+        uint64_t& next = next_offset(a_id);
+        char* p = a_buf;
+        *p++ = s_magic;
+        *p++ = msg_base_header::APPEND;
+        put_varint(p, a_id);
+        put_varint(p, zigzag_encode((int64_t)(a_src_offset - next)));
+        put_varint(p, a_chunk_size);
+        next = a_src_offset + a_chunk_size;
+        return p - a_buf;
+    }
+
+    /// Encode the prefix of a version 1 message \a a_msg into \a a_buf which
+    /// must have room for s_max_prefix bytes.  The message and its payload
+    /// follow it.
+    /// @return size of the prefix.
+    static size_t encode_prefix(char* a_buf, const msg_base_header* a_msg) {
+        char* p = a_buf;
+        *p++ = s_magic;
+        *p++ = a_msg->cmd();
+        put_varint(p, a_msg->header_size() + a_msg->payload_size());
+        return p - a_buf;
+    }
+
+    /// Decode a frame at \a a_buf holding \a n bytes.  Sizes come from the
+    /// peer: payloads are bounded by msg_base_header::s_max_payload_size.
+    /// @return false if the buffer doesn't hold a complete frame yet, in
+    ///         which case a_frame.size is the size of the frame, or 0 if
+    ///         its header is incomplete too.
+    bool decode(const char* a_buf, size_t n, frame_v2& a_frame) {
+        a_frame.size = 0;
+        if (n < 3)
+            return false;
+        if (!is_v2(a_buf[0]))
+            throw replog_error("Wrong magic number:", (int)(uint8_t)a_buf[0]);
+
+        const char* p   = a_buf + 2;
+        const char* end = a_buf + n;
+        a_frame.cmd = a_buf[1];
+
+        if (a_frame.cmd == msg_base_header::APPEND) {
+            uint64_t v[3];
+            if (!get_varint(p, end, v[0]) || !get_varint(p, end, v[1]) ||
+                !get_varint(p, end, v[2]))
+                return false;
+            if (v[0] > 0xFFFFFFFFull)
+                throw replog_error("Bad APPEND frame");
+            if (v[2] > msg_base_header::s_max_payload_size)
+                throw replog_error("Chunk too large:", v[2]);
+            a_frame.id         = v[0];
+            a_frame.chunk_size = v[2];
+            a_frame.data       = p;
+            a_frame.size       = (p - a_buf) + a_frame.chunk_size;
+            if (a_frame.size > n)
+                return false;
+            uint64_t& next     = next_offset(a_frame.id);
+            a_frame.src_offset = next + zigzag_decode(v[1]);
+            next               = a_frame.src_offset + a_frame.chunk_size;
+            return true;
+        }
+
+        uint64_t len;
+        if (!get_varint(p, end, len))
+            return false;
+        if (len < sizeof(msg_base_header) || len > s_max_message_size)
+            throw replog_error("Bad message size:", len);
+        a_frame.data       = p;
+        a_frame.size       = (p - a_buf) + len;
+        if (a_frame.size > n)
+            return false;
+        msg_base_header* m = msg_base_header::decode_header(const_cast<char*>(p), len);
+        if (m->cmd() != a_frame.cmd)
+            throw replog_error("Mismatched command type:", m->cmd());
+        if (m->header_size() + m->payload_size() != len)
+            throw replog_error("Bad message size:", len);
+        if (m->id() >= m_max_files)
+            throw replog_error("Bad file id:", m->id());
+        a_frame.id         = m->id();
+        a_frame.src_offset = 0;
+        a_frame.chunk_size = 0;
+        return true;
+    }
+};
+
+} // namespace replog
+
+#endif // _REPLOG_PROTO_V2_HPP_
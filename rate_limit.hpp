@@ -0,0 +1,235 @@
+//----------------------------------------------------------------------------
+/// \file  rate_limit.hpp
+//----------------------------------------------------------------------------
+/// \brief Hierarchical token-bucket shaping of replication bandwidth.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _REPLOG_RATE_LIMIT_HPP_
+#define _REPLOG_RATE_LIMIT_HPP_
+
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+#include <replog/error.hpp>
+#include <replog/scheduler.hpp>
+
+namespace replog {
+
+/**
+ * \brief Token bucket refilled from a caller-supplied monotonic clock.
+ * Tokens are bytes.  The bucket holds at most burst() bytes and refills
+ * at rate() bytes per second.  A chunk may be sent while the bucket is
+ * not empty and may overdraw it: the debt is paid back by later
+ * refills, so chunks never have to be split to fit the tokens left.
+ * A bucket with a zero rate is unlimited.
+ */
+class token_bucket {
+public:
+    explicit token_bucket(uint64_t a_rate = 0, uint64_t a_burst = 0)
+        : m_tokens(0), m_time(0)
+    {
+        rate(a_rate, a_burst);
+    }
+
+    /// Change the rate to \a a_rate bytes per second with a burst of
+    /// \a a_burst bytes (0 - a tenth of a second at the rate, at least
+    /// 64KB).  Tokens above the new burst are dropped.
+    void rate(uint64_t a_rate, uint64_t a_burst = 0) {
+        m_rate   = a_rate;
+        m_burst  = a_burst ? a_burst : std::max<uint64_t>(a_rate / 10, 64 * 1024);
+        m_tokens = std::min<int64_t>(m_tokens, m_burst);
+        if (!m_time)
+            m_tokens = m_burst;
+    }
+
+    uint64_t rate()      const { return m_rate; }
+    uint64_t burst()     const { return m_burst; }
+    bool     unlimited() const { return !m_rate; }
+    /// Bytes available, negative while a chunk's overdraft is paid back.
+    int64_t  tokens()    const { return m_tokens; }
+
+    /// Add the tokens earned until time \a a_now (ns).
+    void refill(uint64_t a_now) {
+        if (!m_time || unlimited()) {
+            m_time = a_now;
+            return;
+        }
+        if (a_now <= m_time)
+            return;
+        uint64_t elapsed = a_now - m_time;
+        uint64_t room    = m_burst - m_tokens;
+        if (elapsed / s_ns >= room / m_rate + 1) {
+            m_tokens = m_burst;
+            m_time   = a_now;
+            return;
+        }
+        uint64_t add = elapsed / s_ns * m_rate + elapsed % s_ns * m_rate / s_ns;
+        if (add >= room) {
+            m_tokens = m_burst;
+            m_time   = a_now;
+            return;
+        }
+        // Advance by the time the whole tokens took, keeping the remainder
+        m_tokens += add;
+        m_time   += add * s_ns / m_rate;
+    }
+
+    /// Time (ns) until the bucket holds more than \a a_level bytes, 0 if
+    /// it already does.
+    uint64_t delay(int64_t a_level = 0) const {
+        if (unlimited() || m_tokens > a_level)
+            return 0;
+        return (uint64_t)(a_level - m_tokens + 1) * s_ns / m_rate + 1;
+    }
+
+    /// Take \a n bytes of tokens.
+    void consume(uint64_t n) {
+        if (!unlimited())
+            m_tokens -= n;
+    }
+
+private:
+    static const uint64_t s_ns = 1000000000ull;
+
+    uint64_t m_rate;
+    uint64_t m_burst;
+    int64_t  m_tokens;
+    uint64_t m_time;        // Time of the last refill, 0 - never refilled
+};
+
+/**
+ * \brief Hierarchical shaper of APPEND traffic.
+ * A chunk passes three token buckets: the global cap of the process, the
+ * cap of its peer and the cap of its file's priority class (the classes
+ * of stream_scheduler), and may be sent only when none of them is empty.
+ * Every bucket is unlimited until a rate is set, and rates can be changed
+ * at any time.  The clock is supplied by the caller (e.g. reactor::now()),
+ * so shaping makes no system calls.
+ *
+ * The scheduler serves class 0 (live tails) first, but a bulk catch-up
+ * sent while the tails are idle could drain the global bucket just before
+ * they need it.  reserve() sets aside part of the global burst that only
+ * class 0 may use: lower classes wait while the global bucket is at or
+ * below the reserve.
+ */
+class rate_limiter {
+public:
+    static const int s_classes = stream_scheduler::s_classes;
+
+    explicit rate_limiter(uint64_t a_rate = 0, uint64_t a_burst = 0)
+        : m_global(a_rate, a_burst), m_reserve(0)
+    {}
+
+    /// Set the global rate (bytes per second, 0 - unlimited).  The
+    /// reserve is cut down to half of the new burst if needed.
+    void global(uint64_t a_rate, uint64_t a_burst = 0) {
+        m_global.rate(a_rate, a_burst);
+        m_reserve = std::min(m_reserve, m_global.burst() / 2);
+    }
+
+    /// Set the rate of peer \a a_peer (bytes per second, 0 - unlimited).
+    void peer(uint32_t a_peer, uint64_t a_rate, uint64_t a_burst = 0) {
+        if (a_peer >= m_peers.size())
+            m_peers.resize(a_peer + 1);
+        m_peers[a_peer].rate(a_rate, a_burst);
+    }
+
+    /// Set the rate of priority class \a a_class (bytes per second,
+    /// 0 - unlimited).
+    void file_class(int a_class, uint64_t a_rate, uint64_t a_burst = 0) throw(io_error) {
+        check_class(a_class);
+        m_classes[a_class].rate(a_rate, a_burst);
+    }
+
+    /// Reserve \a a_bytes of the global burst for class 0, at most half
+    /// of the burst.
+    void reserve(uint64_t a_bytes) throw(io_error) {
+        if (a_bytes && a_bytes > m_global.burst() / 2)
+            throw io_error("Reserve exceeds half of the global burst:", a_bytes);
+        m_reserve = a_bytes;
+    }
+
+    const token_bucket& global()                 const { return m_global; }
+    const token_bucket& file_class(int a_class)  const { return m_classes[a_class]; }
+    uint64_t            reserve()                const { return m_reserve; }
+
+    /// Time (ns) until a chunk of peer \a a_peer and class \a a_class may
+    /// be sent, 0 if it may be sent at time \a a_now (ns).
+    uint64_t delay(uint32_t a_peer, int a_class, uint64_t a_now) throw(io_error) {
+        check_class(a_class);
+        m_global.refill(a_now);
+        token_bucket& c = m_classes[a_class];
+        c.refill(a_now);
+        uint64_t d = std::max(m_global.delay(a_class ? m_reserve : 0), c.delay());
+        if (a_peer < m_peers.size()) {
+            m_peers[a_peer].refill(a_now);
+            d = std::max(d, m_peers[a_peer].delay());
+        }
+        return d;
+    }
+
+    /// Bit mask of classes that peer \a a_peer may not send now, for
+    /// stream_scheduler::next().  \a a_delay is set to the time (ns)
+    /// until the first of them is allowed, 0 if none is blocked.
+    unsigned blocked(uint32_t a_peer, uint64_t a_now, uint64_t& a_delay) throw(io_error) {
+        unsigned mask = 0;
+        a_delay = 0;
+        for (int c = 0; c < s_classes; ++c) {
+            uint64_t d = delay(a_peer, c, a_now);
+            if (d) {
+                mask   |= 1u << c;
+                a_delay = a_delay ? std::min(a_delay, d) : d;
+            }
+        }
+        return mask;
+    }
+
+    /// Account \a n bytes sent by peer \a a_peer from class \a a_class.
+    void consume(uint32_t a_peer, int a_class, uint64_t n) throw(io_error) {
+        check_class(a_class);
+        m_global.consume(n);
+        m_classes[a_class].consume(n);
+        if (a_peer < m_peers.size())
+            m_peers[a_peer].consume(n);
+    }
+
+private:
+    token_bucket              m_global;
+    token_bucket              m_classes[s_classes];
+    std::vector<token_bucket> m_peers;
+    uint64_t                  m_reserve;    // Global tokens kept for class 0
+
+    static void check_class(int a_class) throw(io_error) {
+        if (a_class < 0 || a_class >= s_classes)
+            throw io_error("Invalid priority class:", a_class);
+    }
+};
+
+} // namespace replog
+
+#endif // _REPLOG_RATE_LIMIT_HPP_
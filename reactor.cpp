@@ -0,0 +1,663 @@
+//----------------------------------------------------------------------------
+/// \file  reactor.cpp
+//----------------------------------------------------------------------------
+/// \brief Edge-triggered epoll event loop.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#include <replog/reactor.hpp>
+#include <replog/shm_transport.hpp>
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+namespace replog {
+
+//----------------------------------------------------------------------------
+// connection
+//----------------------------------------------------------------------------
+
+connection::connection(reactor& a_reactor, int a_fd)
+    : m_reactor(a_reactor), m_fd(a_fd), m_space_fd(-1), m_shm(NULL)
+    , m_stats(a_reactor.stats()), m_out_head(0), m_out_bytes(0)
+    , m_dirty(false), m_closed(false), m_suspended(false), m_read_ready(false)
+    , m_throttled(false), m_decoding(false), m_sendmsg(true), m_hb_interval(0)
+    , m_held_since(0), m_frames_sent(0), m_writes(0), m_in_version(WIRE_V1)
+{
+    m_hb.bind<connection, &connection::heartbeat_timer>(this);
+    m_resend.bind<connection, &connection::resend_timer>(this);
+    m_hold.bind<connection, &connection::hold_timer>(this);
+    if (m_stats)
+        m_stats->on_connection(1);
+}
+
+connection::connection(reactor& a_reactor, shm_channel& a_channel) throw(io_error)
+    : m_reactor(a_reactor), m_fd(dup(a_channel.data_fd()))
+    , m_space_fd(dup(a_channel.space_fd())), m_shm(&a_channel)
+    , m_stats(a_reactor.stats()), m_out_head(0), m_out_bytes(0)
+    , m_dirty(false), m_closed(false), m_suspended(false), m_read_ready(false)
+    , m_throttled(false), m_decoding(false), m_sendmsg(false), m_hb_interval(0)
+    , m_held_since(0), m_frames_sent(0), m_writes(0), m_in_version(WIRE_V1)
+{
+    if (m_fd < 0 || m_space_fd < 0) {
+        int err = errno;
+        m_shm = NULL;
+        close_fds();
+        throw io_error(err, "dup");
+    }
+    m_hb.bind<connection, &connection::heartbeat_timer>(this);
+    m_resend.bind<connection, &connection::resend_timer>(this);
+    m_hold.bind<connection, &connection::hold_timer>(this);
+    if (m_stats)
+        m_stats->on_connection(1);
+}
+
+connection::~connection()
+{
+    std::vector<connection*>& dirty  = m_reactor.m_dirty;
+    std::vector<connection*>& closed = m_reactor.m_closed;
+    std::vector<connection*>& thr    = m_reactor.m_throttled;
+    if (m_dirty)
+        dirty.erase(std::find(dirty.begin(), dirty.end(), this));
+    if (m_throttled)
+        thr.erase(std::find(thr.begin(), thr.end(), this));
+    if (m_closed) {
+        std::vector<connection*>::iterator it = std::find(closed.begin(), closed.end(), this);
+        if (it != closed.end())
+            closed.erase(it);
+    }
+    close_fds();
+    if (m_stats) {
+        m_stats->on_buffer(-(int64_t)m_out_bytes);
+        m_stats->on_connection(-1);
+    }
+}
+
+void connection::close_fds()
+{
+    if (m_shm && m_fd >= 0) {
+        try {
+            m_shm->shutdown();
+        } catch (io_error&) {
+        }
+        // The channel holds the eventfds too, so closing ours doesn't
+        // remove them from the epoll set
+        epoll_ctl(m_reactor.m_epfd, EPOLL_CTL_DEL, m_fd, NULL);
+        epoll_ctl(m_reactor.m_epfd, EPOLL_CTL_DEL, m_space_fd, NULL);
+    }
+    if (m_fd >= 0)
+        ::close(m_fd);
+    if (m_space_fd >= 0)
+        ::close(m_space_fd);
+    m_fd = m_space_fd = -1;
+}
+
+char* connection::reserve(size_t n)
+{
+    basic_io_buffer<s_buf_size>& out = m_buf.out;
+    if (out.available() < n) {
+        out.crunch();
+        if (out.available() < n)
+            out.reallocate(std::max(out.max_size() * 2, out.size() + n));
+    }
+    return out.wr_ptr();
+}
+
+void connection::send(const void* a_hdr, size_t a_hdr_len, const char* a_payload, size_t n)
+{
+    memcpy(reserve(a_hdr_len), a_hdr, a_hdr_len);
+    m_buf.out.commit(a_hdr_len);
+    queue(NULL, a_hdr_len);
+    queue(a_payload, n);
+    sent(static_cast<const char*>(a_hdr), a_hdr_len + n);
+}
+
+void connection::queue(const char* a_ref, size_t n)
+{
+    if (!n || m_closed)
+        return;
+    // Coalesce consecutive buffer segments
+    if (!a_ref && m_out.size() > m_out_head && !m_out.back().iov_base)
+        m_out.back().iov_len += n;
+    else {
+        iovec v = { const_cast<char*>(a_ref), n };
+        m_out.push_back(v);
+    }
+    m_out_bytes += n;
+    if (m_stats)
+        m_stats->on_buffer(n);
+    if (!m_dirty) {
+        m_dirty = true;
+        m_reactor.m_dirty.push_back(this);
+    }
+}
+
+void connection::heartbeat(uint64_t a_interval_ns)
+{
+    m_hb_interval = a_interval_ns;
+    if (a_interval_ns && !m_closed)
+        m_reactor.m_timers.schedule(m_hb, m_reactor.now() + a_interval_ns);
+    else
+        m_hb.cancel();
+}
+
+void connection::resend_after(uint64_t a_timeout_ns)
+{
+    if (!m_closed)
+        m_reactor.m_timers.schedule(m_resend, m_reactor.now() + a_timeout_ns);
+}
+
+void connection::close(const std::string& a_reason)
+{
+    if (m_closed)
+        return;
+    m_closed = true;
+    m_reason = a_reason;
+    m_hb.cancel();
+    m_resend.cancel();
+    m_hold.cancel();
+    // Closing a socket removes it from the epoll set
+    close_fds();
+    m_reactor.m_closed.push_back(this);
+}
+
+void connection::resume_input()
+{
+    if (!m_suspended)
+        return;
+    m_suspended = false;
+    // Resumed from on_frame(): the decoding loop picks up the next frame
+    if (m_decoding)
+        return;
+    decode();
+    if (m_read_ready && !m_suspended && !m_throttled && !m_closed) {
+        m_read_ready = false;
+        handle_read();
+    }
+}
+
+void connection::handle_read()
+{
+    basic_io_buffer<s_buf_size>& in = m_buf.in;
+    while (!m_closed) {
+        if (m_suspended) {
+            m_read_ready = true;
+            return;
+        }
+        if (memory_budget::instance().pressure()) {
+            m_read_ready = true;
+            if (!m_throttled) {
+                m_throttled = true;
+                m_reactor.m_throttled.push_back(this);
+            }
+            return;
+        }
+        if (!in.available()) {
+            in.crunch();
+            if (!in.available())
+                in.reallocate(in.max_size() * 2);
+        }
+        size_t  avail = in.available();
+        ssize_t n     = read(in.wr_ptr(), avail);
+        if (n > 0) {
+            in.commit(n);
+            decode();
+            // A short read drained the socket: the next arrival of data
+            // raises a new edge, so there's no need to read until EAGAIN.
+            // A shm channel raises one only once the wait is announced.
+            if ((size_t)n < avail && !m_suspended && !m_shm) {
+                input_idle();
+                return;
+            }
+        } else if (n == 0) {
+            close("Connection closed by peer");
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            input_idle();
+            return;
+        } else if (errno != EINTR) {
+            close(io_error(errno, "read").what());
+        }
+    }
+}
+
+void connection::input_idle()
+{
+    // A partial frame in the buffer means more input is on its way
+    if (m_closed || m_suspended || m_buf.in.size())
+        return;
+    try {
+        on_input_idle();
+    } catch (std::exception& e) {
+        close(e.what());
+    }
+}
+
+ssize_t connection::read(char* a_buf, size_t n)
+{
+    if (!m_shm)
+        return ::read(m_fd, a_buf, n);
+    try {
+        for (;;) {
+            size_t k = m_shm->read(a_buf, n);
+            if (k)
+                return k;
+            if (m_shm->peer_closed())
+                return m_shm->read(a_buf, n);
+            // Reset the eventfd, then announce the wait for it
+            uint64_t v;
+            while (::read(m_fd, &v, sizeof(v)) < 0 && errno == EINTR) {}
+            if (m_shm->prepare_wait_data()) {
+                errno = EAGAIN;
+                return -1;
+            }
+        }
+    } catch (io_error&) {
+        errno = EIO;
+        return -1;
+    }
+}
+
+void connection::decode()
+{
+    basic_io_buffer<s_buf_size>& in = m_buf.in;
+    m_decoding = true;
+    try {
+        while (!m_closed && !m_suspended && in.size()) {
+            size_t need = m_in_version == WIRE_V2 ? decode_v2() : decode_v1();
+            if (need) {
+                // Make room for the whole frame
+                if (need > (size_t)(in.end() - in.rd_ptr())) {
+                    in.crunch();
+                    in.reallocate(need);
+                }
+                break;
+            }
+        }
+    } catch (std::exception& e) {
+        m_decoding = false;
+        close(e.what());
+        return;
+    }
+    m_decoding = false;
+    if (!in.size()) {
+        // Release the memory of a buffer grown for a large frame
+        if (in.allocated())
+            in.reset();
+        else
+            in.crunch();
+    }
+}
+
+size_t connection::decode_v1()
+{
+    basic_io_buffer<s_buf_size>& in = m_buf.in;
+    if (in.size() < sizeof(msg_base_header))
+        return sizeof(msg_base_header);
+    msg_base_header* h = msg_base_header::decode_header(in.rd_ptr(), in.size());
+    size_t need = h->header_size();
+    // The peer sets the payload size: it's bounded before the buffer is
+    // grown for the frame
+    if (in.size() >= need)
+        need += h->payload_size();
+    if (in.size() < need)
+        return need;
+    in.read(need);
+    if (m_stats)
+        m_stats->on_frame(stats_layout::RX, h->cmd(), need);
+    on_frame(h, need);
+    return 0;
+}
+
+size_t connection::decode_v2()
+{
+    basic_io_buffer<s_buf_size>& in = m_buf.in;
+    frame_v2 f;
+    if (!m_codec.decode(in.rd_ptr(), in.size(), f))
+        return f.size ? f.size : in.size() + 1;
+    in.read(f.size);
+    if (m_stats)
+        m_stats->on_frame(stats_layout::RX, f.cmd, f.size);
+    if (f.cmd != msg_base_header::APPEND) {
+        // A version 1 message follows the prefix
+        msg_base_header* h = reinterpret_cast<msg_base_header*>(const_cast<char*>(f.data));
+        on_frame(h, h->header_size() + h->payload_size());
+        return 0;
+    }
+    // Rebuild the version 1 frame: the short header leaves no room to
+    // do it in place
+    size_t n = sizeof(msg_append) + f.chunk_size;
+    m_v2_frame.reallocate(n);
+    char*  p = m_v2_frame.wr_ptr();
+    msg_append::create(f.id, 0, -1, f.src_offset, f.chunk_size, buffer_allocator(p));
+    memcpy(p + sizeof(msg_append), f.data, f.chunk_size);
+    on_frame(reinterpret_cast<msg_base_header*>(p), n);
+    if (m_v2_frame.allocated())
+        m_v2_frame.reset();
+    return 0;
+}
+
+void connection::flush_due()
+{
+    if (!m_out_bytes)
+        return;     // Flushed by the hold timer
+    uint64_t now  = m_reactor.now();
+    bool     held = m_held_since != 0;
+    if (!held)
+        m_held_since = now;
+    if (m_policy.due(m_out_bytes, m_held_since, now))
+        flush();
+    else if (!held && m_policy.max_delay)
+        m_reactor.m_timers.schedule(m_hold, now + m_policy.max_delay);
+}
+
+void connection::flush()
+{
+    basic_io_buffer<s_buf_size>& out = m_buf.out;
+    m_held_since = 0;
+    m_hold.cancel();
+    while (!m_closed && m_out_head < m_out.size()) {
+        iovec  iov[s_max_iov];
+        int    cnt = 0;
+        char*  p   = out.rd_ptr();
+        size_t i   = m_out_head;
+        for (; i < m_out.size() && cnt < s_max_iov; ++i, ++cnt) {
+            iov[cnt] = m_out[i];
+            if (!iov[cnt].iov_base) {
+                iov[cnt].iov_base = p;
+                p += iov[cnt].iov_len;
+            }
+        }
+        ssize_t n = write(iov, cnt, i < m_out.size());
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return;     // Resumed on the EPOLLOUT edge
+            close(io_error(errno, "writev").what());
+            return;
+        }
+        m_out_bytes -= n;
+        if (m_stats)
+            m_stats->on_buffer(-n);
+        while (n > 0) {
+            iovec& v = m_out[m_out_head];
+            size_t k = std::min((size_t)n, v.iov_len);
+            if (v.iov_base)
+                v.iov_base = static_cast<char*>(v.iov_base) + k;
+            else
+                out.read(k);
+            v.iov_len -= k;
+            n         -= k;
+            if (!v.iov_len)
+                m_out_head++;
+        }
+    }
+    m_out.clear();
+    m_out_head = 0;
+    if (out.allocated())
+        out.reset();
+    else
+        out.crunch();
+    if (!m_closed)
+        on_drained();
+}
+
+ssize_t connection::write(const iovec* a_iov, int a_cnt, bool a_more)
+{
+    if (m_shm) {
+        try {
+            for (;;) {
+                if (m_shm->peer_closed()) {
+                    errno = EPIPE;
+                    return -1;
+                }
+                size_t n = m_shm->write(a_iov, a_cnt);
+                if (n)
+                    return n;
+                uint64_t v;
+                while (::read(m_space_fd, &v, sizeof(v)) < 0 && errno == EINTR) {}
+                if (m_shm->prepare_wait_space()) {
+                    errno = EAGAIN;
+                    return -1;
+                }
+            }
+        } catch (io_error&) {
+            errno = EIO;
+            return -1;
+        }
+    }
+    m_writes++;
+    if (m_stats)
+        m_stats->on_write();
+    if (m_sendmsg) {
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov    = const_cast<iovec*>(a_iov);
+        msg.msg_iovlen = a_cnt;
+        ssize_t n = ::sendmsg(m_fd, &msg, MSG_NOSIGNAL | (a_more ? MSG_MORE : 0));
+        if (n >= 0 || errno != ENOTSOCK)
+            return n;
+        m_sendmsg = false;
+    }
+    return ::writev(m_fd, a_iov, a_cnt);
+}
+
+void connection::heartbeat_timer()
+{
+    m_reactor.m_timers.schedule(m_hb, m_reactor.now() + m_hb_interval);
+    on_heartbeat();
+}
+
+void connection::resend_timer()
+{
+    on_resend_timeout();
+}
+
+void connection::hold_timer()
+{
+    if (!m_closed)
+        flush();
+}
+
+//----------------------------------------------------------------------------
+// reactor
+//----------------------------------------------------------------------------
+
+reactor::reactor(uint64_t a_tick_ns) throw(io_error)
+    : m_epfd(epoll_create1(EPOLL_CLOEXEC)), m_stop(false), m_now(clock_ns())
+    , m_timers(a_tick_ns, m_now), m_polls(0), m_stats(NULL)
+{
+    if (m_epfd < 0)
+        throw io_error(errno, "epoll_create");
+}
+
+reactor::~reactor()
+{
+    ::close(m_epfd);
+}
+
+uint64_t reactor::clock_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void reactor::add(connection& a_conn) throw(io_error)
+{
+    // Events of a shm channel's space eventfd are served like EPOLLOUT
+    int fds[2] = { a_conn.fd(), a_conn.space_fd() };
+    for (int i = 0; i < 2 && fds[i] >= 0; ++i) {
+        int fl = fcntl(fds[i], F_GETFL);
+        if (fl < 0 || fcntl(fds[i], F_SETFL, fl | O_NONBLOCK) < 0)
+            throw io_error(errno, "fcntl");
+        epoll_event ev;
+        ev.events   = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.ptr = &a_conn;
+        if (epoll_ctl(m_epfd, EPOLL_CTL_ADD, fds[i], &ev) < 0)
+            throw io_error(errno, "epoll_ctl");
+    }
+    m_busy.apply(a_conn.fd());
+    // Data may have arrived before the registration
+    a_conn.handle_read();
+    flush_all();
+    reap();
+}
+
+int reactor::run_once(int a_timeout_ms) throw(io_error)
+{
+    uint64_t next = m_timers.next_expiry();
+    if (next) {
+        uint64_t now = clock_ns();
+        int      ms  = next > now ? (int)((next - now + 999999) / 1000000) : 0;
+        if (a_timeout_ms < 0 || ms < a_timeout_ms)
+            a_timeout_ms = ms;
+    }
+    // Memory freed by other threads raises no event: poll for relief
+    if (!m_throttled.empty() && (a_timeout_ms < 0 || a_timeout_ms > 1))
+        a_timeout_ms = 1;
+    // Don't sleep until the reactor has been idle for a while.  A blocking
+    // wait in busy-polling mode is capped at the idle window, so that a
+    // window that was open when the caller checked it can't turn into an
+    // unbounded sleep.
+    if (a_timeout_ms && m_backoff.polling(clock_ns())) {
+        a_timeout_ms = 0;
+        m_polls++;
+    } else if (m_busy.enabled()) {
+        int ms = (int)std::min<uint64_t>((m_busy.idle_ns + 999999) / 1000000, INT_MAX);
+        if (a_timeout_ms < 0 || ms < a_timeout_ms)
+            a_timeout_ms = ms;
+    }
+
+    epoll_event events[s_max_events];
+    int n = epoll_wait(m_epfd, events, s_max_events, a_timeout_ms);
+    if (n < 0) {
+        if (errno != EINTR)
+            throw io_error(errno, "epoll_wait");
+        n = 0;
+    }
+    m_now = clock_ns();
+    if (n)
+        m_backoff.work(m_now);
+
+    for (int i = 0; i < n; ++i) {
+        connection* c = static_cast<connection*>(events[i].data.ptr);
+        if (c->m_closed)
+            continue;
+        uint32_t e = events[i].events;
+        if (e & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+            c->handle_read();
+        if ((e & EPOLLOUT) && !c->m_closed && !c->m_dirty && !c->m_held_since &&
+            c->m_out_bytes)
+            c->flush();
+    }
+    m_timers.advance(m_now);
+    flush_all();
+    reap();
+    if (!m_throttled.empty() || memory_budget::instance().pressure())
+        relieve();
+    return n;
+}
+
+void reactor::run() throw(io_error)
+{
+    m_stop = false;
+    if (m_busy.cpu >= 0)
+        busy_poll::pin(m_busy.cpu);
+    while (!m_stop)
+        run_once();
+}
+
+void reactor::busy_polling(const busy_poll& a_opts)
+{
+    m_busy = a_opts;
+    m_backoff.idle_ns(a_opts.idle_ns);
+    // Start polling right away
+    m_backoff.work(clock_ns());
+}
+
+void reactor::flush_all()
+{
+    for (size_t i = 0; i < m_dirty.size(); ++i) {
+        connection* c = m_dirty[i];
+        c->m_dirty = false;
+        if (!c->m_closed)
+            c->flush_due();
+    }
+    m_dirty.clear();
+}
+
+void reactor::remove_reclaimer(memory_reclaimer& a_reclaimer)
+{
+    std::vector<memory_reclaimer*>::iterator it =
+        std::find(m_reclaimers.begin(), m_reclaimers.end(), &a_reclaimer);
+    if (it != m_reclaimers.end())
+        m_reclaimers.erase(it);
+}
+
+void reactor::relieve()
+{
+    memory_budget& mb = memory_budget::instance();
+    // Shrink caches down to the low watermark, freed memory goes to this
+    // thread's credit until flushed
+    mb.flush();
+    for (size_t i = 0; i < m_reclaimers.size() && mb.pressure(); ++i)
+        if (mb.used() > mb.low_watermark()) {
+            m_reclaimers[i]->reclaim(mb.used() - mb.low_watermark());
+            mb.flush();
+        }
+    if (mb.pressure() || m_throttled.empty())
+        return;
+    std::vector<connection*> thr;
+    thr.swap(m_throttled);
+    for (size_t i = 0; i < thr.size(); ++i) {
+        connection* c = thr[i];
+        c->m_throttled = false;
+        if (!c->m_closed && !c->m_suspended && c->m_read_ready) {
+            c->m_read_ready = false;
+            c->handle_read();
+        }
+    }
+    flush_all();
+    reap();
+}
+
+void reactor::reap()
+{
+    while (!m_closed.empty()) {
+        connection* c = m_closed.back();
+        m_closed.pop_back();
+        c->on_close(c->m_reason);
+    }
+}
+
+} // namespace replog
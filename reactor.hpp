@@ -0,0 +1,334 @@
+//----------------------------------------------------------------------------
+/// \file  reactor.hpp
+//----------------------------------------------------------------------------
+/// \brief Edge-triggered epoll event loop driving replication connections.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _REPLOG_REACTOR_HPP_
+#define _REPLOG_REACTOR_HPP_
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <sys/uio.h>
+#include <boost/noncopyable.hpp>
+#include <replog/error.hpp>
+#include <replog/buffer.hpp>
+#include <replog/proto.hpp>
+#include <replog/proto_v2.hpp>
+#include <replog/memory_budget.hpp>
+#include <replog/timer_wheel.hpp>
+#include <replog/send_policy.hpp>
+#include <replog/busy_poll.hpp>
+#include <replog/stats.hpp>
+
+namespace replog {
+
+class reactor;
+class shm_channel;
+
+/**
+ * \brief Connection driven by a reactor.
+ * The reactor reads everything available into the input buffer and calls
+ * on_frame() for every complete frame, so a subclass only implements the
+ * protocol.  Output queued with send() is gathered and written with one
+ * writev() per loop iteration.  A payload may be queued by reference
+ * (e.g. a chunk of a mapped file), it must then stay valid until the
+ * output is written out.  Both buffers start inline and grow only for
+ * frames that don't fit; they shrink back once drained.
+ *
+ * With a send_policy other than immediate, output is held back in the
+ * buffer until the policy is due and then written in one batch; a timer
+ * flushes output that stays below the byte threshold.  The delay is
+ * honoured at the resolution of the timer wheel when the reactor is idle.
+ * A batch that needs several system calls is written with MSG_MORE on
+ * all but the last one, so the kernel coalesces it into full packets.
+ *
+ * A connection has a heartbeat timer, rearmed automatically, and a resend
+ * timer armed on demand, both on the reactor's timer wheel.
+ *
+ * Instead of a socket a connection can run over one side of a shared
+ * memory channel: frames are then copied to and from its rings and the
+ * reactor waits on the channel's eventfds only when a ring is empty or
+ * full, so the same protocol code serves same-host peers without any
+ * kernel copy.  Closing the connection shuts its side of the channel
+ * down; the channel must outlive the connection.
+ *
+ * Input is decoded in version 1 of the wire format until input_version()
+ * switches it, e.g. to the codec_v2 format agreed with msg_hello.  An
+ * APPEND of version 2 is handed to on_frame() as a msg_append followed
+ * by its payload, like one of version 1, so subclasses handle both alike.
+ *
+ * A connection created while its reactor has a stats_segment counts
+ * itself, the frames and bytes it sends and receives per command, its
+ * writes (see frames_sent() and writes()) and the output it holds in the
+ * segment.
+ */
+class connection: boost::noncopyable {
+public:
+    static const int s_buf_size = 16 * 1024;
+    static const int s_max_iov  = 64;
+    typedef io_buffer<s_buf_size> buffer_type;
+
+    connection(reactor& a_reactor, int a_fd);
+    /// Connection over side \a a_channel of an open shared memory channel.
+    connection(reactor& a_reactor, shm_channel& a_channel) throw(io_error);
+    virtual ~connection();
+
+    int                 fd()        const { return m_fd; }
+    /// Descriptor signalling output space of a shm channel, -1 if none.
+    int                 space_fd()  const { return m_space_fd; }
+    bool                is_open()   const { return m_fd >= 0; }
+    /// Reason the connection was closed for, empty while it's open.
+    const std::string&  reason()    const { return m_reason; }
+    reactor&            get_reactor()     { return m_reactor; }
+    buffer_type&        buffer()          { return m_buf; }
+    /// Bytes queued for output.
+    size_t              pending()   const { return m_out_bytes; }
+    /// Segment the connection publishes its counters to, NULL if none.
+    stats_segment*      stats()     const { return m_stats; }
+
+    /// Set the policy of flushing queued output.
+    void                policy(const send_policy& a_policy) { m_policy = a_policy; }
+    const send_policy&  policy()    const { return m_policy; }
+    /// Frames queued for output since the connection was created.
+    uint64_t            frames_sent()   const { return m_frames_sent; }
+    /// System calls that wrote output (at most one packet each, usually).
+    uint64_t            writes()        const { return m_writes; }
+
+    /// Return space for \a n bytes of output, e.g. to build a message in
+    /// place with buffer_allocator.
+    char* reserve(size_t n);
+    /// Queue \a n bytes written at the pointer returned by reserve().
+    void  commit(size_t n) {
+        m_buf.out.commit(n);
+        queue(NULL, n);
+        sent(m_buf.out.wr_ptr() - n, n);
+    }
+
+    /// Queue a copy of \a n bytes at \a a_data for output.
+    void send(const void* a_data, size_t n) {
+        memcpy(reserve(n), a_data, n);
+        commit(n);
+    }
+
+    /// Queue a copy of header \a a_hdr followed by \a a_payload passed by
+    /// reference.
+    void send(const void* a_hdr, size_t a_hdr_len, const char* a_payload, size_t n);
+
+    /// Call on_heartbeat() every \a a_interval_ns (0 - never).
+    void heartbeat(uint64_t a_interval_ns);
+
+    /// Call on_resend_timeout() in \a a_timeout_ns unless rearmed or
+    /// cancelled before.
+    void resend_after(uint64_t a_timeout_ns);
+    void cancel_resend() { m_resend.cancel(); }
+
+    /// Decode the input following the frame being handled in version
+    /// \a a_version of the wire format.
+    void input_version(wire_version a_version) { m_in_version = a_version; }
+    wire_version input_version() const { return m_in_version; }
+
+    /// Stop decoding frames and reading the socket, e.g. to apply
+    /// backpressure.  Unread data is left in the socket buffer.
+    void suspend_input() { m_suspended = true; }
+    /// Resume input, decoding frames buffered so far.
+    void resume_input();
+    bool input_suspended() const { return m_suspended; }
+
+    /// Close the connection.  on_close() is called from the reactor once
+    /// the current event batch is done.  A connection registered with a
+    /// reactor may only be deleted from its on_close().
+    void close(const std::string& a_reason);
+
+protected:
+    /// Handle frame \a a_hdr of \a n bytes including the payload.  The
+    /// frame is valid only for the duration of the call.  Exceptions
+    /// close the connection.
+    virtual void on_frame(msg_base_header* a_hdr, size_t n) = 0;
+    virtual void on_heartbeat() {}
+    virtual void on_resend_timeout() {}
+    /// Called when all queued output has been written.
+    virtual void on_drained() {}
+    /// Called when the input ran dry: every frame received so far has
+    /// been handled and the peer sent nothing more yet.  Exceptions close
+    /// the connection.
+    virtual void on_input_idle() {}
+    virtual void on_close(const std::string& /*a_reason*/) {}
+
+private:
+    friend class reactor;
+
+    reactor&           m_reactor;
+    int                m_fd;
+    int                m_space_fd;
+    shm_channel*       m_shm;
+    stats_segment*     m_stats;
+    buffer_type        m_buf;
+    // Output segments in order, iov_base == NULL refers to bytes of the
+    // output buffer
+    std::vector<iovec> m_out;
+    size_t             m_out_head;  // First unwritten segment
+    size_t             m_out_bytes;
+    bool               m_dirty;     // Queued for flushing
+    bool               m_closed;
+    bool               m_suspended;
+    bool               m_read_ready;    // Input left unread while suspended
+    bool               m_throttled;     // Input left unread for memory pressure
+    bool               m_decoding;
+    bool               m_sendmsg;       // The descriptor is a socket
+    std::string        m_reason;
+    uint64_t           m_hb_interval;
+    wheel_timer        m_hb;
+    wheel_timer        m_resend;
+    send_policy        m_policy;
+    uint64_t           m_held_since;    // Time output was held back, 0 - not held
+    wheel_timer        m_hold;
+    uint64_t           m_frames_sent;
+    uint64_t           m_writes;
+    wire_version       m_in_version;
+    codec_v2           m_codec;         // Offset state of version 2 input
+    basic_io_buffer<512> m_v2_frame;    // Version 2 APPEND as msg_append
+
+    void queue(const char* a_ref, size_t n);
+    /// Account for frame \a a_hdr of \a n bytes queued for output.
+    void sent(const char* a_hdr, size_t n) {
+        m_frames_sent++;
+        if (m_stats)
+            m_stats->on_frame(stats_layout::TX,
+                reinterpret_cast<const msg_base_header*>(a_hdr)->cmd(), n);
+    }
+    void close_fds();
+    void handle_read();
+    void input_idle();
+    ssize_t read(char* a_buf, size_t n);
+    void decode();
+    /// Handle the frame at the start of the input buffer if it's complete.
+    /// @return 0 if handled, otherwise the bytes it needs.
+    size_t decode_v1();
+    size_t decode_v2();
+    /// Flush output if the send policy is due, hold it back otherwise.
+    void flush_due();
+    void flush();
+    ssize_t write(const iovec* a_iov, int a_cnt, bool a_more);
+    void heartbeat_timer();
+    void resend_timer();
+    void hold_timer();
+};
+
+/**
+ * \brief Single-threaded event loop over edge-triggered epoll.
+ * Each readiness edge is drained completely: a connection reads until the
+ * socket is empty and decodes all complete frames before the next one is
+ * served.  Output queued while handling events is flushed at the end of
+ * the iteration, so replies to a batch of frames leave in one writev().
+ * Timeouts of all connections share one timer wheel, and epoll_wait()
+ * sleeps no longer than until its next expiry.
+ *
+ * While memory_budget reports pressure, connections leave new input
+ * unread in their sockets, and the reactor asks its reclaimers to free
+ * the excess.  Input resumes once the pressure is relieved.
+ *
+ * In busy-polling mode run_once() doesn't block while events keep
+ * coming: it polls epoll without a timeout until the reactor has been
+ * idle for busy_poll::idle_ns, and then blocks no longer than another
+ * idle window at a time.  run() pins the calling thread to the configured CPU.
+ */
+class reactor: boost::noncopyable {
+public:
+    static const int s_max_events = 256;
+
+    /// Create a reactor with timer resolution of \a a_tick_ns.
+    explicit reactor(uint64_t a_tick_ns = 1000000) throw(io_error);
+    ~reactor();
+
+    /// Start serving connection \a a_conn.  Its socket is made
+    /// non-blocking.
+    void add(connection& a_conn) throw(io_error);
+
+    /// Wait for events no longer than \a a_timeout_ms (-1 - until there
+    /// are events or timers expire) and handle them.
+    /// @return number of events handled.
+    int  run_once(int a_timeout_ms = -1) throw(io_error);
+
+    /// Run until stop() is called.
+    void run() throw(io_error);
+    void stop() { m_stop = true; }
+
+    /// Shrink \a a_reclaimer (e.g. a cache used by connections of this
+    /// reactor) under memory pressure.
+    void add_reclaimer(memory_reclaimer& a_reclaimer) { m_reclaimers.push_back(&a_reclaimer); }
+    void remove_reclaimer(memory_reclaimer& a_reclaimer);
+
+    /// Publish counters of connections created afterwards to \a a_stats,
+    /// NULL - stop publishing.  The segment must outlive them.
+    void stats(stats_segment* a_stats) { m_stats = a_stats; }
+    stats_segment* stats() const { return m_stats; }
+
+    /// Connections waiting for memory pressure to ease.
+    size_t throttled() const { return m_throttled.size(); }
+
+    /// Set the busy-polling mode.  SO_BUSY_POLL is applied to connections
+    /// added afterwards.
+    void busy_polling(const busy_poll& a_opts);
+    const busy_poll& busy_polling() const { return m_busy; }
+    /// True if the next run_once() polls rather than blocks.
+    bool polling() const { return m_backoff.polling(clock_ns()); }
+    /// Iterations of run_once() that polled instead of blocking.
+    uint64_t polls() const { return m_polls; }
+
+    /// Time (CLOCK_MONOTONIC ns) cached at the last wakeup.
+    uint64_t     now() const { return m_now; }
+    timer_wheel& timers()    { return m_timers; }
+
+    static uint64_t clock_ns();
+
+private:
+    friend class connection;
+
+    int                      m_epfd;
+    bool                     m_stop;
+    uint64_t                 m_now;
+    timer_wheel              m_timers;
+    std::vector<connection*> m_dirty;
+    std::vector<connection*> m_closed;
+    std::vector<connection*> m_throttled;
+    std::vector<memory_reclaimer*> m_reclaimers;
+    busy_poll                m_busy;
+    idle_backoff             m_backoff;
+    uint64_t                 m_polls;
+    stats_segment*           m_stats;
+
+    void flush_all();
+    void reap();
+    void relieve();
+};
+
+} // namespace replog
+
+#endif // _REPLOG_REACTOR_HPP_
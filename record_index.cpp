@@ -0,0 +1,286 @@
+//----------------------------------------------------------------------------
+/// \file  record_index.cpp
+//----------------------------------------------------------------------------
+/// \brief Sparse index of record offsets and timestamps.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#include <replog/record_index.hpp>
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace replog {
+
+const size_t record_index::s_head_size;
+
+record_index::record_index(uint32_t a_interval, char a_delim, timestamp_fn a_ts)
+    : m_interval(a_interval ? a_interval : 1), m_delim(a_delim), m_ts(a_ts), m_fd(-1)
+    , m_records(0), m_size(0), m_rec_start(0), m_head_len(0)
+{}
+
+void record_index::open(const std::string& a_name) throw(io_error)
+{
+    close();
+    std::string idx = a_name + ".idx";
+    if ((m_fd = ::open(idx.c_str(), O_RDWR | O_CREAT, 0644)) < 0)
+        throw io_error(errno, idx.c_str());
+
+    int dfd = ::open(a_name.c_str(), O_RDONLY);
+    if (dfd < 0 && errno != ENOENT) {
+        int err = errno;
+        close();
+        throw io_error(err, a_name.c_str());
+    }
+    try {
+        struct stat st;
+        uint64_t data_size = dfd >= 0 && fstat(dfd, &st) == 0 ? st.st_size : 0;
+        if (fstat(m_fd, &st) < 0)
+            throw io_error(errno, "fstat");
+
+        // Keep entries consistent with the data file
+        std::vector<disk_entry> disk(st.st_size / sizeof(disk_entry));
+        size_t n = disk.size() * sizeof(disk_entry);
+        if (n && pread(m_fd, &disk[0], n, 0) != (ssize_t)n)
+            throw io_error(errno, "pread");
+        m_entries.clear();
+        for (size_t i = 0; i < disk.size(); ++i) {
+            entry e(disk[i].record, disk[i].timestamp, disk[i].offset);
+            if (e.offset >= data_size ||
+                (!m_entries.empty() && (e.record  <= m_entries.back().record ||
+                                        e.offset  <= m_entries.back().offset)))
+                break;
+            m_entries.push_back(e);
+        }
+
+        // Rescan the data following the last entry
+        entry last;
+        if (!m_entries.empty()) {
+            last = m_entries.back();
+            m_entries.pop_back();
+        }
+        if (ftruncate(m_fd, m_entries.size() * sizeof(disk_entry)) < 0)
+            throw io_error(errno, "ftruncate");
+        m_records   = last.record;
+        m_size      = m_rec_start = last.offset;
+        m_head_len  = 0;
+        char buf[64 * 1024];
+        while (m_size < data_size) {
+            ssize_t k = pread(dfd, buf, std::min<uint64_t>(sizeof(buf), data_size - m_size), m_size);
+            if (k <= 0)
+                throw io_error(k < 0 ? errno : EIO, "pread");
+            append(buf, k, m_size);
+        }
+    } catch (...) {
+        if (dfd >= 0)
+            ::close(dfd);
+        close();
+        throw;
+    }
+    if (dfd >= 0)
+        ::close(dfd);
+}
+
+void record_index::close()
+{
+    if (m_fd >= 0)
+        ::close(m_fd);
+    m_fd = -1;
+    m_entries.clear();
+    m_records = m_size = m_rec_start = 0;
+    m_head_len = 0;
+}
+
+void record_index::append(const char* a_data, size_t n, uint64_t a_offset) throw(io_error)
+{
+    if (a_offset != m_size)
+        throw io_error("Non-sequential append to index (offset=", a_offset,
+                       ", expected=", m_size, ")");
+    const char* p = a_data;
+    const char* e = a_data + n;
+    while (p < e) {
+        const char* q = static_cast<const char*>(memchr(p, m_delim, e - p));
+        bool sampled  = m_records % m_interval == 0;
+        if (!q) {
+            // Keep the head of an incomplete sampled record for the timestamp
+            if (sampled && m_head_len < s_head_size) {
+                size_t k = std::min<size_t>(s_head_size - m_head_len, e - p);
+                memcpy(m_head + m_head_len, p, k);
+                m_head_len += k;
+            }
+            break;
+        }
+        if (sampled) {
+            const char* rec = p;
+            size_t      len = std::min<size_t>(q + 1 - p, s_head_size);
+            if (m_head_len) {
+                size_t k = std::min<size_t>(s_head_size - m_head_len, q + 1 - p);
+                memcpy(m_head + m_head_len, p, k);
+                rec = m_head;
+                len = m_head_len + k;
+            }
+            add(entry(m_records, m_ts ? m_ts(rec, len) : 0, m_rec_start));
+        }
+        m_records++;
+        m_head_len  = 0;
+        p           = q + 1;
+        m_rec_start = a_offset + (p - a_data);
+    }
+    m_size = a_offset + n;
+}
+
+void record_index::skip(uint64_t a_offset, uint64_t n) throw(io_error)
+{
+    static const char s_zeros[4096] = {0};
+    if (!m_delim) {
+        // Every zero byte of the hole ends a record
+        for (uint64_t k; n; n -= k, a_offset += k) {
+            k = std::min<uint64_t>(n, sizeof(s_zeros));
+            append(s_zeros, k, a_offset);
+        }
+        return;
+    }
+    if (a_offset != m_size)
+        throw io_error("Non-sequential append to index (offset=", a_offset,
+                       ", expected=", m_size, ")");
+    // No record ends in the hole, it only extends the incomplete record
+    if (m_records % m_interval == 0 && m_head_len < s_head_size) {
+        size_t k = std::min<uint64_t>(s_head_size - m_head_len, n);
+        memset(m_head + m_head_len, 0, k);
+        m_head_len += k;
+    }
+    m_size = a_offset + n;
+}
+
+void record_index::add(const entry& a_entry) throw(io_error)
+{
+    m_entries.push_back(a_entry);
+    if (m_fd < 0)
+        return;
+    disk_entry d;
+    d.record    = a_entry.record;
+    d.timestamp = a_entry.timestamp;
+    d.offset    = a_entry.offset;
+    off_t pos   = (m_entries.size() - 1) * sizeof(d);
+    if (pwrite(m_fd, &d, sizeof(d), pos) != (ssize_t)sizeof(d))
+        throw io_error(errno, "pwrite");
+}
+
+size_t record_index::upper_bound_record(uint64_t a_record) const
+{
+    size_t lo = 0, hi = m_entries.size();
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (m_entries[mid].record <= a_record)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+size_t record_index::lower_bound_time(uint64_t a_ts) const
+{
+    size_t lo = 0, hi = m_entries.size();
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (m_entries[mid].timestamp < a_ts)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+record_index::entry record_index::find_record(uint64_t a_record) const
+{
+    size_t i = upper_bound_record(a_record);
+    return i ? m_entries[i-1] : entry();
+}
+
+record_index::entry record_index::find_time(uint64_t a_ts) const
+{
+    size_t i = lower_bound_time(a_ts);
+    return i ? m_entries[i-1] : m_entries.empty() ? entry() : m_entries[0];
+}
+
+void record_index::read_span(int a_fd, size_t a_idx, std::string& a_buf) const throw(io_error)
+{
+    uint64_t begin = m_entries[a_idx].offset;
+    uint64_t end   = a_idx + 1 < m_entries.size() ? m_entries[a_idx+1].offset : m_size;
+    a_buf.resize(end - begin);
+    for (size_t n = 0; n < a_buf.size(); ) {
+        ssize_t k = pread(a_fd, &a_buf[n], a_buf.size() - n, begin + n);
+        if (k <= 0)
+            throw io_error(k < 0 ? errno : EIO, "pread");
+        n += k;
+    }
+}
+
+uint64_t record_index::offset_of(int a_fd, uint64_t a_record) const throw(io_error)
+{
+    if (a_record >= m_records)
+        return m_size;
+    size_t i = upper_bound_record(a_record) - 1;
+    const entry& e = m_entries[i];
+    if (e.record == a_record)
+        return e.offset;
+    std::string buf;
+    read_span(a_fd, i, buf);
+    const char* p = buf.data();
+    for (uint64_t n = e.record; n < a_record; ++n)
+        p = static_cast<const char*>(memchr(p, m_delim, buf.data() + buf.size() - p)) + 1;
+    return e.offset + (p - buf.data());
+}
+
+uint64_t record_index::offset_at(int a_fd, uint64_t a_ts) const throw(io_error)
+{
+    if (!m_ts)
+        throw io_error("Index has no timestamps");
+    if (m_entries.empty())
+        return m_size;
+    size_t i = lower_bound_time(a_ts);
+    if (i == 0)
+        return m_entries[0].offset;
+    std::string buf;
+    read_span(a_fd, i - 1, buf);
+    const char* b = buf.data();
+    const char* e = b + buf.size();
+    for (const char* p = b; p < e; ) {
+        const char* q = static_cast<const char*>(memchr(p, m_delim, e - p));
+        if (!q)
+            break;
+        if (m_ts(p, std::min<size_t>(q + 1 - p, s_head_size)) >= a_ts)
+            return m_entries[i-1].offset + (p - b);
+        p = q + 1;
+    }
+    return i < m_entries.size() ? m_entries[i].offset : m_size;
+}
+
+} // namespace replog
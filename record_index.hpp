@@ -0,0 +1,145 @@
+//----------------------------------------------------------------------------
+/// \file  record_index.hpp
+//----------------------------------------------------------------------------
+/// \brief Sparse index of record offsets and timestamps of replicated files.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _REPLOG_RECORD_INDEX_HPP_
+#define _REPLOG_RECORD_INDEX_HPP_
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <string.h>
+#include <boost/noncopyable.hpp>
+#include <replog/error.hpp>
+#include <replog/raw_char.hpp>
+
+namespace replog {
+
+/// Length of the longest prefix of \a a_data made of complete records
+/// terminated by \a a_delim, 0 if there's none.  Senders use it to align
+/// chunks to record boundaries.
+inline size_t record_boundary(const char* a_data, size_t n, char a_delim = '\n') {
+    const char* p = static_cast<const char*>(memrchr(a_data, a_delim, n));
+    return p ? p - a_data + 1 : 0;
+}
+
+/**
+ * \brief Sparse index of the records of a file.
+ * Records are terminated by a delimiter.  The receiver passes appended
+ * data to append() as it arrives; every interval-th record gets an entry
+ * holding its number, its timestamp (extracted by an optional callback
+ * from the head of the record) and its byte offset.  Entries are kept in
+ * memory and appended to a sidecar file "<file>.idx", which open() loads
+ * after a restart, checking it against the data file.
+ *
+ * Queries are a binary search over the entries followed by a single read
+ * of at most interval records: offset_of() locates a record by number
+ * (e.g. the last N records for a tail), offset_at() the first record at
+ * or after a timestamp.  Timestamps are expected to be non-decreasing.
+ */
+class record_index: boost::noncopyable {
+public:
+    struct entry {
+        uint64_t record;        ///< Record number, 0-based
+        uint64_t timestamp;
+        uint64_t offset;        ///< Byte offset of the record
+        entry(uint64_t a_rec = 0, uint64_t a_ts = 0, uint64_t a_off = 0)
+            : record(a_rec), timestamp(a_ts), offset(a_off)
+        {}
+    };
+
+    /// Extract a timestamp from record head \a a_rec of \a n bytes.
+    typedef uint64_t (*timestamp_fn)(const char* a_rec, size_t n);
+
+    /// Bytes of a record head available to the timestamp callback
+    static const size_t s_head_size = 64;
+
+    explicit record_index(uint32_t a_interval = 1024, char a_delim = '\n',
+                          timestamp_fn a_ts = NULL);
+    ~record_index() { close(); }
+
+    /// Open the index of data file \a a_name, creating or rebuilding it
+    /// as needed.  The index then covers the whole data file.
+    void open(const std::string& a_name) throw(io_error);
+    void close();
+
+    /// Index \a n bytes appended at \a a_offset, which must be the end
+    /// of data indexed so far.
+    void append(const char* a_data, size_t n, uint64_t a_offset) throw(io_error);
+    /// Index a hole of \a n zero bytes at \a a_offset, as append() would.
+    void skip(uint64_t a_offset, uint64_t n) throw(io_error);
+
+    /// Number of complete records.
+    uint64_t records()  const { return m_records; }
+    /// Bytes indexed.
+    uint64_t size()     const { return m_size; }
+    const std::vector<entry>& entries() const { return m_entries; }
+
+    /// Entry preceding record \a a_record (a zero entry if there's none).
+    entry find_record(uint64_t a_record) const;
+    /// Last entry with a timestamp below \a a_ts (the first entry if
+    /// there's none).
+    entry find_time(uint64_t a_ts) const;
+
+    /// Offset of record \a a_record of the data file open as \a a_fd,
+    /// size() if there's no such record.
+    uint64_t offset_of(int a_fd, uint64_t a_record) const throw(io_error);
+    /// Offset of the first record with a timestamp not below \a a_ts,
+    /// size() if there's none.
+    uint64_t offset_at(int a_fd, uint64_t a_ts) const throw(io_error);
+
+private:
+    struct disk_entry {
+        raw_char<8> record;
+        raw_char<8> timestamp;
+        raw_char<8> offset;
+    };
+
+    uint32_t           m_interval;
+    char               m_delim;
+    timestamp_fn       m_ts;
+    int                m_fd;            // Sidecar file
+    uint64_t           m_records;
+    uint64_t           m_size;
+    uint64_t           m_rec_start;     // Offset of the incomplete record
+    char               m_head[s_head_size];
+    size_t             m_head_len;      // Head of an incomplete sampled record
+    std::vector<entry> m_entries;
+
+    void add(const entry& a_entry) throw(io_error);
+    /// Read data between entry \a a_idx and the next one into \a a_buf.
+    void read_span(int a_fd, size_t a_idx, std::string& a_buf) const throw(io_error);
+    size_t upper_bound_record(uint64_t a_record) const;
+    size_t lower_bound_time(uint64_t a_ts) const;
+};
+
+} // namespace replog
+
+#endif // _REPLOG_RECORD_INDEX_HPP_
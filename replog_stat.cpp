@@ -0,0 +1,138 @@
+//----------------------------------------------------------------------------
+/// \file  replog_stat.cpp
+//----------------------------------------------------------------------------
+/// \brief Tool printing statistics published by a REPLOG daemon.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <replog/stats.hpp>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace replog;
+
+namespace {
+
+    void print_histogram(const char* a_name, const latency_histogram& h) {
+        printf("%-16s count=%llu p50=%.3fus p99=%.3fus p999=%.3fus max=%.3fus\n",
+            a_name, (unsigned long long)h.total(),
+            h.percentile(50) / 1e3, h.percentile(99) / 1e3,
+            h.percentile(99.9) / 1e3, h.max() / 1e3);
+    }
+
+    void print(const stats_segment& a_seg, bool a_all) {
+        const stats_layout* d = a_seg.data();
+        printf("role=%s pid=%u max_files=%u connections=%llu resends=%llu syncs=%llu\n",
+            d->role, d->pid, d->max_files,
+            (unsigned long long)atomic::load_relaxed(d->connections),
+            (unsigned long long)atomic::load_relaxed(d->resends),
+            (unsigned long long)atomic::load_relaxed(d->syncs));
+        printf("buffer_bytes=%llu buffer_high_water=%llu queue_depth=%llu "
+               "queue_high_water=%llu\n",
+            (unsigned long long)atomic::load_relaxed(d->buffer_bytes),
+            (unsigned long long)atomic::load_relaxed(d->buffer_high_water),
+            (unsigned long long)atomic::load_relaxed(d->queue_depth),
+            (unsigned long long)atomic::load_relaxed(d->queue_high_water));
+
+        uint64_t tx = 0;
+        for (int c = 0; c < 256; ++c)
+            tx += atomic::load_relaxed(d->frames[stats_layout::TX][c]);
+        uint64_t writes = atomic::load_relaxed(d->writes);
+        printf("writes=%llu frames_per_write=%.2f\n", (unsigned long long)writes,
+            writes ? (double)tx / writes : 0.0);
+
+        printf("%-4s %14s %16s %14s %16s\n", "cmd", "tx_frames", "tx_bytes",
+               "rx_frames", "rx_bytes");
+        for (int c = 0; c < 256; ++c) {
+            uint64_t txf = atomic::load_relaxed(d->frames[stats_layout::TX][c]);
+            uint64_t rxf = atomic::load_relaxed(d->frames[stats_layout::RX][c]);
+            if (!txf && !rxf)
+                continue;
+            printf("%-4c %14llu %16llu %14llu %16llu\n", c,
+                (unsigned long long)txf,
+                (unsigned long long)atomic::load_relaxed(d->bytes[stats_layout::TX][c]),
+                (unsigned long long)rxf,
+                (unsigned long long)atomic::load_relaxed(d->bytes[stats_layout::RX][c]));
+        }
+
+        print_histogram("apply_latency", d->apply_latency);
+        print_histogram("ack_latency",   d->ack_latency);
+
+        printf("%-8s %14s %14s %14s %8s  %s\n",
+            "id", "src_size", "ack_size", "lag", "resends", "name");
+        for (uint32_t i = 0; i < a_seg.max_files(); ++i) {
+            const stats_file* f = a_seg.file(i);
+            if (!atomic::load_acquire(f->active) && !a_all)
+                continue;
+            printf("%-8u %14llu %14llu %14llu %8llu  %s\n", f->id,
+                (unsigned long long)atomic::load_relaxed(f->src_size),
+                (unsigned long long)atomic::load_relaxed(f->ack_size),
+                (unsigned long long)f->lag(),
+                (unsigned long long)atomic::load_relaxed(f->resends),
+                f->name);
+        }
+    }
+
+    void usage(const char* a_prog) {
+        fprintf(stderr,
+            "Usage: %s [-i Seconds] [-a] SegmentName\n\n"
+            "  -i  Print statistics every Seconds\n"
+            "  -a  Include inactive file slots\n",
+            a_prog);
+        exit(1);
+    }
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    int  interval = 0, opt;
+    bool all      = false;
+    while ((opt = getopt(argc, argv, "i:ah")) != -1)
+        switch (opt) {
+            case 'i': interval = atoi(optarg); break;
+            case 'a': all      = true;         break;
+            default:  usage(argv[0]);
+        }
+    if (optind >= argc)
+        usage(argv[0]);
+
+    try {
+        stats_segment seg;
+        seg.open(argv[optind]);
+        do {
+            print(seg, all);
+            fflush(stdout);
+        } while (interval > 0 && sleep(interval) == 0);
+    } catch (std::exception& e) {
+        fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
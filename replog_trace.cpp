@@ -0,0 +1,159 @@
+//----------------------------------------------------------------------------
+/// \file  replog_trace.cpp
+//----------------------------------------------------------------------------
+/// \brief Tool reconstructing per-chunk timelines from a trace dump.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <replog/trace.hpp>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace replog;
+
+namespace {
+
+    typedef std::pair<uint32_t, uint64_t>         chunk_key;    // (id, src_offset)
+    typedef std::vector<trace_record>             timeline;
+    typedef std::map<chunk_key, timeline>         chunk_map;
+
+    bool by_tsc(const trace_record& a, const trace_record& b) { return a.tsc < b.tsc; }
+
+    struct chunk {
+        chunk_key       key;
+        const timeline* events;
+        uint64_t        duration;
+        bool operator< (const chunk& a) const { return duration > a.duration; }
+    };
+
+    double to_us(uint64_t a_ticks, uint64_t a_hz) { return a_ticks * 1e6 / a_hz; }
+
+    void print_timeline(const chunk& c, uint64_t a_hz) {
+        const timeline& t = *c.events;
+        printf("id=%u offset=%llu total=%.3fus:", c.key.first,
+            (unsigned long long)c.key.second, to_us(c.duration, a_hz));
+        for (size_t i = 0; i < t.size(); ++i)
+            printf(" %s(t%u)+%.3f", trace_event_name(t[i].event), t[i].thread,
+                to_us(t[i].tsc - t[0].tsc, a_hz));
+        printf("\n");
+    }
+
+    /// Print percentiles of delays between consecutive stages.
+    void print_stages(const chunk_map& a_chunks, uint64_t a_hz) {
+        std::map<std::pair<int,int>, std::vector<uint64_t> > delays;
+        for (chunk_map::const_iterator it = a_chunks.begin(); it != a_chunks.end(); ++it)
+            for (size_t i = 1; i < it->second.size(); ++i)
+                delays[std::make_pair(it->second[i-1].event, it->second[i].event)]
+                    .push_back(it->second[i].tsc - it->second[i-1].tsc);
+
+        printf("%-28s %10s %12s %12s %12s\n", "stage", "count", "p50_us", "p99_us", "max_us");
+        for (std::map<std::pair<int,int>, std::vector<uint64_t> >::iterator
+             it = delays.begin(); it != delays.end(); ++it) {
+            std::vector<uint64_t>& v = it->second;
+            std::sort(v.begin(), v.end());
+            std::string name = std::string(trace_event_name(it->first.first))
+                             + "->" + trace_event_name(it->first.second);
+            printf("%-28s %10lu %12.3f %12.3f %12.3f\n", name.c_str(),
+                (unsigned long)v.size(), to_us(v[v.size() / 2], a_hz),
+                to_us(v[(v.size() - 1) * 99 / 100], a_hz), to_us(v.back(), a_hz));
+        }
+    }
+
+    void usage(const char* a_prog) {
+        fprintf(stderr,
+            "Usage: %s [-n Count] [-i Id] [-a] TraceFile ...\n\n"
+            "  -n  Print timelines of Count slowest chunks (default: 20)\n"
+            "  -i  Only consider chunks of file Id\n"
+            "  -a  Print timelines of all chunks in file order\n",
+            a_prog);
+        exit(1);
+    }
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t count = 20;
+    long   id    = -1;
+    bool   all   = false;
+    int    opt;
+    while ((opt = getopt(argc, argv, "n:i:ah")) != -1)
+        switch (opt) {
+            case 'n': count = atoi(optarg); break;
+            case 'i': id    = atol(optarg); break;
+            case 'a': all   = true;         break;
+            default:  usage(argv[0]);
+        }
+    if (optind >= argc)
+        usage(argv[0]);
+
+    try {
+        // Dumps of several processes on the same host share the TSC clock
+        trace_file_header         hdr;
+        std::vector<trace_record> records;
+        for (int i = optind; i < argc; ++i) {
+            std::vector<trace_record> v;
+            tracer::load(argv[i], hdr, v);
+            records.insert(records.end(), v.begin(), v.end());
+        }
+
+        chunk_map chunks;
+        for (size_t i = 0; i < records.size(); ++i)
+            if (id < 0 || records[i].id == (uint32_t)id)
+                chunks[chunk_key(records[i].id, records[i].src_offset)].push_back(records[i]);
+
+        std::vector<chunk> list;
+        for (chunk_map::iterator it = chunks.begin(); it != chunks.end(); ++it) {
+            std::sort(it->second.begin(), it->second.end(), by_tsc);
+            chunk c = { it->first, &it->second,
+                        it->second.back().tsc - it->second.front().tsc };
+            list.push_back(c);
+        }
+
+        printf("records=%lu chunks=%lu tsc_hz=%llu\n", (unsigned long)records.size(),
+            (unsigned long)list.size(), (unsigned long long)hdr.tsc_hz);
+        if (list.empty())
+            return 0;
+        print_stages(chunks, hdr.tsc_hz);
+
+        if (!all) {
+            std::sort(list.begin(), list.end());
+            list.resize(std::min(count, list.size()));
+        }
+        for (size_t i = 0; i < list.size(); ++i)
+            print_timeline(list[i], hdr.tsc_hz);
+    } catch (std::exception& e) {
+        fprintf(stderr, "Error: %s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
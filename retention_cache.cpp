@@ -0,0 +1,205 @@
+//----------------------------------------------------------------------------
+/// \file  retention_cache.cpp
+//----------------------------------------------------------------------------
+/// \brief Sender-side cache of recently sent chunks.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#include <replog/retention_cache.hpp>
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace replog {
+
+retention_cache::retention_cache(size_t a_budget, int a_protected_pct)
+    : m_budget(a_budget), m_protected_pct(std::max(0, std::min(100, a_protected_pct)))
+    , m_size(0), m_protected_size(0), m_chunks(0), m_hit_bytes(0), m_miss_bytes(0)
+{}
+
+retention_cache::~retention_cache()
+{
+    for (size_t i = 0; i < m_files.size(); ++i)
+        remove(i);
+}
+
+void retention_cache::insert(uint32_t a_id, uint64_t a_offset, const char* a_data, size_t n)
+{
+    if (!n || n > m_budget)
+        return;
+    if (a_id >= m_files.size())
+        m_files.resize(a_id + 1);
+    erase(a_id, a_offset, a_offset + n);
+    memory_budget& mb = memory_budget::instance();
+    while (!mb.try_acquire(n)) {
+        if (!m_chunks)
+            return;
+        evict_one();
+    }
+    node* p = new node(a_id, a_offset, n);
+    memcpy(p->data.data, a_data, n);
+    m_files[a_id][a_offset] = p;
+    m_probation.add(p);
+    m_size += n;
+    m_chunks++;
+    evict();
+}
+
+size_t retention_cache::read(uint32_t a_id, uint64_t a_offset, char* a_buf, size_t n,
+    int a_fd) throw(io_error)
+{
+    size_t done = 0;
+    while (done < n) {
+        uint64_t pos = a_offset + done;
+        node*    p   = find(a_id, pos);
+        if (p && p->data.offset <= pos) {
+            size_t k = std::min<uint64_t>(n - done, p->data.offset + p->data.len - pos);
+            memcpy(a_buf + done, p->data.data + (pos - p->data.offset), k);
+            m_hit_bytes += k;
+            done        += k;
+            hit(p);
+            continue;
+        }
+        // Read from disk up to the next cached chunk
+        size_t  want = p ? std::min<uint64_t>(n - done, p->data.offset - pos) : n - done;
+        ssize_t k    = pread(a_fd, a_buf + done, want, pos);
+        if (k < 0) {
+            if (errno == EINTR)
+                continue;
+            throw io_error(errno, "pread");
+        }
+        m_miss_bytes += k;
+        done         += k;
+        if ((size_t)k < want)
+            break;
+    }
+    return done;
+}
+
+void retention_cache::release(uint32_t a_id, uint64_t a_offset)
+{
+    if (a_id >= m_files.size())
+        return;
+    file_map& f = m_files[a_id];
+    while (!f.empty()) {
+        node* p = f.begin()->second;
+        if (p->data.offset + p->data.len > a_offset)
+            break;
+        erase(p);
+    }
+}
+
+void retention_cache::remove(uint32_t a_id)
+{
+    release(a_id, (uint64_t)-1);
+}
+
+void retention_cache::budget(size_t a_budget)
+{
+    m_budget = a_budget;
+    evict();
+}
+
+void retention_cache::hit(node* a_node)
+{
+    if (a_node->data.hot) {
+        m_protected.use(a_node);
+        return;
+    }
+    m_probation.remove(a_node);
+    m_protected.add(a_node);
+    a_node->data.hot  = true;
+    m_protected_size += a_node->data.len;
+    // Demote the least recently used protected chunks
+    size_t limit = m_budget / 100 * m_protected_pct;
+    while (m_protected_size > limit && !m_protected.empty()) {
+        node* p = lru<chunk>::node(m_protected.tail());
+        m_protected.remove(p);
+        m_probation.add(p);
+        p->data.hot       = false;
+        m_protected_size -= p->data.len;
+    }
+}
+
+size_t retention_cache::reclaim(size_t a_bytes)
+{
+    size_t size = m_size;
+    while (m_chunks && size - m_size < a_bytes)
+        evict_one();
+    return size - m_size;
+}
+
+void retention_cache::evict()
+{
+    while (m_size > m_budget)
+        evict_one();
+}
+
+void retention_cache::evict_one()
+{
+    chunk* c = m_probation.empty() ? m_protected.tail() : m_probation.tail();
+    erase(lru<chunk>::node(c));
+}
+
+void retention_cache::erase(node* a_node)
+{
+    chunk& c = a_node->data;
+    if (c.hot) {
+        m_protected.remove(a_node);
+        m_protected_size -= c.len;
+    } else
+        m_probation.remove(a_node);
+    m_files[c.id].erase(c.offset);
+    m_size -= c.len;
+    m_chunks--;
+    memory_budget::instance().release(c.len);
+    delete a_node;
+}
+
+void retention_cache::erase(uint32_t a_id, uint64_t a_begin, uint64_t a_end)
+{
+    for (node* p; (p = find(a_id, a_begin)) && p->data.offset < a_end; )
+        erase(p);
+}
+
+retention_cache::node* retention_cache::find(uint32_t a_id, uint64_t a_offset) const
+{
+    if (a_id >= m_files.size())
+        return NULL;
+    const file_map& f = m_files[a_id];
+    file_map::const_iterator it = f.upper_bound(a_offset);
+    if (it != f.begin()) {
+        file_map::const_iterator prev = it;
+        node* p = (--prev)->second;
+        if (p->data.offset + p->data.len > a_offset)
+            return p;
+    }
+    return it == f.end() ? NULL : it->second;
+}
+
+} // namespace replog
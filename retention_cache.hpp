@@ -0,0 +1,145 @@
+//----------------------------------------------------------------------------
+/// \file  retention_cache.hpp
+//----------------------------------------------------------------------------
+/// \brief Sender-side cache of recently sent chunks answering resend
+/// requests from memory.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _REPLOG_RETENTION_CACHE_HPP_
+#define _REPLOG_RETENTION_CACHE_HPP_
+
+#include <map>
+#include <vector>
+#include <stdint.h>
+#include <boost/noncopyable.hpp>
+#include <replog/error.hpp>
+#include <replog/lru.hpp>
+#include <replog/memory_budget.hpp>
+
+namespace replog {
+
+/**
+ * \brief Cache of chunks recently sent to receivers.
+ * The sender stores every chunk it sends with insert().  After a network
+ * blip a receiver asks to resend a file from its dst_size, and read()
+ * serves the range from memory.  It reads from disk only the parts that
+ * the cache no longer holds.  Chunks below a receiver's ack are
+ * dropped with release().
+ *
+ * All files share one byte budget.  Eviction follows a segmented LRU.
+ * New chunks enter a probation segment.  A chunk is promoted to the
+ * protected segment when a read hits it.  The protected segment holds at
+ * most a fraction of the budget, and its least recently used chunks are
+ * demoted back to probation.  Eviction takes the tail of probation first.
+ * Chunks that several reconnecting receivers ask for therefore survive a
+ * stream of fresh chunks that nobody reads back.
+ *
+ * Cached data is accounted in memory_budget.  When the budget refuses
+ * a new chunk the cache evicts its own chunks to make room for it.  It
+ * is also a memory_reclaimer, so a reactor under memory pressure can
+ * shrink it.
+ *
+ * The cache isn't thread-safe: it's shared by the sessions of one
+ * reactor thread.
+ */
+class retention_cache: public memory_reclaimer, boost::noncopyable {
+public:
+    /// \a a_budget - total bytes of cached data; \a a_protected_pct -
+    /// percentage of the budget held by the protected segment.
+    explicit retention_cache(size_t a_budget, int a_protected_pct = 80);
+    ~retention_cache();
+
+    /// Cache \a n bytes of file \a a_id sent at \a a_offset.  Cached data
+    /// overlapping the range is replaced.
+    void insert(uint32_t a_id, uint64_t a_offset, const char* a_data, size_t n);
+
+    /// Copy \a n bytes of file \a a_id at \a a_offset to \a a_buf.  Ranges
+    /// not in the cache are read from \a a_fd.
+    /// @return number of bytes copied, less than \a n at end of file.
+    size_t read(uint32_t a_id, uint64_t a_offset, char* a_buf, size_t n, int a_fd)
+        throw(io_error);
+
+    /// Drop cached data of file \a a_id below \a a_offset.
+    void release(uint32_t a_id, uint64_t a_offset);
+    /// Drop all cached data of file \a a_id.
+    void remove(uint32_t a_id);
+
+    /// Change the budget, evicting chunks that no longer fit.
+    void budget(size_t a_budget);
+
+    /// Evict about \a a_bytes of the least valuable chunks.
+    size_t reclaim(size_t a_bytes);
+
+    size_t   budget()     const { return m_budget; }
+    size_t   size()       const { return m_size; }
+    size_t   chunks()     const { return m_chunks; }
+    /// Bytes served by read() from memory and from disk.
+    uint64_t hit_bytes()  const { return m_hit_bytes; }
+    uint64_t miss_bytes() const { return m_miss_bytes; }
+
+private:
+    struct chunk {
+        uint32_t id;
+        bool     hot;       // In the protected segment
+        uint64_t offset;
+        size_t   len;
+        char*    data;
+
+        chunk(uint32_t a_id, uint64_t a_offset, size_t a_len)
+            : id(a_id), hot(false), offset(a_offset), len(a_len), data(new char[a_len])
+        {}
+        ~chunk() { delete [] data; }
+    };
+
+    typedef lru_node<chunk>                 node;
+    typedef std::map<uint64_t, node*>       file_map;   // By chunk offset
+
+    size_t                  m_budget;
+    int                     m_protected_pct;
+    size_t                  m_size;
+    size_t                  m_protected_size;
+    size_t                  m_chunks;
+    uint64_t                m_hit_bytes;
+    uint64_t                m_miss_bytes;
+    lru<chunk>              m_probation;
+    lru<chunk>              m_protected;
+    std::vector<file_map>   m_files;
+
+    void hit(node* a_node);
+    void evict();
+    void evict_one();
+    void erase(node* a_node);
+    void erase(uint32_t a_id, uint64_t a_begin, uint64_t a_end);
+    /// Chunk of file \a a_id holding \a a_offset, or else the first chunk
+    /// after it.  NULL if there's none.
+    node* find(uint32_t a_id, uint64_t a_offset) const;
+};
+
+} // namespace replog
+
+#endif // _REPLOG_RETENTION_CACHE_HPP_
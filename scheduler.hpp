@@ -0,0 +1,201 @@
+//----------------------------------------------------------------------------
+/// \file  scheduler.hpp
+//----------------------------------------------------------------------------
+/// \brief Scheduler interleaving chunks of per-file streams on one
+/// connection by priority class and weight.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _REPLOG_SCHEDULER_HPP_
+#define _REPLOG_SCHEDULER_HPP_
+
+#include <vector>
+#include <stdint.h>
+#include <boost/assert.hpp>
+#include <replog/error.hpp>
+
+namespace replog {
+
+/**
+ * \brief Deficit round-robin scheduler of per-file streams.
+ * Every file of a session is a stream identified by its file id.  Streams
+ * belong to strict priority classes (0 is the highest): a class is served
+ * only when all higher classes are idle.  Within a class backlogged
+ * streams take turns; on each turn a stream earns quantum * weight bytes
+ * of credit and is picked by next() while the credit lasts.  A chunk may
+ * overdraw the credit, the debt is paid back on later turns, so each
+ * stream gets a share of the connection proportional to its weight
+ * whatever the size of its chunks.  A hot file therefore waits behind at
+ * most one turn of every other backlogged stream of its class rather
+ * than behind a whole backlog of a bulk resync.
+ */
+class stream_scheduler {
+public:
+    static const int s_classes = 4;
+
+    explicit stream_scheduler(uint32_t a_quantum = 16 * 1024)
+        : m_quantum(a_quantum)
+    {
+        for (int i = 0; i < s_classes; ++i)
+            m_head[i] = -1;
+    }
+
+    /// Register stream \a a_id with priority class \a a_class and
+    /// relative \a a_weight within the class.
+    void add(uint32_t a_id, int a_class = 0, uint32_t a_weight = 1) throw(io_error) {
+        if (a_class < 0 || a_class >= s_classes)
+            throw io_error("Invalid priority class:", a_class);
+        if (a_weight == 0)
+            throw io_error("Invalid stream weight:", a_weight);
+        if (m_streams.size() <= a_id)
+            m_streams.resize(a_id + 1);
+        remove(a_id);
+        stream& s = m_streams[a_id];
+        s.cls     = a_class;
+        s.weight  = a_weight;
+        s.deficit = 0;
+        s.exists  = true;
+    }
+
+    /// Unregister stream \a a_id.
+    void remove(uint32_t a_id) {
+        if (!exists(a_id))
+            return;
+        unlink(a_id);
+        m_streams[a_id].exists = false;
+    }
+
+    bool exists(uint32_t a_id) const {
+        return a_id < m_streams.size() && m_streams[a_id].exists;
+    }
+
+    /// True if stream \a a_id is queued for sending.
+    bool active(uint32_t a_id) const {
+        return exists(a_id) && m_streams[a_id].next >= 0;
+    }
+
+    /// Queue stream \a a_id that got data to send.
+    void activate(uint32_t a_id) {
+        BOOST_ASSERT(exists(a_id));
+        if (active(a_id))
+            return;
+        stream& s = m_streams[a_id];
+        int&    h = m_head[s.cls];
+        if (h < 0) {
+            s.next = s.prev = a_id;
+            h = a_id;
+        } else {
+            // Insert at the tail, i.e. just before the head
+            stream& head = m_streams[h];
+            s.next = h;
+            s.prev = head.prev;
+            m_streams[head.prev].next = a_id;
+            head.prev = a_id;
+        }
+    }
+
+    /// Pick the stream to send the next chunk from, skipping classes
+    /// set in the \a a_blocked bit mask (e.g. by rate_limiter::blocked()).
+    /// @return stream id or -1 if no stream is backlogged.
+    int next(unsigned a_blocked = 0) {
+        for (int c = 0; c < s_classes; ++c) {
+            if (a_blocked & (1u << c))
+                continue;
+            for (int& h = m_head[c]; h >= 0; h = m_streams[h].next) {
+                stream& s = m_streams[h];
+                if (s.deficit > 0)
+                    return h;
+                s.deficit += (int64_t)m_quantum * s.weight;
+            }
+        }
+        return -1;
+    }
+
+    /// Credit left to stream \a a_id returned by next().  Callers should
+    /// keep the chunk within it, though overdrawing is allowed.
+    uint32_t budget(uint32_t a_id) const {
+        int64_t d = m_streams[a_id].deficit;
+        return d > 0 ? (d > 0xFFFFFFFFll ? 0xFFFFFFFFu : (uint32_t)d) : 0;
+    }
+
+    /// Account \a a_bytes sent by stream \a a_id.  \a a_backlogged tells
+    /// whether the stream has more data queued.
+    void sent(uint32_t a_id, uint32_t a_bytes, bool a_backlogged) {
+        stream& s = m_streams[a_id];
+        s.deficit -= a_bytes;
+        if (!a_backlogged) {
+            // An idle stream keeps its debt but doesn't bank credit
+            if (s.deficit > 0)
+                s.deficit = 0;
+            unlink(a_id);
+        } else if (s.deficit <= 0 && m_head[s.cls] == (int)a_id)
+            m_head[s.cls] = s.next;
+    }
+
+    bool empty() const {
+        for (int c = 0; c < s_classes; ++c)
+            if (m_head[c] >= 0)
+                return false;
+        return true;
+    }
+
+private:
+    struct stream {
+        int      cls;
+        uint32_t weight;
+        int64_t  deficit;
+        int      next;      // Circular list of active streams of a class,
+        int      prev;      // -1 when the stream is idle
+        bool     exists;
+
+        stream() : cls(0), weight(1), deficit(0), next(-1), prev(-1), exists(false) {}
+    };
+
+    uint32_t            m_quantum;
+    int                 m_head[s_classes];
+    std::vector<stream> m_streams;
+
+    void unlink(uint32_t a_id) {
+        stream& s = m_streams[a_id];
+        if (s.next < 0)
+            return;
+        int& h = m_head[s.cls];
+        if (s.next == (int)a_id)
+            h = -1;
+        else {
+            m_streams[s.prev].next = s.next;
+            m_streams[s.next].prev = s.prev;
+            if (h == (int)a_id)
+                h = s.next;
+        }
+        s.next = s.prev = -1;
+    }
+};
+
+} // namespace replog
+
+#endif // _REPLOG_SCHEDULER_HPP_
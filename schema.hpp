@@ -0,0 +1,319 @@
+//----------------------------------------------------------------------------
+/// \file  schema.hpp
+//----------------------------------------------------------------------------
+/// \brief Declarative compile-time message schema.
+/// A message is declared as a list of tagged integer fields.  The packed
+/// layout, field offsets and byte order conversion are computed at compile
+/// time from the declaration.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _REPLOG_SCHEMA_HPP_
+#define _REPLOG_SCHEMA_HPP_
+
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/is_same.hpp>
+#include <replog/error.hpp>
+#include <replog/endian.hpp>
+#include <replog/proto.hpp>
+
+namespace replog {
+namespace schema {
+
+//----------------------------------------------------------------------------
+// Byte orders
+//----------------------------------------------------------------------------
+
+/// Network byte order of the wire format.
+struct big_endian_order {
+    static const uint8_t s_magic = 132;
+
+    template <typename T>
+    static T    load(const char* p)     { T n; cast_be(p, n); return n; }
+    template <typename T>
+    static void store(char* p, T n)     { store_be(p, n); }
+};
+
+//----------------------------------------------------------------------------
+// Field lists
+//----------------------------------------------------------------------------
+
+/// Field of integer type \a T identified by the \a Tag type.
+template <class Tag, typename T>
+struct field {
+    typedef Tag tag;
+    typedef T   type;
+    static const size_t size = sizeof(T);
+};
+
+struct no_field {
+    typedef no_field tag;
+    typedef void     type;
+    static const size_t size = 0;
+};
+
+/// Ordered list of up to eight fields.
+template <class F0 = no_field, class F1 = no_field, class F2 = no_field,
+          class F3 = no_field, class F4 = no_field, class F5 = no_field,
+          class F6 = no_field, class F7 = no_field>
+struct fields {
+    typedef F0 f0; typedef F1 f1; typedef F2 f2; typedef F3 f3;
+    typedef F4 f4; typedef F5 f5; typedef F6 f6; typedef F7 f7;
+};
+
+/// N-th field of a field list.
+template <class Fields, int N> struct field_at;
+template <class L> struct field_at<L, 0> { typedef typename L::f0 type; };
+template <class L> struct field_at<L, 1> { typedef typename L::f1 type; };
+template <class L> struct field_at<L, 2> { typedef typename L::f2 type; };
+template <class L> struct field_at<L, 3> { typedef typename L::f3 type; };
+template <class L> struct field_at<L, 4> { typedef typename L::f4 type; };
+template <class L> struct field_at<L, 5> { typedef typename L::f5 type; };
+template <class L> struct field_at<L, 6> { typedef typename L::f6 type; };
+template <class L> struct field_at<L, 7> { typedef typename L::f7 type; };
+template <class L> struct field_at<L, 8> { typedef no_field type; };
+
+/// Offset of the N-th field from the beginning of the field list.
+template <class Fields, int N>
+struct field_offset {
+    static const size_t value = field_offset<Fields, N-1>::value
+                              + field_at<Fields, N-1>::type::size;
+};
+template <class Fields>
+struct field_offset<Fields, 0> { static const size_t value = 0; };
+
+/// Total packed size of a field list.
+template <class Fields>
+struct fields_size { static const size_t value = field_offset<Fields, 8>::value; };
+
+/// Index of the field tagged \a Tag, or 8 if there's no such field.
+template <class Fields, class Tag, int N = 0>
+struct field_index {
+    static const int value =
+        boost::is_same<typename field_at<Fields, N>::type::tag, Tag>::value
+            ? N : field_index<Fields, Tag, N+1>::value;
+};
+template <class Fields, class Tag>
+struct field_index<Fields, Tag, 8> { static const int value = 8; };
+
+/// Field tagged \a Tag.
+template <class Fields, class Tag>
+struct field_of {
+    static const int index = field_index<Fields, Tag>::value;
+    BOOST_STATIC_ASSERT(index < 8);
+    typedef typename field_at<Fields, index>::type  field_type;
+    typedef typename field_type::type               type;
+    static const size_t offset = field_offset<Fields, index>::value;
+};
+
+//----------------------------------------------------------------------------
+// Messages
+//----------------------------------------------------------------------------
+
+/**
+ * \brief Message of command \a Cmd with fields \a Fields following the
+ * common 12-byte header (header size, magic, command, id, name hash)
+ * encoded in byte order \a Order.
+ * The object is a packed array of bytes, so it can be placed directly
+ * in an I/O buffer.  A variable-size tail (e.g. a file name) may follow
+ * the fixed part and is included in header_size().
+ */
+template <char Cmd, class Fields, class Order = big_endian_order>
+class message {
+public:
+    typedef Fields  field_list;
+    typedef Order   order;
+
+    static const char   s_cmd       = Cmd;
+    static const size_t s_base_size = 12;
+    static const size_t s_size      = s_base_size + fields_size<Fields>::value;
+
+    BOOST_STATIC_ASSERT(s_base_size == sizeof(msg_base_header));
+    BOOST_STATIC_ASSERT(s_size <= 0xFFFF);
+private:
+    char m_data[s_size];
+
+    message() {}
+public:
+    uint16_t header_size()  const { return Order::template load<uint16_t>(m_data);     }
+    uint8_t  magic()        const { return m_data[2]; }
+    char     cmd()          const { return m_data[3]; }
+    uint32_t id()           const { return Order::template load<uint32_t>(m_data + 4); }
+    uint32_t name_hash()    const { return Order::template load<uint32_t>(m_data + 8); }
+
+    /// Variable-size data following the fixed fields.
+    char*       tail()            { return m_data + s_size; }
+    const char* tail()      const { return m_data + s_size; }
+    size_t      tail_size() const { return header_size() - s_size; }
+
+    template <class Tag>
+    typename field_of<Fields, Tag>::type get() const {
+        typedef field_of<Fields, Tag> f;
+        return Order::template load<typename f::type>(m_data + s_base_size + f::offset);
+    }
+
+    template <class Tag>
+    void set(typename field_of<Fields, Tag>::type a_value) {
+        typedef field_of<Fields, Tag> f;
+        Order::store(m_data + s_base_size + f::offset, a_value);
+    }
+
+    /// Initialize the header of a message placed in \a a_buf, which must
+    /// have room for s_size + \a a_tail_size bytes.
+    static message* init(char* a_buf, uint32_t a_id, uint32_t a_name_hash,
+                         size_t a_tail_size = 0)
+    {
+        size_t size = s_size + a_tail_size;
+        if (size > 0xFFFF)
+            throw replog_error("Message too large:", size);
+        message* p = reinterpret_cast<message*>(a_buf);
+        Order::store(p->m_data, (uint16_t)size);
+        p->m_data[2] = Order::s_magic;
+        p->m_data[3] = Cmd;
+        Order::store(p->m_data + 4, a_id);
+        Order::store(p->m_data + 8, a_name_hash);
+        return p;
+    }
+
+    template <typename Alloc>
+    static message* create(uint32_t a_id, uint32_t a_name_hash,
+                           size_t a_tail_size = 0, const Alloc& a = Alloc())
+    {
+        char* p = Alloc(a).allocate(s_size + a_tail_size);
+        return init(p, a_id, a_name_hash, a_tail_size);
+    }
+
+    /// Validate a frame of \a a_len bytes and return it as this message.
+    static message* cast(char* a_buf, size_t a_len) {
+        if (a_len < s_size)
+            throw replog_error("Bad buffer size:", a_len);
+        message* p = reinterpret_cast<message*>(a_buf);
+        if (p->magic() != Order::s_magic)
+            throw replog_error("Wrong magic number:", (int)p->magic());
+        if (p->cmd() != Cmd)
+            throw replog_error("Unexpected command type:", p->cmd());
+        if (p->header_size() < s_size || p->header_size() > a_len)
+            throw replog_error("Bad header size (got=", p->header_size(),
+                               ", expected=", s_size, ")");
+        return p;
+    }
+};
+
+template <char Cmd, class Fields, class Order>
+const char   message<Cmd, Fields, Order>::s_cmd;
+template <char Cmd, class Fields, class Order>
+const size_t message<Cmd, Fields, Order>::s_base_size;
+template <char Cmd, class Fields, class Order>
+const size_t message<Cmd, Fields, Order>::s_size;
+
+//----------------------------------------------------------------------------
+// Schemas of the REPLOG protocol messages
+//----------------------------------------------------------------------------
+namespace tag {
+    struct mode;        struct src_fd;      struct src_size;    struct dst_fd;
+    struct dst_size;    struct src_offset;  struct chunk_size;  struct last_cmd;
+    struct block_size;  struct first_block; struct count;       struct dst_offset;
+    struct old_offset;  struct length;      struct checksum;    struct version;
+}
+
+template <class Order = big_endian_order>
+struct protocol {
+    typedef message<msg_base_header::GET_SIZE, fields<
+        field<tag::mode,        uint32_t>,
+        field<tag::src_fd,      int32_t>,
+        field<tag::src_size,    uint64_t> >, Order>             get_size;
+
+    typedef message<msg_base_header::GET_SIZE_RESPONSE, fields<
+        field<tag::dst_fd,      int32_t>,
+        field<tag::dst_size,    uint64_t> >, Order>             get_size_response;
+
+    typedef message<msg_base_header::APPEND, fields<
+        field<tag::dst_fd,      int32_t>,
+        field<tag::src_offset,  uint64_t>,
+        field<tag::chunk_size,  uint32_t> >, Order>             append;
+
+    typedef message<msg_base_header::HOLE, fields<
+        field<tag::dst_fd,      int32_t>,
+        field<tag::src_offset,  uint64_t>,
+        field<tag::length,      uint64_t> >, Order>             hole;
+
+    typedef message<msg_base_header::RESEND_REQUEST, fields<
+        field<tag::dst_size,    uint64_t> >, Order>             resend_request;
+
+    typedef message<msg_base_header::ACK, fields<
+        field<tag::dst_size,    uint64_t> >, Order>             ack;
+
+    typedef message<msg_base_header::ERROR_RESPONSE, fields<
+        field<tag::last_cmd,    uint8_t> >, Order>              error_response;
+
+    typedef message<msg_base_header::DELTA_REQUEST, fields<
+        field<tag::dst_fd,      int32_t>,
+        field<tag::src_size,    uint64_t>,
+        field<tag::block_size,  uint32_t> >, Order>             delta_request;
+
+    typedef message<msg_base_header::DELTA_SIGNATURES, fields<
+        field<tag::dst_size,    uint64_t>,
+        field<tag::block_size,  uint32_t>,
+        field<tag::first_block, uint32_t>,
+        field<tag::count,       uint32_t> >, Order>             delta_signatures;
+
+    typedef message<msg_base_header::DELTA_COPY, fields<
+        field<tag::dst_fd,      int32_t>,
+        field<tag::dst_offset,  uint64_t>,
+        field<tag::old_offset,  uint64_t>,
+        field<tag::length,      uint32_t> >, Order>             delta_copy;
+
+    typedef message<msg_base_header::DELTA_DONE, fields<
+        field<tag::dst_fd,      int32_t>,
+        field<tag::src_size,    uint64_t>,
+        field<tag::checksum,    uint64_t> >, Order>             delta_done;
+
+    typedef message<msg_base_header::HELLO, fields<
+        field<tag::version,     uint32_t> >, Order>             hello;
+
+    // The schemas must describe exactly the hand-written message classes:
+    // sizes are checked here, each field against its accessor by test_schema
+    BOOST_STATIC_ASSERT(get_size::s_size            == sizeof(msg_get_size));
+    BOOST_STATIC_ASSERT(get_size_response::s_size   == sizeof(msg_get_size_response));
+    BOOST_STATIC_ASSERT(append::s_size              == sizeof(msg_append));
+    BOOST_STATIC_ASSERT(hole::s_size                == sizeof(msg_hole));
+    BOOST_STATIC_ASSERT(resend_request::s_size      == sizeof(msg_resend_request));
+    BOOST_STATIC_ASSERT(ack::s_size                 == sizeof(msg_ack));
+    BOOST_STATIC_ASSERT(error_response::s_size      == sizeof(msg_error_response));
+    BOOST_STATIC_ASSERT(delta_request::s_size       == sizeof(msg_delta_request));
+    BOOST_STATIC_ASSERT(delta_signatures::s_size    == sizeof(msg_delta_signatures));
+    BOOST_STATIC_ASSERT(delta_copy::s_size          == sizeof(msg_delta_copy));
+    BOOST_STATIC_ASSERT(delta_done::s_size          == sizeof(msg_delta_done));
+    BOOST_STATIC_ASSERT(hello::s_size               == sizeof(msg_hello));
+};
+
+typedef protocol<big_endian_order>  wire;
+
+} // namespace schema
+} // namespace replog
+
+#endif // _REPLOG_SCHEMA_HPP_
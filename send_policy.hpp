@@ -0,0 +1,88 @@
+//----------------------------------------------------------------------------
+/// \file  send_policy.hpp
+//----------------------------------------------------------------------------
+/// \brief Policy trading latency for packet efficiency when flushing
+/// queued output.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _REPLOG_SEND_POLICY_HPP_
+#define _REPLOG_SEND_POLICY_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace replog {
+
+/**
+ * \brief When to flush frames queued for output.
+ * Writing every frame as soon as it's encoded gives the lowest latency
+ * but costs a system call and usually a packet per frame.  A policy lets
+ * output accumulate in the connection's buffer up to a high-water mark
+ * of max_bytes, or for at most max_delay nanoseconds since the first
+ * frame was held back, whichever comes first, so that it leaves in fewer
+ * and fuller writes.
+ */
+struct send_policy {
+    size_t   max_bytes;     ///< Flush once this much is queued, 0 - no limit
+    uint64_t max_delay;     ///< Flush this long (ns) after holding output back
+
+    send_policy() : max_bytes(0), max_delay(0) {}
+
+    /// Flush at once (the default).
+    static send_policy immediate() { return send_policy(); }
+
+    /// Flush when \a a_bytes are queued or \a a_max_delay ns after the
+    /// first frame was held back, so that a quiet stream isn't stalled.
+    static send_policy bytes(size_t a_bytes, uint64_t a_max_delay = 1000000) {
+        send_policy p;
+        p.max_bytes = a_bytes;
+        p.max_delay = a_max_delay;
+        return p;
+    }
+
+    /// Flush \a a_delay ns after the first frame was held back.
+    static send_policy delay(uint64_t a_delay) {
+        send_policy p;
+        p.max_delay = a_delay;
+        return p;
+    }
+
+    bool is_immediate() const { return !max_bytes && !max_delay; }
+
+    /// True if \a a_pending bytes held back since time \a a_since (ns)
+    /// are to be flushed at time \a a_now.
+    bool due(size_t a_pending, uint64_t a_since, uint64_t a_now) const {
+        return is_immediate()
+            || (max_bytes && a_pending >= max_bytes)
+            || (max_delay && a_now - a_since >= max_delay);
+    }
+};
+
+} // namespace replog
+
+#endif // _REPLOG_SEND_POLICY_HPP_
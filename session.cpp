@@ -0,0 +1,926 @@
+//----------------------------------------------------------------------------
+/// \file  session.cpp
+//----------------------------------------------------------------------------
+/// \brief Replication sessions written as coroutines.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#include <replog/session.hpp>
+#include <replog/delta.hpp>
+#include <replog/sparse.hpp>
+#include <replog/trace.hpp>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+namespace replog {
+
+namespace {
+
+    const uint32_t s_min_delta_block  = 512;
+    const uint32_t s_max_delta_block  = 1024 * 1024;
+    const uint32_t s_signature_batch  = 1024;   // Signatures per message
+
+} // namespace
+
+/// File being reconstructed by a delta transfer next to the file it
+/// replaces.  Removed unless the transfer completes.
+struct receiver_session::delta_target {
+    int         old_fd;     // Current file, source of block copies
+    int         new_fd;     // Reconstructed file
+    uint64_t    old_size;
+    std::string name;       // Name of the reconstructed file
+
+    delta_target(const std::string& a_name, uint64_t a_size) throw(io_error)
+        : old_fd(-1), new_fd(-1), old_size(a_size)
+    {
+        if ((old_fd = ::open(a_name.c_str(), O_RDONLY)) < 0)
+            throw io_error(errno, a_name.c_str());
+        // A unique name created exclusively: it can't clobber a file
+        // being replicated, whatever that one is called
+        std::vector<char> tmp(a_name.begin(), a_name.end());
+        const char suffix[] = ".delta.XXXXXX";
+        tmp.insert(tmp.end(), suffix, suffix + sizeof(suffix));
+        struct stat st;
+        if ((new_fd = ::mkstemp(&tmp[0])) < 0 || fstat(old_fd, &st) < 0
+         || fchmod(new_fd, st.st_mode & 07777) < 0) {
+            int err = errno;
+            if (new_fd >= 0) {
+                ::close(new_fd);
+                ::unlink(&tmp[0]);
+            }
+            ::close(old_fd);
+            throw io_error(err, &tmp[0]);
+        }
+        name = &tmp[0];
+    }
+
+    ~delta_target() {
+        ::close(old_fd);
+        if (new_fd >= 0) {
+            ::close(new_fd);
+            ::unlink(name.c_str());
+        }
+    }
+
+    /// Cut the reconstructed file at \a a_size and rename it to \a a_name.
+    void replace(const std::string& a_name, uint64_t a_size, bool a_sync) throw(io_error) {
+        if (ftruncate(new_fd, a_size) < 0)
+            throw io_error(errno, "ftruncate");
+        if (a_sync && fsync(new_fd) < 0)
+            throw io_error(errno, "fsync");
+        if (::rename(name.c_str(), a_name.c_str()) < 0)
+            throw io_error(errno, "rename");
+        ::close(new_fd);
+        new_fd = -1;
+    }
+};
+
+//----------------------------------------------------------------------------
+// session
+//----------------------------------------------------------------------------
+
+void session::await_frame(uint64_t a_deadline)
+{
+    m_wait = WAIT_FRAME;
+    if (!a_deadline)
+        cancel_resend();
+    else {
+        uint64_t now = get_reactor().now();
+        resend_after(a_deadline > now ? a_deadline - now : 0);
+    }
+}
+
+void session::await_drain()
+{
+    m_wait = WAIT_DRAIN;
+    suspend_input();
+}
+
+void session::on_frame(msg_base_header* a_hdr, size_t n)
+{
+    if (m_wait != WAIT_FRAME)
+        throw io_error("Unexpected frame:", (char)a_hdr->cmd());
+    m_frame      = a_hdr;
+    m_frame_size = n;
+    resume();
+    m_frame      = NULL;
+    m_frame_size = 0;
+}
+
+void session::on_resend_timeout()
+{
+    if (m_wait == WAIT_FRAME)
+        resume();
+}
+
+void session::on_drained()
+{
+    if (m_wait == WAIT_DRAIN)
+        resume();
+}
+
+void session::resume()
+{
+    m_wait = WAIT_NONE;
+    try {
+        run();
+    } catch (std::exception& e) {
+        close(e.what());
+        return;
+    }
+    if (m_co.is_complete())
+        close("Session complete");
+    else if (m_wait == WAIT_FRAME)
+        resume_input();
+}
+
+//----------------------------------------------------------------------------
+// receiver_session
+//----------------------------------------------------------------------------
+
+receiver_session::~receiver_session()
+{
+    for (size_t i = 0; i < m_files.size(); ++i) {
+        if (m_opts.follow && m_files[i].writer)
+            m_opts.follow->remove_file(i);
+        if (m_files[i].stats)
+            stats()->remove_file(i);
+        delete m_files[i].writer;
+        delete m_files[i].index;
+        delete m_files[i].delta;
+    }
+}
+
+void receiver_session::run()
+{
+    REPLOG_SESSION_BEGIN;
+
+    // Handshake: the peer may agree on the wire version first, and then
+    // opens a file
+    do {
+        REPLOG_AWAIT_FRAME(0);
+        if (frame()->cmd() == msg_base_header::HELLO)
+            hello(static_cast<msg_hello*>(frame()));
+        else if (frame()->cmd() != msg_base_header::GET_SIZE)
+            error(frame(), "Expected GET_SIZE");
+    } while (frame()->cmd() != msg_base_header::GET_SIZE);
+    open_file(static_cast<msg_get_size*>(frame()));
+
+    // Append stream with resend recovery
+    for (;;) {
+        REPLOG_AWAIT_FRAME(deadline());
+        if (frame())
+            dispatch(frame());
+        else if (m_deadline && get_reactor().now() >= m_deadline) {
+            if (++m_resends > m_opts.max_resends)
+                throw io_error("Resent data not received after attempts:", m_opts.max_resends);
+            for (size_t i = 0; i < m_files.size(); ++i)
+                if (m_files[i].recovering)
+                    request_resend(i);
+            m_deadline = 0;
+        }
+        if (m_commit.due(get_reactor().now()))
+            sync();
+
+        if (!m_recovering)
+            m_deadline = m_resends = 0;
+        else if (!m_deadline)
+            m_deadline = get_reactor().now() + m_opts.resend_timeout;
+
+        REPLOG_AWAIT_DRAIN(m_opts.max_pending);
+    }
+
+    REPLOG_SESSION_END;
+}
+
+void receiver_session::dispatch(msg_base_header* a_hdr)
+{
+    switch (a_hdr->cmd()) {
+        case msg_base_header::GET_SIZE:
+            open_file(static_cast<msg_get_size*>(a_hdr));
+            break;
+        case msg_base_header::APPEND:
+            append(static_cast<msg_append*>(a_hdr));
+            break;
+        case msg_base_header::HOLE:
+            hole(static_cast<msg_hole*>(a_hdr));
+            break;
+        case msg_base_header::DELTA_REQUEST:
+            delta_request(static_cast<msg_delta_request*>(a_hdr));
+            break;
+        case msg_base_header::DELTA_COPY:
+            delta_copy(static_cast<msg_delta_copy*>(a_hdr));
+            break;
+        case msg_base_header::DELTA_DONE:
+            delta_done(static_cast<msg_delta_done*>(a_hdr));
+            break;
+        default:
+            error(a_hdr, "Unsupported command");
+    }
+}
+
+void receiver_session::hello(const msg_hello* a_msg)
+{
+    if (a_msg->version() < WIRE_V1) {
+        error(a_msg, "Unsupported version");
+        return;
+    }
+    wire_version peer = a_msg->version() < WIRE_V2 ? WIRE_V1 : WIRE_V2;
+    wire_version v    = negotiate_version(WIRE_V2, peer);
+    msg_hello::create(v, buffer_allocator(reserve(sizeof(msg_hello))));
+    commit(sizeof(msg_hello));
+    input_version(v);
+}
+
+void receiver_session::open_file(const msg_get_size* a_msg)
+{
+    // Both the id and the name come from the peer
+    uint32_t    id   = a_msg->id();
+    std::string name = a_msg->name();
+    if (id >= m_opts.max_files) {
+        error(a_msg, "Bad file id");
+        return;
+    }
+    if (!contained_name(name)) {
+        error(a_msg, "Bad file name");
+        return;
+    }
+    if (!m_opts.root.empty())
+        name = m_opts.root + '/' + name;
+    name += m_opts.suffix;
+
+    if (id >= m_files.size())
+        m_files.resize(id + 1);
+    file_state& f = m_files[id];
+    if (!f.writer)
+        f.writer = new file_writer;
+    try {
+        if (f.writer->is_open()) {
+            // Unsynced writes of the file must not outlive its reopening
+            sync();
+            m_commit.remove(id);
+        }
+        delete f.delta;
+        f.delta = NULL;
+        f.writer->open(name, m_opts.writer);
+        if (m_opts.index_interval) {
+            if (!f.index)
+                f.index = new record_index(m_opts.index_interval, '\n', m_opts.timestamp);
+            f.index->open(name);
+        }
+    } catch (io_error& e) {
+        error(a_msg, e.what());
+        return;
+    }
+    f.name_hash = a_msg->name_hash();
+    if (m_opts.follow)
+        m_opts.follow->add_file(id, name, f.writer->size());
+    if (stats()) {
+        f.stats = stats()->add_file(id, f.name_hash, name.c_str());
+        stats()->on_source_size(f.stats, f.writer->size());
+        stats()->on_ack(f.stats, f.writer->size());
+    }
+    if (f.recovering) {
+        f.recovering = false;
+        m_recovering--;
+    }
+    // The source resumes from the current size of the destination
+    msg_get_size_response::create(id, f.name_hash, f.writer->fd(), f.writer->size(),
+        buffer_allocator(reserve(sizeof(msg_get_size_response))));
+    commit(sizeof(msg_get_size_response));
+}
+
+void receiver_session::append(const msg_append* a_msg)
+{
+    if (file(a_msg->id()) && m_files[a_msg->id()].delta) {
+        delta_literal(a_msg);
+        return;
+    }
+    uint64_t skip;
+    if (!in_sequence(a_msg, a_msg->src_offset(), a_msg->chunk_size(), skip))
+        return;
+    file_state& f    = m_files[a_msg->id()];
+    uint64_t    size = f.writer->size();
+    uint32_t    len  = a_msg->chunk_size();
+    const char* data = reinterpret_cast<const char*>(a_msg) + a_msg->header_size() + skip;
+    f.writer->write(data, len - skip, size);
+    if (f.index)
+        f.index->append(data, len - skip, size);
+    applied(a_msg->id(), len - skip);
+}
+
+void receiver_session::hole(const msg_hole* a_msg)
+{
+    if (file(a_msg->id()) && m_files[a_msg->id()].delta) {
+        error(a_msg, "Delta transfer in progress");
+        return;
+    }
+    uint64_t skip;
+    if (!in_sequence(a_msg, a_msg->src_offset(), a_msg->length(), skip))
+        return;
+    file_state& f    = m_files[a_msg->id()];
+    uint64_t    size = f.writer->size();
+    uint64_t    len  = a_msg->length() - skip;
+    f.writer->hole(size, len);
+    if (f.index)
+        f.index->skip(size, len);
+    applied(a_msg->id(), len);
+}
+
+void receiver_session::delta_request(const msg_delta_request* a_msg)
+{
+    uint32_t id = a_msg->id();
+    uint32_t bs = a_msg->block_size();
+    if (!file(id) || !file(id)->is_open()) {
+        error(a_msg, "File not open");
+        return;
+    }
+    if (bs < s_min_delta_block || bs > s_max_delta_block) {
+        error(a_msg, "Bad delta block size");
+        return;
+    }
+    file_state& f = m_files[id];
+    delete f.delta;     // Restarted transfer
+    f.delta = NULL;
+
+    std::vector<block_signature> sigs;
+    try {
+        f.writer->flush();
+        f.delta = new delta_target(f.writer->name(), f.writer->size());
+        delta_signatures(f.delta->old_fd, f.delta->old_size, bs, sigs);
+    } catch (io_error& e) {
+        delete f.delta;
+        f.delta = NULL;
+        error(a_msg, e.what());
+        return;
+    }
+
+    // At least one message, so that an empty file is answered too
+    size_t i = 0;
+    do {
+        uint32_t count = std::min(sigs.size() - i, (size_t)s_signature_batch);
+        size_t   n     = sizeof(msg_delta_signatures) + count * msg_delta_signatures::s_entry_size;
+        char*    p     = reserve(n);
+        msg_delta_signatures::create(id, f.name_hash, f.delta->old_size, bs, i, count,
+            buffer_allocator(p));
+        p += sizeof(msg_delta_signatures);
+        for (uint32_t k = 0; k < count; ++k)
+            p = sigs[i + k].encode(p);
+        commit(n);
+        i += count;
+    } while (i < sigs.size());
+}
+
+void receiver_session::delta_copy(const msg_delta_copy* a_msg)
+{
+    file_state* f = delta_file(a_msg);
+    if (!f)
+        return;
+    uint64_t old_size = f->delta->old_size;
+    if (a_msg->length() > old_size || a_msg->old_offset() > old_size - a_msg->length()) {
+        error(a_msg, "Delta copy beyond end of file");
+        return;
+    }
+    try {
+        replog::delta_copy(f->delta->old_fd, f->delta->new_fd, a_msg->dst_offset(),
+                           a_msg->old_offset(), a_msg->length());
+    } catch (io_error& e) {
+        error(a_msg, e.what());
+    }
+}
+
+void receiver_session::delta_literal(const msg_append* a_msg)
+{
+    file_state& f    = m_files[a_msg->id()];
+    const char* data = reinterpret_cast<const char*>(a_msg) + a_msg->header_size();
+    try {
+        replog::delta_literal(f.delta->new_fd, a_msg->src_offset(), data, a_msg->chunk_size());
+    } catch (io_error& e) {
+        error(a_msg, e.what());
+    }
+}
+
+void receiver_session::delta_done(const msg_delta_done* a_msg)
+{
+    file_state* f = delta_file(a_msg);
+    if (!f)
+        return;
+    uint32_t    id   = a_msg->id();
+    std::string name = f->writer->name();
+    try {
+        // Block matches rest on a 64-bit hash: check the result end to end
+        if (file_content_hash(f->delta->new_fd, a_msg->src_size()) != a_msg->checksum())
+            throw io_error("Delta checksum mismatch");
+        // Acks of the old file go first
+        sync();
+        m_commit.remove(id);
+        f->delta->replace(name, a_msg->src_size(), m_commit.get_mode() != group_commit::NONE);
+        f->writer->open(name, m_opts.writer);
+        if (f->index) {
+            // Offsets of the old content are meaningless: rebuild the index
+            f->index->close();
+            ::unlink((name + ".idx").c_str());
+            f->index->open(name);
+        }
+    } catch (io_error& e) {
+        delete f->delta;
+        f->delta = NULL;
+        error(a_msg, e.what());
+        return;
+    }
+    delete f->delta;
+    f->delta = NULL;
+    if (m_opts.follow) {
+        m_opts.follow->remove_file(id);
+        m_opts.follow->add_file(id, name, f->writer->size());
+    }
+    applied(id, f->writer->size());
+}
+
+receiver_session::file_state* receiver_session::delta_file(const msg_base_header* a_msg)
+{
+    uint32_t id = a_msg->id();
+    if (!file(id) || !m_files[id].delta) {
+        error(a_msg, "No delta transfer");
+        return NULL;
+    }
+    return &m_files[id];
+}
+
+bool receiver_session::in_sequence(const msg_base_header* a_msg, uint64_t a_offset,
+    uint64_t a_len, uint64_t& a_skip)
+{
+    uint32_t id = a_msg->id();
+    if (!file(id) || !file(id)->is_open()) {
+        error(a_msg, "File not open");
+        return false;
+    }
+    file_state& f    = m_files[id];
+    uint64_t    size = f.writer->size();
+    if (a_offset > size) {
+        // Data was lost, frames in flight are dropped until it's resent
+        if (!f.recovering) {
+            f.recovering = true;
+            m_recovering++;
+            request_resend(id);
+        }
+        return false;
+    }
+    if (a_len <= size - a_offset)
+        return false;   // Duplicate
+    // Skip the part already written
+    a_skip = size - a_offset;
+    return true;
+}
+
+void receiver_session::applied(uint32_t a_id, uint64_t a_bytes)
+{
+    file_state& f = m_files[a_id];
+    if (m_opts.follow) {
+        // Direct mode data becomes readable only when flushed
+        f.writer->flush();
+        m_opts.follow->on_apply(a_id, f.writer->size());
+    }
+    if (f.stats)
+        stats()->on_source_size(f.stats, f.writer->size());
+    if (f.recovering) {
+        f.recovering = false;
+        m_recovering--;
+    }
+    m_commit.on_write(a_id, f.writer, f.writer->size(), a_bytes, get_reactor().now());
+    if (m_commit.get_mode() != group_commit::BEFORE_ACK)
+        ack(a_id);
+    else if (!f.unacked) {
+        f.unacked = true;
+        m_unacked.push_back(a_id);
+    }
+}
+
+void receiver_session::ack(uint32_t a_id)
+{
+    file_state& f = m_files[a_id];
+    msg_ack::create(a_id, f.name_hash, m_commit.durable(a_id),
+        buffer_allocator(reserve(sizeof(msg_ack))));
+    commit(sizeof(msg_ack));
+    if (f.stats)
+        stats()->on_ack(f.stats, m_commit.durable(a_id));
+}
+
+void receiver_session::sync()
+{
+    m_commit.sync();
+    for (size_t i = 0; i < m_unacked.size(); ++i) {
+        m_files[m_unacked[i]].unacked = false;
+        ack(m_unacked[i]);
+    }
+    m_unacked.clear();
+}
+
+void receiver_session::on_input_idle()
+{
+    if (m_commit.get_mode() == group_commit::BEFORE_ACK && m_commit.dirty())
+        sync();
+}
+
+uint64_t receiver_session::deadline() const
+{
+    uint64_t t = m_commit.deadline();
+    return t && (!m_deadline || t < m_deadline) ? t : m_deadline;
+}
+
+void receiver_session::request_resend(uint32_t a_id)
+{
+    file_state& f = m_files[a_id];
+    msg_resend_request::create(a_id, f.name_hash, f.writer->size(),
+        buffer_allocator(reserve(sizeof(msg_resend_request))));
+    commit(sizeof(msg_resend_request));
+    if (f.stats)
+        stats()->on_resend(f.stats);
+}
+
+void receiver_session::error(const msg_base_header* a_hdr, const std::string& a_error)
+{
+    size_t n = sizeof(msg_error_response) + a_error.size() + 1;
+    msg_error_response::create(a_hdr->id(), a_hdr->name_hash(), a_hdr->cmd(), a_error,
+        buffer_allocator(reserve(n)));
+    commit(n);
+}
+
+//----------------------------------------------------------------------------
+// sender_session
+//----------------------------------------------------------------------------
+
+sender_session::sender_session(reactor& a_reactor, int a_fd, const options& a_opts)
+    throw(io_error)
+    : session(a_reactor, a_fd), m_opts(a_opts), m_sched(a_opts.quantum)
+    , m_sizer(a_opts.min_chunk, a_opts.max_chunk), m_resends(0), m_wakeup(0), m_opening(0)
+    , m_finishing(false)
+{}
+
+sender_session::sender_session(reactor& a_reactor, shm_channel& a_channel,
+                               const options& a_opts) throw(io_error)
+    : session(a_reactor, a_channel), m_opts(a_opts), m_sched(a_opts.quantum)
+    , m_sizer(a_opts.min_chunk, a_opts.max_chunk), m_resends(0), m_wakeup(0), m_opening(0)
+    , m_finishing(false)
+{}
+
+sender_session::~sender_session()
+{
+    for (size_t i = 0; i < m_files.size(); ++i) {
+        if (m_files[i].stats)
+            stats()->remove_file(i);
+        if (m_opts.cache)
+            m_opts.cache->remove(i);
+        delete m_files[i].map;
+        ::close(m_files[i].fd);
+    }
+}
+
+uint32_t sender_session::add_file(const std::string& a_name, int a_class, uint32_t a_weight)
+    throw(io_error)
+{
+    uint32_t    id   = m_files.size();
+    std::string name = m_opts.root.empty() ? a_name : m_opts.root + '/' + a_name;
+    m_sched.add(id, a_class, a_weight);
+
+    file_state f;
+    f.name = a_name;
+    f.cls  = a_class;
+    try {
+        if ((f.fd = ::open(name.c_str(), O_RDONLY)) < 0)
+            throw io_error(errno, name.c_str());
+        if (m_opts.mmap) {
+            f.map = new mmap_reader;
+            f.map->open(name);
+        }
+    } catch (io_error&) {
+        delete f.map;
+        if (f.fd >= 0)
+            ::close(f.fd);
+        m_sched.remove(id);
+        throw;
+    }
+    m_files.push_back(f);
+    return id;
+}
+
+void sender_session::finish()
+{
+    m_finishing = true;
+    // Wake the session up if it waits for a frame
+    resend_after(0);
+}
+
+void sender_session::run()
+{
+    REPLOG_SESSION_BEGIN;
+
+    open_files();
+    // The peer answers with the size of its copies, streams resume from it
+    while (m_opening) {
+        REPLOG_AWAIT_FRAME(0);
+        if (frame())
+            dispatch(frame());
+    }
+
+    for (;;) {
+        refresh();
+        pump();
+        if (m_finishing && drained())
+            break;
+        if (pending() > m_opts.max_pending) {
+            REPLOG_AWAIT_DRAIN(m_opts.max_pending);
+            continue;
+        }
+        REPLOG_AWAIT_FRAME(m_wakeup);
+        if (frame())
+            dispatch(frame());
+    }
+
+    REPLOG_SESSION_END;
+}
+
+void sender_session::open_files()
+{
+    for (size_t i = 0; i < m_files.size(); ++i) {
+        file_state& f = m_files[i];
+        struct stat st;
+        if (fstat(f.fd, &st) < 0)
+            throw io_error(errno, "fstat");
+        size_t n = sizeof(msg_get_size) + f.name.size() + 1;
+        msg_get_size* m = msg_get_size::create(i, f.name, st.st_size, f.fd, st.st_mode & 07777,
+            buffer_allocator(reserve(n)));
+        f.name_hash = m->name_hash();
+        commit(n);
+    }
+    m_opening = m_files.size();
+}
+
+void sender_session::dispatch(msg_base_header* a_hdr)
+{
+    switch (a_hdr->cmd()) {
+        case msg_base_header::GET_SIZE_RESPONSE:
+            opened(static_cast<msg_get_size_response*>(a_hdr));
+            break;
+        case msg_base_header::ACK:
+            ack(static_cast<msg_ack*>(a_hdr));
+            break;
+        case msg_base_header::RESEND_REQUEST:
+            resend(static_cast<msg_resend_request*>(a_hdr));
+            break;
+        case msg_base_header::ERROR_RESPONSE: {
+            msg_error_response* m = static_cast<msg_error_response*>(a_hdr);
+            throw io_error("Peer error: ", m->error());
+        }
+        default:
+            throw io_error("Unexpected command:", (char)a_hdr->cmd());
+    }
+}
+
+void sender_session::opened(const msg_get_size_response* a_msg)
+{
+    uint32_t id = a_msg->id();
+    if (id >= m_files.size() || m_files[id].open)
+        throw io_error("Unexpected GET_SIZE_RESPONSE of file:", id);
+    file_state& f = m_files[id];
+    // Resume from the data the peer has
+    f.dst_fd = a_msg->dst_fd();
+    f.offset = f.sent = f.acked = a_msg->dst_size();
+    f.open   = true;
+    m_opening--;
+    if (stats()) {
+        f.stats = stats()->add_file(id, f.name_hash, f.name.c_str());
+        stats()->on_ack(f.stats, f.acked);
+    }
+}
+
+sender_session::file_state& sender_session::file(const msg_base_header* a_msg)
+{
+    uint32_t id = a_msg->id();
+    if (id >= m_files.size() || !m_files[id].open)
+        throw io_error("Bad file id:", id);
+    return m_files[id];
+}
+
+void sender_session::ack(const msg_ack* a_msg)
+{
+    file_state& f    = file(a_msg);
+    uint64_t    size = a_msg->dst_size();
+    m_sizer.on_ack(a_msg->id(), size, get_reactor().now());
+    f.acked = size;
+    if (f.map)
+        f.map->release(size);
+    if (m_opts.cache)
+        m_opts.cache->release(a_msg->id(), size);
+    if (f.stats)
+        stats()->on_ack(f.stats, size);
+}
+
+void sender_session::resend(const msg_resend_request* a_msg)
+{
+    // Rewind, the data is sent again from the cache or the file
+    file_state& f = file(a_msg);
+    f.offset = std::min(f.offset, a_msg->dst_size());
+    m_sizer.on_resend(get_reactor().now());
+    m_resends++;
+    if (f.stats)
+        stats()->on_resend(f.stats);
+}
+
+void sender_session::refresh()
+{
+    for (uint32_t i = 0; i < m_files.size(); ++i) {
+        file_state& f = m_files[i];
+        if (m_sched.active(i))
+            continue;
+        struct stat st;
+        if (fstat(f.fd, &st) < 0)
+            throw io_error(errno, "fstat");
+        uint64_t size = st.st_size;
+        if (size < f.sent)
+            throw io_error("Source file truncated: ", f.name.c_str());
+        if (f.stats)
+            stats()->on_source_size(f.stats, size);
+        if (size > f.offset)
+            m_sched.activate(i);
+    }
+}
+
+void sender_session::pump()
+{
+    uint64_t now = get_reactor().now();
+    m_wakeup = now + m_opts.poll_interval;
+    while (pending() <= m_opts.max_pending) {
+        // Classes over their rate sit out until their buckets refill
+        uint64_t wait     = 0;
+        unsigned blocked  = m_opts.limiter ? m_opts.limiter->blocked(m_opts.peer, now, wait) : 0;
+        int      id       = m_sched.next(blocked);
+        if (id < 0) {
+            if (blocked && !m_sched.empty())
+                m_wakeup = std::min(m_wakeup, now + wait);
+            return;
+        }
+        send_chunk(id);
+    }
+}
+
+void sender_session::send_chunk(uint32_t a_id)
+{
+    file_state& f     = m_files[a_id];
+    size_t      limit = std::min<size_t>(m_sizer.chunk_size(), m_sched.budget(a_id));
+    size_t      cap   = m_opts.max_chunk;
+    if (m_opts.holes) {
+        // Replicate a hole with a descriptor, don't read data past it
+        struct stat st;
+        uint64_t    end;
+        if (fstat(f.fd, &st) < 0)
+            throw io_error(errno, "fstat");
+        if (find_extent(f.fd, f.offset, st.st_size, end)) {
+            char hdr[sizeof(msg_hole)];
+            msg_hole::create(a_id, f.name_hash, f.dst_fd, f.offset, end - f.offset,
+                             buffer_allocator(hdr));
+            send(hdr, sizeof(hdr));
+            advance(a_id, end - f.offset);
+            m_sched.sent(a_id, sizeof(hdr), true);
+            if (m_opts.limiter)
+                m_opts.limiter->consume(m_opts.peer, f.cls, sizeof(hdr));
+            return;
+        }
+        if (end > f.offset) {
+            cap   = std::min<uint64_t>(cap, end - f.offset);
+            limit = std::min(limit, cap);
+        }
+    }
+
+    size_t n, k;
+    if (f.map) {
+        // Reference the chunk in the mapped file
+        const char* data;
+        n = f.map->read(f.offset, limit, data);
+        k = boundary(f, data, n);
+        if (!k && n == limit && limit < cap) {
+            // Overdraw the credit for a long record
+            limit = cap;
+            n = f.map->read(f.offset, limit, data);
+            k = boundary(f, data, n);
+        }
+        if (f.map->truncated())
+            throw io_error("Source file truncated: ", f.name.c_str());
+        if (!k) {
+            m_sched.sent(a_id, 0, false);
+            return;
+        }
+        REPLOG_TRACE(TRACE_SOURCE_READ, a_id, f.offset, k);
+        char hdr[sizeof(msg_append)];
+        msg_append::create(a_id, f.name_hash, f.dst_fd, f.offset, k, buffer_allocator(hdr));
+        REPLOG_TRACE(TRACE_ENCODE, a_id, f.offset, k);
+        if (space_fd() < 0)
+            send(hdr, sizeof(hdr), data, k);
+        else {
+            // Shared memory rings take a copy, guarded against truncation
+            char* p = reserve(sizeof(hdr) + k);
+            memcpy(p, hdr, sizeof(hdr));
+            if (!f.map->copy(p + sizeof(hdr), data, k))
+                throw io_error("Source file truncated: ", f.name.c_str());
+            commit(sizeof(hdr) + k);
+        }
+    } else {
+        // Read the chunk straight into the frame being built
+        char* hdr  = reserve(sizeof(msg_append) + cap);
+        char* data = hdr + sizeof(msg_append);
+        n = read(f, a_id, data, limit);
+        k = boundary(f, data, n);
+        if (!k && n == limit && limit < cap) {
+            limit = cap;
+            n = read(f, a_id, data, limit);
+            k = boundary(f, data, n);
+        }
+        if (!k) {
+            m_sched.sent(a_id, 0, false);
+            return;
+        }
+        REPLOG_TRACE(TRACE_SOURCE_READ, a_id, f.offset, k);
+        msg_append::create(a_id, f.name_hash, f.dst_fd, f.offset, k, buffer_allocator(hdr));
+        REPLOG_TRACE(TRACE_ENCODE, a_id, f.offset, k);
+        if (m_opts.cache && f.offset >= f.sent)
+            m_opts.cache->insert(a_id, f.offset, data, k);
+        commit(sizeof(msg_append) + k);
+    }
+    REPLOG_TRACE(TRACE_SEND, a_id, f.offset, k);
+    advance(a_id, k);
+    m_sched.sent(a_id, k, n == limit);
+    if (m_opts.limiter)
+        m_opts.limiter->consume(m_opts.peer, f.cls, sizeof(msg_append) + k);
+}
+
+size_t sender_session::read(file_state& a_file, uint32_t a_id, char* a_buf, size_t n)
+    throw(io_error)
+{
+    // Data being resent is read through the retention cache
+    if (m_opts.cache && a_file.offset < a_file.sent)
+        return m_opts.cache->read(a_id, a_file.offset, a_buf,
+            std::min<uint64_t>(n, a_file.sent - a_file.offset), a_file.fd);
+    ssize_t k;
+    while ((k = pread(a_file.fd, a_buf, n, a_file.offset)) < 0 && errno == EINTR);
+    if (k < 0)
+        throw io_error(errno, "pread");
+    return k;
+}
+
+size_t sender_session::boundary(file_state& a_file, const char* a_data, size_t n)
+{
+    if (!m_opts.records || !n)
+        return n;
+    size_t k = a_file.map ? a_file.map->boundary(a_data, n, m_opts.delimiter)
+                          : record_boundary(a_data, n, m_opts.delimiter);
+    // A finishing session sends the partial record at the end too
+    return k || !m_finishing || (a_file.map && a_file.map->truncated()) ? k : n;
+}
+
+void sender_session::advance(uint32_t a_id, uint64_t n)
+{
+    file_state& f = m_files[a_id];
+    f.offset += n;
+    f.sent    = std::max(f.sent, f.offset);
+    m_sizer.on_send(a_id, f.offset, get_reactor().now());
+}
+
+bool sender_session::drained() const
+{
+    if (!m_sched.empty())
+        return false;
+    for (size_t i = 0; i < m_files.size(); ++i)
+        if (m_files[i].acked < m_files[i].sent)
+            return false;
+    return true;
+}
+
+} // namespace replog
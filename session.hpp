@@ -0,0 +1,398 @@
+//----------------------------------------------------------------------------
+/// \file  session.hpp
+//----------------------------------------------------------------------------
+/// \brief Replication sessions written as coroutines over the reactor.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _REPLOG_SESSION_HPP_
+#define _REPLOG_SESSION_HPP_
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <replog/coroutine.hpp>
+#include <replog/reactor.hpp>
+#include <replog/file_writer.hpp>
+#include <replog/durability.hpp>
+#include <replog/record_index.hpp>
+#include <replog/tail_follow.hpp>
+#include <replog/scheduler.hpp>
+#include <replog/chunk_sizer.hpp>
+#include <replog/mmap_reader.hpp>
+#include <replog/retention_cache.hpp>
+#include <replog/rate_limit.hpp>
+
+namespace replog {
+
+/**
+ * \brief Connection whose protocol is a coroutine.
+ * Instead of reacting to each frame in a callback, a subclass writes the
+ * protocol as one sequential run() function that suspends on
+ * REPLOG_AWAIT_FRAME() until the next frame arrives (or a deadline
+ * passes) and on REPLOG_AWAIT_DRAIN() until its output is written out.
+ * The session is resumed by the reactor right inside the frame, timer and
+ * write callbacks, so frames are handled in place in the input buffer and
+ * the steady state neither copies nor allocates: the coroutine state is
+ * a member of the session.  While the session waits for its output to
+ * drain its input is suspended.
+ *
+ * An exception thrown by run() closes the connection, so does the
+ * completion of the coroutine.
+ */
+class session: public connection {
+public:
+    session(reactor& a_reactor, int a_fd)
+        : connection(a_reactor, a_fd), m_wait(WAIT_NONE), m_frame(NULL), m_frame_size(0)
+    {}
+    session(reactor& a_reactor, shm_channel& a_channel)
+        : connection(a_reactor, a_channel), m_wait(WAIT_NONE), m_frame(NULL), m_frame_size(0)
+    {}
+
+    /// Run the coroutine up to its first suspension.
+    void start() { resume(); }
+
+    bool complete() const { return m_co.is_complete(); }
+
+protected:
+    /// Body of the session enclosed in REPLOG_SESSION_BEGIN and
+    /// REPLOG_SESSION_END.  It is reentered on every resumption: locals
+    /// don't survive suspension points.
+    virtual void run() = 0;
+
+    /// Frame the session was resumed with, NULL if the deadline passed.
+    msg_base_header* frame()      const { return m_frame; }
+    /// Size of frame() including the payload.
+    size_t           frame_size() const { return m_frame_size; }
+
+    /// Use REPLOG_AWAIT_FRAME() and REPLOG_AWAIT_DRAIN() instead.
+    void await_frame(uint64_t a_deadline);
+    void await_drain();
+
+    coroutine m_co;
+
+private:
+    enum wait_type { WAIT_NONE, WAIT_FRAME, WAIT_DRAIN };
+
+    wait_type        m_wait;
+    msg_base_header* m_frame;
+    size_t           m_frame_size;
+
+    void on_frame(msg_base_header* a_hdr, size_t n);
+    void on_resend_timeout();
+    void on_drained();
+    void resume();
+};
+
+#define REPLOG_SESSION_BEGIN REPLOG_CO_BEGIN(m_co)
+#define REPLOG_SESSION_END   REPLOG_CO_END(m_co)
+
+/// Suspend the session until the next frame arrives or until reactor time
+/// \a Deadline (ns, 0 - none) passes, in which case frame() is NULL.
+#define REPLOG_AWAIT_FRAME(Deadline) \
+    do { await_frame(Deadline); REPLOG_CO_YIELD(m_co); } while (0)
+
+/// Suspend the session while more than \a Limit bytes of output are queued.
+#define REPLOG_AWAIT_DRAIN(Limit) \
+    do { if (pending() > (Limit)) { await_drain(); REPLOG_CO_YIELD(m_co); } } while (0)
+
+/**
+ * \brief Destination side of the replication protocol.
+ * The peer opens files with msg_get_size, answered with the current size
+ * of the destination file so that the source resumes from it, and then
+ * streams msg_append frames, each acknowledged with msg_ack once written.
+ * Before the first msg_get_size it may offer a wire version with
+ * msg_hello; frames following it are then decoded in the agreed version.
+ * File names are resolved under the root directory: absolute names,
+ * names with ".." components and ids beyond max_files are refused.
+ * Holes of sparse files come as msg_hole frames, sequenced like appends.
+ * A msg_delta_request is answered with the block signatures of the file,
+ * after which the source rebuilds it from msg_delta_copy and msg_append
+ * frames in a temporary file that replaces it on msg_delta_done, once
+ * the content_hash of the result matches the one of the source.
+ * An append past the end of a file means lost data: the session sends a
+ * msg_resend_request for the file, drops appends that were already in
+ * flight and waits for the one that continues the file.  If none arrives
+ * before the resend timeout the request is repeated, up to max_resends
+ * times.  Other files keep streaming meanwhile.  Unexpected frames are
+ * answered with msg_error_response.  With index_interval set, a
+ * record_index of every file is maintained as data arrives.  With a
+ * follow segment set, applied data is published to local consumers.
+ *
+ * Writes are synced by a group_commit in the configured durability mode.
+ * In BEFORE_ACK mode acks carry only the synced size, so a sender never
+ * drops data a crash would lose.  They are sent once the sync window
+ * closes or, sooner, once the input runs dry: a sync then covers
+ * everything received in a burst without delaying the acks of an idle
+ * receiver by the window.
+ *
+ * With a stats_segment on the reactor the session publishes the size
+ * received and acknowledged and the resends of every file it opens, and
+ * the syncs of its group_commit.
+ */
+class receiver_session: public session {
+public:
+    struct options {
+        std::string          root;              ///< Directory of files, empty - current
+        std::string          suffix;            ///< Appended to file names
+        uint32_t             max_files;         ///< Bound of file ids
+        file_writer::options writer;
+        uint64_t             resend_timeout;    ///< ns
+        int                  max_resends;
+        size_t               max_pending;       ///< Output suspending input
+        uint32_t             index_interval;    ///< Records per index entry, 0 - off
+        record_index::timestamp_fn timestamp;   ///< Record timestamp extractor
+        follow_segment*      follow;            ///< Consumer notification, NULL - off
+        group_commit::mode   durability;
+        uint64_t             sync_window;       ///< ns
+        uint64_t             sync_window_bytes;
+
+        options()
+            : max_files(64 * 1024), resend_timeout(100000000), max_resends(5), max_pending(256 * 1024)
+            , index_interval(0), timestamp(NULL), follow(NULL)
+            , durability(group_commit::NONE), sync_window(1000000)
+            , sync_window_bytes(1024 * 1024)
+        {}
+    };
+
+    receiver_session(reactor& a_reactor, int a_fd, const options& a_opts = options())
+        : session(a_reactor, a_fd), m_opts(a_opts)
+        , m_commit(a_opts.durability, a_opts.sync_window, a_opts.sync_window_bytes)
+        , m_deadline(0), m_resends(0), m_recovering(0)
+    { m_commit.stats(stats()); }
+    receiver_session(reactor& a_reactor, shm_channel& a_channel,
+                     const options& a_opts = options())
+        : session(a_reactor, a_channel), m_opts(a_opts)
+        , m_commit(a_opts.durability, a_opts.sync_window, a_opts.sync_window_bytes)
+        , m_deadline(0), m_resends(0), m_recovering(0)
+    { m_commit.stats(stats()); }
+    ~receiver_session();
+
+    /// Writer of file \a a_id, NULL if the file isn't open.
+    file_writer* file(uint32_t a_id) const {
+        return a_id < m_files.size() ? m_files[a_id].writer : NULL;
+    }
+    /// Record index of file \a a_id, NULL if not indexed.
+    record_index* index(uint32_t a_id) const {
+        return a_id < m_files.size() ? m_files[a_id].index : NULL;
+    }
+    /// Group commit of the written files.
+    const group_commit& durability() const { return m_commit; }
+
+protected:
+    void run();
+    void on_input_idle();
+
+private:
+    struct delta_target;
+
+    struct file_state {
+        file_writer*  writer;
+        record_index* index;
+        delta_target* delta;        // Delta transfer in progress
+        stats_file*   stats;        // Slot in the stats segment, NULL - none
+        uint32_t      name_hash;
+        bool          recovering;   // Waiting for resent data
+        bool          unacked;      // Applied data waiting for a sync
+        file_state()
+            : writer(NULL), index(NULL), delta(NULL), stats(NULL), name_hash(0)
+            , recovering(false)
+            , unacked(false)
+        {}
+    };
+
+    options                 m_opts;
+    std::vector<file_state> m_files;
+    group_commit            m_commit;
+    std::vector<uint32_t>   m_unacked;      // Files with unacked data
+    uint64_t                m_deadline;     // Resend timeout, 0 - none
+    int                     m_resends;
+    int                     m_recovering;   // Files waiting for resent data
+
+    void dispatch(msg_base_header* a_hdr);
+    void hello(const msg_hello* a_msg);
+    void open_file(const msg_get_size* a_msg);
+    void append(const msg_append* a_msg);
+    void hole(const msg_hole* a_msg);
+    void delta_request(const msg_delta_request* a_msg);
+    void delta_copy(const msg_delta_copy* a_msg);
+    void delta_literal(const msg_append* a_msg);
+    void delta_done(const msg_delta_done* a_msg);
+    /// File \a a_msg is about if it's in a delta transfer, NULL otherwise.
+    file_state* delta_file(const msg_base_header* a_msg);
+    /// Check that a frame of \a a_len bytes at \a a_offset continues the
+    /// file, setting \a a_skip to the length of its part already written.
+    bool in_sequence(const msg_base_header* a_msg, uint64_t a_offset, uint64_t a_len,
+                     uint64_t& a_skip);
+    /// Report \a a_bytes applied to file \a a_id, acknowledging them
+    /// unless they wait for a sync.
+    void applied(uint32_t a_id, uint64_t a_bytes);
+    void ack(uint32_t a_id);
+    /// Sync written files and acknowledge the data that waited for it.
+    void sync();
+    /// Time to resume the session at without a frame, 0 - none.
+    uint64_t deadline() const;
+    void request_resend(uint32_t a_id);
+    void error(const msg_base_header* a_hdr, const std::string& a_error);
+};
+
+/**
+ * \brief Source side of the replication protocol.
+ * The session opens the files added with add_file() on the peer with
+ * msg_get_size and streams them from the size the peer reports, so a
+ * transfer resumes where it stopped.  Files keep being tailed: one that
+ * grew past the data sent becomes a backlogged stream of a
+ * stream_scheduler, which picks the file of every chunk by priority
+ * class and weight, and idle files are checked for growth every
+ * poll_interval.  A chunk is at most as large as the chunk_sizer limit
+ * (or the stream's credit), ends on a record boundary unless records is
+ * off, and passes the optional rate_limiter shared by the sessions of a
+ * process.  With holes set, holes of sparse files are sent as msg_hole.
+ *
+ * Data is read with pread() into the output buffer or, with mmap set,
+ * referenced in place through an mmap_reader and written out with
+ * writev().  A msg_resend_request rewinds the file to the size the peer
+ * has; data sent before is read back through the optional
+ * retention_cache, which every chunk read from a file is inserted into.
+ * Acks release the cache, the mappings and the RTT samples of the
+ * chunk_sizer up to the acknowledged size.  msg_error_response ends the
+ * session.
+ *
+ * After finish() the session completes once no file has more to send,
+ * a partial record at its end included, and the peer acknowledged all
+ * of it.  With a stats_segment on the
+ * reactor the session publishes the source and acknowledged size and
+ * the resends of its files.
+ */
+class sender_session: public session {
+public:
+    struct options {
+        std::string      root;              ///< Directory of files, empty - current
+        uint32_t         min_chunk;         ///< Bounds of the chunk size
+        uint32_t         max_chunk;
+        bool             records;           ///< Send whole records only
+        char             delimiter;         ///< Record terminator
+        bool             mmap;              ///< Reference mapped data, don't copy it
+        bool             holes;             ///< Send holes of sparse files as msg_hole
+        uint64_t         poll_interval;     ///< ns between growth checks of idle files
+        size_t           max_pending;       ///< Output suspending the stream
+        uint32_t         quantum;           ///< Scheduler credit per turn and weight
+        retention_cache* cache;             ///< Data sent, read by resends, NULL - none
+        rate_limiter*    limiter;           ///< Shaper of the files, NULL - off
+        uint32_t         peer;              ///< Peer of the session in limiter
+
+        options()
+            : min_chunk(4 * 1024), max_chunk(64 * 1024), records(true), delimiter('\n')
+            , mmap(false), holes(false), poll_interval(1000000), max_pending(256 * 1024)
+            , quantum(16 * 1024), cache(NULL), limiter(NULL), peer(0)
+        {}
+    };
+
+    sender_session(reactor& a_reactor, int a_fd, const options& a_opts = options())
+        throw(io_error);
+    sender_session(reactor& a_reactor, shm_channel& a_channel,
+                   const options& a_opts = options()) throw(io_error);
+    ~sender_session();
+
+    /// Open file \a a_name, relative to the root directory, and stream it
+    /// in priority \a a_class with \a a_weight.  Call before start().
+    /// @return id of the file.
+    uint32_t add_file(const std::string& a_name, int a_class = 0, uint32_t a_weight = 1)
+        throw(io_error);
+
+    /// Complete the session once the files have nothing more to send and
+    /// the peer acknowledged everything.
+    void finish();
+
+    /// Offset of file \a a_id up to which data was sent.
+    uint64_t sent(uint32_t a_id)  const { return m_files[a_id].offset; }
+    /// Size of file \a a_id acknowledged by the peer.
+    uint64_t acked(uint32_t a_id) const { return m_files[a_id].acked; }
+    /// Resend requests received.
+    uint64_t resends()            const { return m_resends; }
+    /// Chunk sizer of the session, e.g. for its RTT estimate.
+    const chunk_sizer& sizer()    const { return m_sizer; }
+
+protected:
+    void run();
+
+private:
+    struct file_state {
+        std::string  name;          // Name sent to the peer
+        int          fd;
+        mmap_reader* map;           // NULL unless options::mmap is set
+        stats_file*  stats;         // Slot in the stats segment, NULL - none
+        uint32_t     name_hash;
+        int          dst_fd;
+        int          cls;
+        uint64_t     offset;        // Next byte to send
+        uint64_t     sent;          // End of the data sent so far
+        uint64_t     acked;
+        bool         open;          // The peer opened the file
+        file_state()
+            : fd(-1), map(NULL), stats(NULL), name_hash(0), dst_fd(-1), cls(0), offset(0)
+            , sent(0), acked(0), open(false)
+        {}
+    };
+
+    options                 m_opts;
+    std::vector<file_state> m_files;
+    stream_scheduler        m_sched;
+    chunk_sizer             m_sizer;
+    uint64_t                m_resends;
+    uint64_t                m_wakeup;       // Time to resume without a frame at
+    size_t                  m_opening;      // Files not opened by the peer yet
+    bool                    m_finishing;
+
+    /// Ask the peer to open the files.
+    void open_files();
+    void dispatch(msg_base_header* a_hdr);
+    void opened(const msg_get_size_response* a_msg);
+    void ack(const msg_ack* a_msg);
+    void resend(const msg_resend_request* a_msg);
+    /// File \a a_msg is about, which the peer must have opened.
+    file_state& file(const msg_base_header* a_msg);
+    /// Queue files that grew past the data sent.
+    void refresh();
+    /// Send chunks of backlogged files while the output and the rate
+    /// limiter allow, setting m_wakeup to when to try again.
+    void pump();
+    void send_chunk(uint32_t a_id);
+    /// Read up to \a n bytes of file \a a_id at its offset into \a a_buf.
+    size_t read(file_state& a_file, uint32_t a_id, char* a_buf, size_t n) throw(io_error);
+    /// Length of the complete records in \a n bytes of \a a_file at \a a_data.
+    size_t boundary(file_state& a_file, const char* a_data, size_t n);
+    /// Advance file \a a_id by \a n bytes sent.
+    void advance(uint32_t a_id, uint64_t n);
+    /// True if the files have nothing more to send and all of it is
+    /// acknowledged.
+    bool drained() const;
+};
+
+} // namespace replog
+
+#endif // _REPLOG_SESSION_HPP_
@@ -0,0 +1,313 @@
+//----------------------------------------------------------------------------
+/// \file  shm_transport.cpp
+//----------------------------------------------------------------------------
+/// \brief Same-host shared memory transport.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#include <replog/shm_transport.hpp>
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+
+namespace replog {
+
+namespace {
+
+    const size_t s_page = 4096;
+
+    /// Size of one ring in the memfd: control page followed by data.
+    size_t ring_span(uint32_t a_capacity) { return s_page + a_capacity; }
+
+    void close_fd(int& a_fd) {
+        if (a_fd >= 0) {
+            ::close(a_fd);
+            a_fd = -1;
+        }
+    }
+}
+
+//----------------------------------------------------------------------------
+// shm_channel_fds
+//----------------------------------------------------------------------------
+
+void shm_channel_fds::close()
+{
+    close_fd(memfd);
+    for (int i = 0; i < 4; ++i)
+        close_fd(efd[i]);
+}
+
+void shm_channel_fds::send_fds(int a_sock) const throw(io_error)
+{
+    int  fds[5] = { memfd, efd[0], efd[1], efd[2], efd[3] };
+    char ctl[CMSG_SPACE(sizeof(fds))];
+    char tag    = 'M';
+    iovec  iov  = { &tag, 1 };
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    memset(ctl,  0, sizeof(ctl));
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = ctl;
+    msg.msg_controllen = sizeof(ctl);
+    cmsghdr* c    = CMSG_FIRSTHDR(&msg);
+    c->cmsg_level = SOL_SOCKET;
+    c->cmsg_type  = SCM_RIGHTS;
+    c->cmsg_len   = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(c), fds, sizeof(fds));
+    while (sendmsg(a_sock, &msg, 0) < 0)
+        if (errno != EINTR)
+            throw io_error(errno, "sendmsg");
+}
+
+void shm_channel_fds::recv_fds(int a_sock) throw(io_error)
+{
+    int  fds[5];
+    char ctl[CMSG_SPACE(sizeof(fds))];
+    char tag;
+    iovec  iov  = { &tag, 1 };
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = ctl;
+    msg.msg_controllen = sizeof(ctl);
+    ssize_t n;
+    while ((n = recvmsg(a_sock, &msg, MSG_CMSG_CLOEXEC)) < 0)
+        if (errno != EINTR)
+            throw io_error(errno, "recvmsg");
+    cmsghdr* c = CMSG_FIRSTHDR(&msg);
+    if (n != 1 || tag != 'M' || !c || c->cmsg_type != SCM_RIGHTS
+     || c->cmsg_len != CMSG_LEN(sizeof(fds)))
+        throw io_error("Invalid shared memory channel descriptors");
+    memcpy(fds, CMSG_DATA(c), sizeof(fds));
+    close();
+    memfd = fds[0];
+    for (int i = 0; i < 4; ++i)
+        efd[i] = fds[i+1];
+}
+
+//----------------------------------------------------------------------------
+// shm_channel
+//----------------------------------------------------------------------------
+
+void shm_channel::create(uint32_t a_capacity, shm_channel_fds& a_fds) throw(io_error)
+{
+    uint32_t cap = s_page;
+    while (cap < a_capacity)
+        cap <<= 1;
+
+    a_fds.close();
+    a_fds.memfd = memfd_create("replog.shm_channel", MFD_CLOEXEC);
+    if (a_fds.memfd < 0)
+        throw io_error(errno, "memfd_create");
+    size_t size = 2 * ring_span(cap);
+    if (ftruncate(a_fds.memfd, size) < 0) {
+        int err = errno;
+        a_fds.close();
+        throw io_error(err, "ftruncate");
+    }
+    for (int i = 0; i < 4; ++i)
+        if ((a_fds.efd[i] = eventfd(0, EFD_CLOEXEC)) < 0) {
+            int err = errno;
+            a_fds.close();
+            throw io_error(err, "eventfd");
+        }
+
+    // Initialize both control blocks
+    void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, a_fds.memfd, 0);
+    if (p == MAP_FAILED) {
+        int err = errno;
+        a_fds.close();
+        throw io_error(err, "mmap");
+    }
+    for (int i = 0; i < 2; ++i) {
+        char* base = static_cast<char*>(p) + i * ring_span(cap);
+        spsc_ring ring;
+        ring.attach(reinterpret_cast<spsc_ring_header*>(base), base + s_page, cap, true);
+    }
+    munmap(p, size);
+}
+
+void shm_channel::open(const shm_channel_fds& a_fds, side a_side) throw(io_error)
+{
+    close();
+
+    struct stat st;
+    if (fstat(a_fds.memfd, &st) < 0)
+        throw io_error(errno, "fstat");
+    if (st.st_size <= (off_t)(2 * s_page) || st.st_size % (2 * s_page))
+        throw io_error("Invalid shared memory channel size:", st.st_size);
+    uint32_t cap = st.st_size / 2 - s_page;
+
+    // Reserve address space for both rings with their data mirrored:
+    // [ctl][data][data mirror] x 2
+    size_t span = ring_span(cap) + cap;
+    m_size = 2 * span;
+    void* p = mmap(NULL, m_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED)
+        throw io_error(errno, "mmap");
+    m_base = static_cast<char*>(p);
+
+    spsc_ring* rings[2] = { &m_out, &m_in };
+    if (a_side == SERVER)
+        std::swap(rings[0], rings[1]);
+
+    for (int i = 0; i < 2; ++i) {
+        char* base = m_base + i * span;
+        off_t off  = i * ring_span(cap);
+        if (mmap(base, ring_span(cap), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+                 a_fds.memfd, off) == MAP_FAILED
+         || mmap(base + ring_span(cap), cap, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+                 a_fds.memfd, off + s_page) == MAP_FAILED) {
+            int err = errno;
+            close();
+            throw io_error(err, "mmap");
+        }
+        spsc_ring_header* h = reinterpret_cast<spsc_ring_header*>(base);
+        if (h->magic != spsc_ring_header::s_magic || h->capacity != cap) {
+            close();
+            throw io_error("Incompatible shared memory channel");
+        }
+        rings[i]->attach(h, base + s_page, cap, false);
+    }
+
+    // Ring 0 uses efd[0..1], ring 1 uses efd[2..3]
+    int out = a_side == CLIENT ? 0 : 2;
+    int in  = 2 - out;
+    m_data_efd[0]  = dup(a_fds.efd[out]);
+    m_space_efd[0] = dup(a_fds.efd[out+1]);
+    m_data_efd[1]  = dup(a_fds.efd[in]);
+    m_space_efd[1] = dup(a_fds.efd[in+1]);
+    if (m_data_efd[0] < 0 || m_data_efd[1] < 0
+     || m_space_efd[0] < 0 || m_space_efd[1] < 0) {
+        int err = errno;
+        close();
+        throw io_error(err, "dup");
+    }
+}
+
+void shm_channel::close()
+{
+    if (m_base) {
+        munmap(m_base, m_size);
+        m_base = NULL;
+        m_size = 0;
+    }
+    m_out = m_in = spsc_ring();
+    for (int i = 0; i < 2; ++i) {
+        close_fd(m_data_efd[i]);
+        close_fd(m_space_efd[i]);
+    }
+}
+
+char* shm_channel::reserve(size_t n) throw(io_error)
+{
+    if (n > capacity())
+        throw io_error("Reservation exceeds ring capacity:", n);
+    for (int spin = 0;; ++spin) {
+        char* p = m_out.reserve(n);
+        if (p)
+            return p;
+        if (spin < s_spin_count)
+            atomic::pause();
+        else if (m_out.prepare_wait_space(n))
+            sleep(m_space_efd[0]);
+    }
+}
+
+void shm_channel::shutdown() throw(io_error)
+{
+    m_out.close();
+    wakeup(m_data_efd[0]);
+}
+
+size_t shm_channel::wait(char*& a_ptr, size_t n) throw(io_error)
+{
+    for (int spin = 0;; ++spin) {
+        size_t avail = m_in.peek(a_ptr);
+        if (avail >= n)
+            return avail;
+        if (m_in.closed())
+            return m_in.peek(a_ptr);
+        if (spin < s_spin_count)
+            atomic::pause();
+        else if (m_in.prepare_wait_data(n))
+            sleep(m_data_efd[1]);
+    }
+}
+
+size_t shm_channel::read(char* a_buf, size_t n) throw(io_error)
+{
+    char*  p;
+    size_t k = std::min(m_in.peek(p), n);
+    if (k) {
+        memcpy(a_buf, p, k);
+        consume(k);
+    }
+    return k;
+}
+
+size_t shm_channel::write(const iovec* a_iov, int a_cnt) throw(io_error)
+{
+    size_t room = m_out.space();
+    if (!room)
+        return 0;
+    char*  p = m_out.reserve(room);
+    size_t n = 0;
+    for (int i = 0; i < a_cnt && n < room; ++i) {
+        size_t k = std::min(a_iov[i].iov_len, room - n);
+        memcpy(p + n, a_iov[i].iov_base, k);
+        n += k;
+    }
+    commit(n);
+    return n;
+}
+
+void shm_channel::wakeup(int a_efd) throw(io_error)
+{
+    uint64_t v = 1;
+    while (::write(a_efd, &v, sizeof(v)) < 0)
+        if (errno != EINTR)
+            throw io_error(errno, "eventfd write");
+}
+
+void shm_channel::sleep(int a_efd) throw(io_error)
+{
+    uint64_t v;
+    while (::read(a_efd, &v, sizeof(v)) < 0)
+        if (errno != EINTR)
+            throw io_error(errno, "eventfd read");
+}
+
+} // namespace replog
@@ -0,0 +1,175 @@
+//----------------------------------------------------------------------------
+/// \file  shm_transport.hpp
+//----------------------------------------------------------------------------
+/// \brief Same-host transport carrying protocol frames through a pair of
+/// SPSC rings in a shared memfd.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _REPLOG_SHM_TRANSPORT_HPP_
+#define _REPLOG_SHM_TRANSPORT_HPP_
+
+#include <stdint.h>
+#include <sys/uio.h>
+#include <boost/noncopyable.hpp>
+#include <replog/error.hpp>
+#include <replog/spsc_ring.hpp>
+
+namespace replog {
+
+/**
+ * \brief Descriptors backing a shared memory channel.
+ * The memfd holds two rings, one per direction.  Each ring has a "data"
+ * eventfd signalled by its producer and a "space" eventfd signalled by
+ * its consumer.  The set is inherited across fork() or passed to an
+ * unrelated process with send_fds()/recv_fds().
+ */
+struct shm_channel_fds {
+    int memfd;
+    int efd[4];     ///< data/space of ring 0, data/space of ring 1
+
+    shm_channel_fds() : memfd(-1) { efd[0] = efd[1] = efd[2] = efd[3] = -1; }
+
+    void close();
+
+    /// Pass the descriptors over a connected UNIX socket \a a_sock.
+    void send_fds(int a_sock) const throw(io_error);
+    /// Receive descriptors sent by send_fds().
+    void recv_fds(int a_sock) throw(io_error);
+};
+
+/**
+ * \brief One end of a bidirectional shared memory channel.
+ * The sender writes frames once, directly into the ring with
+ * reserve()/commit(), and the receiver applies them straight from the
+ * ring with wait()/consume(), so a frame payload is never copied by the
+ * kernel on its way between the processes.  An eventfd is signalled
+ * only when the peer announced that it's idle: while both sides are
+ * busy the channel makes no system calls.
+ *
+ * A side can also be driven by a reactor instead of blocking: a
+ * connection constructed over the channel copies frames with the
+ * non-blocking read()/write() and waits for data_fd() and space_fd()
+ * after announcing it with prepare_wait_data()/prepare_wait_space().
+ * The eventfds are then non-blocking and the blocking calls can't be
+ * used on that side anymore.
+ */
+class shm_channel: boost::noncopyable {
+public:
+    enum side { CLIENT = 0, SERVER = 1 };
+
+    /// Busy-poll iterations before a side goes to sleep on its eventfd
+    static const int s_spin_count = 256;
+
+    shm_channel() : m_base(NULL), m_size(0) {
+        m_data_efd[0] = m_data_efd[1] = m_space_efd[0] = m_space_efd[1] = -1;
+    }
+    ~shm_channel() { close(); }
+
+    /// Create descriptors of a channel with two rings of \a a_capacity
+    /// bytes each (rounded up to a power of two of at least a page).
+    static void create(uint32_t a_capacity, shm_channel_fds& a_fds) throw(io_error);
+
+    /// Map the channel described by \a a_fds.  The CLIENT writes to ring
+    /// 0 and reads from ring 1, the SERVER the other way around.  The
+    /// eventfds are duplicated, \a a_fds can be closed afterwards.
+    void open(const shm_channel_fds& a_fds, side a_side) throw(io_error);
+
+    void close();
+
+    bool     is_open()  const { return m_base != NULL; }
+    uint32_t capacity() const { return m_out.capacity(); }
+
+    /// Return a pointer to \a n writable contiguous bytes, blocking while
+    /// the ring is full.  \a n must not exceed capacity().
+    char* reserve(size_t n) throw(io_error);
+
+    /// Publish \a n bytes written at the pointer returned by reserve().
+    void commit(size_t n) throw(io_error) {
+        if (m_out.commit(n))
+            wakeup(m_data_efd[0]);
+    }
+
+    /// Signal end of stream to the peer.
+    void shutdown() throw(io_error);
+
+    /// Block until at least \a n bytes are available for reading or the
+    /// peer shut down its side, and set \a a_ptr to the first of them.
+    /// @return number of contiguous bytes available (less than \a n
+    ///         only at end of stream).
+    size_t wait(char*& a_ptr, size_t n) throw(io_error);
+
+    /// Set \a a_ptr to unread data without blocking.
+    /// @return number of contiguous bytes available.
+    size_t peek(char*& a_ptr) { return m_in.peek(a_ptr); }
+
+    /// Release \a n bytes returned by wait() or peek().
+    void consume(size_t n) throw(io_error) {
+        if (m_in.consume(n))
+            wakeup(m_space_efd[1]);
+    }
+
+    /// Copy up to \a n bytes of input to \a a_buf without blocking.
+    /// @return number of bytes copied.
+    size_t read(char* a_buf, size_t n) throw(io_error);
+
+    /// Copy as much of \a a_cnt buffers at \a a_iov as fits in the output
+    /// ring without blocking.
+    /// @return number of bytes copied.
+    size_t write(const iovec* a_iov, int a_cnt) throw(io_error);
+
+    /// True if the peer shut down its side.  Input committed before is
+    /// still readable.
+    bool peer_closed() const { return m_in.closed(); }
+
+    /// Eventfd signalled when data arrives after prepare_wait_data().
+    int  data_fd()  const { return m_data_efd[1]; }
+    /// Eventfd signalled when space frees up after prepare_wait_space().
+    int  space_fd() const { return m_space_efd[0]; }
+
+    /// Announce a wait for input on data_fd().
+    /// @return false if input arrived or the peer shut down meanwhile.
+    bool prepare_wait_data()  { return m_in.prepare_wait_data(1); }
+    /// Announce a wait for output space on space_fd().
+    /// @return false if space became available meanwhile.
+    bool prepare_wait_space() { return m_out.prepare_wait_space(1); }
+
+private:
+    char*     m_base;
+    size_t    m_size;
+    int       m_data_efd[2];    // [0] - signal on m_out, [1] - wait on m_in
+    int       m_space_efd[2];   // [0] - wait on m_out, [1] - signal on m_in
+    spsc_ring m_out;
+    spsc_ring m_in;
+
+    static void wakeup(int a_efd) throw(io_error);
+    static void sleep(int a_efd) throw(io_error);
+};
+
+} // namespace replog
+
+#endif // _REPLOG_SHM_TRANSPORT_HPP_
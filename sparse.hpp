@@ -0,0 +1,80 @@
+//----------------------------------------------------------------------------
+/// \file  sparse.hpp
+//----------------------------------------------------------------------------
+/// \brief Detection of holes in sparse source files.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _REPLOG_SPARSE_HPP_
+#define _REPLOG_SPARSE_HPP_
+
+#include <errno.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <replog/error.hpp>
+
+namespace replog {
+
+/**
+ * \brief Find the extent of file \a a_fd that starts at \a a_offset.
+ * Preallocated and ring-style journals have holes that read back as
+ * zeros; the sender replicates them as msg_hole frames rather than
+ * streaming the zeros.  The extent is data if \a a_offset is in data and
+ * a hole otherwise; \a a_end is set to where it ends, at most \a a_limit.
+ * File systems without SEEK_DATA/SEEK_HOLE report everything as data.
+ * @return true if the extent is a hole.
+ */
+inline bool find_extent(int a_fd, uint64_t a_offset, uint64_t a_limit, uint64_t& a_end)
+    throw(io_error)
+{
+    a_end = a_limit;
+    if (a_offset >= a_limit)
+        return false;
+    off_t data = lseek(a_fd, a_offset, SEEK_DATA);
+    if (data < 0) {
+        if (errno == ENXIO)
+            return true;        // A hole up to the end of the file
+        if (errno == EINVAL)
+            return false;       // SEEK_DATA is not supported
+        throw io_error(errno, "lseek");
+    }
+    if ((uint64_t)data > a_offset) {
+        if ((uint64_t)data < a_limit)
+            a_end = data;
+        return true;
+    }
+    off_t hole = lseek(a_fd, a_offset, SEEK_HOLE);
+    if (hole < 0)
+        throw io_error(errno, "lseek");
+    if ((uint64_t)hole < a_limit)
+        a_end = hole;
+    return false;
+}
+
+} // namespace replog
+
+#endif // _REPLOG_SPARSE_HPP_
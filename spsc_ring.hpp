@@ -0,0 +1,225 @@
+//----------------------------------------------------------------------------
+/// \file  spsc_ring.hpp
+//----------------------------------------------------------------------------
+/// \brief Single-producer/single-consumer byte ring for shared memory.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _REPLOG_SPSC_RING_HPP_
+#define _REPLOG_SPSC_RING_HPP_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <boost/static_assert.hpp>
+#include <replog/atomic.hpp>
+#include <replog/error.hpp>
+
+namespace replog {
+
+/**
+ * \brief Control block of a ring placed at the start of a shared page.
+ * Producer and consumer positions live on separate cache lines, the
+ * wait flags on a third one that is only written when a side goes idle.
+ */
+struct spsc_ring_header {
+    static const uint32_t s_magic = 0x52504C52;   // "RPLR"
+
+    uint32_t magic;
+    uint32_t capacity;              ///< Size of the data area, power of two
+    char     pad0[56];
+    uint64_t head;                  ///< Bytes ever committed by the producer
+    uint32_t closed;                ///< The producer won't write anymore
+    char     pad1[52];
+    uint64_t tail;                  ///< Bytes ever consumed by the consumer
+    char     pad2[56];
+    uint32_t consumer_waiting;      ///< Consumer is about to block for data
+    uint32_t producer_waiting;      ///< Producer is about to block for space
+    char     pad3[56];
+};
+
+BOOST_STATIC_ASSERT(sizeof(spsc_ring_header) == 256);
+
+/**
+ * \brief Lock-free SPSC byte ring over a mirrored data area.
+ * The data area is expected to be mapped twice back to back, so that
+ * any region of up to capacity() bytes starting anywhere in the ring is
+ * contiguous in memory.  The producer therefore builds frames in place
+ * with reserve()/commit() and the consumer parses them in place with
+ * peek()/consume(), no matter where the ring wraps.
+ *
+ * The class doesn't block.  Sides that want to sleep call
+ * prepare_wait_data()/prepare_wait_space() and block on some external
+ * event only if it returns true; commit()/consume() return true when the
+ * peer has to be woken up.  The flag handshake uses a full fence on both
+ * sides so that a wakeup can't be lost.
+ *
+ * Positions of the peer are validated when loaded, so a corrupt or
+ * hostile peer makes reserve()/space()/peek() throw io_error.
+ */
+class spsc_ring {
+    spsc_ring_header* m_hdr;
+    char*             m_data;
+    uint64_t          m_mask;
+    uint64_t          m_head;       // Local copy of own position
+    uint64_t          m_tail;
+    uint64_t          m_peer_pos;   // Cached position of the other side
+
+    // Positions of the peer come from memory the peer process can write:
+    // a distance outside of the ring means a corrupt channel, reading or
+    // writing through it would leave the mirrored mapping.
+    uint64_t load_tail() const throw(io_error) {
+        uint64_t tail = atomic::load_acquire(m_hdr->tail);
+        if (m_head - tail > capacity())
+            throw io_error("Corrupt ring: tail=", tail, ", head=", m_head);
+        return tail;
+    }
+    uint64_t load_head() const throw(io_error) {
+        uint64_t head = atomic::load_acquire(m_hdr->head);
+        if (head - m_tail > capacity())
+            throw io_error("Corrupt ring: head=", head, ", tail=", m_tail);
+        return head;
+    }
+
+    static bool clear_flag(uint32_t& a_flag) {
+        if (!atomic::load_relaxed(a_flag))
+            return false;
+        uint32_t expected = 1;
+        return atomic::cas(a_flag, expected, 0u);
+    }
+public:
+    spsc_ring() : m_hdr(NULL), m_data(NULL), m_mask(0), m_head(0), m_tail(0), m_peer_pos(0) {}
+
+    /// Attach to a control block \a a_hdr and a mirrored data area
+    /// \a a_data.  If \a a_init is true the control block is initialized.
+    void attach(spsc_ring_header* a_hdr, char* a_data, uint32_t a_capacity, bool a_init) {
+        m_hdr  = a_hdr;
+        m_data = a_data;
+        m_mask = a_capacity - 1;
+        if (a_init) {
+            m_hdr->capacity = a_capacity;
+            m_hdr->head = m_hdr->tail = 0;
+            m_hdr->closed = m_hdr->consumer_waiting = m_hdr->producer_waiting = 0;
+            atomic::store_release(m_hdr->magic, spsc_ring_header::s_magic);
+        }
+        m_head     = atomic::load_acquire(m_hdr->head);
+        m_tail     = atomic::load_acquire(m_hdr->tail);
+        m_peer_pos = 0;
+    }
+
+    bool     is_attached() const { return m_hdr != NULL; }
+    uint32_t capacity()    const { return m_mask + 1; }
+
+    //------------------------------------------------------------------------
+    // Producer side
+    //------------------------------------------------------------------------
+
+    /// Return a pointer to \a n contiguous writable bytes or NULL if the
+    /// ring doesn't have that much free space.
+    char* reserve(size_t n) throw(io_error) {
+        if (m_head + n - m_peer_pos > capacity()) {
+            m_peer_pos = load_tail();
+            if (m_head + n - m_peer_pos > capacity())
+                return NULL;
+        }
+        return m_data + (m_head & m_mask);
+    }
+
+    /// Free space of the ring.
+    size_t space() throw(io_error) {
+        m_peer_pos = load_tail();
+        return capacity() - (m_head - m_peer_pos);
+    }
+
+    /// Publish \a n bytes written at the pointer returned by reserve().
+    /// @return true if the consumer is blocked and has to be woken up.
+    bool commit(size_t n) {
+        m_head += n;
+        atomic::store_release(m_hdr->head, m_head);
+        atomic::fence();
+        return clear_flag(m_hdr->consumer_waiting);
+    }
+
+    /// Mark end of stream.  The consumer has to be woken up afterwards.
+    void close() {
+        atomic::store_release(m_hdr->closed, 1u);
+        atomic::fence();
+    }
+
+    /// Announce that the producer is going to block until \a n bytes are
+    /// free.  @return false if the space became available meanwhile.
+    bool prepare_wait_space(size_t n) throw(io_error) {
+        atomic::store_relaxed(m_hdr->producer_waiting, 1u);
+        atomic::fence();
+        if (reserve(n)) {
+            atomic::store_relaxed(m_hdr->producer_waiting, 0u);
+            return false;
+        }
+        return true;
+    }
+
+    //------------------------------------------------------------------------
+    // Consumer side
+    //------------------------------------------------------------------------
+
+    /// Set \a a_ptr to the oldest unconsumed byte.
+    /// @return number of contiguous bytes available for reading.
+    size_t peek(char*& a_ptr) throw(io_error) {
+        m_peer_pos = load_head();
+        a_ptr = m_data + (m_tail & m_mask);
+        return m_peer_pos - m_tail;
+    }
+
+    /// Release \a n bytes returned by peek().
+    /// @return true if the producer is blocked and has to be woken up.
+    bool consume(size_t n) {
+        m_tail += n;
+        atomic::store_release(m_hdr->tail, m_tail);
+        atomic::fence();
+        return clear_flag(m_hdr->producer_waiting);
+    }
+
+    /// True when the producer closed the ring.  Data committed before
+    /// close() is visible to a subsequent peek().
+    bool closed() const { return atomic::load_acquire(m_hdr->closed) != 0; }
+
+    /// Announce that the consumer is going to block until \a n bytes are
+    /// available.  @return false if data arrived or the ring got closed.
+    bool prepare_wait_data(size_t n) throw(io_error) {
+        atomic::store_relaxed(m_hdr->consumer_waiting, 1u);
+        atomic::fence();
+        char* p;
+        if (peek(p) >= n || closed()) {
+            atomic::store_relaxed(m_hdr->consumer_waiting, 0u);
+            return false;
+        }
+        return true;
+    }
+};
+
+} // namespace replog
+
+#endif // _REPLOG_SPSC_RING_HPP_
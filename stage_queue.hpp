@@ -0,0 +1,172 @@
+//----------------------------------------------------------------------------
+/// \file  stage_queue.hpp
+//----------------------------------------------------------------------------
+/// \brief Lock-free SPSC queue and wakeup event connecting the threads of
+/// a staged pipeline.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _REPLOG_STAGE_QUEUE_HPP_
+#define _REPLOG_STAGE_QUEUE_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <boost/noncopyable.hpp>
+#include <replog/error.hpp>
+#include <replog/atomic.hpp>
+
+namespace replog {
+
+/**
+ * \brief Bounded lock-free queue of items passed from one thread to
+ * another.
+ * Unlike spsc_ring, which carries variable-size frames between
+ * processes, the queue holds fixed-size items (typically records
+ * referencing buffers) in process memory.  Each side caches the other
+ * side's position and reloads it only when the queue looks full or
+ * empty, so in the steady state push() and pop() touch one shared cache
+ * line each.  The queue doesn't block, see stage_event.
+ */
+template <class T>
+class spsc_queue: boost::noncopyable {
+public:
+    /// Create a queue of \a a_capacity items rounded up to a power of two.
+    explicit spsc_queue(size_t a_capacity = 1024)
+        : m_head(0), m_tail_cache(0), m_tail(0), m_head_cache(0)
+    {
+        size_t n = 2;
+        while (n < a_capacity)
+            n <<= 1;
+        m_mask  = n - 1;
+        m_slots = new T[n];
+    }
+    ~spsc_queue() { delete [] m_slots; }
+
+    size_t capacity() const { return m_mask + 1; }
+
+    /// Producer: append \a a_item.  @return false if the queue is full.
+    bool push(const T& a_item) {
+        uint64_t h = m_head;
+        if (h - m_tail_cache > m_mask) {
+            m_tail_cache = atomic::load_acquire(m_tail);
+            if (h - m_tail_cache > m_mask)
+                return false;
+        }
+        m_slots[h & m_mask] = a_item;
+        atomic::store_release(m_head, h + 1);
+        return true;
+    }
+
+    /// Consumer: remove the oldest item into \a a_item.
+    /// @return false if the queue is empty.
+    bool pop(T& a_item) {
+        uint64_t t = m_tail;
+        if (t == m_head_cache) {
+            m_head_cache = atomic::load_acquire(m_head);
+            if (t == m_head_cache)
+                return false;
+        }
+        a_item = m_slots[t & m_mask];
+        atomic::store_release(m_tail, t + 1);
+        return true;
+    }
+
+    /// Consumer: true if no item is queued.
+    bool empty() const { return m_tail == atomic::load_acquire(m_head); }
+
+private:
+    // Producer's cache line
+    uint64_t m_head;
+    uint64_t m_tail_cache;
+    char     m_pad0[48];
+    // Consumer's cache line
+    uint64_t m_tail;
+    uint64_t m_head_cache;
+    char     m_pad1[48];
+    T*       m_slots;
+    uint64_t m_mask;
+};
+
+/**
+ * \brief Wakeup of a thread sleeping on empty stage queues.
+ * A consumer about to sleep calls prepare(), checks its queues once more
+ * and calls wait() only if they're still empty (cancel() otherwise).
+ * notify() bumps a sequence and makes a system call only if a consumer
+ * announced that it's waiting, so busy stages exchange items without
+ * system calls.  The handshake uses a full fence on both sides so that
+ * a wakeup can't be lost.
+ *
+ * An event created with an eventfd wakes the consumer through the
+ * eventfd instead of a futex, so that it can wait for the event and
+ * for socket input in one poll(), and call clear() after waking up.
+ */
+class stage_event: boost::noncopyable {
+    uint32_t m_seq;
+    uint32_t m_waiters;
+    int      m_efd;
+public:
+    /// Create an event woken with a futex, or through an eventfd if
+    /// \a a_eventfd is true.
+    explicit stage_event(bool a_eventfd = false) throw(io_error);
+    ~stage_event();
+
+    /// Eventfd readable after notify(), -1 for a futex event.
+    int fd() const { return m_efd; }
+
+    /// Announce that the caller is going to wait.
+    /// @return sequence to pass to wait().
+    uint32_t prepare() {
+        atomic::add_relaxed(m_waiters, 1u);
+        atomic::fence();
+        return atomic::load_acquire(m_seq);
+    }
+    /// Withdraw the announcement made by prepare() without waiting.
+    void cancel() { atomic::sub_relaxed(m_waiters, 1u); }
+
+    /// Sleep until notify() is called after prepare() returned \a a_seq
+    /// or \a a_timeout_ms passes (-1 - no timeout).  Futex events only.
+    void wait(uint32_t a_seq, int a_timeout_ms = -1) throw(io_error);
+
+    /// Reset the eventfd after a poll() reported it readable, and withdraw
+    /// the announcement.
+    void clear();
+
+    /// Wake the waiting consumer, if any.
+    void notify() {
+        atomic::add_relaxed(m_seq, 1u);
+        atomic::fence();
+        if (atomic::load_relaxed(m_waiters))
+            wake();
+    }
+
+private:
+    void wake();
+};
+
+} // namespace replog
+
+#endif // _REPLOG_STAGE_QUEUE_HPP_
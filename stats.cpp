@@ -0,0 +1,151 @@
+//----------------------------------------------------------------------------
+/// \file  stats.cpp
+//----------------------------------------------------------------------------
+/// \brief Implementation of the shared memory statistics segment.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#include <replog/stats.hpp>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace replog {
+
+uint64_t stats_segment::realtime_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+void stats_segment::create(const std::string& a_name, const char* a_role,
+    uint32_t a_max_files) throw(io_error)
+{
+    close();
+    size_t size = stats_layout::size(a_max_files);
+    int fd = shm_open(a_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        throw io_error(errno, "shm_open");
+    if (ftruncate(fd, size) < 0) {
+        int err = errno;
+        ::close(fd);
+        throw io_error(err, "ftruncate");
+    }
+    void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED)
+        throw io_error(errno, "mmap");
+
+    m_data  = static_cast<stats_layout*>(p);
+    m_size  = size;
+    m_name  = a_name;
+    m_owner = true;
+
+    memset(m_data, 0, size);
+    m_data->version    = stats_layout::s_version;
+    m_data->max_files  = a_max_files;
+    m_data->pid        = getpid();
+    m_data->start_time = realtime_ns();
+    strncpy(m_data->role, a_role, sizeof(m_data->role)-1);
+    // Publish the magic last so that readers never see a partial header
+    atomic::store_release(m_data->magic, stats_layout::s_magic);
+}
+
+void stats_segment::open(const std::string& a_name) throw(io_error)
+{
+    close();
+    int fd = shm_open(a_name.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        throw io_error(errno, "shm_open");
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        int err = errno;
+        ::close(fd);
+        throw io_error(err, "fstat");
+    }
+    if ((size_t)st.st_size < sizeof(stats_layout)) {
+        ::close(fd);
+        throw io_error("Invalid statistics segment size:", st.st_size);
+    }
+    void* p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED)
+        throw io_error(errno, "mmap");
+
+    m_data  = static_cast<stats_layout*>(p);
+    m_size  = st.st_size;
+    m_name  = a_name;
+    m_owner = false;
+
+    if (atomic::load_acquire(m_data->magic) != stats_layout::s_magic
+     || m_data->version != stats_layout::s_version
+     || stats_layout::size(m_data->max_files) > m_size) {
+        close();
+        throw io_error("Incompatible statistics segment:", a_name);
+    }
+}
+
+void stats_segment::close()
+{
+    if (!m_data)
+        return;
+    munmap(m_data, m_size);
+    if (m_owner)
+        shm_unlink(m_name.c_str());
+    m_data  = NULL;
+    m_size  = 0;
+    m_owner = false;
+}
+
+stats_file* stats_segment::add_file(uint32_t a_id, uint32_t a_name_hash, const char* a_name)
+{
+    stats_file* f = file(a_id % m_data->max_files);
+    atomic::store_relaxed(f->active, (uint64_t)0);
+    f->id        = a_id;
+    f->name_hash = a_name_hash;
+    strncpy(f->name, a_name, sizeof(f->name)-1);
+    f->name[sizeof(f->name)-1] = '\0';
+    atomic::store_relaxed(f->src_size,    (uint64_t)0);
+    atomic::store_relaxed(f->ack_size,    (uint64_t)0);
+    atomic::store_relaxed(f->resends,     (uint64_t)0);
+    atomic::store_relaxed(f->update_time, realtime_ns());
+    atomic::store_release(f->active,      (uint64_t)1);
+    return f;
+}
+
+void stats_segment::remove_file(uint32_t a_id)
+{
+    stats_file* f = file(a_id % m_data->max_files);
+    if (f->id == a_id)
+        atomic::store_release(f->active, (uint64_t)0);
+}
+
+} // namespace replog
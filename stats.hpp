@@ -0,0 +1,256 @@
+//----------------------------------------------------------------------------
+/// \file  stats.hpp
+//----------------------------------------------------------------------------
+/// \brief Statistics published by REPLOG daemons in a shared memory
+/// segment that external tools can scrape without talking to the daemon.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _REPLOG_STATS_HPP_
+#define _REPLOG_STATS_HPP_
+
+#include <string>
+#include <algorithm>
+#include <stdint.h>
+#include <string.h>
+#include <boost/noncopyable.hpp>
+#include <replog/error.hpp>
+#include <replog/atomic.hpp>
+
+namespace replog {
+
+/**
+ * \brief Log-linear (HDR-style) histogram of nanosecond latencies.
+ * Each power of two is split into 32 linear sub-buckets, which gives
+ * about 3% precision from 1ns up to 2^40ns (~18 minutes).  The class
+ * is a POD that lives in shared memory: record() uses relaxed atomic
+ * increments and takes no locks.
+ */
+class latency_histogram {
+public:
+    static const int s_sub_bits = 5;
+    static const int s_sub      = 1 << s_sub_bits;
+    static const int s_buckets  = (40 - s_sub_bits + 2) * s_sub;
+private:
+    uint64_t m_counts[s_buckets];
+    uint64_t m_total;
+    uint64_t m_max;
+public:
+    static int bucket(uint64_t a_ns) {
+        if (a_ns < (uint64_t)s_sub)
+            return a_ns;
+        int e = 63 - __builtin_clzll(a_ns);
+        int i = (e - s_sub_bits + 1) * s_sub + ((a_ns >> (e - s_sub_bits)) & (s_sub - 1));
+        return std::min(i, s_buckets - 1);
+    }
+
+    /// Lowest value that falls in \a a_bucket.
+    static uint64_t value(int a_bucket) {
+        if (a_bucket < s_sub)
+            return a_bucket;
+        int e = a_bucket / s_sub + s_sub_bits - 1;
+        return (uint64_t)(s_sub + a_bucket % s_sub) << (e - s_sub_bits);
+    }
+
+    void reset() { memset(this, 0, sizeof(*this)); }
+
+    void record(uint64_t a_ns) {
+        atomic::add_relaxed(m_counts[bucket(a_ns)], (uint64_t)1);
+        atomic::add_relaxed(m_total, (uint64_t)1);
+        atomic::max_relaxed(m_max, a_ns);
+    }
+
+    uint64_t total()            const { return atomic::load_relaxed(m_total); }
+    uint64_t max()              const { return atomic::load_relaxed(m_max);   }
+    uint64_t count(int a_bucket)const { return atomic::load_relaxed(m_counts[a_bucket]); }
+
+    /// Value below which \a a_pct percent of samples fall.
+    uint64_t percentile(double a_pct) const {
+        uint64_t total = this->total();
+        if (total == 0)
+            return 0;
+        uint64_t n = std::max((uint64_t)1, (uint64_t)(total * a_pct / 100.0 + 0.5));
+        uint64_t sum = 0;
+        for (int i = 0; i < s_buckets; ++i)
+            if ((sum += count(i)) >= n)
+                return value(i);
+        return max();
+    }
+};
+
+/// Replication state of one file.
+struct stats_file {
+    char     name[208];
+    uint32_t id;
+    uint32_t name_hash;
+    uint64_t src_size;          // Source size known to the sender
+    uint64_t ack_size;          // Size applied/acknowledged by the receiver
+    uint64_t resends;           // Number of msg_resend_request for the file
+    uint64_t update_time;       // CLOCK_REALTIME ns of the last update
+    uint64_t active;
+
+    uint64_t lag() const {
+        uint64_t src = atomic::load_relaxed(src_size);
+        uint64_t ack = atomic::load_relaxed(ack_size);
+        return src > ack ? src - ack : 0;
+    }
+};
+
+/// Layout of the shared memory statistics segment.
+struct stats_layout {
+    static const uint32_t s_magic   = 0x52504c53; // "RPLS"
+    static const uint32_t s_version = 3;
+
+    enum direction { TX, RX };
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t max_files;
+    uint32_t pid;
+    uint64_t start_time;            // CLOCK_REALTIME ns
+    char     role[16];              // "sender", "receiver"
+
+    uint64_t frames[2][256];        // Frames per direction and command type
+    uint64_t bytes[2][256];         // Bytes per direction and command type
+    uint64_t writes;                // System calls writing output (~ packets)
+    uint64_t resends;
+    uint64_t buffer_bytes;          // Current bytes held in I/O buffers
+    uint64_t buffer_high_water;
+    uint64_t connections;           // Open connections
+    uint64_t syncs;                 // Group syncs of destination files
+    uint64_t queue_depth;           // Records queued for disk stages
+    uint64_t queue_high_water;
+
+    latency_histogram apply_latency;    // Source write to destination apply
+    latency_histogram ack_latency;      // Frame send to acknowledgement
+
+    stats_file files[0];
+
+    static size_t size(uint32_t a_max_files) {
+        return sizeof(stats_layout) + a_max_files * sizeof(stats_file);
+    }
+};
+
+/**
+ * \brief Shared memory segment with daemon statistics.
+ * The daemon creates the segment with create() and updates it on the
+ * hot path with relaxed atomic operations.  Scraping tools attach to
+ * it with open() in read-only mode.
+ *
+ * The library components publish their counters once given the
+ * segment: connections of a reactor (see reactor::stats()) count frames
+ * and bytes per command, the system calls writing their output (so
+ * frames per packet follow), buffered output and themselves, a
+ * receiver_session the state of its files, a group_commit its syncs,
+ * and a pipeline_receiver its frames, files and the depth of the
+ * pipeline queues.
+ */
+class stats_segment: boost::noncopyable {
+    stats_layout* m_data;
+    size_t        m_size;
+    std::string   m_name;
+    bool          m_owner;
+
+    static uint64_t realtime_ns();
+public:
+    stats_segment() : m_data(NULL), m_size(0), m_owner(false) {}
+    ~stats_segment() { close(); }
+
+    /// Create (or recreate) segment \a a_name (e.g. "/replog.sender")
+    /// able to hold \a a_max_files file slots.
+    void create(const std::string& a_name, const char* a_role,
+                uint32_t a_max_files) throw(io_error);
+
+    /// Attach to an existing segment in read-only mode.
+    void open(const std::string& a_name) throw(io_error);
+
+    /// Unmap the segment and, if it was created by this object, remove it.
+    void close();
+
+    bool                is_open()  const { return m_data != NULL; }
+    const stats_layout* data()     const { return m_data; }
+    stats_layout*       data()           { return m_data; }
+    uint32_t            max_files()const { return m_data ? m_data->max_files : 0; }
+
+    stats_file*         file(uint32_t a_slot)       { return &m_data->files[a_slot]; }
+    const stats_file*   file(uint32_t a_slot) const { return &m_data->files[a_slot]; }
+
+    /// Claim a slot for file \a a_id, the slot index is a_id % max_files().
+    stats_file* add_file(uint32_t a_id, uint32_t a_name_hash, const char* a_name);
+
+    /// Release the slot of file \a a_id.
+    void remove_file(uint32_t a_id);
+
+    void on_frame(stats_layout::direction a_dir, char a_cmd, uint32_t a_bytes) {
+        atomic::add_relaxed(m_data->frames[a_dir][(unsigned char)a_cmd], (uint64_t)1);
+        atomic::add_relaxed(m_data->bytes [a_dir][(unsigned char)a_cmd], (uint64_t)a_bytes);
+    }
+
+    void on_source_size(stats_file* a_file, uint64_t a_size) {
+        atomic::store_relaxed(a_file->src_size, a_size);
+    }
+
+    void on_ack(stats_file* a_file, uint64_t a_size) {
+        atomic::store_relaxed(a_file->ack_size, a_size);
+        atomic::store_relaxed(a_file->update_time, realtime_ns());
+    }
+
+    void on_resend(stats_file* a_file) {
+        atomic::add_relaxed(a_file->resends,  (uint64_t)1);
+        atomic::add_relaxed(m_data->resends,  (uint64_t)1);
+    }
+
+    void on_write() {
+        atomic::add_relaxed(m_data->writes, (uint64_t)1);
+    }
+
+    void on_sync() {
+        atomic::add_relaxed(m_data->syncs, (uint64_t)1);
+    }
+
+    void on_connection(int a_delta) {
+        atomic::add_relaxed(m_data->connections, (uint64_t)(int64_t)a_delta);
+    }
+
+    /// Publish the current depth of the disk stage queues.
+    void on_queue_depth(uint64_t a_depth) {
+        atomic::store_relaxed(m_data->queue_depth, a_depth);
+        if (a_depth > atomic::load_relaxed(m_data->queue_high_water))
+            atomic::max_relaxed(m_data->queue_high_water, a_depth);
+    }
+
+    /// Account for \a a_delta bytes added to (or removed from) I/O buffers.
+    void on_buffer(int64_t a_delta) {
+        uint64_t n = atomic::add_relaxed(m_data->buffer_bytes, (uint64_t)a_delta) + a_delta;
+        if (n > atomic::load_relaxed(m_data->buffer_high_water))
+            atomic::max_relaxed(m_data->buffer_high_water, n);
+    }
+};
+
+} // namespace replog
+
+#endif // _REPLOG_STATS_HPP_
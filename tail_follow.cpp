@@ -0,0 +1,246 @@
+//----------------------------------------------------------------------------
+/// \file  tail_follow.cpp
+//----------------------------------------------------------------------------
+/// \brief Notification of local consumers tailing replicated files.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#include <replog/tail_follow.hpp>
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+namespace replog {
+
+namespace {
+
+    /// Busy-poll iterations before a consumer blocks on the futex
+    const int s_spin_count = 256;
+
+    uint64_t monotonic_ns() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+    }
+
+    /// The segment is shared by processes, so the futex is not private.
+    int futex(uint32_t* a_addr, int a_op, uint32_t a_val, const timespec* a_timeout) {
+        return syscall(SYS_futex, a_addr, a_op, a_val, a_timeout, NULL, 0);
+    }
+}
+
+//----------------------------------------------------------------------------
+// follow_segment
+//----------------------------------------------------------------------------
+
+void follow_segment::create(const std::string& a_name, uint32_t a_max_files)
+    throw(io_error)
+{
+    close();
+    if (!a_max_files)
+        throw io_error("Invalid number of follow segment slots:", a_max_files);
+    size_t size = follow_layout::size(a_max_files);
+    int fd = shm_open(a_name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        throw io_error(errno, "shm_open");
+    if (ftruncate(fd, size) < 0) {
+        int err = errno;
+        ::close(fd);
+        throw io_error(err, "ftruncate");
+    }
+    void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED)
+        throw io_error(errno, "mmap");
+
+    m_data = static_cast<follow_layout*>(p);
+    m_size = size;
+    m_name = a_name;
+
+    memset(m_data, 0, size);
+    m_data->version   = follow_layout::s_version;
+    m_data->max_files = a_max_files;
+    m_data->pid       = getpid();
+    // Publish the magic last so that consumers never see a partial header
+    atomic::store_release(m_data->magic, follow_layout::s_magic);
+}
+
+void follow_segment::close()
+{
+    if (!m_data)
+        return;
+    // Let blocked consumers see that their files are gone
+    for (uint32_t i = 0; i < m_data->max_files; ++i)
+        if (atomic::load_relaxed(m_data->files[i].active))
+            remove_file(m_data->files[i].id);
+    munmap(m_data, m_size);
+    shm_unlink(m_name.c_str());
+    m_data = NULL;
+    m_size = 0;
+}
+
+follow_file* follow_segment::add_file(uint32_t a_id, const std::string& a_name,
+    uint64_t a_size)
+{
+    follow_file* f = file(a_id);
+    if (atomic::load_relaxed(f->active))
+        remove_file(f->id);
+    f->id = a_id;
+    strncpy(f->name, a_name.c_str(), sizeof(f->name)-1);
+    f->name[sizeof(f->name)-1] = '\0';
+    atomic::store_relaxed(f->applied, a_size);
+    atomic::store_relaxed(f->synced,  a_size);
+    atomic::store_release(f->active,  1u);
+    return f;
+}
+
+void follow_segment::remove_file(uint32_t a_id)
+{
+    follow_file* f = file(a_id);
+    atomic::store_release(f->active, 0u);
+    notify(f);
+}
+
+void follow_segment::wake(follow_file* a_file)
+{
+    futex(&a_file->seq, FUTEX_WAKE, INT_MAX, NULL);
+}
+
+//----------------------------------------------------------------------------
+// tail_follower
+//----------------------------------------------------------------------------
+
+void tail_follower::open(const std::string& a_segment, const std::string& a_name)
+    throw(io_error)
+{
+    close();
+    int fd = shm_open(a_segment.c_str(), O_RDWR, 0);
+    if (fd < 0)
+        throw io_error(errno, "shm_open");
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        int err = errno;
+        ::close(fd);
+        throw io_error(err, "fstat");
+    }
+    if ((size_t)st.st_size < sizeof(follow_layout)) {
+        ::close(fd);
+        throw io_error("Invalid follow segment size:", st.st_size);
+    }
+    // Writable: consumers announce themselves in the waiters counter
+    void* p = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED)
+        throw io_error(errno, "mmap");
+    m_data = static_cast<follow_layout*>(p);
+    m_size = st.st_size;
+
+    if (atomic::load_acquire(m_data->magic) != follow_layout::s_magic
+     || m_data->version != follow_layout::s_version
+     || follow_layout::size(m_data->max_files) > m_size) {
+        close();
+        throw io_error("Incompatible follow segment:", a_segment);
+    }
+    for (uint32_t i = 0; i < m_data->max_files && !m_file; ++i) {
+        follow_file* f = &m_data->files[i];
+        if (atomic::load_acquire(f->active) && a_name == f->name)
+            m_file = f;
+    }
+    if (!m_file) {
+        close();
+        throw io_error("File is not replicated: ", a_name.c_str());
+    }
+    try {
+        m_reader.open(a_name);
+    } catch (...) {
+        close();
+        throw;
+    }
+}
+
+void tail_follower::close()
+{
+    m_reader.close();
+    if (m_data)
+        munmap(m_data, m_size);
+    m_data = NULL;
+    m_size = 0;
+    m_file = NULL;
+}
+
+uint64_t tail_follower::wait(uint64_t a_offset, int a_timeout_ms, bool a_synced)
+    throw(io_error)
+{
+    uint64_t deadline = a_timeout_ms < 0 ? 0 : monotonic_ns() + a_timeout_ms * 1000000ull;
+    for (int spin = 0;; ++spin) {
+        uint32_t seq = atomic::load_acquire(m_file->seq);
+        uint64_t n   = available(a_synced);
+        if (n > a_offset || !atomic::load_relaxed(m_file->active))
+            return n;
+        if (spin < s_spin_count) {
+            atomic::pause();
+            continue;
+        }
+        timespec  ts;
+        timespec* timeout = NULL;
+        if (deadline) {
+            uint64_t now = monotonic_ns();
+            if (now >= deadline)
+                return n;
+            ts.tv_sec  = (deadline - now) / 1000000000ull;
+            ts.tv_nsec = (deadline - now) % 1000000000ull;
+            timeout    = &ts;
+        }
+        // Announce the sleep, then check that no update slipped in
+        atomic::add_relaxed(m_file->waiters, 1u);
+        atomic::fence();
+        int rc = atomic::load_relaxed(m_file->seq) == seq
+               ? futex(&m_file->seq, FUTEX_WAIT, seq, timeout) : 0;
+        int err = errno;
+        atomic::sub_relaxed(m_file->waiters, 1u);
+        if (rc < 0 && err != EAGAIN && err != EINTR && err != ETIMEDOUT)
+            throw io_error(err, "futex");
+    }
+}
+
+size_t tail_follower::read(uint64_t a_offset, size_t n, const char*& a_ptr) throw(io_error)
+{
+    uint64_t avail = available();
+    if (a_offset >= avail)
+        return 0;
+    return m_reader.read(a_offset, std::min<uint64_t>(n, avail - a_offset), a_ptr);
+}
+
+} // namespace replog
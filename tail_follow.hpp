@@ -0,0 +1,184 @@
+//----------------------------------------------------------------------------
+/// \file  tail_follow.hpp
+//----------------------------------------------------------------------------
+/// \brief Notification of local consumers tailing replicated files
+/// through a shared memory segment.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _REPLOG_TAIL_FOLLOW_HPP_
+#define _REPLOG_TAIL_FOLLOW_HPP_
+
+#include <string>
+#include <stdint.h>
+#include <boost/noncopyable.hpp>
+#include <replog/error.hpp>
+#include <replog/atomic.hpp>
+#include <replog/mmap_reader.hpp>
+
+namespace replog {
+
+/// Progress of one replicated file.
+struct follow_file {
+    char     name[232];
+    uint32_t id;
+    uint32_t active;
+    uint32_t seq;               // Bumped on every update, futex word
+    uint32_t waiters;           // Consumers about to block on seq
+    uint64_t applied;           // Bytes written to the file
+    uint64_t synced;            // Bytes made durable
+};
+
+/// Layout of the shared memory follow segment.
+struct follow_layout {
+    static const uint32_t s_magic   = 0x52504c46; // "RPLF"
+    static const uint32_t s_version = 1;
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t max_files;
+    uint32_t pid;
+
+    follow_file files[0];
+
+    static size_t size(uint32_t a_max_files) {
+        return sizeof(follow_layout) + a_max_files * sizeof(follow_file);
+    }
+};
+
+/**
+ * \brief Receiver side of the follow segment.
+ * The receiver publishes the size of every file as it applies and syncs
+ * data.  A publish is two stores and a sequence increment; a futex wake
+ * is issued only if some consumer announced that it's going to sleep, so
+ * with no consumers blocked the receiver makes no system calls.
+ */
+class follow_segment: boost::noncopyable {
+    follow_layout* m_data;
+    size_t         m_size;
+    std::string    m_name;
+public:
+    follow_segment() : m_data(NULL), m_size(0) {}
+    ~follow_segment() { close(); }
+
+    /// Create (or recreate) segment \a a_name (e.g. "/replog.follow")
+    /// able to hold \a a_max_files file slots.
+    void create(const std::string& a_name, uint32_t a_max_files) throw(io_error);
+
+    /// Unmap and remove the segment.
+    void close();
+
+    bool     is_open()   const { return m_data != NULL; }
+    uint32_t max_files() const { return m_data ? m_data->max_files : 0; }
+
+    /// Claim slot a_id % max_files() for file \a a_name of size \a a_size.
+    follow_file* add_file(uint32_t a_id, const std::string& a_name, uint64_t a_size);
+
+    /// Release the slot of file \a a_id, waking up its consumers.
+    void remove_file(uint32_t a_id);
+
+    /// Publish \a a_size bytes of file \a a_id readable.
+    void on_apply(uint32_t a_id, uint64_t a_size) {
+        follow_file* f = file(a_id);
+        atomic::store_release(f->applied, a_size);
+        notify(f);
+    }
+
+    /// Publish \a a_size bytes of file \a a_id durable.
+    void on_sync(uint32_t a_id, uint64_t a_size) {
+        follow_file* f = file(a_id);
+        atomic::store_release(f->synced, a_size);
+        notify(f);
+    }
+
+private:
+    follow_file* file(uint32_t a_id) { return &m_data->files[a_id % m_data->max_files]; }
+
+    void notify(follow_file* a_file) {
+        atomic::add_relaxed(a_file->seq, 1u);
+        atomic::fence();
+        if (atomic::load_relaxed(a_file->waiters))
+            wake(a_file);
+    }
+
+    static void wake(follow_file* a_file);
+};
+
+/**
+ * \brief Consumer tailing one replicated file on the receiver host.
+ * The consumer attaches to the follow segment of the receiver, finds the
+ * slot of its file by name and waits for new data with wait(), blocking
+ * on a futex of the slot's sequence number until the receiver publishes
+ * an update.  Data is read in place from a shared read-only mapping of
+ * the file with read(), without copying.
+ */
+class tail_follower: boost::noncopyable {
+public:
+    explicit tail_follower(size_t a_window = mmap_reader::s_default_window)
+        : m_data(NULL), m_size(0), m_file(NULL), m_reader(a_window)
+    {}
+    ~tail_follower() { close(); }
+
+    /// Attach to follow segment \a a_segment and open replicated file
+    /// \a a_name.
+    void open(const std::string& a_segment, const std::string& a_name) throw(io_error);
+    void close();
+
+    bool is_open() const { return m_file != NULL; }
+
+    /// Bytes of the file readable (or durable if \a a_synced is set).
+    uint64_t available(bool a_synced = false) const {
+        return atomic::load_acquire(a_synced ? m_file->synced : m_file->applied);
+    }
+
+    /// Wait until more than \a a_offset bytes are available, for at most
+    /// \a a_timeout_ms milliseconds (-1 - forever).
+    /// @return available(a_synced), not above \a a_offset on timeout or
+    ///         if the file was removed from the segment.
+    uint64_t wait(uint64_t a_offset, int a_timeout_ms = -1, bool a_synced = false)
+        throw(io_error);
+
+    /// Map up to \a n available bytes at \a a_offset and set \a a_ptr to
+    /// them.  The pointer stays valid until release() of the offset.
+    /// @return number of bytes at \a a_ptr, 0 if nothing is available.
+    size_t read(uint64_t a_offset, size_t n, const char*& a_ptr) throw(io_error);
+
+    /// Data before \a a_offset is consumed, see mmap_reader::release().
+    void release(uint64_t a_offset) { m_reader.release(a_offset); }
+
+    const mmap_reader& reader() const { return m_reader; }
+
+private:
+    follow_layout* m_data;
+    size_t         m_size;
+    follow_file*   m_file;
+    mmap_reader    m_reader;
+};
+
+} // namespace replog
+
+#endif // _REPLOG_TAIL_FOLLOW_HPP_
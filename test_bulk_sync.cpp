@@ -0,0 +1,141 @@
+//----------------------------------------------------------------------------
+/// \file  test_bulk_sync.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for the parallel bulk transfer.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <replog/bulk_sync.hpp>
+#include <replog/test_util.hpp>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using namespace replog;
+using namespace replog::test;
+
+namespace {
+    struct stream_arg {
+        bulk_sink*         sink;
+        const std::string* data;
+        byte_range         range;
+    };
+
+    // Write a range in chunks from the end backwards
+    void* stream(void* a_arg) {
+        stream_arg* a = static_cast<stream_arg*>(a_arg);
+        for (uint64_t e = a->range.end; e > a->range.begin; ) {
+            uint64_t b = e > a->range.begin + 1000 ? e - 1000 : a->range.begin;
+            a->sink->write(a->data->data() + b, e - b, b);
+            e = b;
+        }
+        return NULL;
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_split_ranges )
+{
+    std::vector<byte_range> v = split_ranges(0, 10000, 3, 1000);
+    BOOST_REQUIRE_EQUAL(3u, v.size());
+    BOOST_REQUIRE_EQUAL(0u,     v[0].begin);
+    BOOST_REQUIRE_EQUAL(4000u,  v[0].end);
+    BOOST_REQUIRE_EQUAL(8000u,  v[1].end);
+    BOOST_REQUIRE_EQUAL(10000u, v[2].end);
+
+    // Inner boundaries are aligned to file offsets
+    v = split_ranges(1500, 5000, 4, 1000);
+    BOOST_REQUIRE_EQUAL(4u, v.size());
+    BOOST_REQUIRE_EQUAL(1500u, v[0].begin);
+    BOOST_REQUIRE_EQUAL(2000u, v[0].end);
+    BOOST_REQUIRE_EQUAL(3000u, v[1].end);
+    BOOST_REQUIRE_EQUAL(5000u, v[3].end);
+
+    BOOST_REQUIRE_EQUAL(1u, split_ranges(0, 10, 8).size());
+    BOOST_REQUIRE(split_ranges(10, 10, 8).empty());
+}
+
+BOOST_AUTO_TEST_CASE( test_bulk_sink )
+{
+    std::string data;
+    for (int i = 0; i < 100000; ++i)
+        data += (char)('a' + i % 26);
+    std::string name = temp_name();
+
+    bulk_sink sink;
+    sink.open(name, data.size());
+    // The prefix advances only when the data below is complete
+    BOOST_REQUIRE_EQUAL(0u, sink.write(data.data() + 500, 500, 500));
+    BOOST_REQUIRE_EQUAL(1000u, sink.write(data.data(), 500, 0));
+    BOOST_REQUIRE_THROW(sink.write(data.data(), 10, data.size() - 5), io_error);
+
+    std::vector<byte_range> ranges = split_ranges(1000, data.size(), 4, 4096);
+    std::vector<stream_arg> args(ranges.size());
+    std::vector<pthread_t>  threads(ranges.size());
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        stream_arg a = { &sink, &data, ranges[i] };
+        args[i] = a;
+        pthread_create(&threads[i], NULL, stream, &args[i]);
+    }
+    for (size_t i = 0; i < threads.size(); ++i)
+        pthread_join(threads[i], NULL);
+    BOOST_REQUIRE(sink.complete());
+    BOOST_REQUIRE_EQUAL(data.size(), sink.received());
+    // The file appears only once complete
+    BOOST_REQUIRE_EQUAL(-1, access(name.c_str(), F_OK));
+    sink.close();
+    BOOST_REQUIRE(read_file(name) == data);
+    BOOST_REQUIRE_EQUAL(-1, access(sink.part_name().c_str(), F_OK));
+    unlink(name.c_str());
+
+    // An interrupted transfer leaves the complete prefix only
+    sink.open(name, data.size());
+    sink.write(data.data(), 3000, 0);
+    sink.write(data.data() + 5000, 3000, 5000);
+    sink.close();
+    BOOST_REQUIRE(read_file(sink.part_name()) == data.substr(0, 3000));
+    BOOST_REQUIRE_EQUAL(-1, access(name.c_str(), F_OK));
+
+    // ...which a resumed transfer keeps
+    sink.open(name, data.size(), true);
+    BOOST_REQUIRE_EQUAL(3000u, sink.contiguous());
+    BOOST_REQUIRE_EQUAL(data.size(),
+        sink.write(data.data() + 3000, data.size() - 3000, 3000));
+    sink.close();
+    BOOST_REQUIRE(read_file(name) == data);
+
+    // A restart without resume discards it
+    sink.open(name, data.size());
+    sink.write(data.data(), 3000, 0);
+    sink.close();
+    sink.open(name, data.size());
+    BOOST_REQUIRE_EQUAL(0u, sink.contiguous());
+    sink.close();
+    unlink(sink.part_name().c_str());
+    unlink(name.c_str());
+}
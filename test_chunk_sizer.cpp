@@ -0,0 +1,79 @@
+//----------------------------------------------------------------------------
+/// \file  test_chunk_sizer.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for adaptive chunk sizing.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <replog/chunk_sizer.hpp>
+
+using namespace replog;
+
+BOOST_AUTO_TEST_CASE( test_chunk_sizer )
+{
+    BOOST_REQUIRE_THROW(chunk_sizer(0, 10), io_error);
+    BOOST_REQUIRE_THROW(chunk_sizer(20, 10), io_error);
+
+    chunk_sizer s(4096, 1024 * 1024);
+    BOOST_REQUIRE_EQUAL(4096u, s.chunk_size());
+
+    // Light load: 100KB/s with 1ms RTT -> BDP of 100 bytes, minimum chunks
+    uint64_t now = 1000000000ull, off = 0;
+    for (int i = 0; i < 200; ++i, now += 1000000) {
+        off += 100;
+        s.on_send(0, off, now);
+        s.on_ack(0, off, now + 1000000);
+    }
+    BOOST_REQUIRE(s.srtt() >= 900000 && s.srtt() <= 1100000);
+    BOOST_REQUIRE_EQUAL(4096u, s.chunk_size());
+
+    // Catch-up: 400MB/s with 1ms RTT -> BDP of 400KB, chunks of ~100KB
+    for (int i = 0; i < 20000; ++i, now += 10000) {
+        off += 4000;
+        s.on_send(0, off, now);
+        s.on_ack(0, off, now + 1000000);
+    }
+    BOOST_REQUIRE(s.rate() >= 350000000 && s.rate() <= 450000000);
+    BOOST_REQUIRE(s.chunk_size() >= 80000 && s.chunk_size() <= 120000);
+
+    // Losses shrink chunks, loss-free time restores them
+    uint32_t before = s.chunk_size();
+    s.on_resend(now);
+    BOOST_REQUIRE(s.chunk_size() <= before / 2 + 1);
+    for (int i = 0; i < 20000; ++i, now += 10000) {
+        off += 4000;
+        s.on_send(0, off, now);
+        s.on_ack(0, off, now + 1000000);
+    }
+    BOOST_REQUIRE(s.chunk_size() >= before * 9 / 10);
+
+    // Bounds are enforced and changeable at runtime
+    s.bounds(4096, 65536);
+    BOOST_REQUIRE_EQUAL(65536u, s.chunk_size());
+}
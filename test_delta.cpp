@@ -0,0 +1,209 @@
+//----------------------------------------------------------------------------
+/// \file  test_delta.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for delta synchronization.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <replog/delta.hpp>
+#include <string>
+
+using namespace replog;
+
+namespace {
+
+    struct delta_applier {
+        const std::string& old;
+        std::string        out;
+        size_t             copies;
+        size_t             literals;
+
+        delta_applier(const std::string& a_old)
+            : old(a_old), copies(0), literals(0) {}
+
+        void copy(uint64_t a_dst_offset, uint64_t a_old_offset, uint32_t a_len) {
+            BOOST_REQUIRE_EQUAL(out.size(), a_dst_offset);
+            out.append(old, a_old_offset, a_len);
+            copies++;
+        }
+        void literal(uint64_t a_dst_offset, const char* a_data, uint32_t a_len) {
+            BOOST_REQUIRE_EQUAL(out.size(), a_dst_offset);
+            out.append(a_data, a_len);
+            literals += a_len;
+        }
+    };
+
+    /// Applier that asks to pause once more than \a a_limit bytes of
+    /// frames were produced, a copy taking 32 bytes.
+    struct paced_applier: public delta_applier {
+        size_t sent;
+        size_t mark;
+        size_t limit;
+
+        paced_applier(const std::string& a_old, size_t a_limit)
+            : delta_applier(a_old), sent(0), mark(0), limit(a_limit) {}
+
+        void copy(uint64_t a_dst_offset, uint64_t a_old_offset, uint32_t a_len) {
+            delta_applier::copy(a_dst_offset, a_old_offset, a_len);
+            sent += 32;
+        }
+        void literal(uint64_t a_dst_offset, const char* a_data, uint32_t a_len) {
+            delta_applier::literal(a_dst_offset, a_data, a_len);
+            sent += a_len;
+        }
+        bool full() const { return sent - mark > limit; }
+    };
+
+    std::string make_data(size_t n, unsigned a_seed) {
+        std::string s(n, '\0');
+        for (size_t i = 0; i < n; ++i) {
+            a_seed = a_seed * 1103515245 + 12345;
+            s[i] = 'a' + (a_seed >> 16) % 26;
+        }
+        return s;
+    }
+
+    void build_index(signature_index& a_idx, const std::string& a_old) {
+        for (size_t i = 0; i < a_old.size(); i += a_idx.block_size())
+            a_idx.add(block_signature(a_old.data() + i,
+                std::min((size_t)a_idx.block_size(), a_old.size() - i)));
+        a_idx.build();
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_rolling_checksum )
+{
+    const std::string s = make_data(1000, 1);
+    const size_t bs = 64;
+    rolling_checksum rc(s.data(), bs);
+    for (size_t i = 0; i + bs < s.size(); ++i) {
+        rc.roll(s[i], s[i + bs]);
+        BOOST_REQUIRE_EQUAL(rc.value(), rolling_checksum::compute(s.data() + i + 1, bs));
+    }
+
+    block_signature sig(s.data(), bs), sig2;
+    char buf[12];
+    BOOST_REQUIRE_EQUAL(buf + sizeof(buf), sig.encode(buf));
+    sig2.decode(buf);
+    BOOST_REQUIRE_EQUAL(sig.weak,   sig2.weak);
+    BOOST_REQUIRE_EQUAL(sig.strong, sig2.strong);
+}
+
+BOOST_AUTO_TEST_CASE( test_delta_generate )
+{
+    const size_t bs = 128;
+    const std::string old_data = make_data(100 * bs + 17, 2);
+
+    {
+        // Rewritten in place: one block modified, file truncated
+        std::string new_data = old_data.substr(0, 60 * bs);
+        new_data[10 * bs + 5] = '#';
+
+        signature_index idx(bs, old_data.size());
+        build_index(idx, old_data);
+        delta_applier h(old_data);
+        uint64_t n = delta_generate(idx, new_data.data(), new_data.size(), h);
+        BOOST_REQUIRE(h.out == new_data);
+        BOOST_REQUIRE_EQUAL(bs, n);
+        BOOST_REQUIRE_EQUAL(2u, h.copies);
+    }
+    {
+        // Data inserted in the middle shifts the remaining blocks
+        std::string new_data = old_data;
+        new_data.insert(33 * bs + 3, "inserted text");
+
+        signature_index idx(bs, old_data.size());
+        build_index(idx, old_data);
+        delta_applier h(old_data);
+        uint64_t n = delta_generate(idx, new_data.data(), new_data.size(), h, bs);
+        BOOST_REQUIRE(h.out == new_data);
+        BOOST_REQUIRE(n < 2 * bs + 17 + 13);
+    }
+    {
+        // Nothing in common
+        std::string new_data = make_data(10 * bs, 3);
+        signature_index idx(bs, old_data.size());
+        build_index(idx, old_data);
+        delta_applier h(old_data);
+        uint64_t n = delta_generate(idx, new_data.data(), new_data.size(), h);
+        BOOST_REQUIRE(h.out == new_data);
+        BOOST_REQUIRE_EQUAL(new_data.size(), n);
+        BOOST_REQUIRE_EQUAL(0u, h.copies);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_delta_generator )
+{
+    // Paused whenever 1000 bytes were produced, the delta is the same
+    const size_t bs = 128;
+    const std::string old_data = make_data(100 * bs, 4);
+    std::string new_data = make_data(20 * bs, 5) + old_data.substr(0, 50 * bs)
+                         + make_data(30 * bs + 7, 6);
+    signature_index idx(bs, old_data.size());
+    build_index(idx, old_data);
+
+    paced_applier h(old_data, 1000);
+    delta_generator g(idx, new_data.data(), new_data.size(), bs);
+    int runs = 0;
+    for (; !g.run(h); ++runs) {
+        BOOST_REQUIRE(!g.done());
+        BOOST_REQUIRE(h.sent - h.mark <= 1000 + bs + 64);
+        h.mark = h.sent;
+    }
+    BOOST_REQUIRE(g.done());
+    BOOST_REQUIRE(h.out == new_data);
+    BOOST_REQUIRE(runs >= 5);
+    BOOST_REQUIRE_EQUAL(50u * bs + 7, g.literals());
+    BOOST_REQUIRE_EQUAL(h.literals, g.literals());
+    BOOST_REQUIRE(g.run(h));
+}
+
+BOOST_AUTO_TEST_CASE( test_content_hash )
+{
+    // The hash doesn't depend on the pieces the data is fed in
+    const std::string s = make_data(3 * content_hash::s_piece_size + 1000, 7);
+    uint64_t h = content_hash::compute(s.data(), s.size());
+    content_hash h2;
+    for (size_t i = 0; i < s.size(); i += 777)
+        h2.update(s.data() + i, std::min((size_t)777, s.size() - i));
+    BOOST_REQUIRE_EQUAL(h, h2.value());
+    std::string t = s;
+    t[content_hash::s_piece_size + 5] ^= 1;
+    BOOST_REQUIRE(h != content_hash::compute(t.data(), t.size()));
+    BOOST_REQUIRE(h != content_hash::compute(s.data(), s.size() - 1));
+}
+
+BOOST_AUTO_TEST_CASE( test_delta_sync_required )
+{
+    BOOST_REQUIRE(!delta_sync_required(100, 100));
+    BOOST_REQUIRE(!delta_sync_required(100, 50));
+    BOOST_REQUIRE( delta_sync_required(100, 150));
+    BOOST_REQUIRE_EQUAL(2048u,   delta_block_size(1000));
+    BOOST_REQUIRE_EQUAL(131072u, delta_block_size(100ull << 30));
+}
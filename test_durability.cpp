@@ -0,0 +1,126 @@
+//----------------------------------------------------------------------------
+/// \file  test_durability.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for group commit of receiver writes.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <replog/durability.hpp>
+#include <replog/test_util.hpp>
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace replog;
+using namespace replog::test;
+
+BOOST_AUTO_TEST_CASE( test_group_commit_before_ack )
+{
+    file_writer w[2];
+    for (int i = 0; i < 2; ++i)
+        w[i].open(temp_name(i), file_writer::options(), true);
+
+    group_commit gc(group_commit::BEFORE_ACK, 1000, 100);
+    BOOST_REQUIRE(!gc.dirty());
+    BOOST_REQUIRE(!gc.due(1));
+
+    w[0].write("0123456789", 10, 0);
+    gc.on_write(0, &w[0], 10, 10, 1);
+    w[1].write("abcdefghij", 10, 0);
+    gc.on_write(1, &w[1], 10, 10, 2);
+    w[0].write("0123456789", 10, 10);
+    gc.on_write(0, &w[0], 20, 10, 3);
+
+    // Nothing is acknowledged before the covering sync
+    BOOST_REQUIRE(gc.dirty());
+    BOOST_REQUIRE_EQUAL(0u, gc.durable(0));
+    BOOST_REQUIRE_EQUAL(0u, gc.durable(1));
+
+    // The time window counts from the oldest unsynced write
+    BOOST_REQUIRE_EQUAL(1001u, gc.deadline());
+    BOOST_REQUIRE(!gc.due(1000));
+    BOOST_REQUIRE(gc.due(1001));
+
+    // One sync covers all files and appends
+    BOOST_REQUIRE_EQUAL(2u, gc.sync());
+    BOOST_REQUIRE_EQUAL(1u, gc.syncs());
+    BOOST_REQUIRE(!gc.dirty());
+    BOOST_REQUIRE_EQUAL(20u, gc.durable(0));
+    BOOST_REQUIRE_EQUAL(10u, gc.durable(1));
+    BOOST_REQUIRE_EQUAL(0u, gc.sync());
+    BOOST_REQUIRE_EQUAL(1u, gc.syncs());
+    BOOST_REQUIRE_EQUAL(0u, gc.deadline());
+
+    // The byte window
+    std::string s(60, 'x');
+    w[1].write(s.data(), s.size(), 10);
+    gc.on_write(1, &w[1], 70, s.size(), 2000);
+    BOOST_REQUIRE(!gc.due(2000));
+    w[1].write(s.data(), s.size(), 70);
+    gc.on_write(1, &w[1], 130, s.size(), 2001);
+    BOOST_REQUIRE(gc.due(2001));
+    BOOST_REQUIRE_EQUAL(10u, gc.durable(1));
+    BOOST_REQUIRE_EQUAL(1u, gc.sync());
+    BOOST_REQUIRE_EQUAL(130u, gc.durable(1));
+
+    for (int i = 0; i < 2; ++i) {
+        w[i].close();
+        unlink(temp_name(i).c_str());
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_group_commit_modes )
+{
+    file_writer w;
+    w.open(temp_name(0), file_writer::options(), true);
+
+    // Without syncing data is acknowledged once written
+    group_commit none(group_commit::NONE);
+    w.write("0123456789", 10, 0);
+    none.on_write(0, &w, 10, 10, 1);
+    BOOST_REQUIRE(!none.dirty());
+    BOOST_REQUIRE(!none.due(1000000000));
+    BOOST_REQUIRE_EQUAL(10u, none.durable(0));
+
+    // Periodic syncs don't hold back acknowledgements
+    group_commit periodic(group_commit::PERIODIC, 1000, 100);
+    periodic.on_write(0, &w, 10, 10, 1);
+    BOOST_REQUIRE(periodic.dirty());
+    BOOST_REQUIRE_EQUAL(10u, periodic.durable(0));
+    BOOST_REQUIRE(periodic.due(1001));
+    BOOST_REQUIRE_EQUAL(1u, periodic.sync());
+
+    // Removed files are no longer synced
+    periodic.on_write(0, &w, 20, 10, 2000);
+    periodic.remove(0);
+    BOOST_REQUIRE(!periodic.dirty());
+    BOOST_REQUIRE_EQUAL(0u, periodic.durable(0));
+
+    w.close();
+    unlink(temp_name(0).c_str());
+}
@@ -0,0 +1,166 @@
+//----------------------------------------------------------------------------
+/// \file  test_file_writer.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for the destination file writer.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <replog/file_writer.hpp>
+#include <replog/sparse.hpp>
+#include <replog/test_util.hpp>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+using namespace replog;
+using namespace replog::test;
+
+namespace {
+    uint64_t disk_usage(const std::string& a_name, uint64_t* a_size = NULL) {
+        struct stat st;
+        stat(a_name.c_str(), &st);
+        if (a_size)
+            *a_size = st.st_size;
+        return st.st_blocks * 512ull;
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_file_writer_preallocate )
+{
+    std::string name = temp_name();
+    file_writer::options opts;
+    opts.extent = 1024 * 1024;
+
+    file_writer w;
+    w.open(name, opts, true);
+    std::string expect;
+    for (int i = 0; i < 1000; ++i) {
+        std::string line(99, 'a' + i % 26);
+        line += '\n';
+        w.write(line.data(), line.size(), expect.size());
+        expect += line;
+    }
+    BOOST_REQUIRE_EQUAL(100000u, w.size());
+    uint64_t size;
+    uint64_t used = disk_usage(name, &size);
+    BOOST_REQUIRE_EQUAL(100000u, size);
+    if (w.allocated() > w.size())   // The file system supports fallocate
+        BOOST_REQUIRE(used >= opts.extent);
+
+    w.close();
+    BOOST_REQUIRE(disk_usage(name, &size) < opts.extent);
+    BOOST_REQUIRE_EQUAL(100000u, size);
+    BOOST_REQUIRE(read_file(name) == expect);
+    unlink(name.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( test_file_writer_hole )
+{
+    std::string name = temp_name();
+    const uint64_t hole = 8 * 1024 * 1024;
+    for (int direct = 0; direct < 2; ++direct) {
+        file_writer::options opts;
+        opts.extent = 1024 * 1024;
+        opts.direct = direct;
+
+        // Holes in the middle and at the end, the first one partly
+        // inside a preallocated extent
+        file_writer w;
+        w.open(name, opts, true);
+        w.write("head\n", 5, 0);
+        w.hole(5, hole);
+        w.write("tail\n", 5, 5 + hole);
+        w.hole(10 + hole, hole);
+        BOOST_REQUIRE_EQUAL(10 + 2 * hole, w.size());
+        w.close();
+
+        uint64_t size;
+        BOOST_REQUIRE(disk_usage(name, &size) < 2 * opts.extent);
+        BOOST_REQUIRE_EQUAL(10 + 2 * hole, size);
+        std::string expect = "head\n" + std::string(hole, '\0') + "tail\n" +
+                             std::string(hole, '\0');
+        BOOST_REQUIRE(read_file(name) == expect);
+
+        int fd = ::open(name.c_str(), O_RDONLY);
+        uint64_t end;
+        BOOST_REQUIRE(!find_extent(fd, 0, size, end));
+        BOOST_REQUIRE(end >= 5 && end < hole);
+        BOOST_REQUIRE(find_extent(fd, end, size, end));
+        BOOST_REQUIRE(end > 5 && end <= 5 + hole);
+        BOOST_REQUIRE(!find_extent(fd, end, size, end));
+        BOOST_REQUIRE(find_extent(fd, end, size, end));
+        BOOST_REQUIRE_EQUAL(size, end);
+        ::close(fd);
+    }
+    unlink(name.c_str());
+}
+
+BOOST_AUTO_TEST_CASE( test_file_writer_direct )
+{
+    std::string name = temp_name();
+    file_writer::options opts;
+    opts.direct = true;
+
+    file_writer w;
+    w.open(name, opts, true);
+    std::string expect;
+    for (int i = 0; expect.size() < 3 * 1024 * 1024; ++i) {
+        std::string chunk(1 + (i * 7919) % 20000, 'a' + i % 26);
+        w.write(chunk.data(), chunk.size(), expect.size());
+        expect += chunk;
+        // Unaligned tails become visible on flush
+        if (i % 50 == 0) {
+            w.flush();
+            uint64_t size;
+            disk_usage(name, &size);
+            BOOST_REQUIRE_EQUAL(expect.size(), size);
+            BOOST_REQUIRE(read_file(name) == expect);
+        }
+    }
+
+    // Out of sequence writes restart the buffer at the new offset
+    w.write("XYZ", 3, 5000);
+    expect.replace(5000, 3, "XYZ");
+    w.write("tail", 4, expect.size());
+    expect += "tail";
+    w.sync();
+    BOOST_REQUIRE(read_file(name) == expect);
+    w.close();
+    BOOST_REQUIRE(read_file(name) == expect);
+
+    // Reopening continues from the unaligned end of the file
+    w.open(name, opts);
+    BOOST_REQUIRE_EQUAL(expect.size(), w.size());
+    w.write("more", 4, expect.size());
+    expect += "more";
+    w.close();
+    BOOST_REQUIRE(read_file(name) == expect);
+    unlink(name.c_str());
+}
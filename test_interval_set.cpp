@@ -0,0 +1,72 @@
+//----------------------------------------------------------------------------
+/// \file  test_interval_set.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for the interval set.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <replog/interval_set.hpp>
+
+using namespace replog;
+
+BOOST_AUTO_TEST_CASE( test_interval_set )
+{
+    interval_set s;
+    BOOST_REQUIRE_EQUAL(0u, s.contiguous());
+    s.insert(100, 200);
+    s.insert(300, 400);
+    BOOST_REQUIRE_EQUAL(2u, s.size());
+    BOOST_REQUIRE_EQUAL(200u, s.bytes());
+    BOOST_REQUIRE_EQUAL(0u, s.contiguous());
+    BOOST_REQUIRE_EQUAL(200u, s.contiguous(100));
+    BOOST_REQUIRE_EQUAL(200u, s.contiguous(150));
+    BOOST_REQUIRE_EQUAL(250u, s.contiguous(250));
+    BOOST_REQUIRE(s.contains(120, 200));
+    BOOST_REQUIRE(!s.contains(150, 250));
+
+    // Overlaps, adjacency and contained ranges merge
+    s.insert(150, 180);
+    BOOST_REQUIRE_EQUAL(2u, s.size());
+    s.insert(200, 300);
+    BOOST_REQUIRE_EQUAL(1u, s.size());
+    BOOST_REQUIRE_EQUAL(300u, s.bytes());
+    s.insert(500, 600);
+    s.insert(700, 800);
+    s.insert(50, 750);
+    BOOST_REQUIRE_EQUAL(1u, s.size());
+    BOOST_REQUIRE_EQUAL(750u, s.bytes());
+    BOOST_REQUIRE_EQUAL(50u, s.begin()->first);
+    BOOST_REQUIRE_EQUAL(800u, s.begin()->second);
+
+    s.insert(0, 50);
+    BOOST_REQUIRE_EQUAL(800u, s.contiguous());
+    BOOST_REQUIRE_EQUAL(800u, s.bytes());
+    s.clear();
+    BOOST_REQUIRE(s.empty());
+}
@@ -0,0 +1,78 @@
+//----------------------------------------------------------------------------
+/// \file  test_lru.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for the LRU lists.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <replog/lru.hpp>
+
+using namespace replog;
+
+BOOST_AUTO_TEST_CASE( test_lru )
+{
+    lru<int> l(true);
+    BOOST_REQUIRE(l.empty());
+    for (int i = 0; i < 3; ++i)
+        l.add(new lru_node<int>(i));
+    // 2 1 0
+    BOOST_REQUIRE_EQUAL(2, *l.head());
+    BOOST_REQUIRE_EQUAL(0, *l.tail());
+    BOOST_REQUIRE_EQUAL(1, *l.next(l.head()));
+    BOOST_REQUIRE_EQUAL(1, *l.prev(l.tail()));
+    BOOST_REQUIRE(l.next(l.tail()) == NULL);
+
+    l.use(l.tail());            // 0 2 1
+    BOOST_REQUIRE_EQUAL(0, *l.head());
+    BOOST_REQUIRE_EQUAL(1, *l.tail());
+    BOOST_REQUIRE_EQUAL(2, *l.prev(l.tail()));
+
+    delete l.remove(l.next(l.head()));  // 0 1
+    BOOST_REQUIRE_EQUAL(1, *l.next(l.head()));
+    BOOST_REQUIRE_EQUAL(0, *l.prev(l.tail()));
+    delete l.remove(l.head());
+    delete l.remove(l.tail());
+    BOOST_REQUIRE(l.empty());
+    BOOST_REQUIRE(l.tail() == NULL);
+}
+
+BOOST_AUTO_TEST_CASE( test_lru_fixed_size )
+{
+    lru_fixed_size<int> l(2, true);
+    BOOST_REQUIRE(l.add(new lru_node<int>(1)) == NULL);
+    BOOST_REQUIRE(l.add(new lru_node<int>(2)) == NULL);
+    l.use(l.tail());            // 1 2
+    lru_node<int>* old = l.add(new lru_node<int>(3));
+    BOOST_REQUIRE(old != NULL);
+    BOOST_REQUIRE_EQUAL(2, old->data);
+    delete old;
+    BOOST_REQUIRE_EQUAL(2u, l.size());
+    BOOST_REQUIRE_EQUAL(3, *l.head());
+    BOOST_REQUIRE_EQUAL(1, *l.tail());
+}
@@ -0,0 +1,155 @@
+//----------------------------------------------------------------------------
+/// \file  test_memory_budget.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for the process-wide memory budget.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <replog/memory_budget.hpp>
+#include <replog/reactor.hpp>
+#include <replog/retention_cache.hpp>
+#include <unistd.h>
+#include <sys/socket.h>
+
+using namespace replog;
+
+namespace {
+    struct count_conn: public connection {
+        size_t frames;
+        count_conn(reactor& a_r, int a_fd) : connection(a_r, a_fd), frames(0) {}
+        void on_frame(msg_base_header*, size_t) { frames++; }
+    };
+
+    /// Allow 1MB over current usage, with pressure between 512K and 256K
+    /// over it.
+    size_t limit_usage() {
+        memory_budget& mb = memory_budget::instance();
+        mb.flush();
+        size_t base  = mb.used();
+        size_t limit = base + 1024 * 1024;
+        mb.limit(limit, (base + 512 * 1024) * 100 / limit, (base + 256 * 1024) * 100 / limit);
+        return base;
+    }
+
+    std::string ack_frame() {
+        std::allocator<char> alloc;
+        msg_ack* m = msg_ack::create(1, 1, 0, alloc);
+        std::string s(reinterpret_cast<char*>(m), m->header_size());
+        alloc.deallocate(reinterpret_cast<char*>(m), m->header_size());
+        return s;
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_memory_budget )
+{
+    memory_budget& mb   = memory_budget::instance();
+    size_t         base = limit_usage();
+
+    // Small acquisitions are served from the thread's credit
+    BOOST_REQUIRE(mb.try_acquire(100));
+    size_t used = mb.used();
+    BOOST_REQUIRE_EQUAL(base + 100 + memory_budget::s_slab, used);
+    BOOST_REQUIRE(mb.try_acquire(1000));
+    BOOST_REQUIRE_EQUAL(used, mb.used());
+    mb.release(1100);
+    BOOST_REQUIRE_EQUAL(used, mb.used());
+    mb.flush();
+    BOOST_REQUIRE_EQUAL(base, mb.used());
+
+    // The limit holds, pressure has hysteresis
+    uint64_t failures = mb.failures();
+    BOOST_REQUIRE(!mb.try_acquire(2 * 1024 * 1024));
+    BOOST_REQUIRE_THROW(mb.acquire(2 * 1024 * 1024), io_error);
+    BOOST_REQUIRE_EQUAL(failures + 2, mb.failures());
+    BOOST_REQUIRE(mb.try_acquire(600 * 1024));
+    BOOST_REQUIRE(mb.pressure());
+    mb.release(200 * 1024);
+    mb.flush();
+    BOOST_REQUIRE(mb.pressure());
+    mb.release(300 * 1024);
+    mb.flush();
+    BOOST_REQUIRE(!mb.pressure());
+    mb.release(100 * 1024);
+    mb.flush();
+    BOOST_REQUIRE_EQUAL(base, mb.used());
+
+    // Buffers account their heap space
+    {
+        basic_io_buffer<16> b;
+        b.reallocate(4096);
+        mb.flush();
+        BOOST_REQUIRE_EQUAL(base + 4096, mb.used());
+        BOOST_REQUIRE_THROW(b.reallocate(2 * 1024 * 1024), io_error);
+        b.reset();
+        mb.flush();
+        BOOST_REQUIRE_EQUAL(base, mb.used());
+    }
+    mb.limit(0);
+}
+
+BOOST_AUTO_TEST_CASE( test_memory_budget_backpressure )
+{
+    memory_budget& mb   = memory_budget::instance();
+    size_t         base = limit_usage();
+
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    reactor         r;
+    count_conn      c(r, fds[1]);
+    retention_cache cache(1024 * 1024);
+    r.add(c);
+
+    // A full cache takes the budget over the high watermark
+    std::string chunk(64 * 1024, 'x');
+    for (int i = 0; i < 16; ++i)
+        cache.insert(0, i * chunk.size(), chunk.data(), chunk.size());
+    BOOST_REQUIRE(mb.pressure());
+
+    // Input is left in the socket under pressure
+    std::string f = ack_frame();
+    BOOST_REQUIRE_EQUAL((ssize_t)f.size(), write(fds[0], f.data(), f.size()));
+    r.run_once(100);
+    BOOST_REQUIRE_EQUAL(0u, c.frames);
+    BOOST_REQUIRE_EQUAL(1u, r.throttled());
+
+    // Shrinking the cache relieves the pressure and resumes input
+    r.add_reclaimer(cache);
+    r.run_once(0);
+    BOOST_REQUIRE(!mb.pressure());
+    BOOST_REQUIRE(cache.size() <= 256 * 1024);
+    BOOST_REQUIRE_EQUAL(0u, r.throttled());
+    BOOST_REQUIRE_EQUAL(1u, c.frames);
+
+    r.remove_reclaimer(cache);
+    cache.budget(0);
+    mb.flush();
+    BOOST_REQUIRE_EQUAL(base, mb.used());
+    mb.limit(0);
+    ::close(fds[0]);
+}
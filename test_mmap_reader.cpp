@@ -0,0 +1,107 @@
+//----------------------------------------------------------------------------
+/// \file  test_mmap_reader.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for the memory mapped source reader.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <replog/mmap_reader.hpp>
+#include <replog/test_util.hpp>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace replog;
+using namespace replog::test;
+
+namespace {
+    void append(int a_fd, const std::string& a_data) {
+        BOOST_REQUIRE_EQUAL((ssize_t)a_data.size(), write(a_fd, a_data.data(), a_data.size()));
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_mmap_reader )
+{
+    std::string name = temp_name();
+    int fd = ::open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    BOOST_REQUIRE(fd >= 0);
+
+    size_t      page = sysconf(_SC_PAGESIZE);
+    mmap_reader r(2 * page);
+    r.open(name);
+    const char* p;
+    BOOST_REQUIRE_EQUAL(0u, r.read(0, 100, p));
+
+    // Appends within the window are read without remapping
+    std::string expect;
+    for (int i = 0; expect.size() < page * 5 / 2; ++i) {
+        std::string line(99, 'a' + i % 26);
+        line += '\n';
+        append(fd, line);
+        expect += line;
+    }
+    size_t n = r.read(0, 1050, p);
+    BOOST_REQUIRE_EQUAL(1050u, n);
+    BOOST_REQUIRE(std::string(p, n) == expect.substr(0, n));
+    BOOST_REQUIRE_EQUAL(1000u, r.boundary(p, n));
+    n = r.read(1000, page, p);
+    BOOST_REQUIRE_EQUAL(page, n);
+    BOOST_REQUIRE(std::string(p, n) == expect.substr(1000, n));
+    BOOST_REQUIRE_EQUAL(1u, r.windows());
+
+    // A read crossing the end of the window maps the next one
+    n = r.read(page + 1000, page, p);
+    BOOST_REQUIRE_EQUAL(page, n);
+    BOOST_REQUIRE(std::string(p, n) == expect.substr(page + 1000, n));
+    BOOST_REQUIRE_EQUAL(2u, r.windows());
+    char buf[100];
+    BOOST_REQUIRE(r.copy(buf, p, sizeof(buf)));
+    BOOST_REQUIRE(std::string(buf, sizeof(buf)) == expect.substr(page + 1000, 100));
+
+    // Acknowledged windows are unmapped
+    r.release(page + 1000);
+    BOOST_REQUIRE_EQUAL(2u, r.windows());
+    r.release(2 * page);
+    BOOST_REQUIRE_EQUAL(1u, r.windows());
+
+    // Truncation is detected instead of crashing on SIGBUS
+    BOOST_REQUIRE(!r.truncated());
+    BOOST_REQUIRE_EQUAL(0, ftruncate(fd, 0));
+    BOOST_REQUIRE_EQUAL(0u, r.boundary(p, n));
+    BOOST_REQUIRE(r.truncated());
+    BOOST_REQUIRE(!r.copy(buf, p, sizeof(buf)));
+    r.refresh();
+    BOOST_REQUIRE_EQUAL(0u, r.size());
+    BOOST_REQUIRE_EQUAL(0u, r.read(page + 1000, 100, p));
+
+    r.close();
+    BOOST_REQUIRE_EQUAL(0u, r.windows());
+    ::close(fd);
+    unlink(name.c_str());
+}
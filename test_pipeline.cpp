@@ -0,0 +1,468 @@
+//----------------------------------------------------------------------------
+/// \file  test_pipeline.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for the staged receiver pipeline.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <replog/pipeline.hpp>
+#include <replog/test_util.hpp>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+
+using namespace replog;
+using namespace replog::test;
+
+namespace {
+    const int s_files = 4;
+
+    void* produce(void* a_arg) {
+        spsc_queue<uint32_t>* q = static_cast<spsc_queue<uint32_t>*>(a_arg);
+        for (uint32_t i = 0; i < 1000000; )
+            if (q->push(i))
+                ++i;
+            else
+                sched_yield();
+        return NULL;
+    }
+
+    /// Appends records to in-memory files, file 0 possibly slowly.
+    struct test_handler: public disk_handler {
+        std::string data[s_files];
+        int         errors;
+        int         idles[2];
+        useconds_t  slow_us;
+        int         fail_at;    // Fail the record of file 3 at this offset
+
+        test_handler() : errors(0), slow_us(0), fail_at(-1) { idles[0] = idles[1] = 0; }
+
+        bool apply(int a_shard, const disk_record& a_rec, disk_completion& a_done) {
+            std::string& f = data[a_rec.id];
+            if ((int)a_rec.id % 2 != a_shard || a_rec.offset != f.size())
+                errors++;
+            if (a_rec.id == 3 && (int)a_rec.offset == fail_at)
+                throw io_error("Injected disk error");
+            if (a_rec.id == 0 && slow_us)
+                usleep(slow_us);
+            f.append(a_rec.data, a_rec.length);
+            a_done.id      = a_rec.id;
+            a_done.size    = f.size();
+            a_done.durable = 0;
+            return true;
+        }
+        void idle(int a_shard, std::vector<disk_completion>&) { idles[a_shard]++; }
+    };
+
+    /// Frames of the test: file id, 3 bytes of length, payload.
+    std::string make_stream(std::string* a_files, int a_frames, int a_max_len) {
+        std::string s;
+        for (int i = 0; i < a_frames; ++i) {
+            int      id  = rand() % s_files;
+            uint32_t len = 1 + rand() % a_max_len;
+            std::string payload(len, 'a' + (a_files[id].size() + i) % 26);
+            s += (char)id;
+            s += (char)(len >> 16);
+            s += (char)(len >> 8);
+            s += (char)len;
+            s += payload;
+            a_files[id] += payload;
+        }
+        return s;
+    }
+
+    /// Feed \a a_stream to \a a_pipe in pieces of random size.
+    void feed(apply_pipeline& a_pipe, const std::string& a_stream, uint64_t* a_sizes) {
+        uint64_t offsets[s_files] = {0};
+        std::vector<disk_completion> done;
+        for (size_t pos = 0; pos < a_stream.size(); ) {
+            size_t avail;
+            char*  p = a_pipe.input(avail);
+            size_t n = std::min<size_t>(std::min<size_t>(avail, 1 + rand() % 20000),
+                                        a_stream.size() - pos);
+            memcpy(p, a_stream.data() + pos, n);
+            a_pipe.received(n);
+            pos += n;
+            char* q;
+            for (size_t k = a_pipe.peek(q); k >= 4; k = a_pipe.peek(q)) {
+                uint32_t len = (uint8_t)q[1] << 16 | (uint8_t)q[2] << 8 | (uint8_t)q[3];
+                if (k < 4 + len)
+                    break;
+                disk_record r;
+                r.id     = q[0];
+                r.cmd    = 'A';
+                r.offset = offsets[r.id];
+                r.length = len;
+                r.data   = q + 4;   // In place, the payload is never copied
+                a_pipe.submit(r);
+                offsets[r.id] += len;
+                a_pipe.consume(4 + len);
+            }
+            a_pipe.poll(done);
+        }
+        for (size_t i = 0; i < done.size(); ++i)
+            a_sizes[done[i].id] = std::max(a_sizes[done[i].id], done[i].size);
+    }
+
+    void* serve(void* a_arg) {
+        try {
+            static_cast<pipeline_receiver*>(a_arg)->run();
+        } catch (std::exception& e) {
+            BOOST_ERROR(e.what());
+        }
+        return NULL;
+    }
+
+    /// Write frame \a a_msg followed by \a a_payload to \a a_fd and free it.
+    template <class Msg>
+    void send_frame(int a_fd, Msg* a_msg, const std::string& a_payload = std::string()) {
+        std::string f(reinterpret_cast<char*>(a_msg), a_msg->header_size());
+        std::allocator<char>().deallocate(reinterpret_cast<char*>(a_msg), f.size());
+        f += a_payload;
+        BOOST_REQUIRE_EQUAL((ssize_t)f.size(), write(a_fd, f.data(), f.size()));
+    }
+
+    /// Read one response frame from \a a_fd.
+    std::string recv_frame(int a_fd) {
+        std::string f(sizeof(msg_base_header), '\0');
+        BOOST_REQUIRE_EQUAL((ssize_t)f.size(), recv(a_fd, &f[0], f.size(), MSG_WAITALL));
+        size_t n = reinterpret_cast<msg_base_header*>(&f[0])->header_size();
+        f.resize(n);
+        size_t k = n - sizeof(msg_base_header);
+        BOOST_REQUIRE_EQUAL((ssize_t)k, recv(a_fd, &f[sizeof(msg_base_header)], k, MSG_WAITALL));
+        msg_base_header::decode_header(&f[0], f.size());
+        return f;
+    }
+
+    msg_base_header* frame(std::string& a_frame) {
+        return reinterpret_cast<msg_base_header*>(&a_frame[0]);
+    }
+
+    /// Poll until files reach \a a_sizes or a second passes.
+    bool wait_applied(apply_pipeline& a_pipe, uint64_t* a_applied, const std::string* a_files) {
+        std::vector<disk_completion> done;
+        for (int t = 0; t < 1000; ++t) {
+            done.clear();
+            a_pipe.poll(done);
+            for (size_t i = 0; i < done.size(); ++i)
+                a_applied[done[i].id] = std::max(a_applied[done[i].id], done[i].size);
+            int f = 0;
+            while (f < s_files && a_applied[f] == a_files[f].size())
+                ++f;
+            if (f == s_files)
+                return true;
+            usleep(1000);
+        }
+        return false;
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_spsc_queue )
+{
+    spsc_queue<uint32_t> q(5);
+    BOOST_REQUIRE_EQUAL(8u, q.capacity());
+    BOOST_REQUIRE(q.empty());
+    for (uint32_t i = 0; i < 8; ++i)
+        BOOST_REQUIRE(q.push(i));
+    BOOST_REQUIRE(!q.push(8));
+    uint32_t v;
+    for (uint32_t i = 0; i < 8; ++i) {
+        BOOST_REQUIRE(q.pop(v));
+        BOOST_REQUIRE_EQUAL(i, v);
+    }
+    BOOST_REQUIRE(!q.pop(v));
+    BOOST_REQUIRE(q.empty());
+
+    // Items cross threads in order
+    spsc_queue<uint32_t> q2(64);
+    pthread_t th;
+    pthread_create(&th, NULL, produce, &q2);
+    int errors = 0;
+    for (uint32_t i = 0; i < 1000000; )
+        if (q2.pop(v))
+            errors += v != i++;
+        else
+            sched_yield();
+    pthread_join(th, NULL);
+    BOOST_REQUIRE_EQUAL(0, errors);
+}
+
+BOOST_AUTO_TEST_CASE( test_apply_pipeline )
+{
+    srand(7);
+    std::string  files[s_files];
+    std::string  stream = make_stream(files, 2000, 3000);
+    test_handler h;
+    apply_pipeline::options opts;
+    opts.shards      = 2;
+    opts.block_size  = 64 * 1024;
+    opts.max_blocks  = 4;
+    opts.queue_depth = 64;
+    apply_pipeline pipe(h, opts);
+    pipe.start();
+
+    uint64_t applied[s_files] = {0};
+    feed(pipe, stream, applied);
+    BOOST_REQUIRE(wait_applied(pipe, applied, files));
+    pipe.stop();
+    BOOST_REQUIRE_EQUAL(0, h.errors);
+    for (int i = 0; i < s_files; ++i)
+        BOOST_REQUIRE(h.data[i] == files[i]);
+    // Blocks are recycled rather than allocated per read
+    BOOST_REQUIRE(pipe.blocks() <= 4);
+    BOOST_REQUIRE(h.idles[0] > 0 && h.idles[1] > 0);
+}
+
+BOOST_AUTO_TEST_CASE( test_apply_pipeline_slow_disk )
+{
+    // A slow shard doesn't hold back the network stage nor other shards
+    std::string  files[s_files];
+    std::string  stream;
+    for (int i = 0; i < 200; ++i) {
+        int id = i % 10 ? 1 : 0;
+        stream += (char)id;
+        stream += std::string("\0\0\x10", 3);
+        stream += std::string(16, 'x');
+        files[id] += std::string(16, 'x');
+    }
+    test_handler h;
+    h.slow_us = 20000;
+    apply_pipeline pipe(h);
+    pipe.start();
+
+    uint64_t applied[s_files] = {0};
+    feed(pipe, stream, applied);
+    std::vector<disk_completion> done;
+    for (int t = 0; t < 1000 && applied[1] < files[1].size(); ++t) {
+        done.clear();
+        pipe.poll(done);
+        for (size_t i = 0; i < done.size(); ++i)
+            applied[done[i].id] = std::max(applied[done[i].id], done[i].size);
+        usleep(1000);
+    }
+    BOOST_REQUIRE_EQUAL(files[1].size(), applied[1]);
+    BOOST_REQUIRE(applied[0] < files[0].size());
+    BOOST_REQUIRE_EQUAL(0u, pipe.stalls());
+    BOOST_REQUIRE(wait_applied(pipe, applied, files));
+    pipe.stop();
+    BOOST_REQUIRE(h.data[0] == files[0]);
+}
+
+BOOST_AUTO_TEST_CASE( test_apply_pipeline_error )
+{
+    std::string  files[s_files];
+    std::string  stream;
+    for (int i = 0; i < 4; ++i) {
+        stream += std::string("\x03\0\0\x08", 4) + "01234567";
+        files[3] += "01234567";
+    }
+    test_handler h;
+    h.fail_at = 16;
+    apply_pipeline pipe(h);
+    pipe.start();
+    uint64_t applied[s_files] = {0};
+    feed(pipe, stream, applied);
+    std::vector<disk_completion> done;
+    bool failed = false;
+    for (int t = 0; t < 1000 && !failed; ++t) {
+        try { pipe.poll(done); } catch (io_error&) { failed = true; }
+        usleep(1000);
+    }
+    BOOST_REQUIRE(failed);
+    BOOST_REQUIRE_EQUAL(16u, h.data[3].size());
+}
+
+BOOST_AUTO_TEST_CASE( test_file_apply_handler )
+{
+    srand(11);
+    std::string files[s_files];
+    std::string stream = make_stream(files, 500, 3000);
+    // Only syncs of idle shards make data durable
+    file_apply_handler::options opts;
+    opts.durability  = group_commit::BEFORE_ACK;
+    opts.sync_window = 60000000000ull;
+    opts.sync_window_bytes = 1ull << 40;
+    file_apply_handler h(2, opts);
+    apply_pipeline pipe(h);
+    pipe.start();
+
+    // The disk threads open the files of their shards
+    std::string names[s_files];
+    for (int i = 0; i < s_files; ++i) {
+        names[i] = temp_name(i);
+        disk_record r;
+        r.id     = i;
+        r.cmd    = 'S';
+        r.data   = names[i].data();
+        r.length = names[i].size();
+        pipe.submit(r);
+    }
+    uint64_t applied[s_files] = {0};
+    feed(pipe, stream, applied);
+    uint64_t durable[s_files] = {0};
+    std::vector<disk_completion> done;
+    int synced = 0, opened = 0;
+    for (int t = 0; t < 1000 && synced < s_files; ++t) {
+        done.clear();
+        pipe.poll(done);
+        for (size_t i = 0; i < done.size(); ++i) {
+            if (done[i].cmd == 'S') {
+                BOOST_REQUIRE(done[i].fd >= 0);
+                BOOST_REQUIRE_EQUAL(0u, done[i].size);
+                opened++;
+            }
+            BOOST_REQUIRE(done[i].durable <= done[i].size);
+            durable[done[i].id] = std::max(durable[done[i].id], done[i].durable);
+        }
+        for (synced = 0; synced < s_files && durable[synced] == files[synced].size(); )
+            ++synced;
+        if (synced < s_files)
+            usleep(1000);
+    }
+    BOOST_REQUIRE_EQUAL(s_files, synced);
+    BOOST_REQUIRE_EQUAL(s_files, opened);
+
+    // Holes are applied as well
+    disk_record r;
+    r.id     = 1;
+    r.cmd    = 'H';
+    r.offset = files[1].size();
+    r.length = 100;
+    pipe.submit(r);
+    files[1].append(100, '\0');
+    pipe.stop();
+    h.sync();
+    BOOST_REQUIRE(h.syncs() > 0);
+
+    for (int i = 0; i < s_files; ++i) {
+        BOOST_REQUIRE_EQUAL(files[i].size(), h.file(i)->size());
+        h.file(i)->close();
+        BOOST_REQUIRE(read_file(names[i]) == files[i]);
+        unlink(names[i].c_str());
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_pipeline_receiver )
+{
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    char seg_name[64];
+    snprintf(seg_name, sizeof(seg_name), "/replog.test.%d", getpid());
+    stats_segment seg;
+    seg.create(seg_name, "receiver", 4);
+    file_apply_handler::options opts;
+    opts.suffix = ".dst";
+    opts.stats  = &seg;
+    file_apply_handler h(2, opts);
+    apply_pipeline pipe(h);
+    pipe.start();
+    pipeline_receiver rx(fds[1], pipe, 4);
+    rx.stats(&seg);
+    pthread_t th;
+    pthread_create(&th, NULL, serve, &rx);
+
+    // Files are opened by the disk stage before their frames are accepted
+    std::string name = temp_name();
+    std::string data[2];
+    std::allocator<char> alloc;
+    for (uint32_t i = 0; i < 2; ++i) {
+        char buf[16];
+        snprintf(buf, sizeof(buf), ".%u", i);
+        send_frame(fds[0], msg_get_size::create(i, name + buf, 0, -1, 0644, alloc));
+        std::string f = recv_frame(fds[0]);
+        BOOST_REQUIRE_EQUAL(msg_base_header::GET_SIZE_RESPONSE, frame(f)->cmd());
+        BOOST_REQUIRE_EQUAL(0u, static_cast<msg_get_size_response*>(frame(f))->dst_size());
+    }
+    send_frame(fds[0], msg_get_size::create(2, "/etc/passwd", 0, -1, 0644, alloc));
+    std::string e = recv_frame(fds[0]);
+    BOOST_REQUIRE_EQUAL(msg_base_header::ERROR_RESPONSE, frame(e)->cmd());
+    send_frame(fds[0], msg_append::create(3, 0, -1, 0, 3, alloc), "abc");
+    e = recv_frame(fds[0]);
+    BOOST_REQUIRE_EQUAL(msg_base_header::ERROR_RESPONSE, frame(e)->cmd());
+
+    // Applied data is acknowledged, a gap asks for a resend
+    for (int i = 0; i < 20; ++i) {
+        std::string chunk(100 + i, 'a' + i);
+        uint32_t    id = i % 2;
+        send_frame(fds[0], msg_append::create(id, 0, -1, data[id].size(), chunk.size(), alloc),
+                   chunk);
+        data[id] += chunk;
+    }
+    send_frame(fds[0], msg_append::create(0, 0, -1, data[0].size() + 10, 3, alloc), "xyz");
+    bool resend = false;
+    uint64_t acked[2] = {0, 0};
+    while (!resend || acked[0] < data[0].size() || acked[1] < data[1].size()) {
+        std::string f = recv_frame(fds[0]);
+        if (frame(f)->cmd() == msg_base_header::RESEND_REQUEST) {
+            BOOST_REQUIRE_EQUAL(data[0].size(),
+                static_cast<msg_resend_request*>(frame(f))->dst_size());
+            resend = true;
+        } else {
+            BOOST_REQUIRE_EQUAL(msg_base_header::ACK, frame(f)->cmd());
+            acked[frame(f)->id()] = static_cast<msg_ack*>(frame(f))->dst_size();
+        }
+    }
+    shutdown(fds[0], SHUT_WR);
+    pthread_join(th, NULL);
+    pipe.stop();
+    BOOST_REQUIRE_EQUAL(20u, rx.frames());
+    BOOST_REQUIRE_EQUAL(1u, rx.dropped());
+    BOOST_REQUIRE_EQUAL(data[0].size() + data[1].size(), rx.bytes());
+
+    // Counters of the network stage
+    const stats_layout* st = seg.data();
+    BOOST_REQUIRE_EQUAL(3u,  st->frames[stats_layout::RX]['S']);
+    BOOST_REQUIRE_EQUAL(22u, st->frames[stats_layout::RX]['A']);
+    BOOST_REQUIRE_EQUAL(2u,  st->frames[stats_layout::TX]['s']);
+    BOOST_REQUIRE_EQUAL(2u,  st->frames[stats_layout::TX]['e']);
+    BOOST_REQUIRE_EQUAL(1u,  st->frames[stats_layout::TX]['r']);
+    BOOST_REQUIRE_EQUAL(sizeof(msg_resend_request), st->bytes[stats_layout::TX]['r']);
+    BOOST_REQUIRE_EQUAL(1u,  st->resends);
+    BOOST_REQUIRE_EQUAL(0u,  st->queue_depth);
+    for (uint32_t i = 0; i < 2; ++i) {
+        BOOST_REQUIRE_EQUAL(1u, seg.file(i)->active);
+        BOOST_REQUIRE_EQUAL(data[i].size(), seg.file(i)->src_size);
+        BOOST_REQUIRE_EQUAL(data[i].size(), seg.file(i)->ack_size);
+    }
+    BOOST_REQUIRE_EQUAL(1u, seg.file(0)->resends);
+
+    for (uint32_t i = 0; i < 2; ++i) {
+        char buf[16];
+        snprintf(buf, sizeof(buf), ".%u", i);
+        BOOST_REQUIRE(read_file(name + buf + ".dst") == data[i]);
+        BOOST_REQUIRE_EQUAL(data[i].size(), h.file(i)->size());
+        unlink((name + buf + ".dst").c_str());
+    }
+    close(fds[0]);
+    close(fds[1]);
+}
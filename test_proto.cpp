@@ -122,6 +122,7 @@ BOOST_AUTO_TEST_CASE( test_msg_append )
     BOOST_REQUIRE_EQUAL(msg->dst_fd(),      2);
     BOOST_REQUIRE_EQUAL(msg->src_offset(),  1234567890ull);
     BOOST_REQUIRE_EQUAL(msg->chunk_size(),  1234u);
+    BOOST_REQUIRE_EQUAL(msg->payload_size(), 1234u);
     const uint8_t expect[] = {
         0,  28 ,132,65 ,0  ,0  ,0  ,1,
         7,  91 ,205,21 ,0  ,0  ,0  ,2,
@@ -130,6 +131,27 @@ BOOST_AUTO_TEST_CASE( test_msg_append )
     };
     BOOST_REQUIRE_EQUAL(sizeof(expect), msg->header_size());
     BOOST_REQUIRE_EQUAL(0, memcmp(expect, &*msg, msg->header_size()));
+
+    BOOST_REQUIRE_THROW(msg_append::create(1, 1, 2, 0, msg_base_header::s_max_payload_size + 1, a),
+                        replog_error);
+}
+
+BOOST_AUTO_TEST_CASE( test_msg_hole )
+{
+    typedef std::allocator<char> alloc_t;
+    alloc_t a;
+
+    boost::scoped_ptr<msg_hole> msg(
+        msg_hole::create(1, 123456789u, 2, 1234567890ull, 1ull << 33, a));
+
+    BOOST_REQUIRE_EQUAL(msg->cmd(),         msg_base_header::HOLE);
+    BOOST_REQUIRE_EQUAL(msg->header_size(), (uint16_t)sizeof(msg_hole));
+    BOOST_REQUIRE_EQUAL(msg->dst_fd(),      2);
+    BOOST_REQUIRE_EQUAL(msg->src_offset(),  1234567890ull);
+    BOOST_REQUIRE_EQUAL(msg->length(),      1ull << 33);
+    BOOST_REQUIRE_EQUAL(msg->payload_size(), 0u);
+    BOOST_REQUIRE(msg_base_header::decode_header(
+        reinterpret_cast<char*>(msg.get()), msg->header_size()) == msg.get());
 }
 
 BOOST_AUTO_TEST_CASE( test_msg_resend_request )
@@ -155,6 +177,26 @@ BOOST_AUTO_TEST_CASE( test_msg_resend_request )
     BOOST_REQUIRE_EQUAL(0, memcmp(expect, &*msg, msg->header_size()));
 }
 
+BOOST_AUTO_TEST_CASE( test_msg_ack )
+{
+    typedef std::allocator<char> alloc_t;
+    alloc_t a;
+
+    boost::scoped_ptr<msg_ack> msg(msg_ack::create(1, 123456789u, 1234567890ull, a));
+
+    BOOST_REQUIRE_EQUAL(msg->cmd(),         msg_base_header::ACK);
+    BOOST_REQUIRE_EQUAL(msg->header_size(), (uint16_t)sizeof(msg_ack));
+    BOOST_REQUIRE_EQUAL(msg->dst_size(),    1234567890ull);
+    const uint8_t expect[] = {
+        0  ,20 ,132,75 ,0  ,0  ,0  ,1,
+        7  ,91 ,205,21 ,0  ,0  ,0  ,0,
+        73 ,150,2  ,210
+    };
+    BOOST_REQUIRE_EQUAL(sizeof(expect), msg->header_size());
+    BOOST_REQUIRE_EQUAL(0, memcmp(expect, &*msg, msg->header_size()));
+    BOOST_REQUIRE(msg_base_header::decode_header((char*)&*msg, sizeof(expect)) == &*msg);
+}
+
 BOOST_AUTO_TEST_CASE( test_msg_error_response )
 {
     typedef std::allocator<char> alloc_t;
@@ -181,3 +223,33 @@ BOOST_AUTO_TEST_CASE( test_msg_error_response )
     BOOST_REQUIRE_EQUAL(sizeof(expect), msg->header_size());
     BOOST_REQUIRE_EQUAL(0, memcmp(expect, &*msg, msg->header_size()));
 }
+
+BOOST_AUTO_TEST_CASE( test_msg_delta_copy )
+{
+    typedef std::allocator<char> alloc_t;
+    alloc_t a;
+
+    boost::scoped_ptr<msg_delta_copy> msg(
+        msg_delta_copy::create(1, 123456789u, 2, 1234567890ull, 4096ull, 1234u, a));
+
+    BOOST_REQUIRE_EQUAL(msg->magic(),       msg_base_header::get_magic());
+    BOOST_REQUIRE_EQUAL(msg->cmd(),         msg_base_header::DELTA_COPY);
+    BOOST_REQUIRE_EQUAL(msg->header_size(), (uint16_t)sizeof(msg_delta_copy));
+    BOOST_REQUIRE_EQUAL(msg->id(),          (uint32_t)1);
+    BOOST_REQUIRE_EQUAL(msg->name_hash(),   123456789u);
+    BOOST_REQUIRE_EQUAL(msg->dst_fd(),      2);
+    BOOST_REQUIRE_EQUAL(msg->dst_offset(),  1234567890ull);
+    BOOST_REQUIRE_EQUAL(msg->old_offset(),  4096ull);
+    BOOST_REQUIRE_EQUAL(msg->length(),      1234u);
+    const uint8_t expect[] = {
+        0,  36 ,132,67 ,0  ,0  ,0  ,1,
+        7,  91 ,205,21 ,0  ,0  ,0  ,2,
+        0,  0  ,0  ,0  ,73 ,150,2  ,210,
+        0,  0  ,0  ,0  ,0  ,0  ,16 ,0,
+        0,  0  ,4  ,210
+    };
+    BOOST_REQUIRE_EQUAL(sizeof(expect), msg->header_size());
+    BOOST_REQUIRE_EQUAL(0, memcmp(expect, &*msg, msg->header_size()));
+    BOOST_REQUIRE_EQUAL(msg.get(),
+        msg_base_header::decode_header(reinterpret_cast<char*>(msg.get()), sizeof(expect)));
+}
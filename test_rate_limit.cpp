@@ -0,0 +1,122 @@
+//----------------------------------------------------------------------------
+/// \file  test_rate_limit.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for token-bucket bandwidth shaping.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <replog/rate_limit.hpp>
+
+using namespace replog;
+
+namespace {
+    const uint64_t s_ms = 1000000;
+}
+
+BOOST_AUTO_TEST_CASE( test_token_bucket )
+{
+    token_bucket b(1000000, 10000);     // 1MB/s, 10KB burst
+    BOOST_REQUIRE_EQUAL(10000, b.tokens());
+    b.refill(1 * s_ms);
+    BOOST_REQUIRE_EQUAL(0u, b.delay());
+
+    // A chunk may overdraw the bucket, the debt delays the next one
+    b.consume(15000);
+    BOOST_REQUIRE_EQUAL(-5000, b.tokens());
+    BOOST_REQUIRE(b.delay() > 5 * s_ms && b.delay() < 5 * s_ms + 10000);
+
+    // Refills in 1us steps don't lose the fractions of a byte
+    for (uint64_t t = 1 * s_ms; t <= 3 * s_ms; t += 1000)
+        b.refill(t);
+    BOOST_REQUIRE_EQUAL(-3000, b.tokens());
+    b.refill(100 * s_ms);
+    BOOST_REQUIRE_EQUAL(10000, b.tokens());
+
+    // Sending at the rate for a second passes about a second of data
+    uint64_t sent = 0;
+    for (uint64_t t = 100 * s_ms; t < 1100 * s_ms; t += 100000) {
+        b.refill(t);
+        while (!b.delay()) {
+            b.consume(1500);
+            sent += 1500;
+        }
+    }
+    BOOST_REQUIRE(sent >= 1000000 && sent <= 1000000 + 10000 + 1500);
+
+    // Rates change at runtime, a zero rate is unlimited
+    b.rate(2000000, 5000);
+    BOOST_REQUIRE(b.tokens() <= 5000);
+    b.rate(0);
+    BOOST_REQUIRE(b.unlimited());
+    b.consume(1000000);
+    BOOST_REQUIRE_EQUAL(0u, b.delay());
+}
+
+BOOST_AUTO_TEST_CASE( test_rate_limiter )
+{
+    rate_limiter r;
+    uint64_t d;
+    BOOST_REQUIRE_EQUAL(0u, r.delay(0, 0, s_ms));
+    BOOST_REQUIRE_EQUAL(0u, r.blocked(0, s_ms, d));
+    BOOST_REQUIRE_THROW(r.delay(0, rate_limiter::s_classes, s_ms), io_error);
+
+    r.global(1000000, 100000);
+    r.file_class(1, 100000, 20000);     // Bulk catch-up
+    r.peer(1, 500000, 50000);
+    r.reserve(30000);
+    BOOST_REQUIRE_THROW(r.reserve(60000), io_error);
+
+    // The bulk class stops at its own cap
+    r.consume(0, 1, 20000);
+    BOOST_REQUIRE(r.delay(0, 1, s_ms) > 0);
+    BOOST_REQUIRE_EQUAL(0u, r.delay(0, 0, s_ms));
+    BOOST_REQUIRE_EQUAL(2u, r.blocked(0, s_ms, d));
+    BOOST_REQUIRE(d > 0 && d <= 10 * s_ms + 1);
+    BOOST_REQUIRE_EQUAL(0u, r.blocked(0, s_ms + d, d));
+
+    // A peer stops at its cap, other peers don't
+    r.consume(1, 0, 50000);
+    BOOST_REQUIRE(r.delay(1, 0, 20 * s_ms) > 0);
+    BOOST_REQUIRE_EQUAL(0u, r.delay(0, 0, 20 * s_ms));
+
+    // Bulk classes leave the reserve of the global bucket to class 0
+    r.file_class(1, 0);
+    r.consume(0, 0, r.global().tokens() - 20000);
+    BOOST_REQUIRE(r.delay(0, 1, 20 * s_ms) > 0);
+    BOOST_REQUIRE(r.delay(0, 2, 20 * s_ms) > 0);
+    BOOST_REQUIRE_EQUAL(0u, r.delay(0, 0, 20 * s_ms));
+    BOOST_REQUIRE_EQUAL(0xEu, r.blocked(0, 20 * s_ms, d));
+    BOOST_REQUIRE(d > 10 * s_ms && d < 11 * s_ms);
+
+    // The global cap applies to all
+    r.consume(0, 0, 20000);
+    BOOST_REQUIRE(r.delay(0, 0, 20 * s_ms) > 0);
+    r.global(0);
+    BOOST_REQUIRE_EQUAL(0u, r.delay(0, 1, 20 * s_ms));
+}
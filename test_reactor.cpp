@@ -0,0 +1,318 @@
+//----------------------------------------------------------------------------
+/// \file  test_reactor.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for the epoll reactor.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <replog/reactor.hpp>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+using namespace replog;
+
+namespace {
+    struct test_conn: public connection {
+        size_t      frames;
+        size_t      bytes;
+        int         heartbeats;
+        int         resends;
+        bool        closed;
+        std::string reason;
+        std::string payload;
+
+        test_conn(reactor& a_r, int a_fd)
+            : connection(a_r, a_fd), frames(0), bytes(0), heartbeats(0), resends(0)
+            , closed(false)
+        {}
+
+        void on_frame(msg_base_header* a_hdr, size_t n) {
+            frames++;
+            bytes += n;
+            if (a_hdr->cmd() != msg_base_header::APPEND)
+                return;
+            // Echo the header and the payload by reference
+            msg_append* m = static_cast<msg_append*>(a_hdr);
+            payload.assign(reinterpret_cast<char*>(m) + m->header_size(), m->chunk_size());
+            send(m, m->header_size(), payload.data(), payload.size());
+        }
+        void on_heartbeat()      { heartbeats++; }
+        void on_resend_timeout() { resends++; }
+        void on_close(const std::string& a_reason) { closed = true; reason = a_reason; }
+    };
+
+    std::string append_frame(uint32_t a_id, uint64_t a_offset, const std::string& a_data) {
+        std::allocator<char> alloc;
+        msg_append* m = msg_append::create(a_id, 1, 0, a_offset, a_data.size(), alloc);
+        std::string s(reinterpret_cast<char*>(m), m->header_size());
+        alloc.deallocate(reinterpret_cast<char*>(m), m->header_size());
+        return s + a_data;
+    }
+
+    size_t drain(int a_fd, std::string& a_out) {
+        char    buf[65536];
+        ssize_t n;
+        size_t  total = 0;
+        while ((n = recv(a_fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+            a_out.append(buf, n);
+            total += n;
+        }
+        return total;
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_reactor_frames )
+{
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+    reactor   r;
+    test_conn c(r, fds[1]);
+    r.add(c);
+
+    // Many small frames in one write and a frame larger than the buffer
+    // split across writes
+    std::string in;
+    for (int i = 0; i < 1000; ++i)
+        in += append_frame(1, i * 10, "0123456789");
+    std::string big = append_frame(2, 0, std::string(100000, 'x'));
+    std::string expect = in + big;
+    BOOST_REQUIRE_EQUAL((ssize_t)in.size(), write(fds[0], in.data(), in.size()));
+    BOOST_REQUIRE_EQUAL(30, write(fds[0], big.data(), 30));
+
+    std::string out;
+    size_t      sent = 30;
+    for (int i = 0; i < 1000 && out.size() < expect.size(); ++i) {
+        r.run_once(10);
+        // The socket buffer fills up, so input and output alternate
+        if (sent < big.size()) {
+            ssize_t n = send(fds[0], big.data() + sent, big.size() - sent, MSG_DONTWAIT);
+            if (n > 0)
+                sent += n;
+        }
+        drain(fds[0], out);
+    }
+    BOOST_REQUIRE_EQUAL(1001u, c.frames);
+    BOOST_REQUIRE_EQUAL(expect.size(), c.bytes);
+    BOOST_REQUIRE_EQUAL(0u, c.pending());
+    BOOST_REQUIRE(out == expect);
+    // Buffers grown for the large frame are released
+    BOOST_REQUIRE(!c.buffer().in.allocated());
+    BOOST_REQUIRE(!c.buffer().out.allocated());
+
+    // Peer shutdown
+    BOOST_REQUIRE(!c.closed);
+    ::close(fds[0]);
+    r.run_once(100);
+    BOOST_REQUIRE(c.closed);
+    BOOST_REQUIRE_EQUAL("Connection closed by peer", c.reason);
+    BOOST_REQUIRE(!c.is_open());
+}
+
+BOOST_AUTO_TEST_CASE( test_reactor_frame_limit )
+{
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+    reactor   r;
+    test_conn c(r, fds[1]);
+    r.add(c);
+
+    // A header announcing a 4GB chunk closes the connection before any
+    // buffer is grown for it
+    std::string f = append_frame(1, 0, "");
+    memset(&f[f.size() - 4], 0xFF, 4);
+    BOOST_REQUIRE_EQUAL((ssize_t)f.size(), write(fds[0], f.data(), f.size()));
+    for (int i = 0; i < 10 && !c.closed; ++i)
+        r.run_once(10);
+    BOOST_REQUIRE(c.closed);
+    BOOST_REQUIRE(c.reason.find("Payload too large") != std::string::npos);
+    BOOST_REQUIRE(!c.buffer().in.allocated());
+    ::close(fds[0]);
+}
+
+BOOST_AUTO_TEST_CASE( test_reactor_timers )
+{
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+    reactor   r;
+    test_conn c(r, fds[1]);
+    r.add(c);
+    c.heartbeat(2000000);
+    c.resend_after(5000000);
+
+    uint64_t start = reactor::clock_ns();
+    while (reactor::clock_ns() - start < 30000000)
+        r.run_once();
+    BOOST_REQUIRE(c.heartbeats >= 5 && c.heartbeats <= 15);
+    BOOST_REQUIRE_EQUAL(1, c.resends);
+
+    c.heartbeat(0);
+    c.resend_after(5000000);
+    c.cancel_resend();
+    BOOST_REQUIRE_EQUAL(0u, r.timers().size());
+    int hb = c.heartbeats;
+    r.run_once(10);
+    BOOST_REQUIRE_EQUAL(hb, c.heartbeats);
+
+    // A corrupt frame closes the connection
+    char junk[32] = {0, 20, 0};
+    BOOST_REQUIRE_EQUAL(32, write(fds[0], junk, sizeof(junk)));
+    r.run_once(100);
+    BOOST_REQUIRE(c.closed);
+    BOOST_REQUIRE(c.reason.find("magic") != std::string::npos);
+    ::close(fds[0]);
+}
+
+BOOST_AUTO_TEST_CASE( test_reactor_send_policy )
+{
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+    char seg_name[64];
+    snprintf(seg_name, sizeof(seg_name), "/replog.test.%d", getpid());
+    stats_segment seg;
+    seg.create(seg_name, "sender", 1);
+
+    reactor   r;
+    r.stats(&seg);
+    test_conn c(r, fds[1]);
+    r.add(c);
+    std::string frame = append_frame(1, 0, "0123456789");
+    std::string out;
+
+    // Immediate: every reply is written in the iteration it was queued
+    for (int i = 0; i < 5; ++i) {
+        BOOST_REQUIRE_EQUAL((ssize_t)frame.size(), write(fds[0], frame.data(), frame.size()));
+        r.run_once(100);
+        BOOST_REQUIRE_EQUAL(frame.size(), drain(fds[0], out));
+    }
+    BOOST_REQUIRE_EQUAL(5u, c.frames_sent());
+    BOOST_REQUIRE_EQUAL(5u, c.writes());
+
+    // Bytes: replies are held back up to the high-water mark
+    c.policy(send_policy::bytes(4 * frame.size(), 20000000));
+    for (int i = 0; i < 4; ++i) {
+        BOOST_REQUIRE_EQUAL(0u, drain(fds[0], out));
+        BOOST_REQUIRE_EQUAL((ssize_t)frame.size(), write(fds[0], frame.data(), frame.size()));
+        r.run_once(100);
+    }
+    BOOST_REQUIRE_EQUAL(4 * frame.size(), drain(fds[0], out));
+    BOOST_REQUIRE_EQUAL(6u, c.writes());
+
+    // ...and flushed by the timer when the stream goes quiet
+    BOOST_REQUIRE_EQUAL((ssize_t)frame.size(), write(fds[0], frame.data(), frame.size()));
+    r.run_once(100);
+    BOOST_REQUIRE_EQUAL(frame.size(), c.pending());
+    uint64_t start = reactor::clock_ns();
+    while (c.pending() && reactor::clock_ns() - start < 100000000)
+        r.run_once(100);
+    BOOST_REQUIRE(reactor::clock_ns() - start >= 15000000);
+    BOOST_REQUIRE_EQUAL(frame.size(), drain(fds[0], out));
+    BOOST_REQUIRE_EQUAL(7u, c.writes());
+
+    // Delay: replies queued within the delay leave in one write
+    c.policy(send_policy::delay(5000000));
+    std::string two = frame + frame;
+    BOOST_REQUIRE_EQUAL((ssize_t)two.size(), write(fds[0], two.data(), two.size()));
+    r.run_once(100);
+    BOOST_REQUIRE_EQUAL(0u, drain(fds[0], out));
+    BOOST_REQUIRE_EQUAL((ssize_t)frame.size(), write(fds[0], frame.data(), frame.size()));
+    while (c.pending())
+        r.run_once(100);
+    BOOST_REQUIRE_EQUAL(8u, c.writes());
+    BOOST_REQUIRE_EQUAL(3 * frame.size(), drain(fds[0], out));
+    BOOST_REQUIRE_EQUAL(13u, c.frames_sent());
+
+    // Both counters are published, frames with their payload
+    BOOST_REQUIRE_EQUAL(8u,  seg.data()->writes);
+    BOOST_REQUIRE_EQUAL(13u, seg.data()->frames[stats_layout::TX]['A']);
+    BOOST_REQUIRE_EQUAL(13 * frame.size(), seg.data()->bytes[stats_layout::TX]['A']);
+    BOOST_REQUIRE_EQUAL(13u, seg.data()->frames[stats_layout::RX]['A']);
+    ::close(fds[0]);
+}
+
+BOOST_AUTO_TEST_CASE( test_reactor_busy_poll )
+{
+    idle_backoff b(100);
+    b.work(1000);
+    BOOST_REQUIRE(b.polling(1050));
+    BOOST_REQUIRE(!b.polling(1100));
+    BOOST_REQUIRE(!idle_backoff().polling(0));
+
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+
+    reactor   r;
+    test_conn c(r, fds[1]);
+    r.add(c);
+    BOOST_REQUIRE(!r.polling());
+    r.run_once(0);
+    BOOST_REQUIRE_EQUAL(0u, r.polls());
+
+    // While polling, a blocking wait returns at once
+    r.busy_polling(busy_poll::spin(5000000000ull));
+    BOOST_REQUIRE(r.polling());
+    BOOST_REQUIRE_EQUAL(0, r.run_once());
+    BOOST_REQUIRE_EQUAL(1u, r.polls());
+    std::string frame = append_frame(1, 0, "0123456789");
+    std::string out;
+    BOOST_REQUIRE_EQUAL((ssize_t)frame.size(), write(fds[0], frame.data(), frame.size()));
+    for (int i = 0; i < 1000 && !c.frames; ++i)
+        r.run_once(1);
+    BOOST_REQUIRE_EQUAL(frame.size(), drain(fds[0], out));
+
+    // Once idle, the reactor blocks again
+    r.busy_polling(busy_poll::spin(1000000));
+    uint64_t start = reactor::clock_ns();
+    while (r.polling() && reactor::clock_ns() - start < 1000000000)
+        r.run_once(1);
+    BOOST_REQUIRE(!r.polling());
+    BOOST_REQUIRE(reactor::clock_ns() - start >= 1000000);
+    uint64_t polls = r.polls();
+    BOOST_REQUIRE_EQUAL(0, r.run_once(5));
+    BOOST_REQUIRE_EQUAL(polls, r.polls());
+
+    // Pin to the CPU the thread runs on, then restore the affinity
+    cpu_set_t saved;
+    BOOST_REQUIRE_EQUAL(0, pthread_getaffinity_np(pthread_self(), sizeof(saved), &saved));
+    int cpu = sched_getcpu();
+    BOOST_REQUIRE(cpu >= 0);
+    busy_poll::pin(cpu);
+    cpu_set_t set;
+    BOOST_REQUIRE_EQUAL(0, pthread_getaffinity_np(pthread_self(), sizeof(set), &set));
+    BOOST_REQUIRE_EQUAL(1, CPU_COUNT(&set));
+    BOOST_REQUIRE(CPU_ISSET(cpu, &set));
+    BOOST_REQUIRE_EQUAL(0, pthread_setaffinity_np(pthread_self(), sizeof(saved), &saved));
+    ::close(fds[0]);
+}
@@ -0,0 +1,140 @@
+//----------------------------------------------------------------------------
+/// \file  test_record_index.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for the record index.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <replog/record_index.hpp>
+#include <replog/test_util.hpp>
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace replog;
+using namespace replog::test;
+
+namespace {
+    uint64_t parse_ts(const char* a_rec, size_t n) {
+        return strtoull(std::string(a_rec, std::min<size_t>(n, 10)).c_str(), NULL, 10);
+    }
+
+    /// Build a file of records "<ts> <payload>\n" with timestamps 10*i
+    std::string make_data(size_t a_records, std::vector<uint64_t>& a_offsets) {
+        std::string s;
+        srand(3);
+        for (size_t i = 0; i < a_records; ++i) {
+            char buf[32];
+            snprintf(buf, sizeof(buf), "%010llu ", (unsigned long long)i * 10);
+            a_offsets.push_back(s.size());
+            s += buf;
+            s += std::string(rand() % 200, 'a' + i % 26);
+            s += '\n';
+        }
+        return s;
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_record_boundary )
+{
+    BOOST_REQUIRE_EQUAL(0u, record_boundary("abc", 3));
+    BOOST_REQUIRE_EQUAL(4u, record_boundary("abc\nde", 6));
+    BOOST_REQUIRE_EQUAL(7u, record_boundary("abc\nde\n", 7));
+    BOOST_REQUIRE_EQUAL(2u, record_boundary("a|bc", 4, '|'));
+}
+
+BOOST_AUTO_TEST_CASE( test_record_index )
+{
+    std::vector<uint64_t> offsets;
+    std::string data = make_data(5000, offsets);
+    std::string name = temp_name();
+    int fd = ::open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    BOOST_REQUIRE(fd >= 0);
+    unlink((name + ".idx").c_str());
+
+    record_index idx(64, '\n', parse_ts);
+    idx.open(name);
+    BOOST_REQUIRE_EQUAL(0u, idx.records());
+
+    // Appends of random sizes splitting records anywhere
+    for (size_t off = 0; off < data.size(); ) {
+        size_t n = std::min<size_t>(1 + rand() % 3000, data.size() - off);
+        BOOST_REQUIRE_EQUAL((ssize_t)n, pwrite(fd, data.data() + off, n, off));
+        idx.append(data.data() + off, n, off);
+        off += n;
+    }
+    BOOST_REQUIRE_THROW(idx.append("x", 1, 0), io_error);
+    BOOST_REQUIRE_EQUAL(5000u, idx.records());
+    BOOST_REQUIRE_EQUAL((5000u + 63) / 64, idx.entries().size());
+    for (size_t i = 0; i < idx.entries().size(); ++i) {
+        const record_index::entry& e = idx.entries()[i];
+        BOOST_REQUIRE_EQUAL(i * 64, e.record);
+        BOOST_REQUIRE_EQUAL(i * 640, e.timestamp);
+        BOOST_REQUIRE_EQUAL(offsets[i * 64], e.offset);
+    }
+
+    for (int pass = 0; pass < 2; ++pass) {
+        // Seek by record number, e.g. for the last 10 records
+        for (size_t r = 0; r < 5000; r += 37)
+            BOOST_REQUIRE_EQUAL(offsets[r], idx.offset_of(fd, r));
+        BOOST_REQUIRE_EQUAL(offsets[4990], idx.offset_of(fd, idx.records() - 10));
+        BOOST_REQUIRE_EQUAL(data.size(), idx.offset_of(fd, 5000));
+
+        // Seek by time
+        BOOST_REQUIRE_EQUAL(0u, idx.offset_at(fd, 0));
+        BOOST_REQUIRE_EQUAL(offsets[100], idx.offset_at(fd, 1000));
+        BOOST_REQUIRE_EQUAL(offsets[101], idx.offset_at(fd, 1001));
+        BOOST_REQUIRE_EQUAL(offsets[4999], idx.offset_at(fd, 49990));
+        BOOST_REQUIRE_EQUAL(data.size(), idx.offset_at(fd, 49991));
+        BOOST_REQUIRE_EQUAL(64u, idx.find_time(1000).record);
+
+        // Reload the index from the sidecar file
+        record_index idx2(64, '\n', parse_ts);
+        idx2.open(name);
+        BOOST_REQUIRE_EQUAL(idx.records(), idx2.records());
+        BOOST_REQUIRE_EQUAL(idx.size(), idx2.size());
+        BOOST_REQUIRE_EQUAL(idx.entries().size(), idx2.entries().size());
+        idx.open(name);
+    }
+
+    // A truncated data file drops the entries past its end
+    BOOST_REQUIRE_EQUAL(0, ftruncate(fd, offsets[1000] + 5));
+    idx.open(name);
+    BOOST_REQUIRE_EQUAL(1000u, idx.records());
+    BOOST_REQUIRE_EQUAL(offsets[1000] + 5, idx.size());
+    BOOST_REQUIRE_EQUAL((1000u + 63) / 64, idx.entries().size());
+    BOOST_REQUIRE_EQUAL(offsets[999], idx.offset_of(fd, 999));
+    idx.append(data.data() + offsets[1000] + 5, data.size() - offsets[1000] - 5, idx.size());
+    BOOST_REQUIRE_EQUAL(5000u, idx.records());
+
+    ::close(fd);
+    unlink(name.c_str());
+    unlink((name + ".idx").c_str());
+}
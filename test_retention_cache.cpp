@@ -0,0 +1,103 @@
+//----------------------------------------------------------------------------
+/// \file  test_retention_cache.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for the sender retention cache.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <replog/retention_cache.hpp>
+#include <replog/test_util.hpp>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace replog;
+using namespace replog::test;
+
+BOOST_AUTO_TEST_CASE( test_retention_cache )
+{
+    // The file holds the data, the cache only some of it
+    std::string data;
+    for (int i = 0; i < 1000; ++i)
+        data += (char)('a' + i % 26);
+    std::string name = temp_name();
+    int fd = ::open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    BOOST_REQUIRE(fd >= 0);
+    BOOST_REQUIRE_EQUAL((ssize_t)data.size(), write(fd, data.data(), data.size()));
+
+    retention_cache c(400, 50);
+    for (int off = 0; off < 1000; off += 100)
+        c.insert(0, off, data.data() + off, 100);
+    // Only the last 400 bytes fit
+    BOOST_REQUIRE_EQUAL(400u, c.size());
+    BOOST_REQUIRE_EQUAL(4u, c.chunks());
+
+    char buf[1000];
+    BOOST_REQUIRE_EQUAL(300u, c.read(0, 650, buf, 300, fd));
+    BOOST_REQUIRE(std::string(buf, 300) == data.substr(650, 300));
+    BOOST_REQUIRE_EQUAL(300u, c.hit_bytes());
+    BOOST_REQUIRE_EQUAL(0u, c.miss_bytes());
+
+    // Missing ranges come from the file, reads stop at end of file
+    BOOST_REQUIRE_EQUAL(500u, c.read(0, 500, buf, 600, fd));
+    BOOST_REQUIRE(std::string(buf, 500) == data.substr(500));
+    BOOST_REQUIRE_EQUAL(100u, c.miss_bytes());
+    BOOST_REQUIRE_EQUAL(700u, c.hit_bytes());
+
+    // Chunks that were read back survive new chunks: 600-800 are
+    // protected (the last two hit), 800-1000 are evicted first
+    c.read(0, 600, buf, 200, fd);
+    c.insert(1, 0, data.data(), 100);
+    c.insert(1, 100, data.data() + 100, 100);
+    BOOST_REQUIRE_EQUAL(400u, c.size());
+    uint64_t miss = c.miss_bytes();
+    c.read(0, 600, buf, 200, fd);
+    BOOST_REQUIRE_EQUAL(miss, c.miss_bytes());
+    c.read(0, 800, buf, 200, fd);
+    BOOST_REQUIRE_EQUAL(miss + 200, c.miss_bytes());
+
+    // Overlapping inserts replace cached data
+    c.insert(1, 50, "XYZ", 3);
+    BOOST_REQUIRE_EQUAL(303u, c.size());
+    BOOST_REQUIRE_EQUAL(203u, c.read(1, 50, buf, 203, fd));
+    BOOST_REQUIRE_EQUAL(std::string("XYZ"), std::string(buf, 3));
+    BOOST_REQUIRE(std::string(buf + 3, 200) == data.substr(53, 200));
+
+    // Acknowledged data is released
+    c.release(0, 700);
+    BOOST_REQUIRE_EQUAL(203u, c.size());
+    c.remove(1);
+    BOOST_REQUIRE_EQUAL(100u, c.size());
+    c.budget(0);
+    BOOST_REQUIRE_EQUAL(0u, c.size());
+    BOOST_REQUIRE_EQUAL(0u, c.chunks());
+
+    ::close(fd);
+    unlink(name.c_str());
+}
@@ -0,0 +1,103 @@
+//----------------------------------------------------------------------------
+/// \file  test_scheduler.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for the stream scheduler.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <replog/scheduler.hpp>
+
+using namespace replog;
+
+BOOST_AUTO_TEST_CASE( test_scheduler_weights )
+{
+    stream_scheduler s(1000);
+    s.add(0, 0, 3);
+    s.add(1, 0, 1);
+    s.add(2, 0, 1);
+    BOOST_REQUIRE_EQUAL(-1, s.next());
+    BOOST_REQUIRE(s.empty());
+
+    // Always backlogged streams sending 700-byte chunks share the
+    // connection 3:1:1 even though chunks don't divide the quantum
+    s.activate(0); s.activate(1); s.activate(2);
+    uint64_t bytes[3] = {0, 0, 0};
+    for (int i = 0; i < 5000; ++i) {
+        int id = s.next();
+        BOOST_REQUIRE(id >= 0 && id < 3);
+        bytes[id] += 700;
+        s.sent(id, 700, true);
+    }
+    double r01 = (double)bytes[0] / bytes[1], r12 = (double)bytes[1] / bytes[2];
+    BOOST_REQUIRE(r01 > 2.9 && r01 < 3.1);
+    BOOST_REQUIRE(r12 > 0.95 && r12 < 1.05);
+
+    // A stream going idle leaves the rotation
+    s.sent(s.next(), 0, false);
+    s.sent(s.next(), 0, false);
+    s.sent(s.next(), 0, false);
+    BOOST_REQUIRE(s.empty());
+}
+
+BOOST_AUTO_TEST_CASE( test_scheduler_priority )
+{
+    stream_scheduler s(1000);
+    s.add(5, 1);    // bulk resync
+    s.add(2, 0);    // audit log
+    s.activate(5);
+    BOOST_REQUIRE_EQUAL(5, s.next());
+    BOOST_REQUIRE_EQUAL(1000u, s.budget(5));
+    s.sent(5, 64 * 1024, true);
+
+    // The hot stream overtakes the bulk one as soon as it has data
+    s.activate(2);
+    BOOST_REQUIRE(s.active(2));
+    for (int i = 0; i < 10; ++i) {
+        BOOST_REQUIRE_EQUAL(2, s.next());
+        s.sent(2, 100, true);
+    }
+    s.sent(2, 100, false);
+    BOOST_REQUIRE(!s.active(2));
+
+    // A blocked class is skipped, e.g. when it's over its rate
+    s.activate(2);
+    BOOST_REQUIRE_EQUAL(5, s.next(1u << 0));
+    BOOST_REQUIRE_EQUAL(-1, s.next((1u << 0) | (1u << 1)));
+    BOOST_REQUIRE_EQUAL(2, s.next());
+    s.sent(2, 0, false);
+
+    // The bulk stream pays back its overdraft before its next chunk
+    BOOST_REQUIRE_EQUAL(5, s.next());
+    BOOST_REQUIRE(s.budget(5) > 0 && s.budget(5) <= 1000);
+
+    s.remove(5);
+    BOOST_REQUIRE(!s.exists(5));
+    BOOST_REQUIRE_EQUAL(-1, s.next());
+    BOOST_REQUIRE_THROW(s.add(1, stream_scheduler::s_classes), io_error);
+}
@@ -0,0 +1,210 @@
+//----------------------------------------------------------------------------
+/// \file  test_schema.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for the compile-time message schema.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <boost/smart_ptr.hpp>
+#include <replog/schema.hpp>
+
+using namespace replog;
+using namespace replog::schema;
+
+BOOST_AUTO_TEST_CASE( test_schema_layout )
+{
+    typedef wire::append                append;
+    typedef append::field_list          list;
+    typedef field_of<list, tag::dst_fd>     dst_fd;
+    typedef field_of<list, tag::src_offset> src_offset;
+    typedef field_of<list, tag::chunk_size> chunk_size;
+    BOOST_REQUIRE_EQUAL(0u,  (size_t)dst_fd::offset);
+    BOOST_REQUIRE_EQUAL(4u,  (size_t)src_offset::offset);
+    BOOST_REQUIRE_EQUAL(12u, (size_t)chunk_size::offset);
+    BOOST_REQUIRE_EQUAL(28u, append::s_size);
+    BOOST_REQUIRE_EQUAL(28u, sizeof(append));
+}
+
+BOOST_AUTO_TEST_CASE( test_schema_big_endian )
+{
+    std::allocator<char> a;
+    boost::scoped_ptr<msg_append> msg(
+        msg_append::create(1, 123456789u, 2, 1234567890ull, 1234u, a));
+
+    char buf[wire::append::s_size];
+    wire::append* p = wire::append::init(buf, 1, 123456789u);
+    p->set<tag::dst_fd>(2);
+    p->set<tag::src_offset>(1234567890ull);
+    p->set<tag::chunk_size>(1234u);
+    BOOST_REQUIRE_EQUAL(0, memcmp(buf, &*msg, sizeof(buf)));
+
+    wire::append* q = wire::append::cast(reinterpret_cast<char*>(msg.get()), sizeof(msg_append));
+    BOOST_REQUIRE_EQUAL(q->header_size(),             (uint16_t)sizeof(msg_append));
+    BOOST_REQUIRE_EQUAL(q->id(),                      1u);
+    BOOST_REQUIRE_EQUAL(q->name_hash(),               123456789u);
+    BOOST_REQUIRE_EQUAL(q->get<tag::dst_fd>(),        2);
+    BOOST_REQUIRE_EQUAL(q->get<tag::src_offset>(),    1234567890ull);
+    BOOST_REQUIRE_EQUAL(q->get<tag::chunk_size>(),    1234u);
+
+    BOOST_REQUIRE_THROW(wire::append::cast(buf, 10), replog_error);
+    BOOST_REQUIRE_THROW(wire::get_size_response::cast(buf, sizeof(buf)), replog_error);
+}
+
+BOOST_AUTO_TEST_CASE( test_schema_tail )
+{
+    std::allocator<char> a;
+    const std::string filename("test.log");
+    boost::scoped_ptr<msg_get_size> msg(
+        msg_get_size::create(1, filename, 1234567890ull, 2, 660, a));
+
+    char buf[64];
+    wire::get_size* p = wire::get_size::init(buf, 1, strhash(filename), filename.size() + 1);
+    p->set<tag::mode>(660);
+    p->set<tag::src_fd>(2);
+    p->set<tag::src_size>(1234567890ull);
+    strcpy(p->tail(), filename.c_str());
+    BOOST_REQUIRE_EQUAL(msg->header_size(), p->header_size());
+    BOOST_REQUIRE_EQUAL(filename.size() + 1, p->tail_size());
+    BOOST_REQUIRE_EQUAL(0, memcmp(buf, &*msg, msg->header_size()));
+
+    BOOST_REQUIRE_THROW(wire::get_size::init(buf, 1, 0, 0x10000), replog_error);
+    BOOST_REQUIRE_THROW(msg_get_size::create(1, std::string(0x10000, 'x'), 0, 0, 0, a),
+                        replog_error);
+}
+
+namespace {
+    /// View hand-written message \a a_msg through schema \a Msg.
+    template <class Msg, class Proto>
+    const Msg* as_schema(Proto* a_msg) {
+        const Msg* p = Msg::cast(reinterpret_cast<char*>(a_msg), a_msg->header_size());
+        BOOST_REQUIRE_EQUAL(a_msg->header_size(), p->header_size());
+        BOOST_REQUIRE_EQUAL(a_msg->id(),          p->id());
+        BOOST_REQUIRE_EQUAL(a_msg->name_hash(),   p->name_hash());
+        return p;
+    }
+
+    // Values with distinct bytes, so that fields at a wrong offset or of a
+    // wrong size read back something else
+    const uint64_t s_u64 = 0x0102030405060708ull;
+    const uint64_t s_v64 = 0x1112131415161718ull;
+    const uint32_t s_u32 = 0x21222324u;
+    const int32_t  s_i32 = 0x31323334;
+}
+
+BOOST_AUTO_TEST_CASE( test_schema_fields )
+{
+    // Every field of every schema reads the bytes of the accessor of the
+    // hand-written class
+    std::allocator<char> a;
+    {
+        boost::scoped_ptr<msg_get_size> m(msg_get_size::create(1, "f", s_u64, s_i32, 0755, a));
+        const wire::get_size* p = as_schema<wire::get_size>(m.get());
+        BOOST_REQUIRE_EQUAL((uint32_t)m->mode(), p->get<tag::mode>());
+        BOOST_REQUIRE_EQUAL(m->src_fd(),         p->get<tag::src_fd>());
+        BOOST_REQUIRE_EQUAL(m->src_size(),       p->get<tag::src_size>());
+        BOOST_REQUIRE_EQUAL(0, strcmp(m->name(), p->tail()));
+    }
+    {
+        boost::scoped_ptr<msg_get_size_response> m(
+            msg_get_size_response::create(2, s_u32, s_i32, s_u64, a));
+        const wire::get_size_response* p = as_schema<wire::get_size_response>(m.get());
+        BOOST_REQUIRE_EQUAL(m->dst_fd(),   p->get<tag::dst_fd>());
+        BOOST_REQUIRE_EQUAL(m->dst_size(), p->get<tag::dst_size>());
+    }
+    {
+        boost::scoped_ptr<msg_append> m(msg_append::create(3, s_u32, s_i32, s_u64, 0x4142, a));
+        const wire::append* p = as_schema<wire::append>(m.get());
+        BOOST_REQUIRE_EQUAL(m->dst_fd(),     p->get<tag::dst_fd>());
+        BOOST_REQUIRE_EQUAL(m->src_offset(), p->get<tag::src_offset>());
+        BOOST_REQUIRE_EQUAL(m->chunk_size(), p->get<tag::chunk_size>());
+    }
+    {
+        boost::scoped_ptr<msg_hole> m(msg_hole::create(4, s_u32, s_i32, s_u64, s_v64, a));
+        const wire::hole* p = as_schema<wire::hole>(m.get());
+        BOOST_REQUIRE_EQUAL(m->dst_fd(),     p->get<tag::dst_fd>());
+        BOOST_REQUIRE_EQUAL(m->src_offset(), p->get<tag::src_offset>());
+        BOOST_REQUIRE_EQUAL(m->length(),     p->get<tag::length>());
+    }
+    {
+        boost::scoped_ptr<msg_resend_request> m(msg_resend_request::create(5, s_u32, s_u64, a));
+        const wire::resend_request* p = as_schema<wire::resend_request>(m.get());
+        BOOST_REQUIRE_EQUAL(m->dst_size(), p->get<tag::dst_size>());
+    }
+    {
+        boost::scoped_ptr<msg_ack> m(msg_ack::create(6, s_u32, s_u64, a));
+        const wire::ack* p = as_schema<wire::ack>(m.get());
+        BOOST_REQUIRE_EQUAL(m->dst_size(), p->get<tag::dst_size>());
+    }
+    {
+        boost::scoped_ptr<msg_error_response> m(
+            msg_error_response::create(7, s_u32, msg_base_header::APPEND, "oops", a));
+        const wire::error_response* p = as_schema<wire::error_response>(m.get());
+        BOOST_REQUIRE_EQUAL((uint8_t)m->last_cmd(), p->get<tag::last_cmd>());
+        BOOST_REQUIRE_EQUAL(0, strcmp(m->error(), p->tail()));
+    }
+    {
+        boost::scoped_ptr<msg_delta_request> m(
+            msg_delta_request::create(8, s_u32, s_i32, s_u64, 0x41424344u, a));
+        const wire::delta_request* p = as_schema<wire::delta_request>(m.get());
+        BOOST_REQUIRE_EQUAL(m->dst_fd(),     p->get<tag::dst_fd>());
+        BOOST_REQUIRE_EQUAL(m->src_size(),   p->get<tag::src_size>());
+        BOOST_REQUIRE_EQUAL(m->block_size(), p->get<tag::block_size>());
+    }
+    {
+        boost::scoped_ptr<msg_delta_signatures> m(
+            msg_delta_signatures::create(9, s_u32, s_u64, 0x41424344u, 0x51525354u, 0x1000, a));
+        const wire::delta_signatures* p = as_schema<wire::delta_signatures>(m.get());
+        BOOST_REQUIRE_EQUAL(m->dst_size(),    p->get<tag::dst_size>());
+        BOOST_REQUIRE_EQUAL(m->block_size(),  p->get<tag::block_size>());
+        BOOST_REQUIRE_EQUAL(m->first_block(), p->get<tag::first_block>());
+        BOOST_REQUIRE_EQUAL(m->count(),       p->get<tag::count>());
+    }
+    {
+        boost::scoped_ptr<msg_delta_copy> m(
+            msg_delta_copy::create(10, s_u32, s_i32, s_u64, s_v64, 0x41424344u, a));
+        const wire::delta_copy* p = as_schema<wire::delta_copy>(m.get());
+        BOOST_REQUIRE_EQUAL(m->dst_fd(),     p->get<tag::dst_fd>());
+        BOOST_REQUIRE_EQUAL(m->dst_offset(), p->get<tag::dst_offset>());
+        BOOST_REQUIRE_EQUAL(m->old_offset(), p->get<tag::old_offset>());
+        BOOST_REQUIRE_EQUAL(m->length(),     p->get<tag::length>());
+    }
+    {
+        boost::scoped_ptr<msg_delta_done> m(
+            msg_delta_done::create(11, s_u32, s_i32, s_u64, s_v64, a));
+        const wire::delta_done* p = as_schema<wire::delta_done>(m.get());
+        BOOST_REQUIRE_EQUAL(m->dst_fd(),   p->get<tag::dst_fd>());
+        BOOST_REQUIRE_EQUAL(m->src_size(), p->get<tag::src_size>());
+        BOOST_REQUIRE_EQUAL(m->checksum(), p->get<tag::checksum>());
+    }
+    {
+        boost::scoped_ptr<msg_hello> m(msg_hello::create(s_u32, a));
+        const wire::hello* p = as_schema<wire::hello>(m.get());
+        BOOST_REQUIRE_EQUAL(m->version(), p->get<tag::version>());
+    }
+}
@@ -0,0 +1,833 @@
+//----------------------------------------------------------------------------
+/// \file  test_session.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for coroutine replication sessions.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <replog/session.hpp>
+#include <replog/delta.hpp>
+#include <replog/shm_transport.hpp>
+#include <replog/test_util.hpp>
+#include <algorithm>
+#include <stdio.h>
+#include <unistd.h>
+#include <glob.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+using namespace replog;
+using namespace replog::test;
+
+namespace {
+    std::allocator<char> s_alloc;
+
+    template <class Msg>
+    std::string frame(Msg* a_msg, const std::string& a_payload = std::string()) {
+        std::string s(reinterpret_cast<char*>(a_msg), a_msg->header_size());
+        s_alloc.deallocate(reinterpret_cast<char*>(a_msg), a_msg->header_size());
+        return s + a_payload;
+    }
+
+    std::string get_size(uint32_t a_id, const std::string& a_name) {
+        return frame(msg_get_size::create(a_id, a_name, 0, 3, 0644, s_alloc));
+    }
+
+    std::string append(uint32_t a_id, const std::string& a_name, uint64_t a_offset,
+                       const std::string& a_data) {
+        return frame(msg_append::create(a_id, strhash(a_name), 0, a_offset, a_data.size(),
+                                        s_alloc), a_data);
+    }
+
+    std::string hole(uint32_t a_id, const std::string& a_name, uint64_t a_offset,
+                     uint64_t a_length) {
+        return frame(msg_hole::create(a_id, strhash(a_name), 0, a_offset, a_length, s_alloc));
+    }
+
+    struct peer {
+        int         fd;
+        reactor&    r;
+        std::string in;
+
+        peer(reactor& a_r, int a_fd) : fd(a_fd), r(a_r) {}
+
+        void send(const std::string& a_data) {
+            BOOST_REQUIRE_EQUAL((ssize_t)a_data.size(), write(fd, a_data.data(), a_data.size()));
+        }
+
+        /// Run the reactor until a frame arrives, return its command.
+        char recv(std::string& a_frame, int a_timeout_ms = 1000) {
+            uint64_t deadline = reactor::clock_ns() + a_timeout_ms * 1000000ull;
+            for (;;) {
+                char    buf[4096];
+                ssize_t n;
+                while ((n = ::recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+                    in.append(buf, n);
+                if (in.size() >= sizeof(msg_base_header)) {
+                    msg_base_header* h =
+                        msg_base_header::decode_header(&in[0], in.size());
+                    size_t len = h->header_size();
+                    if (in.size() >= len)
+                        len += h->payload_size();
+                    if (in.size() >= len) {
+                        a_frame = in.substr(0, len);
+                        in.erase(0, len);
+                        return a_frame[3];
+                    }
+                }
+                if (reactor::clock_ns() > deadline)
+                    return 0;
+                r.run_once(10);
+            }
+        }
+
+        template <class Msg>
+        Msg* recv_msg(std::string& a_frame) {
+            return reinterpret_cast<Msg*>(&a_frame[0]);
+        }
+    };
+
+    /// Output of a delta_sender.
+    struct frame_buf {
+        std::string out;
+        size_t      mark;
+
+        frame_buf() : mark(0) {}
+        char*  reserve(size_t n) { mark = out.size(); out.resize(mark + n); return &out[mark]; }
+        void   commit(size_t n)  { out.resize(mark + n); }
+        size_t pending() const   { return out.size(); }
+    };
+
+    /// Append \a a_data to file \a a_name.
+    void append_file(const std::string& a_name, const std::string& a_data) {
+        FILE* f = fopen(a_name.c_str(), "a");
+        BOOST_REQUIRE(f);
+        BOOST_REQUIRE_EQUAL(a_data.size(), fwrite(a_data.data(), 1, a_data.size(), f));
+        fclose(f);
+    }
+
+    /// True if files named \a a_prefix followed by anything exist.
+    bool temp_files(const std::string& a_prefix) {
+        glob_t g;
+        bool found = glob((a_prefix + "*").c_str(), 0, NULL, &g) == 0 && g.gl_pathc > 0;
+        globfree(&g);
+        return found;
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_receiver_session_recovery )
+{
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    std::string name = temp_name();
+    unlink((name + ".dst").c_str());
+
+    reactor r;
+    receiver_session::options opts;
+    opts.suffix         = ".dst";
+    opts.resend_timeout = 20000000;
+    opts.max_resends    = 2;
+    receiver_session s(r, fds[1], opts);
+    r.add(s);
+    s.start();
+    peer p(r, fds[0]);
+    std::string f;
+
+    // Anything before the handshake is rejected
+    p.send(append(1, name, 0, "0123456789"));
+    BOOST_REQUIRE_EQUAL(msg_base_header::ERROR_RESPONSE, p.recv(f));
+    BOOST_REQUIRE_EQUAL(std::string("Expected GET_SIZE"),
+                        p.recv_msg<msg_error_response>(f)->error());
+
+    p.send(get_size(1, name));
+    BOOST_REQUIRE_EQUAL(msg_base_header::GET_SIZE_RESPONSE, p.recv(f));
+    BOOST_REQUIRE_EQUAL(0u, p.recv_msg<msg_get_size_response>(f)->dst_size());
+
+    p.send(append(1, name, 0, "0123456789"));
+    BOOST_REQUIRE_EQUAL(msg_base_header::ACK, p.recv(f));
+    BOOST_REQUIRE_EQUAL(10u, p.recv_msg<msg_ack>(f)->dst_size());
+
+    // A gap triggers a resend request; appends in flight are dropped
+    p.send(append(1, name, 20, "klmnopqrst") + append(1, name, 30, "uvwxyz"));
+    BOOST_REQUIRE_EQUAL(msg_base_header::RESEND_REQUEST, p.recv(f));
+    BOOST_REQUIRE_EQUAL(10u, p.recv_msg<msg_resend_request>(f)->dst_size());
+
+    // Overlapping resend is trimmed
+    p.send(append(1, name, 5, "56789abcdefghij"));
+    BOOST_REQUIRE_EQUAL(msg_base_header::ACK, p.recv(f));
+    BOOST_REQUIRE_EQUAL(20u, p.recv_msg<msg_ack>(f)->dst_size());
+    BOOST_REQUIRE_EQUAL(0, p.recv(f, 50));     // Recovered: no more requests
+
+    // Unsupported commands get an error but don't end the session
+    p.send(frame(msg_ack::create(1, 2, 3, s_alloc)));
+    BOOST_REQUIRE_EQUAL(msg_base_header::ERROR_RESPONSE, p.recv(f));
+    BOOST_REQUIRE_EQUAL(msg_base_header::ACK, p.recv_msg<msg_error_response>(f)->last_cmd());
+
+    // Unanswered resend requests are repeated, then the session gives up
+    p.send(append(1, name, 30, "uvwxyz"));
+    BOOST_REQUIRE_EQUAL(msg_base_header::RESEND_REQUEST, p.recv(f));
+    BOOST_REQUIRE_EQUAL(msg_base_header::RESEND_REQUEST, p.recv(f));
+    BOOST_REQUIRE_EQUAL(20u, p.recv_msg<msg_resend_request>(f)->dst_size());
+    BOOST_REQUIRE_EQUAL(msg_base_header::RESEND_REQUEST, p.recv(f));
+    BOOST_REQUIRE_EQUAL(0, p.recv(f, 100));
+    BOOST_REQUIRE(!s.is_open());
+
+    BOOST_REQUIRE_EQUAL("0123456789abcdefghij", read_file(name + ".dst"));
+    unlink((name + ".dst").c_str());
+    ::close(fds[0]);
+}
+
+BOOST_AUTO_TEST_CASE( test_receiver_session_v2 )
+{
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    std::string name = temp_name();
+
+    reactor r;
+    receiver_session::options opts;
+    opts.suffix = ".dst";
+    receiver_session s(r, fds[1], opts);
+    r.add(s);
+    s.start();
+    peer p(r, fds[0]);
+    std::string f;
+
+    // A newer peer gets the highest version the session supports
+    p.send(frame(msg_hello::create(7, s_alloc)));
+    BOOST_REQUIRE_EQUAL(msg_base_header::HELLO, p.recv(f));
+    BOOST_REQUIRE_EQUAL((uint32_t)WIRE_V2, p.recv_msg<msg_hello>(f)->version());
+    BOOST_REQUIRE_EQUAL(WIRE_V2, s.input_version());
+
+    // Other messages come after a version 2 prefix
+    codec_v2    enc;
+    char        buf[codec_v2::s_max_append_header];
+    std::string m = get_size(1, name);
+    p.send(std::string(buf, codec_v2::encode_prefix(
+        buf, reinterpret_cast<msg_base_header*>(&m[0]))) + m);
+    BOOST_REQUIRE_EQUAL(msg_base_header::GET_SIZE_RESPONSE, p.recv(f));
+
+    // Appends of any size arrive as msg_append, also when split
+    std::string data, out;
+    for (int i = 0; i < 50; ++i) {
+        std::string chunk(i == 25 ? 40000 : 1 + i, 'a' + i % 26);
+        out.append(buf, enc.encode_append(buf, 1, data.size(), chunk.size()));
+        out += chunk;
+        data += chunk;
+    }
+    p.send(out.substr(0, 1000));
+    p.send(out.substr(1000));
+    uint64_t acked = 0;
+    while (acked < data.size()) {
+        BOOST_REQUIRE_EQUAL(msg_base_header::ACK, p.recv(f));
+        acked = p.recv_msg<msg_ack>(f)->dst_size();
+    }
+
+    // Offsets are sent as deltas, so gaps are still detected
+    p.send(std::string(buf, enc.encode_append(buf, 1, data.size() + 10, 3)) + "xyz");
+    BOOST_REQUIRE_EQUAL(msg_base_header::RESEND_REQUEST, p.recv(f));
+    BOOST_REQUIRE_EQUAL(data.size(), p.recv_msg<msg_resend_request>(f)->dst_size());
+    BOOST_REQUIRE(s.is_open());
+    BOOST_REQUIRE(data == read_file(name + ".dst"));
+    unlink((name + ".dst").c_str());
+    ::close(fds[0]);
+}
+
+BOOST_AUTO_TEST_CASE( test_receiver_session_hole )
+{
+    std::string name = temp_name();
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    reactor r;
+    receiver_session::options opts;
+    opts.suffix         = ".dst";
+    opts.index_interval = 1;
+    receiver_session s(r, fds[1], opts);
+    r.add(s);
+    s.start();
+    peer p(r, fds[0]);
+    std::string f;
+
+    const uint64_t len = 4 * 1024 * 1024;
+    p.send(get_size(0, name) + append(0, name, 0, "ab\n") + hole(0, name, 3, len));
+    BOOST_REQUIRE_EQUAL(msg_base_header::GET_SIZE_RESPONSE, p.recv(f));
+    BOOST_REQUIRE_EQUAL(msg_base_header::ACK, p.recv(f));
+    BOOST_REQUIRE_EQUAL(msg_base_header::ACK, p.recv(f));
+    BOOST_REQUIRE_EQUAL(3 + len, p.recv_msg<msg_ack>(f)->dst_size());
+
+    // A duplicate hole is ignored, one past the end requests a resend
+    p.send(hole(0, name, 3, len) + hole(0, name, 4 + len, 1));
+    BOOST_REQUIRE_EQUAL(msg_base_header::RESEND_REQUEST, p.recv(f));
+    BOOST_REQUIRE_EQUAL(3 + len, p.recv_msg<msg_resend_request>(f)->dst_size());
+    p.send(append(0, name, 3 + len, "cd\n"));
+    BOOST_REQUIRE_EQUAL(msg_base_header::ACK, p.recv(f));
+    BOOST_REQUIRE_EQUAL(6 + len, p.recv_msg<msg_ack>(f)->dst_size());
+    // The hole extends the second record
+    BOOST_REQUIRE_EQUAL(2u, s.index(0)->records());
+    BOOST_REQUIRE_EQUAL(3u, s.index(0)->entries()[1].offset);
+
+    ::close(fds[0]);
+    r.run_once(100);
+    BOOST_REQUIRE(!s.is_open());
+    struct stat st;
+    BOOST_REQUIRE_EQUAL(0, stat((name + ".dst").c_str(), &st));
+    BOOST_REQUIRE(st.st_blocks * 512ull < len);
+    BOOST_REQUIRE("ab\n" + std::string(len, '\0') + "cd\n" == read_file(name + ".dst"));
+    unlink((name + ".dst").c_str());
+    unlink((name + ".dst.idx").c_str());
+}
+
+BOOST_AUTO_TEST_CASE( test_receiver_session_resume )
+{
+    // A reopened file resumes from the size of the destination
+    std::string name = temp_name();
+    FILE* fp = fopen((name + ".dst").c_str(), "w");
+    fputs("abc", fp);
+    fclose(fp);
+
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    reactor r;
+    receiver_session::options opts;
+    opts.suffix         = ".dst";
+    opts.max_pending    = 0;    // Suspend input until every reply is written
+    opts.index_interval = 1;
+    follow_segment seg;
+    seg.create("/" + name, 4);
+    opts.follow         = &seg;
+    receiver_session s(r, fds[1], opts);
+    r.add(s);
+    s.start();
+    peer p(r, fds[0]);
+    std::string f;
+
+    // Several frames in one write
+    p.send(get_size(0, name) + append(0, name, 3, "def") + append(0, name, 6, "ghi"));
+    BOOST_REQUIRE_EQUAL(msg_base_header::GET_SIZE_RESPONSE, p.recv(f));
+    BOOST_REQUIRE_EQUAL(3u, p.recv_msg<msg_get_size_response>(f)->dst_size());
+    BOOST_REQUIRE_EQUAL(msg_base_header::ACK, p.recv(f));
+    BOOST_REQUIRE_EQUAL(msg_base_header::ACK, p.recv(f));
+    BOOST_REQUIRE_EQUAL(9u, p.recv_msg<msg_ack>(f)->dst_size());
+    BOOST_REQUIRE_EQUAL(9u, s.file(0)->size());
+    // Local consumers see applied data
+    tail_follower tf;
+    tf.open("/" + name, name + ".dst");
+    BOOST_REQUIRE_EQUAL(9u, tf.wait(3, 0));
+    const char* data;
+    BOOST_REQUIRE_EQUAL(6u, tf.read(3, 100, data));
+    BOOST_REQUIRE_EQUAL(0, memcmp(data, "defghi", 6));
+    tf.close();
+    p.send(append(0, name, 9, "\njk\nl"));
+    BOOST_REQUIRE_EQUAL(msg_base_header::ACK, p.recv(f));
+    BOOST_REQUIRE_EQUAL(2u, s.index(0)->records());
+    BOOST_REQUIRE_EQUAL(10u, s.index(0)->entries()[1].offset);
+
+    ::close(fds[0]);
+    r.run_once(100);
+    BOOST_REQUIRE(!s.is_open());
+    BOOST_REQUIRE_EQUAL("abcdefghi\njk\nl", read_file(name + ".dst"));
+    unlink((name + ".dst").c_str());
+    unlink((name + ".dst.idx").c_str());
+}
+
+BOOST_AUTO_TEST_CASE( test_receiver_session_durability )
+{
+    // Before-ack durability: acks carry the synced size only
+    std::string name = temp_name();
+    unlink((name + ".dst").c_str());
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    reactor r;
+    receiver_session::options opts;
+    opts.suffix      = ".dst";
+    opts.durability  = group_commit::BEFORE_ACK;
+    opts.sync_window = 60000000000ull;
+    receiver_session s(r, fds[1], opts);
+    r.add(s);
+    s.start();
+    peer p(r, fds[0]);
+    std::string f;
+
+    // Both appends are covered by one sync and one ack once the input
+    // runs dry, long before the window closes
+    p.send(get_size(0, name) + append(0, name, 0, "abc") + append(0, name, 3, "def"));
+    BOOST_REQUIRE_EQUAL(msg_base_header::GET_SIZE_RESPONSE, p.recv(f));
+    BOOST_REQUIRE_EQUAL(msg_base_header::ACK, p.recv(f));
+    BOOST_REQUIRE_EQUAL(6u, p.recv_msg<msg_ack>(f)->dst_size());
+    BOOST_REQUIRE_EQUAL(1u, s.durability().syncs());
+    BOOST_REQUIRE_EQUAL(0, p.recv(f, 50));
+
+    // Reopening the file syncs and acks pending data first
+    p.send(append(0, name, 6, "gh") + get_size(0, name));
+    BOOST_REQUIRE_EQUAL(msg_base_header::ACK, p.recv(f));
+    BOOST_REQUIRE_EQUAL(8u, p.recv_msg<msg_ack>(f)->dst_size());
+    BOOST_REQUIRE_EQUAL(msg_base_header::GET_SIZE_RESPONSE, p.recv(f));
+    BOOST_REQUIRE_EQUAL(8u, p.recv_msg<msg_get_size_response>(f)->dst_size());
+    BOOST_REQUIRE_EQUAL(2u, s.durability().syncs());
+
+    ::close(fds[0]);
+    r.run_once(100);
+    BOOST_REQUIRE(!s.is_open());
+    BOOST_REQUIRE_EQUAL("abcdefgh", read_file(name + ".dst"));
+    unlink((name + ".dst").c_str());
+}
+
+BOOST_AUTO_TEST_CASE( test_receiver_session_stats )
+{
+    // Connections and sessions publish their counters to the segment of
+    // the reactor
+    std::string name = temp_name();
+    unlink((name + ".dst").c_str());
+    char seg_name[64];
+    snprintf(seg_name, sizeof(seg_name), "/replog.test.%d", getpid());
+    stats_segment seg;
+    seg.create(seg_name, "receiver", 4);
+    const stats_layout* st = seg.data();
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    reactor r;
+    r.stats(&seg);
+    receiver_session::options opts;
+    opts.suffix      = ".dst";
+    opts.durability  = group_commit::BEFORE_ACK;
+    opts.sync_window = 60000000000ull;
+    {
+        receiver_session s(r, fds[1], opts);
+        r.add(s);
+        s.start();
+        BOOST_REQUIRE_EQUAL(1u, st->connections);
+        peer p(r, fds[0]);
+        std::string f;
+
+        p.send(get_size(1, name) + append(1, name, 0, "abc"));
+        BOOST_REQUIRE_EQUAL(msg_base_header::GET_SIZE_RESPONSE, p.recv(f));
+        BOOST_REQUIRE_EQUAL(msg_base_header::ACK, p.recv(f));
+        p.send(append(1, name, 10, "xyz"));
+        BOOST_REQUIRE_EQUAL(msg_base_header::RESEND_REQUEST, p.recv(f));
+
+        BOOST_REQUIRE_EQUAL(1u, st->frames[stats_layout::RX]['S']);
+        BOOST_REQUIRE_EQUAL(2u, st->frames[stats_layout::RX]['A']);
+        BOOST_REQUIRE_EQUAL(2 * append(1, name, 0, "abc").size(),
+                            st->bytes[stats_layout::RX]['A']);
+        BOOST_REQUIRE_EQUAL(1u, st->frames[stats_layout::TX]['s']);
+        BOOST_REQUIRE_EQUAL(1u, st->frames[stats_layout::TX]['K']);
+        BOOST_REQUIRE_EQUAL(sizeof(msg_ack), st->bytes[stats_layout::TX]['K']);
+        BOOST_REQUIRE_EQUAL(1u, st->frames[stats_layout::TX]['r']);
+        BOOST_REQUIRE_EQUAL(1u, st->resends);
+        BOOST_REQUIRE_EQUAL(1u, st->syncs);
+        BOOST_REQUIRE_EQUAL(0u, st->buffer_bytes);
+        BOOST_REQUIRE(st->buffer_high_water > 0);
+
+        const stats_file* sf = seg.file(1);
+        BOOST_REQUIRE_EQUAL(1u, sf->active);
+        BOOST_REQUIRE_EQUAL(name + ".dst", sf->name);
+        BOOST_REQUIRE_EQUAL(3u, sf->src_size);
+        BOOST_REQUIRE_EQUAL(3u, sf->ack_size);
+        BOOST_REQUIRE_EQUAL(1u, sf->resends);
+    }
+    BOOST_REQUIRE_EQUAL(0u, st->connections);
+    BOOST_REQUIRE_EQUAL(0u, seg.file(1)->active);
+    ::close(fds[0]);
+    unlink((name + ".dst").c_str());
+}
+
+BOOST_AUTO_TEST_CASE( test_receiver_session_names )
+{
+    // Peer-supplied names and ids can't escape the root directory or
+    // size the file table
+    std::string root = temp_name() + ".dir";
+    BOOST_REQUIRE_EQUAL(0, mkdir(root.c_str(), 0755));
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    reactor r;
+    receiver_session::options opts;
+    opts.root      = root;
+    opts.suffix    = ".dst";
+    opts.max_files = 16;
+    receiver_session s(r, fds[1], opts);
+    r.add(s);
+    s.start();
+    peer p(r, fds[0]);
+    std::string f;
+
+    const char* bad[] = { "../escape", "a/../../escape", "..", "/tmp/escape", "" };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i) {
+        p.send(get_size(0, bad[i]));
+        BOOST_REQUIRE_EQUAL(msg_base_header::ERROR_RESPONSE, p.recv(f));
+        BOOST_REQUIRE_EQUAL(std::string("Bad file name"),
+                            p.recv_msg<msg_error_response>(f)->error());
+    }
+    p.send(get_size(1u << 30, "a"));
+    BOOST_REQUIRE_EQUAL(msg_base_header::ERROR_RESPONSE, p.recv(f));
+    BOOST_REQUIRE_EQUAL(std::string("Bad file id"),
+                        p.recv_msg<msg_error_response>(f)->error());
+    BOOST_REQUIRE(!s.file(0));
+
+    p.send(get_size(15, "a..b") + append(15, "a..b", 0, "xyz"));
+    BOOST_REQUIRE_EQUAL(msg_base_header::GET_SIZE_RESPONSE, p.recv(f));
+    BOOST_REQUIRE_EQUAL(msg_base_header::ACK, p.recv(f));
+    BOOST_REQUIRE_EQUAL("xyz", read_file(root + "/a..b.dst"));
+
+    ::close(fds[0]);
+    r.run_once(100);
+    BOOST_REQUIRE(!s.is_open());
+    unlink((root + "/a..b.dst").c_str());
+    BOOST_REQUIRE_EQUAL(0, rmdir(root.c_str()));
+}
+
+BOOST_AUTO_TEST_CASE( test_receiver_session_delta )
+{
+    // A destination larger than the source is rebuilt from its own blocks
+    std::string name = temp_name();
+    std::string old;
+    for (int i = 0; old.size() < 70000; ++i)
+        old += "record " + std::string(1, 'a' + i % 26) + std::string(i % 50, '.') + "\n";
+    std::string fresh;
+    for (int i = 0; fresh.size() < 30000; ++i) {
+        char line[32];
+        snprintf(line, sizeof(line), "fresh line %d\n", i);
+        fresh += line;
+    }
+    std::string src = old.substr(0, 10000) + "inserted" + old.substr(10000, 20000) + fresh;
+    FILE* fp = fopen((name + ".dst").c_str(), "w");
+    fwrite(old.data(), 1, old.size(), fp);
+    fclose(fp);
+
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    reactor r;
+    receiver_session::options opts;
+    opts.suffix         = ".dst";
+    opts.index_interval = 1;
+    receiver_session s(r, fds[1], opts);
+    r.add(s);
+    s.start();
+    peer p(r, fds[0]);
+    std::string f;
+
+    p.send(get_size(0, name) + frame(msg_delta_copy::create(0, strhash(name), 0, 0, 0, 10,
+                                                            s_alloc)));
+    BOOST_REQUIRE_EQUAL(msg_base_header::GET_SIZE_RESPONSE, p.recv(f));
+    uint64_t dst_size = p.recv_msg<msg_get_size_response>(f)->dst_size();
+    BOOST_REQUIRE_EQUAL(old.size(), dst_size);
+    BOOST_REQUIRE_EQUAL(msg_base_header::ERROR_RESPONSE, p.recv(f));
+    BOOST_REQUIRE_EQUAL(std::string("No delta transfer"),
+                        p.recv_msg<msg_error_response>(f)->error());
+
+    BOOST_REQUIRE(delta_sync_required(src.size(), dst_size));
+    // The delta is queued 8KB at a time, as fast as it's sent
+    delta_sender ds(0, strhash(name), src.data(), src.size(), 8192);
+    frame_buf    out;
+    ds.request(out, dst_size);
+    p.send(out.out);
+    out.out.clear();
+    bool sent;
+    do {
+        BOOST_REQUIRE_EQUAL(msg_base_header::DELTA_SIGNATURES, p.recv(f));
+        sent = ds.on_signatures(out, p.recv_msg<msg_delta_signatures>(f));
+    } while (!sent && !ds.sending());
+    for (; !sent; sent = ds.resume(out)) {
+        BOOST_REQUIRE(out.pending() < 8192 + 64 * 1024 + 1024);
+        p.send(out.out);
+        out.out.clear();
+        r.run_once(0);
+    }
+    BOOST_REQUIRE(!ds.sending());
+    BOOST_REQUIRE(ds.literals() < fresh.size() + 10000);
+    p.send(out.out);
+    out.out.clear();
+    BOOST_REQUIRE_EQUAL(msg_base_header::ACK, p.recv(f));
+    BOOST_REQUIRE_EQUAL(src.size(), p.recv_msg<msg_ack>(f)->dst_size());
+    BOOST_REQUIRE(src == read_file(name + ".dst"));
+    BOOST_REQUIRE_EQUAL((uint64_t)std::count(src.begin(), src.end(), '\n'),
+                        s.index(0)->records());
+    BOOST_REQUIRE(!temp_files(name + ".dst.delta"));
+
+    // A copy past the end of the old file, even wrapping around 2^64, and
+    // a result not matching the source are refused, the file is kept
+    delta_sender ds2(0, strhash(name), src.data(), src.size());
+    ds2.request(out, src.size());
+    p.send(out.out);
+    out.out.clear();
+    do {
+        BOOST_REQUIRE_EQUAL(msg_base_header::DELTA_SIGNATURES, p.recv(f));
+    } while (!ds2.on_signatures(out, p.recv_msg<msg_delta_signatures>(f)));
+    out.out[out.out.size() - 1] ^= 1;   // Checksum of msg_delta_done
+    p.send(frame(msg_delta_copy::create(0, strhash(name), 0, 0, (uint64_t)-5, 10, s_alloc))
+           + out.out);
+    out.out.clear();
+    BOOST_REQUIRE_EQUAL(msg_base_header::ERROR_RESPONSE, p.recv(f));
+    BOOST_REQUIRE_EQUAL(std::string("Delta copy beyond end of file"),
+                        p.recv_msg<msg_error_response>(f)->error());
+    BOOST_REQUIRE_EQUAL(msg_base_header::ERROR_RESPONSE, p.recv(f));
+    BOOST_REQUIRE_EQUAL(std::string("Delta checksum mismatch"),
+                        p.recv_msg<msg_error_response>(f)->error());
+    BOOST_REQUIRE(src == read_file(name + ".dst"));
+    BOOST_REQUIRE(!temp_files(name + ".dst.delta"));
+
+    // Appends resume from the end of the source
+    p.send(append(0, name, src.size(), "tail"));
+    BOOST_REQUIRE_EQUAL(msg_base_header::ACK, p.recv(f));
+    BOOST_REQUIRE_EQUAL(src.size() + 4, p.recv_msg<msg_ack>(f)->dst_size());
+
+    ::close(fds[0]);
+    r.run_once(100);
+    BOOST_REQUIRE(!s.is_open());
+    BOOST_REQUIRE(src + "tail" == read_file(name + ".dst"));
+    unlink((name + ".dst").c_str());
+    unlink((name + ".dst.idx").c_str());
+}
+
+BOOST_AUTO_TEST_CASE( test_receiver_session_shm )
+{
+    // The same session serves a peer on a shared memory channel
+    std::string name = temp_name();
+    unlink((name + ".dst").c_str());
+    shm_channel_fds fds;
+    shm_channel::create(4096, fds);
+    shm_channel client, server;
+    client.open(fds, shm_channel::CLIENT);
+    server.open(fds, shm_channel::SERVER);
+    fds.close();
+
+    reactor r;
+    receiver_session::options opts;
+    opts.suffix = ".dst";
+    receiver_session s(r, server, opts);
+    r.add(s);
+    s.start();
+
+    // Appends in batches that fit the ring, acks left unread until the
+    // output of the session is held back by its full ring
+    const uint64_t n = 300;
+    std::string    out = get_size(0, name);
+    for (uint64_t i = 0; i < n; ) {
+        for (int k = 0; k < 50 && i < n; ++k, ++i)
+            out += append(0, name, i, std::string(1, 'a' + i % 26));
+        memcpy(client.reserve(out.size()), out.data(), out.size());
+        client.commit(out.size());
+        out.clear();
+        r.run_once(10);
+    }
+    BOOST_REQUIRE_EQUAL(n, s.file(0)->size());
+    BOOST_REQUIRE(s.pending() > 0);
+
+    // Reading the acks lets the rest through
+    std::string in;
+    uint64_t    acked = 0;
+    uint64_t    deadline = reactor::clock_ns() + 1000000000ull;
+    while (acked < n && reactor::clock_ns() < deadline) {
+        char buf[4096];
+        in.append(buf, client.read(buf, sizeof(buf)));
+        while (in.size() >= sizeof(msg_base_header)) {
+            msg_base_header* h = msg_base_header::decode_header(&in[0], in.size());
+            if (in.size() < h->header_size())
+                break;
+            if (h->cmd() == msg_base_header::ACK)
+                acked = reinterpret_cast<msg_ack*>(h)->dst_size();
+            in.erase(0, h->header_size());
+        }
+        r.run_once(1);
+    }
+    BOOST_REQUIRE_EQUAL(n, acked);
+    BOOST_REQUIRE_EQUAL(0u, s.pending());
+
+    // Shutting the channel down closes the session, and vice versa
+    client.shutdown();
+    for (int i = 0; i < 100 && s.is_open(); ++i)
+        r.run_once(1);
+    BOOST_REQUIRE(!s.is_open());
+    BOOST_REQUIRE(client.peer_closed());
+    BOOST_REQUIRE_EQUAL(n, read_file(name + ".dst").size());
+    unlink((name + ".dst").c_str());
+}
+
+BOOST_AUTO_TEST_CASE( test_sender_session )
+{
+    // A sender tails two files to a receiver on the same reactor
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    std::string a = temp_name(0), b = temp_name(1);
+    unlink(a.c_str()); unlink(b.c_str());
+    unlink((a + ".dst").c_str());
+    unlink((b + ".dst").c_str());
+    append_file(a, "one\ntwo\n");
+    append_file(b, "x\ny");
+    append_file(b + ".dst", "x\n");     // The copy of b resumes after this
+
+    reactor r;
+    receiver_session::options ropts;
+    ropts.suffix = ".dst";
+    receiver_session rcv(r, fds[1], ropts);
+    sender_session snd(r, fds[0]);
+    BOOST_REQUIRE_EQUAL(0u, snd.add_file(a));
+    BOOST_REQUIRE_EQUAL(1u, snd.add_file(b, 1, 2));
+    BOOST_REQUIRE_THROW(snd.add_file(temp_name(2)), io_error);
+    BOOST_REQUIRE_THROW(snd.add_file(a, stream_scheduler::s_classes), io_error);
+    r.add(rcv);
+    r.add(snd);
+    rcv.start();
+    snd.start();
+
+    // Only complete records are sent
+    for (int i = 0; i < 200 && (snd.acked(0) < 8 || snd.acked(1) < 2); ++i)
+        r.run_once(5);
+    BOOST_REQUIRE_EQUAL(8u, snd.acked(0));
+    BOOST_REQUIRE_EQUAL(2u, snd.acked(1));
+    BOOST_REQUIRE_EQUAL(2u, snd.sent(1));
+    BOOST_REQUIRE_EQUAL("one\ntwo\n", read_file(a + ".dst"));
+
+    // Growth of the files is picked up
+    append_file(a, "three\n");
+    append_file(b, "\nz");
+    for (int i = 0; i < 200 && (snd.acked(0) < 14 || snd.acked(1) < 4); ++i)
+        r.run_once(5);
+    BOOST_REQUIRE_EQUAL(14u, snd.acked(0));
+    BOOST_REQUIRE_EQUAL(4u, snd.acked(1));
+
+    // Finishing flushes the partial record and completes the session
+    snd.finish();
+    for (int i = 0; i < 200 && (snd.is_open() || rcv.is_open()); ++i)
+        r.run_once(5);
+    BOOST_REQUIRE(snd.complete());
+    BOOST_REQUIRE_EQUAL("Session complete", snd.reason());
+    BOOST_REQUIRE(!rcv.is_open());
+    BOOST_REQUIRE_EQUAL(5u, snd.acked(1));
+    BOOST_REQUIRE_EQUAL(0u, snd.resends());
+    BOOST_REQUIRE_EQUAL("one\ntwo\nthree\n", read_file(a + ".dst"));
+    BOOST_REQUIRE_EQUAL("x\ny\nz", read_file(b + ".dst"));
+    unlink(a.c_str()); unlink(b.c_str());
+    unlink((a + ".dst").c_str());
+    unlink((b + ".dst").c_str());
+}
+
+BOOST_AUTO_TEST_CASE( test_sender_session_resend )
+{
+    int fds[2];
+    BOOST_REQUIRE_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    std::string name = temp_name();
+    unlink(name.c_str());
+    append_file(name, "aa\nbb\ncc\n");
+
+    reactor r;
+    retention_cache cache(1024 * 1024);
+    sender_session::options opts;
+    opts.cache = &cache;
+    sender_session s(r, fds[1], opts);
+    s.add_file(name);
+    r.add(s);
+    s.start();
+    peer p(r, fds[0]);
+    std::string f;
+
+    BOOST_REQUIRE_EQUAL(msg_base_header::GET_SIZE, p.recv(f));
+    BOOST_REQUIRE_EQUAL(name, p.recv_msg<msg_get_size>(f)->name());
+    BOOST_REQUIRE_EQUAL(9u, p.recv_msg<msg_get_size>(f)->src_size());
+    p.send(frame(msg_get_size_response::create(0, strhash(name), 7, 0, s_alloc)));
+    BOOST_REQUIRE_EQUAL(msg_base_header::APPEND, p.recv(f));
+    BOOST_REQUIRE_EQUAL(7, p.recv_msg<msg_append>(f)->dst_fd());
+    BOOST_REQUIRE_EQUAL(0u, p.recv_msg<msg_append>(f)->src_offset());
+    BOOST_REQUIRE_EQUAL(9u, p.recv_msg<msg_append>(f)->chunk_size());
+    BOOST_REQUIRE_EQUAL(0u, cache.hit_bytes());
+
+    // Data lost by the peer is sent again from the cache
+    p.send(frame(msg_resend_request::create(0, strhash(name), 3, s_alloc)));
+    BOOST_REQUIRE_EQUAL(msg_base_header::APPEND, p.recv(f));
+    BOOST_REQUIRE_EQUAL(3u, p.recv_msg<msg_append>(f)->src_offset());
+    BOOST_REQUIRE_EQUAL("bb\ncc\n", f.substr(sizeof(msg_append)));
+    BOOST_REQUIRE_EQUAL(6u, cache.hit_bytes());
+    BOOST_REQUIRE_EQUAL(1u, s.resends());
+
+    // Acknowledged data leaves the cache
+    p.send(frame(msg_ack::create(0, strhash(name), 9, s_alloc)));
+    BOOST_REQUIRE_EQUAL(0, p.recv(f, 20));
+    BOOST_REQUIRE_EQUAL(9u, s.acked(0));
+    BOOST_REQUIRE_EQUAL(0u, cache.size());
+
+    // An error of the peer ends the session
+    p.send(frame(msg_error_response::create(0, strhash(name), msg_base_header::APPEND,
+                                            "Disk full", s_alloc)));
+    BOOST_REQUIRE_EQUAL(0, p.recv(f, 20));
+    BOOST_REQUIRE(!s.is_open());
+    BOOST_REQUIRE(!s.complete());
+    BOOST_REQUIRE(s.reason().find("Disk full") != std::string::npos);
+    unlink(name.c_str());
+    ::close(fds[0]);
+}
+
+BOOST_AUTO_TEST_CASE( test_sender_session_shm )
+{
+    // Mapped files over a shared memory channel, shaped by a rate limiter
+    std::string name = temp_name();
+    unlink(name.c_str());
+    unlink((name + ".dst").c_str());
+    std::string data;
+    for (int i = 0; data.size() < 128 * 1024; ++i) {
+        char line[32];
+        snprintf(line, sizeof(line), "line %d\n", i);
+        data += line;
+    }
+    append_file(name, data);
+
+    shm_channel_fds fds;
+    shm_channel::create(16 * 1024, fds);
+    shm_channel client, server;
+    client.open(fds, shm_channel::CLIENT);
+    server.open(fds, shm_channel::SERVER);
+    fds.close();
+
+    reactor r;
+    rate_limiter limiter(2 * 1024 * 1024, 16 * 1024);
+    receiver_session::options ropts;
+    ropts.suffix = ".dst";
+    receiver_session rcv(r, server, ropts);
+    sender_session::options sopts;
+    sopts.mmap      = true;
+    sopts.min_chunk = 1024;
+    sopts.max_chunk = 4096;
+    sopts.limiter   = &limiter;
+    sender_session snd(r, client, sopts);
+    snd.add_file(name);
+    r.add(rcv);
+    r.add(snd);
+    rcv.start();
+    snd.start();
+    snd.finish();
+
+    uint64_t t0 = reactor::clock_ns();
+    for (int i = 0; i < 1000 && snd.is_open(); ++i)
+        r.run_once(5);
+    BOOST_REQUIRE(snd.complete());
+    // The burst goes at once, the rest at the rate
+    BOOST_REQUIRE(reactor::clock_ns() - t0 >= 40000000ull);
+    BOOST_REQUIRE_EQUAL(data.size(), snd.acked(0));
+    BOOST_REQUIRE(snd.sizer().chunk_size() <= 4096);
+    BOOST_REQUIRE(data == read_file(name + ".dst"));
+    unlink(name.c_str());
+    unlink((name + ".dst").c_str());
+}
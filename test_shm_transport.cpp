@@ -0,0 +1,163 @@
+//----------------------------------------------------------------------------
+/// \file  test_shm_transport.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for the shared memory SPSC transport.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <replog/shm_transport.hpp>
+#include <replog/proto.hpp>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+using namespace replog;
+
+namespace {
+
+    const int s_frames = 20000;
+
+    struct buffer_allocator {
+        char* m_buf;
+        buffer_allocator(char* a_buf) : m_buf(a_buf) {}
+        char* allocate(size_t) { return m_buf; }
+    };
+
+    /// Streams msg_append frames of varying size through the channel.
+    void* producer(void* a_arg) {
+        shm_channel& ch = *static_cast<shm_channel*>(a_arg);
+        for (int i = 0; i < s_frames; ++i) {
+            uint32_t len = 1 + (i * 7919) % 3000;
+            char* p = ch.reserve(sizeof(msg_append) + len);
+            memset(p + sizeof(msg_append), (char)i, len);
+            msg_append::create(i, 0, 3, i, len, buffer_allocator(p));
+            ch.commit(sizeof(msg_append) + len);
+        }
+        ch.shutdown();
+        return NULL;
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_shm_channel_mirror )
+{
+    shm_channel_fds fds;
+    shm_channel::create(1000, fds);
+    shm_channel a, b;
+    a.open(fds, shm_channel::CLIENT);
+    b.open(fds, shm_channel::SERVER);
+    fds.close();
+    BOOST_REQUIRE_EQUAL(4096u, a.capacity());
+
+    // Writes straddling the end of the ring stay contiguous
+    char* q;
+    for (int i = 0; i < 10; ++i) {
+        char* p = a.reserve(3000);
+        for (int j = 0; j < 3000; ++j)
+            p[j] = (char)(i + j);
+        a.commit(3000);
+        BOOST_REQUIRE_EQUAL(3000u, b.wait(q, 3000));
+        for (int j = 0; j < 3000; ++j)
+            BOOST_REQUIRE_EQUAL((char)(i + j), q[j]);
+        b.consume(3000);
+    }
+
+    // Reverse direction and end of stream
+    memcpy(b.reserve(5), "hello", 5);
+    b.commit(5);
+    b.shutdown();
+    BOOST_REQUIRE_EQUAL(5u, a.wait(q, 10));
+    BOOST_REQUIRE(memcmp(q, "hello", 5) == 0);
+    a.consume(5);
+    BOOST_REQUIRE_EQUAL(0u, a.wait(q, 1));
+}
+
+BOOST_AUTO_TEST_CASE( test_shm_channel_threads )
+{
+    shm_channel_fds fds;
+    shm_channel::create(16 * 1024, fds);
+
+    // Hand the descriptors over a UNIX socket as an unrelated process would
+    int sv[2];
+    BOOST_REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+    fds.send_fds(sv[0]);
+    shm_channel_fds fds2;
+    fds2.recv_fds(sv[1]);
+    ::close(sv[0]);
+    ::close(sv[1]);
+
+    shm_channel a, b;
+    a.open(fds,  shm_channel::CLIENT);
+    b.open(fds2, shm_channel::SERVER);
+    fds.close();
+    fds2.close();
+
+    pthread_t t;
+    pthread_create(&t, NULL, producer, &a);
+
+    int n = 0;
+    for (char* p; b.wait(p, sizeof(msg_append)) >= sizeof(msg_append); ++n) {
+        msg_base_header* h = msg_base_header::decode_header(p, sizeof(msg_append));
+        BOOST_REQUIRE_EQUAL(msg_base_header::APPEND, h->cmd());
+        msg_append* m = static_cast<msg_append*>(h);
+        BOOST_REQUIRE_EQUAL((uint32_t)n, m->id());
+        uint32_t len = m->chunk_size();
+        BOOST_REQUIRE_EQUAL(1 + (n * 7919) % 3000, (int)len);
+        BOOST_REQUIRE(b.wait(p, sizeof(msg_append) + len) >= sizeof(msg_append) + len);
+        BOOST_REQUIRE_EQUAL((char)n, p[sizeof(msg_append) + len - 1]);
+        b.consume(sizeof(msg_append) + len);
+    }
+    pthread_join(t, NULL);
+    BOOST_REQUIRE_EQUAL(s_frames, n);
+}
+
+BOOST_AUTO_TEST_CASE( test_spsc_ring_corrupt )
+{
+    // Positions written by a broken peer are rejected, not dereferenced
+    spsc_ring_header hdr;
+    static char      data[4096];
+    spsc_ring prod, cons;
+    prod.attach(&hdr, data, sizeof(data), true);
+    cons.attach(&hdr, data, sizeof(data), false);
+    char* p;
+    BOOST_REQUIRE(prod.reserve(100));
+    prod.commit(100);
+    BOOST_REQUIRE_EQUAL(100u, cons.peek(p));
+
+    hdr.head = 100 + sizeof(data) + 1;
+    BOOST_REQUIRE_THROW(cons.peek(p), io_error);
+    hdr.head = (uint64_t)-1;
+    BOOST_REQUIRE_THROW(cons.peek(p), io_error);
+    hdr.head = 100;
+
+    hdr.tail = 200;
+    BOOST_REQUIRE_THROW(prod.space(), io_error);
+    BOOST_REQUIRE_THROW(prod.reserve(sizeof(data)), io_error);
+    hdr.tail = 0;
+    BOOST_REQUIRE_EQUAL(sizeof(data) - 100, prod.space());
+}
@@ -0,0 +1,95 @@
+//----------------------------------------------------------------------------
+/// \file  test_stats.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for the shared memory statistics segment.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <replog/stats.hpp>
+#include <unistd.h>
+#include <stdio.h>
+
+using namespace replog;
+
+BOOST_AUTO_TEST_CASE( test_latency_histogram )
+{
+    for (uint64_t n = 1; n < (1ull << 40); n = n * 3 + 1) {
+        int b = latency_histogram::bucket(n);
+        BOOST_REQUIRE(latency_histogram::value(b) <= n);
+        BOOST_REQUIRE(n - latency_histogram::value(b) <= n / latency_histogram::s_sub);
+    }
+
+    latency_histogram h;
+    h.reset();
+    BOOST_REQUIRE_EQUAL(0u, h.percentile(50));
+    for (uint64_t i = 1; i <= 1000; ++i)
+        h.record(i * 1000);
+    BOOST_REQUIRE_EQUAL(1000u,    h.total());
+    BOOST_REQUIRE_EQUAL(1000000u, h.max());
+    uint64_t p50 = h.percentile(50), p99 = h.percentile(99);
+    BOOST_REQUIRE(p50 >= 485000 && p50 <= 500000);
+    BOOST_REQUIRE(p99 >= 960000 && p99 <= 990000);
+}
+
+BOOST_AUTO_TEST_CASE( test_stats_segment )
+{
+    char name[64];
+    snprintf(name, sizeof(name), "/replog.test.%d", getpid());
+
+    stats_segment w;
+    w.create(name, "sender", 4);
+    stats_file* f = w.add_file(5, 123u, "test.log");
+    w.on_source_size(f, 1000);
+    w.on_ack(f, 400);
+    w.on_resend(f);
+    w.on_frame(stats_layout::TX, 'A', 128);
+    w.on_frame(stats_layout::TX, 'A', 64);
+    w.on_buffer(100);
+    w.on_buffer(-60);
+    w.data()->apply_latency.record(5000);
+
+    stats_segment r;
+    r.open(name);
+    BOOST_REQUIRE_EQUAL(4u, r.max_files());
+    BOOST_REQUIRE_EQUAL(std::string("sender"), r.data()->role);
+    const stats_file* rf = r.file(5 % 4);
+    BOOST_REQUIRE_EQUAL(1u,    rf->active);
+    BOOST_REQUIRE_EQUAL(5u,    rf->id);
+    BOOST_REQUIRE_EQUAL(600u,  rf->lag());
+    BOOST_REQUIRE_EQUAL(1u,    rf->resends);
+    BOOST_REQUIRE_EQUAL(std::string("test.log"), rf->name);
+    BOOST_REQUIRE_EQUAL(2u,    r.data()->frames[stats_layout::TX]['A']);
+    BOOST_REQUIRE_EQUAL(192u,  r.data()->bytes[stats_layout::TX]['A']);
+    BOOST_REQUIRE_EQUAL(40u,   r.data()->buffer_bytes);
+    BOOST_REQUIRE_EQUAL(100u,  r.data()->buffer_high_water);
+    BOOST_REQUIRE_EQUAL(1u,    r.data()->apply_latency.total());
+
+    w.remove_file(5);
+    BOOST_REQUIRE_EQUAL(0u,    rf->active);
+}
@@ -0,0 +1,104 @@
+//----------------------------------------------------------------------------
+/// \file  test_tail_follow.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for tail-follow consumers of replicated files.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <replog/tail_follow.hpp>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+using namespace replog;
+
+namespace {
+    struct publisher {
+        follow_segment* seg;
+        int             fd;
+        const char*     data;
+        useconds_t      delay;
+    };
+
+    void* publish(void* a_arg) {
+        publisher* p = static_cast<publisher*>(a_arg);
+        usleep(p->delay);
+        size_t n = strlen(p->data);
+        if (pwrite(p->fd, p->data, n, 0) == (ssize_t)n)
+            p->seg->on_apply(3, n);
+        usleep(p->delay);
+        p->seg->on_sync(3, n);
+        usleep(p->delay);
+        p->seg->remove_file(3);
+        return NULL;
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_tail_follow )
+{
+    char seg_name[64], name[64];
+    snprintf(seg_name, sizeof(seg_name), "/replog.test_follow.%d", getpid());
+    snprintf(name,     sizeof(name),     "test_tail_follow.%d.tmp", getpid());
+    int fd = ::open(name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    BOOST_REQUIRE(fd >= 0);
+
+    follow_segment seg;
+    seg.create(seg_name, 4);
+    seg.add_file(3, name, 0);
+
+    tail_follower f;
+    BOOST_REQUIRE_THROW(f.open(seg_name, "no_such_file"), io_error);
+    f.open(seg_name, name);
+    BOOST_REQUIRE_EQUAL(0u, f.available());
+    BOOST_REQUIRE_EQUAL(0u, f.wait(0, 10));
+    const char* p;
+    BOOST_REQUIRE_EQUAL(0u, f.read(0, 100, p));
+
+    // Consumers block until the receiver publishes applied and synced data
+    publisher pub = { &seg, fd, "line 1\nline 2\n", 20000 };
+    pthread_t th;
+    pthread_create(&th, NULL, publish, &pub);
+    BOOST_REQUIRE_EQUAL(14u, f.wait(0));
+    BOOST_REQUIRE_EQUAL(0u, f.available(true));
+    BOOST_REQUIRE_EQUAL(14u, f.read(0, 100, p));
+    BOOST_REQUIRE_EQUAL(0, memcmp(p, "line 1\nline 2\n", 14));
+    BOOST_REQUIRE_EQUAL(7u, f.read(7, 100, p));
+    BOOST_REQUIRE_EQUAL(0, memcmp(p, "line 2\n", 7));
+    BOOST_REQUIRE_EQUAL(14u, f.wait(0, -1, true));
+    // Removal of the file wakes up the consumer
+    BOOST_REQUIRE_EQUAL(14u, f.wait(14));
+    pthread_join(th, NULL);
+
+    f.close();
+    seg.close();
+    BOOST_REQUIRE_THROW(f.open(seg_name, name), io_error);
+    ::close(fd);
+    unlink(name);
+}
@@ -0,0 +1,160 @@
+//----------------------------------------------------------------------------
+/// \file  test_timer_wheel.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for the timer wheel.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <replog/timer_wheel.hpp>
+#include <vector>
+#include <stdlib.h>
+
+using namespace replog;
+
+namespace {
+    struct probe {
+        timer_wheel*  wheel;
+        uint64_t      now;
+        uint64_t      expected;     // Earliest valid firing time
+        std::vector<uint64_t> fired;
+        wheel_timer   timer;
+        uint64_t      period;       // Rearm period, 0 - one shot
+
+        probe() : wheel(NULL), now(0), expected(0), period(0) {
+            timer.bind<probe, &probe::on_timer>(this);
+        }
+
+        void on_timer() {
+            fired.push_back(now);
+            if (period) {
+                expected = now + period;
+                wheel->schedule(timer, expected);
+            }
+        }
+    };
+}
+
+BOOST_AUTO_TEST_CASE( test_timer_wheel_basic )
+{
+    const uint64_t ms = 1000000;
+    timer_wheel w(ms, 1000 * ms);
+    probe p;
+    p.wheel = &w;
+    BOOST_REQUIRE_EQUAL(0u, w.next_expiry());
+
+    w.schedule(p.timer, 1005 * ms);
+    BOOST_REQUIRE(p.timer.active());
+    BOOST_REQUIRE_EQUAL(1u, w.size());
+    BOOST_REQUIRE_EQUAL(1005 * ms, w.next_expiry());
+
+    p.now = 1004 * ms + ms / 2;
+    BOOST_REQUIRE_EQUAL(0u, w.advance(p.now));
+    BOOST_REQUIRE(p.fired.empty());
+    p.now = 1005 * ms;
+    BOOST_REQUIRE_EQUAL(1u, w.advance(p.now));
+    BOOST_REQUIRE_EQUAL(1u, p.fired.size());
+    BOOST_REQUIRE(!p.timer.active());
+    BOOST_REQUIRE_EQUAL(0u, w.size());
+
+    // Sub-tick expiry rounds up
+    w.schedule(p.timer, 1010 * ms + 1);
+    p.now = 1010 * ms;
+    w.advance(p.now);
+    BOOST_REQUIRE_EQUAL(1u, p.fired.size());
+    p.now = 1011 * ms;
+    w.advance(p.now);
+    BOOST_REQUIRE_EQUAL(2u, p.fired.size());
+
+    // Cancelled and destroyed timers never fire
+    w.schedule(p.timer, 1020 * ms);
+    p.timer.cancel();
+    BOOST_REQUIRE_EQUAL(0u, w.size());
+    {
+        probe q;
+        w.schedule(q.timer, 1020 * ms);
+        BOOST_REQUIRE_EQUAL(1u, w.size());
+    }
+    BOOST_REQUIRE_EQUAL(0u, w.size());
+    BOOST_REQUIRE_EQUAL(0u, w.advance(1030 * ms));
+}
+
+BOOST_AUTO_TEST_CASE( test_timer_wheel_cascade )
+{
+    // Timers spread over all levels fire in order, on time, exactly once
+    const uint64_t ms = 1000000;
+    uint64_t start = 123456 * ms;
+    timer_wheel w(ms, start);
+    const size_t n = 200;
+    static probe probes[n];
+    srand(1);
+    for (size_t i = 0; i < n; ++i) {
+        probe& p  = probes[i];
+        p.wheel   = &w;
+        uint64_t d = i < 40 ? rand() % 64 : i < 80 ? rand() % 4096
+                   : i < 120 ? rand() % 262144 : i < 190 ? rand() % 16000000
+                   : 16777216 + rand() % 1000000;  // Beyond the top level
+        p.expected = start + (d + 1) * ms;
+        if (i % 20 == 0)
+            p.period = 7 * ms;
+        w.schedule(p.timer, p.expected);
+    }
+    BOOST_REQUIRE_EQUAL(n, w.size());
+
+    uint64_t now = start;
+    while (now < start + 17800000 * ms) {
+        uint64_t next = w.next_expiry();
+        BOOST_REQUIRE(next > now);
+        // Jump straight to the next expiry like an event loop would
+        now = next;
+        size_t   fired[n];
+        uint64_t expected[n];
+        for (size_t i = 0; i < n; ++i) {
+            probes[i].now = now;
+            fired[i]    = probes[i].fired.size();
+            expected[i] = probes[i].timer.active() ? probes[i].expected : 0;
+        }
+        w.advance(now);
+        for (size_t i = 0; i < n; ++i) {
+            // Due timers fire exactly once, within a tick of expiry
+            bool   due  = expected[i] && now >= expected[i];
+            size_t diff = probes[i].fired.size() - fired[i];
+            if (diff != (due ? 1u : 0u) || (due && now >= expected[i] + ms))
+                BOOST_FAIL("Timer " << i << " fired " << diff << " times at " << now);
+        }
+        // Stop the periodic timers after a while
+        if (now > start + 100 * ms)
+            for (size_t i = 0; i < n; ++i)
+                probes[i].period = 0;
+        if (!w.size())
+            break;
+    }
+    BOOST_REQUIRE_EQUAL(0u, w.size());
+    for (size_t i = 0; i < n; ++i)
+        BOOST_REQUIRE(!probes[i].fired.empty());
+}
@@ -0,0 +1,89 @@
+//----------------------------------------------------------------------------
+/// \file  test_trace.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for the message lifecycle trace.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <replog/trace.hpp>
+#include <unistd.h>
+#include <stdio.h>
+
+using namespace replog;
+
+BOOST_AUTO_TEST_CASE( test_trace_ring )
+{
+    trace_ring ring(5, 3);
+    BOOST_REQUIRE_EQUAL(8u, ring.capacity());
+    for (uint64_t i = 0; i < 10; ++i)
+        ring.record(TRACE_SEND, 1, i * 100, 100);
+    BOOST_REQUIRE_EQUAL(10u, ring.written());
+
+    std::vector<trace_record> v;
+    ring.snapshot(v);
+    // The oldest slot is the one the writer fills next: it's left out
+    BOOST_REQUIRE_EQUAL(7u, v.size());
+    BOOST_REQUIRE_EQUAL(300u, v.front().src_offset);
+    BOOST_REQUIRE_EQUAL(900u, v.back().src_offset);
+    BOOST_REQUIRE_EQUAL(3u,   v.back().thread);
+    BOOST_REQUIRE(v.front().tsc <= v.back().tsc);
+}
+
+BOOST_AUTO_TEST_CASE( test_tracer )
+{
+    BOOST_REQUIRE(!tracer::enabled());
+    REPLOG_TRACE(TRACE_WRITE, 7, 0, 10);
+    tracer::enable(true);
+    REPLOG_TRACE(TRACE_DECODE, 7, 10, 20);
+    REPLOG_TRACE(TRACE_WRITE,  7, 10, 20);
+    tracer::enable(false);
+
+    char name[64];
+    snprintf(name, sizeof(name), "/tmp/replog.trace.%d", getpid());
+    BOOST_REQUIRE_EQUAL(2u, tracer::dump(name));
+
+    trace_file_header         hdr;
+    std::vector<trace_record> v;
+    tracer::load(name, hdr, v);
+
+    // A count not matching the file size is rejected before allocating
+    hdr.count = 1ull << 40;
+    FILE* f = fopen(name, "r+");
+    BOOST_REQUIRE(f);
+    BOOST_REQUIRE_EQUAL(1u, fwrite(&hdr, sizeof(hdr), 1, f));
+    fclose(f);
+    std::vector<trace_record> bad;
+    BOOST_REQUIRE_THROW(tracer::load(name, hdr, bad), io_error);
+    unlink(name);
+    BOOST_REQUIRE_EQUAL(2u, v.size());
+    BOOST_REQUIRE(hdr.tsc_hz > 0);
+    BOOST_REQUIRE_EQUAL((int)TRACE_DECODE, v[0].event);
+    BOOST_REQUIRE_EQUAL((int)TRACE_WRITE,  v[1].event);
+    BOOST_REQUIRE_EQUAL(10u, v[1].src_offset);
+}
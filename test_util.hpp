@@ -0,0 +1,72 @@
+//----------------------------------------------------------------------------
+/// \file  test_util.hpp
+//----------------------------------------------------------------------------
+/// \brief Temporary file helpers shared by the test cases.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#ifndef _REPLOG_TEST_UTIL_HPP_
+#define _REPLOG_TEST_UTIL_HPP_
+
+#include <boost/test/unit_test.hpp>
+#include <string>
+#include <stdio.h>
+#include <unistd.h>
+
+namespace replog {
+namespace test {
+
+/// Name of a temporary file of the running test case unique to the
+/// process, e.g. "test_file_writer_hole.1234.tmp". A non-negative
+/// \a a_index distinguishes several files of the same test case.
+inline std::string temp_name(int a_index = -1) {
+    std::string test = boost::unit_test::framework::current_test_case().p_name;
+    char buf[64];
+    if (a_index < 0)
+        snprintf(buf, sizeof(buf), ".%d.tmp", getpid());
+    else
+        snprintf(buf, sizeof(buf), ".%d.%d.tmp", getpid(), a_index);
+    return test + buf;
+}
+
+/// Content of file \a a_name, empty if it can't be read.
+inline std::string read_file(const std::string& a_name) {
+    std::string s;
+    FILE* f = fopen(a_name.c_str(), "r");
+    char  buf[4096];
+    for (size_t n; f && (n = fread(buf, 1, sizeof(buf), f)) > 0; )
+        s.append(buf, n);
+    if (f)
+        fclose(f);
+    return s;
+}
+
+} // namespace test
+} // namespace replog
+
+#endif // _REPLOG_TEST_UTIL_HPP_
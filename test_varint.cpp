@@ -0,0 +1,222 @@
+//----------------------------------------------------------------------------
+/// \file  test_varint.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for varint encoding and the version 2 wire format.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <replog/proto_v2.hpp>
+#include <replog/delta.hpp>
+
+using namespace replog;
+
+BOOST_AUTO_TEST_CASE( test_varint )
+{
+    const uint64_t values[] = {
+        0, 1, 127, 128, 300, 16383, 16384, (1ull << 21) - 1, 1ull << 21,
+        0xFFFFFFFFull, 1ull << 49, (1ull << 56) - 1, 1ull << 56,
+        0x7FFFFFFFFFFFFFFFull, 0xFFFFFFFFFFFFFFFFull
+    };
+    const size_t n = sizeof(values) / sizeof(values[0]);
+
+    char buf[n * s_max_varint_size + 16];
+    char* p = buf;
+    for (size_t i = 0; i < n; ++i) {
+        char* q = p;
+        put_varint(p, values[i]);
+        BOOST_REQUIRE_EQUAL(varint_size(values[i]), (size_t)(p - q));
+    }
+    const char* end = p;
+
+    // Single value decoding, both near the end of a buffer and not
+    const char* q = buf;
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t v;
+        BOOST_REQUIRE(get_varint(q, end, v));
+        BOOST_REQUIRE_EQUAL(values[i], v);
+    }
+    BOOST_REQUIRE(q == end);
+
+    // Batch decoding
+    uint64_t v[n];
+    q = buf;
+    BOOST_REQUIRE(get_varints(q, end, v, n));
+    BOOST_REQUIRE(q == end);
+    for (size_t i = 0; i < n; ++i)
+        BOOST_REQUIRE_EQUAL(values[i], v[i]);
+
+    // Incomplete input
+    q = buf;
+    BOOST_REQUIRE(!get_varints(q, end - 1, v, n));
+    BOOST_REQUIRE(q == buf);
+    char b[2] = {(char)0x80, (char)0x80};
+    q = b;
+    BOOST_REQUIRE(!get_varint(q, b + 2, v[0]));
+
+    BOOST_REQUIRE_EQUAL(0u, zigzag_encode(0));
+    BOOST_REQUIRE_EQUAL(1u, zigzag_encode(-1));
+    BOOST_REQUIRE_EQUAL(2u, zigzag_encode(1));
+    BOOST_REQUIRE_EQUAL(-12345678901ll, zigzag_decode(zigzag_encode(-12345678901ll)));
+}
+
+BOOST_AUTO_TEST_CASE( test_codec_v2 )
+{
+    codec_v2 enc, dec;
+    char     buf[1024];
+    char*    p = buf;
+
+    // Consecutive appends of 100-byte lines encode in 5 bytes
+    const char line[100] = "line";
+    for (int i = 0; i < 3; ++i) {
+        size_t n = enc.encode_append(p, 7, 1000 + i * 100, 100);
+        BOOST_REQUIRE_EQUAL(i ? 5u : 6u, n);
+        memcpy(p + n, line, 100);
+        p += n + 100;
+    }
+    // Resend of an earlier range: negative delta
+    size_t n = enc.encode_append(p, 7, 1000, 50);
+    memcpy(p + n, line, 50);
+    p += n + 50;
+
+    // Version 1 control message behind a prefix
+    std::allocator<char> a;
+    msg_resend_request* r = msg_resend_request::create(7, 123u, 1050ull, a);
+    p += codec_v2::encode_prefix(p, r);
+    memcpy(p, r, r->header_size());
+    p += r->header_size();
+    a.deallocate(reinterpret_cast<char*>(r), r->header_size());
+
+    const uint64_t offsets[] = {1000, 1100, 1200, 1000};
+    const uint32_t sizes[]   = {100,  100,  100,  50};
+    const char*    q = buf;
+    frame_v2       f;
+    for (int i = 0; i < 4; ++i) {
+        BOOST_REQUIRE(!dec.decode(q, 4, f));
+        BOOST_REQUIRE(dec.decode(q, p - q, f));
+        BOOST_REQUIRE_EQUAL(msg_base_header::APPEND, f.cmd);
+        BOOST_REQUIRE_EQUAL(7u,         f.id);
+        BOOST_REQUIRE_EQUAL(offsets[i], f.src_offset);
+        BOOST_REQUIRE_EQUAL(sizes[i],   f.chunk_size);
+        BOOST_REQUIRE_EQUAL(0, memcmp(line, f.data, f.chunk_size));
+        q += f.size;
+    }
+    BOOST_REQUIRE(dec.decode(q, p - q, f));
+    BOOST_REQUIRE_EQUAL(msg_base_header::RESEND_REQUEST, f.cmd);
+    BOOST_REQUIRE_EQUAL(7u, f.id);
+    BOOST_REQUIRE_EQUAL(1050u,
+        reinterpret_cast<const msg_resend_request*>(f.data)->dst_size());
+    BOOST_REQUIRE(q + f.size == p);
+
+    buf[0] = msg_base_header::get_magic();
+    BOOST_REQUIRE_THROW(dec.decode(buf, sizeof(buf), f), replog_error);
+    BOOST_REQUIRE_EQUAL(WIRE_V1, negotiate_version(WIRE_V2, WIRE_V1));
+}
+
+BOOST_AUTO_TEST_CASE( test_codec_v2_payload )
+{
+    codec_v2 enc, dec;
+    char     buf[1024];
+    char*    p = buf;
+    char     data[128] = "block";
+
+    // Message with a payload: the prefix covers the signature entries
+    std::allocator<char> a;
+    msg_delta_signatures* s =
+        msg_delta_signatures::create(3, 123u, 8192ull, 2048u, 0u, 4u, a);
+    p += codec_v2::encode_prefix(p, s);
+    memcpy(p, s, s->header_size());
+    p += s->header_size();
+    for (uint32_t i = 0; i < s->count(); ++i)
+        p = block_signature(data, 100 + i).encode(p);
+    a.deallocate(reinterpret_cast<char*>(s), s->header_size());
+
+    // Followed by an append to the same file
+    size_t n = enc.encode_append(p, 3, 0, 10);
+    memcpy(p + n, "0123456789", 10);
+    p += n + 10;
+
+    const char* q = buf;
+    frame_v2    f;
+    BOOST_REQUIRE(!dec.decode(q, p - q - 20, f));
+    BOOST_REQUIRE(dec.decode(q, p - q, f));
+    BOOST_REQUIRE_EQUAL(msg_base_header::DELTA_SIGNATURES, f.cmd);
+    BOOST_REQUIRE_EQUAL(3u, f.id);
+    const msg_delta_signatures* m = reinterpret_cast<const msg_delta_signatures*>(f.data);
+    BOOST_REQUIRE_EQUAL(4u, m->count());
+    BOOST_REQUIRE(f.data + m->header_size() + m->payload_size() == buf + f.size);
+    block_signature sig;
+    sig.decode(f.data + m->header_size() + 3 * msg_delta_signatures::s_entry_size);
+    BOOST_REQUIRE_EQUAL(block_signature(data, 103).strong, sig.strong);
+    q += f.size;
+
+    BOOST_REQUIRE(dec.decode(q, p - q, f));
+    BOOST_REQUIRE_EQUAL(msg_base_header::APPEND, f.cmd);
+    BOOST_REQUIRE_EQUAL(10u, f.chunk_size);
+    BOOST_REQUIRE_EQUAL(0, memcmp("0123456789", f.data, 10));
+    BOOST_REQUIRE(q + f.size == p);
+}
+
+BOOST_AUTO_TEST_CASE( test_codec_v2_file_id_bound )
+{
+    codec_v2 enc(16), dec(16);
+    char     buf[64];
+    frame_v2 f;
+
+    BOOST_REQUIRE_THROW(enc.encode_append(buf, 16, 0, 10), replog_error);
+
+    // A peer sending a huge id is rejected rather than sizing the state
+    char* p = buf;
+    *p++ = codec_v2::s_magic;
+    *p++ = msg_base_header::APPEND;
+    put_varint(p, 0xFFFFFFF0u);
+    put_varint(p, 0);
+    put_varint(p, 0);
+    BOOST_REQUIRE_THROW(dec.decode(buf, p - buf, f), replog_error);
+    size_t n = enc.encode_append(buf, 15, 0, 0);
+    BOOST_REQUIRE(dec.decode(buf, n, f));
+    BOOST_REQUIRE_EQUAL(15u, f.id);
+
+    // So is a chunk the receiver would have to buffer whole
+    BOOST_REQUIRE_THROW(enc.encode_append(buf, 1, 0, msg_base_header::s_max_payload_size + 1),
+                        replog_error);
+    p = buf;
+    *p++ = codec_v2::s_magic;
+    *p++ = msg_base_header::APPEND;
+    put_varint(p, 1);
+    put_varint(p, 0);
+    put_varint(p, msg_base_header::s_max_payload_size + 1);
+    BOOST_REQUIRE_THROW(dec.decode(buf, p - buf, f), replog_error);
+
+    // An incomplete frame reports its size once the header is complete
+    n = enc.encode_append(buf, 1, 0, 1000);
+    BOOST_REQUIRE(!dec.decode(buf, 2, f));
+    BOOST_REQUIRE_EQUAL(0u, f.size);
+    BOOST_REQUIRE(!dec.decode(buf, n, f));
+    BOOST_REQUIRE_EQUAL(n + 1000, f.size);
+}
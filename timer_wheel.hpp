@@ -0,0 +1,230 @@
+//----------------------------------------------------------------------------
+/// \file  timer_wheel.hpp
+//----------------------------------------------------------------------------
+/// \brief Hierarchical timer wheel for connection timeouts.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _REPLOG_TIMER_WHEEL_HPP_
+#define _REPLOG_TIMER_WHEEL_HPP_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <boost/noncopyable.hpp>
+
+namespace replog {
+
+class timer_wheel;
+
+/**
+ * \brief Timer scheduled in a timer_wheel.
+ * Timers are intrusive list nodes: scheduling and cancelling one never
+ * allocates.  A timer cancels itself when destroyed.
+ */
+class wheel_timer: boost::noncopyable {
+    friend class timer_wheel;
+
+    wheel_timer* m_next;
+    wheel_timer* m_prev;
+    timer_wheel* m_wheel;
+    uint64_t     m_expires;         // Tick
+    void       (*m_fn)(void*);
+    void*        m_obj;
+
+    template <class T, void (T::*Method)()>
+    static void thunk(void* a_obj) { (static_cast<T*>(a_obj)->*Method)(); }
+
+    void link(wheel_timer* a_head) {
+        m_next = a_head;
+        m_prev = a_head->m_prev;
+        m_prev->m_next = this;
+        a_head->m_prev = this;
+    }
+    void unlink() {
+        m_prev->m_next = m_next;
+        m_next->m_prev = m_prev;
+        m_next = m_prev = NULL;
+    }
+public:
+    wheel_timer()
+        : m_next(NULL), m_prev(NULL), m_wheel(NULL), m_expires(0), m_fn(NULL), m_obj(NULL)
+    {}
+    ~wheel_timer() { cancel(); }
+
+    /// Call \a a_obj->Method() on expiration.
+    template <class T, void (T::*Method)()>
+    void bind(T* a_obj) { m_fn = &thunk<T, Method>; m_obj = a_obj; }
+
+    bool active() const { return m_next != NULL; }
+
+    inline void cancel();
+};
+
+/**
+ * \brief Hierarchical timer wheel.
+ * Time is divided into ticks of a fixed resolution.  Level 0 has a slot
+ * per tick for the next s_slots ticks, every next level has a slot per
+ * s_slots ticks of the level below.  When the lower level wraps around, a
+ * slot of the level above is cascaded down.  Scheduling and cancelling
+ * are O(1) and expiring a tick costs only the timers that fire or
+ * cascade, so connections can rearm heartbeat and resend timeouts on
+ * every message without a system call.  Timers beyond the range of the
+ * top level are parked in it and rescheduled when cascaded.
+ */
+class timer_wheel: boost::noncopyable {
+public:
+    static const int s_bits   = 6;
+    static const int s_slots  = 1 << s_bits;
+    static const int s_levels = 4;
+
+    /// Create a wheel with ticks of \a a_tick_ns nanoseconds starting at
+    /// time \a a_now (ns).
+    timer_wheel(uint64_t a_tick_ns, uint64_t a_now)
+        : m_tick_ns(a_tick_ns), m_tick(a_now / a_tick_ns), m_count(0)
+    {
+        for (int l = 0; l < s_levels; ++l)
+            for (int i = 0; i < s_slots; ++i)
+                m_slots[l][i].m_next = m_slots[l][i].m_prev = &m_slots[l][i];
+    }
+
+    ~timer_wheel() {
+        for (int l = 0; l < s_levels; ++l)
+            for (int i = 0; i < s_slots; ++i) {
+                wheel_timer& head = m_slots[l][i];
+                while (head.m_next != &head)
+                    head.m_next->unlink();
+                head.m_next = head.m_prev = NULL;
+            }
+    }
+
+    uint64_t tick_ns()  const { return m_tick_ns; }
+    /// Number of scheduled timers.
+    size_t   size()     const { return m_count; }
+
+    /// Schedule \a a_timer to expire at time \a a_expires (ns).  Expiry
+    /// is rounded up to a tick and is never earlier than the next tick.
+    void schedule(wheel_timer& a_timer, uint64_t a_expires) {
+        a_timer.cancel();
+        uint64_t tick = (a_expires + m_tick_ns - 1) / m_tick_ns;
+        a_timer.m_expires = tick > m_tick ? tick : m_tick + 1;
+        a_timer.m_wheel   = this;
+        insert(a_timer);
+        m_count++;
+    }
+
+    /// Expire timers due by time \a a_now (ns).
+    /// @return number of timers fired.
+    size_t advance(uint64_t a_now) {
+        uint64_t target = a_now / m_tick_ns;
+        size_t   fired  = 0;
+        while (m_tick < target) {
+            if (!m_count) {
+                m_tick = target;
+                break;
+            }
+            ++m_tick;
+            // Cascade the slots of upper levels reached by this tick
+            for (int l = 1; l < s_levels; ++l) {
+                if (m_tick & ((1ull << (s_bits * l)) - 1))
+                    break;
+                cascade(m_slots[l][(m_tick >> (s_bits * l)) & (s_slots - 1)]);
+            }
+            // Detach the slot, so callbacks may schedule timers freely
+            wheel_timer& slot = m_slots[0][m_tick & (s_slots - 1)];
+            if (slot.m_next == &slot)
+                continue;
+            wheel_timer due;
+            due.m_next = slot.m_next;
+            due.m_prev = slot.m_prev;
+            due.m_next->m_prev = due.m_prev->m_next = &due;
+            slot.m_next = slot.m_prev = &slot;
+            while (due.m_next != &due) {
+                wheel_timer* t = due.m_next;
+                t->unlink();
+                m_count--;
+                fired++;
+                t->m_fn(t->m_obj);
+            }
+            due.m_next = due.m_prev = NULL;
+        }
+        return fired;
+    }
+
+    /// Time (ns) of the next tick that has to be processed by advance(),
+    /// or 0 if no timers are scheduled.  Event loops should wake up no
+    /// later than that.
+    uint64_t next_expiry() const {
+        if (!m_count)
+            return 0;
+        for (uint64_t t = m_tick + 1; t <= m_tick + s_slots; ++t) {
+            const wheel_timer& slot = m_slots[0][t & (s_slots - 1)];
+            if (slot.m_next != &slot)
+                return t * m_tick_ns;
+            if (!(t & (s_slots - 1)))
+                return t * m_tick_ns;   // Cascade point of upper levels
+        }
+        return (m_tick + s_slots) * m_tick_ns;
+    }
+
+private:
+    friend class wheel_timer;
+
+    uint64_t    m_tick_ns;
+    uint64_t    m_tick;             // Last processed tick
+    size_t      m_count;
+    wheel_timer m_slots[s_levels][s_slots];
+
+    void insert(wheel_timer& a_timer) {
+        uint64_t expires = a_timer.m_expires;
+        uint64_t delta   = expires > m_tick ? expires - m_tick : 0;
+        int      l       = 0;
+        while (l < s_levels - 1 && delta >= (1ull << (s_bits * (l + 1))))
+            ++l;
+        if (delta >= (1ull << (s_bits * s_levels)))
+            expires = m_tick + (1ull << (s_bits * s_levels)) - 1;
+        a_timer.link(&m_slots[l][(expires >> (s_bits * l)) & (s_slots - 1)]);
+    }
+
+    void cascade(wheel_timer& a_slot) {
+        while (a_slot.m_next != &a_slot) {
+            wheel_timer* t = a_slot.m_next;
+            t->unlink();
+            insert(*t);
+        }
+    }
+};
+
+inline void wheel_timer::cancel() {
+    if (!m_next)
+        return;
+    unlink();
+    m_wheel->m_count--;
+}
+
+} // namespace replog
+
+#endif // _REPLOG_TIMER_WHEEL_HPP_
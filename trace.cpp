@@ -0,0 +1,163 @@
+//----------------------------------------------------------------------------
+/// \file  trace.cpp
+//----------------------------------------------------------------------------
+/// \brief Implementation of the message lifecycle trace.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#include <replog/trace.hpp>
+#include <pthread.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+namespace replog {
+
+bool   tracer::s_enabled = false;
+size_t tracer::ring_size = 64 * 1024;
+
+namespace {
+
+    pthread_mutex_t          s_lock = PTHREAD_MUTEX_INITIALIZER;
+    std::vector<trace_ring*> s_rings;   // Rings outlive their threads
+    __thread trace_ring*     t_ring;
+
+    uint64_t now_ns() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+    }
+
+} // namespace
+
+const char* trace_event_name(int a_event)
+{
+    switch (a_event) {
+        case TRACE_SOURCE_READ: return "source_read";
+        case TRACE_ENCODE:      return "encode";
+        case TRACE_SEND:        return "send";
+        case TRACE_RECV:        return "recv";
+        case TRACE_DECODE:      return "decode";
+        case TRACE_WRITE:       return "write";
+        case TRACE_FSYNC:       return "fsync";
+        default:                return "unknown";
+    }
+}
+
+void trace_ring::snapshot(std::vector<trace_record>& a_out) const
+{
+    uint64_t head  = written();
+    uint64_t begin = head > capacity() ? head - capacity() : 0;
+    size_t   first = a_out.size();
+    for (uint64_t i = begin; i < head; ++i)
+        a_out.push_back(m_records[i & m_mask]);
+
+    // Drop records the writer may have overwritten while we were copying,
+    // including the slot of record `now` it may be writing at the moment.
+    // The fence orders the copy before the re-read of the head.
+    atomic::fence();
+    uint64_t cutoff = written() + 1;
+    if (cutoff > capacity() && cutoff - capacity() > begin) {
+        size_t n = std::min(head, cutoff - capacity()) - begin;
+        a_out.erase(a_out.begin() + first, a_out.begin() + first + n);
+    }
+}
+
+trace_ring& tracer::thread_ring()
+{
+    if (__builtin_expect(t_ring != NULL, 1))
+        return *t_ring;
+    pthread_mutex_lock(&s_lock);
+    t_ring = new trace_ring(ring_size, s_rings.size());
+    s_rings.push_back(t_ring);
+    pthread_mutex_unlock(&s_lock);
+    return *t_ring;
+}
+
+uint64_t tracer::tsc_hz()
+{
+    static uint64_t s_hz;
+    if (s_hz)
+        return s_hz;
+    uint64_t t0 = now_ns(), c0 = rdtsc();
+    usleep(20000);
+    uint64_t t1 = now_ns(), c1 = rdtsc();
+    s_hz = (uint64_t)((c1 - c0) * 1e9 / (t1 - t0));
+    return s_hz;
+}
+
+size_t tracer::dump(const std::string& a_filename) throw(io_error)
+{
+    std::vector<trace_record> records;
+    pthread_mutex_lock(&s_lock);
+    for (size_t i = 0; i < s_rings.size(); ++i)
+        s_rings[i]->snapshot(records);
+    pthread_mutex_unlock(&s_lock);
+
+    FILE* f = fopen(a_filename.c_str(), "w");
+    if (!f)
+        throw io_error(errno, a_filename.c_str());
+    trace_file_header h;
+    h.magic   = trace_file_header::s_magic;
+    h.version = 1;
+    h.tsc_hz  = tsc_hz();
+    h.count   = records.size();
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1
+           && (records.empty() ||
+               fwrite(&records[0], sizeof(trace_record), records.size(), f) == records.size());
+    if (fclose(f) != 0 || !ok)
+        throw io_error(errno, a_filename.c_str());
+    return records.size();
+}
+
+void tracer::load(const std::string& a_filename, trace_file_header& a_header,
+    std::vector<trace_record>& a_records) throw(io_error)
+{
+    FILE* f = fopen(a_filename.c_str(), "r");
+    if (!f)
+        throw io_error(errno, a_filename.c_str());
+    if (fread(&a_header, sizeof(a_header), 1, f) != 1
+     || a_header.magic != trace_file_header::s_magic) {
+        fclose(f);
+        throw io_error("Invalid trace file:", a_filename);
+    }
+    struct stat st;
+    if (fstat(fileno(f), &st) < 0 || (uint64_t)st.st_size < sizeof(a_header)
+     || a_header.count != (st.st_size - sizeof(a_header)) / sizeof(trace_record)) {
+        fclose(f);
+        throw io_error("Truncated trace file:", a_filename);
+    }
+    a_records.resize(a_header.count);
+    size_t n = a_records.empty() ? 0
+             : fread(&a_records[0], sizeof(trace_record), a_records.size(), f);
+    fclose(f);
+    if (n != a_records.size())
+        throw io_error("Truncated trace file:", a_filename);
+}
+
+} // namespace replog
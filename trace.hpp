@@ -0,0 +1,179 @@
+//----------------------------------------------------------------------------
+/// \file  trace.hpp
+//----------------------------------------------------------------------------
+/// \brief Low-overhead binary event trace of the message lifecycle.
+/// Every thread records time-stamped events into its own lock-free ring.
+/// The rings are dumped to a file that replog_trace turns into per-chunk
+/// timelines.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _REPLOG_TRACE_HPP_
+#define _REPLOG_TRACE_HPP_
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include <time.h>
+#include <boost/noncopyable.hpp>
+#include <replog/error.hpp>
+#include <replog/atomic.hpp>
+
+namespace replog {
+
+/// Read the CPU time stamp counter (CLOCK_MONOTONIC ns on non-x86 CPUs).
+inline uint64_t rdtsc() {
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t lo, hi;
+    asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+#else
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
+/// Stages of a chunk's life from the source file to the destination disk.
+enum trace_event {
+      TRACE_SOURCE_READ = 1
+    , TRACE_ENCODE
+    , TRACE_SEND
+    , TRACE_RECV
+    , TRACE_DECODE
+    , TRACE_WRITE
+    , TRACE_FSYNC
+};
+
+const char* trace_event_name(int a_event);
+
+/// Trace record, keyed by file id and source offset of the chunk.
+struct trace_record {
+    uint64_t tsc;
+    uint64_t src_offset;
+    uint32_t id;
+    uint32_t len;
+    uint16_t event;
+    uint16_t thread;
+    uint32_t pad;
+};
+
+/// Header of a trace dump file, followed by count records.
+struct trace_file_header {
+    static const uint32_t s_magic = 0x52504c54; // "RPLT"
+
+    uint32_t magic;
+    uint32_t version;
+    uint64_t tsc_hz;
+    uint64_t count;
+};
+
+/**
+ * \brief Fixed-size ring of trace records written by a single thread.
+ * When the ring is full the oldest records are overwritten.
+ */
+class trace_ring: boost::noncopyable {
+    std::vector<trace_record> m_records;
+    uint64_t                  m_mask;
+    uint64_t                  m_head;   // Total number of records written
+    uint16_t                  m_thread;
+public:
+    /// @param a_size number of records (rounded up to a power of two).
+    trace_ring(size_t a_size, uint16_t a_thread)
+        : m_head(0), m_thread(a_thread)
+    {
+        size_t n = 1;
+        while (n < a_size) n <<= 1;
+        m_records.resize(n);
+        m_mask = n - 1;
+    }
+
+    void record(trace_event a_event, uint32_t a_id, uint64_t a_src_offset, uint32_t a_len) {
+        uint64_t      h = m_head;
+        trace_record& r = m_records[h & m_mask];
+        r.tsc        = rdtsc();
+        r.src_offset = a_src_offset;
+        r.id         = a_id;
+        r.len        = a_len;
+        r.event      = a_event;
+        r.thread     = m_thread;
+        atomic::store_release(m_head, h + 1);
+    }
+
+    size_t   capacity() const { return m_records.size(); }
+    uint64_t written()  const { return atomic::load_acquire(m_head); }
+
+    /// Append records currently held by the ring to \a a_out, oldest first.
+    /// Records that are or may be being overwritten while copying are
+    /// skipped, so a wrapped ring yields at most capacity() - 1 records.
+    void snapshot(std::vector<trace_record>& a_out) const;
+};
+
+/**
+ * \brief Process-wide trace control.
+ * Tracing is off by default and can be switched at run-time with
+ * enable().  When it's off, REPLOG_TRACE costs a load of a global flag
+ * and a well-predicted branch.
+ */
+class tracer {
+    static bool s_enabled;
+public:
+    /// Number of records in each per-thread ring.
+    static size_t ring_size;
+
+    static bool enabled()           { return atomic::load_relaxed(s_enabled); }
+    static void enable(bool a_on)   { atomic::store_relaxed(s_enabled, a_on); }
+
+    /// Return the ring of the calling thread, creating it on first use.
+    static trace_ring& thread_ring();
+
+    static void record(trace_event a_event, uint32_t a_id, uint64_t a_src_offset,
+                       uint32_t a_len = 0) {
+        thread_ring().record(a_event, a_id, a_src_offset, a_len);
+    }
+
+    /// Estimated frequency of the time stamp counter.
+    static uint64_t tsc_hz();
+
+    /// Write records of all threads to \a a_filename.
+    /// @return number of records written.
+    static size_t dump(const std::string& a_filename) throw(io_error);
+
+    /// Read records from a file created by dump().
+    static void load(const std::string& a_filename, trace_file_header& a_header,
+                     std::vector<trace_record>& a_records) throw(io_error);
+};
+
+} // namespace replog
+
+#define REPLOG_TRACE(Event, Id, SrcOffset, Len)                             \
+    do {                                                                    \
+        if (__builtin_expect(::replog::tracer::enabled(), 0))               \
+            ::replog::tracer::record((Event), (Id), (SrcOffset), (Len));    \
+    } while (0)
+
+#endif // _REPLOG_TRACE_HPP_
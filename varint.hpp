@@ -0,0 +1,159 @@
+//----------------------------------------------------------------------------
+/// \file  varint.hpp
+//----------------------------------------------------------------------------
+/// \brief Variable-length integer encoding (LEB128) with a branch-light
+/// SWAR decoder and SSE2-assisted decoding of consecutive integers.
+//----------------------------------------------------------------------------
+// Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-19
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the REPLOG project.
+
+Copyright (C) 2010 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#ifndef _REPLOG_VARINT_HPP_
+#define _REPLOG_VARINT_HPP_
+
+#include <stdint.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace replog {
+
+static const size_t s_max_varint_size = 10;
+
+/// Map signed integers to unsigned so that small magnitudes encode short.
+inline uint64_t zigzag_encode(int64_t n)  { return ((uint64_t)n << 1) ^ (uint64_t)(n >> 63); }
+inline int64_t  zigzag_decode(uint64_t n) { return (int64_t)(n >> 1) ^ -(int64_t)(n & 1); }
+
+/// Number of bytes needed to encode \a n.
+inline size_t varint_size(uint64_t n) {
+    int bits = 64 - __builtin_clzll(n | 1);
+    return (bits + 6) / 7;
+}
+
+/// Encode \a n at \a s and advance \a s past the encoded bytes.
+inline void put_varint(char*& s, uint64_t n) {
+    while (n >= 0x80) {
+        *s++ = (char)(n | 0x80);
+        n >>= 7;
+    }
+    *s++ = (char)n;
+}
+
+namespace detail {
+
+    /// Squeeze the 7-bit groups of the first \a a_len (1..8) bytes of the
+    /// little-endian word \a x into an integer.
+    inline uint64_t varint_compact(uint64_t x, int a_len) {
+        x &= (~0ull >> (64 - 8 * a_len)) & 0x7f7f7f7f7f7f7f7full;
+        x = (x & 0x007f007f007f007full) | ((x & 0x7f007f007f007f00ull) >> 1);
+        x = (x & 0x00003fff00003fffull) | ((x & 0x3fff00003fff0000ull) >> 2);
+        x = (x & 0x000000000fffffffull) | ((x & 0x0fffffff00000000ull) >> 4);
+        return x;
+    }
+
+    inline uint64_t load_le64(const char* s) {
+        uint64_t x;
+        memcpy(&x, s, sizeof(x));
+    #if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        x = __builtin_bswap64(x);
+    #endif
+        return x;
+    }
+
+    /// Byte-at-a-time decoder used near the end of a buffer.
+    inline bool get_varint_slow(const char*& s, const char* a_end, uint64_t& a_val) {
+        uint64_t n = 0;
+        for (int shift = 0; s + shift / 7 < a_end && shift < 70; shift += 7) {
+            uint8_t b = s[shift / 7];
+            n |= (uint64_t)(b & 0x7f) << shift;
+            if (!(b & 0x80)) {
+                s    += shift / 7 + 1;
+                a_val = n;
+                return true;
+            }
+        }
+        return false;
+    }
+
+} // namespace detail
+
+/// Decode an integer at \a s and advance \a s past it.
+/// @return false if the buffer ending at \a a_end holds an incomplete value.
+inline bool get_varint(const char*& s, const char* a_end, uint64_t& a_val) {
+    // Single-byte values (small ids, deltas, line sizes) are the common case
+    if (s < a_end && !(*s & 0x80)) {
+        a_val = (uint8_t)*s++;
+        return true;
+    }
+    if (a_end - s >= 8) {
+        uint64_t x    = detail::load_le64(s);
+        uint64_t stop = ~x & 0x8080808080808080ull;
+        if (__builtin_expect(stop != 0, 1)) {
+            int len = (__builtin_ctzll(stop) >> 3) + 1;
+            a_val = detail::varint_compact(x, len);
+            s    += len;
+            return true;
+        }
+    }
+    return detail::get_varint_slow(s, a_end, a_val);
+}
+
+/// Decode \a n consecutive integers at \a s into \a a_vals.  With SSE2 the
+/// terminating bytes of all values within 16 bytes are located at once; for
+/// fewer than four values the scalar single-byte fast path is quicker.
+/// @return false if the buffer holds fewer than \a n complete values, in
+///         which case \a s is left unchanged.
+inline bool get_varints(const char*& s, const char* a_end, uint64_t* a_vals, int n) {
+    const char* p = s;
+    int i = 0;
+#ifdef __SSE2__
+    if (n >= 4 && a_end - p >= 16) {
+        __m128i  b     = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        uint32_t stops = ~_mm_movemask_epi8(b) & 0xFFFF;
+        int      start = 0;
+        for (; i < n && stops; ++i) {
+            int last = __builtin_ctz(stops);
+            int len  = last - start + 1;
+            if (len > 8 || a_end - (p + start) < 8)
+                break;
+            a_vals[i] = len == 1 ? (uint8_t)p[start]
+                      : detail::varint_compact(detail::load_le64(p + start), len);
+            start     = last + 1;
+            stops    &= stops - 1;
+        }
+        p += start;
+    }
+#endif
+    for (; i < n; ++i)
+        if (!get_varint(p, a_end, a_vals[i]))
+            return false;
+    s = p;
+    return true;
+}
+
+} // namespace replog
+
+#endif // _REPLOG_VARINT_HPP_